@@ -67,12 +67,24 @@
 #include "BulletCollision/Gimpact/btGImpactCollisionAlgorithm.h"
 #include "BulletCollision/Gimpact/btGImpactShape.h"
 
+#if BT_THREADSAFE
+#  include <algorithm>
+
+#  include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h"
+#  include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+#  include "LinearMath/btThreads.h"
+
+#  include "BLI_task.h"
+#endif
+
 struct rbDynamicsWorld {
   btDiscreteDynamicsWorld *dynamicsWorld;
   btDefaultCollisionConfiguration *collisionConfiguration;
   btDispatcher *dispatcher;
   btBroadphaseInterface *pairCache;
   btConstraintSolver *constraintSolver;
+  /* Solver for islands too large to be solved on a single thread, only used with threads. */
+  btConstraintSolver *constraintSolverMt;
   btOverlapFilterCallback *filterCallback;
 };
 struct rbRigidBody {
@@ -117,6 +129,261 @@ struct rbFilterCallback : public btOverlapFilterCallback {
   }
 };
 
+#if BT_THREADSAFE
+/* Number of threads Bullet may use, its per-thread storage is limited to #BT_MAX_THREAD_COUNT. */
+static int rb_threads_num()
+{
+  return btMin(BLI_task_scheduler_num_threads(), int(BT_MAX_THREAD_COUNT));
+}
+
+/* Runs Bullet's parallel loops on Blender's task scheduler. Ranges are always split into the
+ * same chunks and partial sums are added up in chunk order, so the result doesn't depend on
+ * which thread handled which chunk. */
+class rbTaskScheduler : public btITaskScheduler {
+ public:
+  rbTaskScheduler() : btITaskScheduler("Blender")
+  {
+  }
+
+  int getMaxNumThreads() const override
+  {
+    return BT_MAX_THREAD_COUNT;
+  }
+  int getNumThreads() const override
+  {
+    return rb_threads_num();
+  }
+  void setNumThreads(int /*numThreads*/) override
+  {
+    /* Defined by Blender's task scheduler. */
+  }
+
+  void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody &body) override
+  {
+    TaskData data = {iBegin, iEnd, btMax(grainSize, 1), &body, NULL, NULL};
+    run(&data, parallel_for_cb);
+  }
+
+  btScalar parallelSum(int iBegin,
+                       int iEnd,
+                       int grainSize,
+                       const btIParallelSumBody &body) override
+  {
+    TaskData data = {iBegin, iEnd, btMax(grainSize, 1), NULL, &body, NULL};
+    btAlignedObjectArray<btScalar> sums;
+    sums.resize(chunks_num(&data), btScalar(0));
+    data.sums = sums.size() ? &sums[0] : NULL;
+    run(&data, parallel_sum_cb);
+
+    btScalar sum = 0;
+    for (int i = 0; i < sums.size(); i++) {
+      sum += sums[i];
+    }
+    return sum;
+  }
+
+ private:
+  struct TaskData {
+    int begin, end, grain_size;
+    const btIParallelForBody *for_body;
+    const btIParallelSumBody *sum_body;
+    btScalar *sums;
+  };
+
+  static int chunks_num(const TaskData *data)
+  {
+    return btMax((data->end - data->begin + data->grain_size - 1) / data->grain_size, 0);
+  }
+
+  static void run(TaskData *data, TaskParallelRangeFunc func)
+  {
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    BLI_task_parallel_range(0, chunks_num(data), data, func, &settings);
+  }
+
+  static void parallel_for_cb(void *__restrict userdata,
+                              const int chunk,
+                              const TaskParallelTLS *__restrict /*tls*/)
+  {
+    const TaskData *data = (const TaskData *)userdata;
+    const int begin = data->begin + chunk * data->grain_size;
+    data->for_body->forLoop(begin, btMin(begin + data->grain_size, data->end));
+  }
+
+  static void parallel_sum_cb(void *__restrict userdata,
+                              const int chunk,
+                              const TaskParallelTLS *__restrict /*tls*/)
+  {
+    const TaskData *data = (const TaskData *)userdata;
+    const int begin = data->begin + chunk * data->grain_size;
+    data->sums[chunk] = data->sum_body->sumLoop(begin,
+                                                btMin(begin + data->grain_size, data->end));
+  }
+};
+
+/* Collision dispatcher running the narrow phase of all overlapping pairs in parallel.
+ *
+ * Contact manifolds created during the parallel loop end up in the order the threads created
+ * them in, which would make the order constraints are solved in (and so the result) differ from
+ * run to run. New manifolds are sorted by their bodies afterwards, and manifolds released during
+ * the loop are only removed once it finished, in a fixed order.
+ *
+ * GImpact shapes lock their child shapes with a counter that isn't atomic while colliding, so
+ * pairs with such a shape are handled after the parallel loop, on the calling thread. */
+class rbCollisionDispatcherMt : public btCollisionDispatcher {
+ public:
+  rbCollisionDispatcherMt(btCollisionConfiguration *config)
+      : btCollisionDispatcher(config), m_batchUpdating(false)
+  {
+  }
+
+  btPersistentManifold *getNewManifold(const btCollisionObject *body0,
+                                       const btCollisionObject *body1) override
+  {
+    if (!m_batchUpdating) {
+      return btCollisionDispatcher::getNewManifold(body0, body1);
+    }
+    m_mutex.lock();
+    btPersistentManifold *manifold = btCollisionDispatcher::getNewManifold(body0, body1);
+    m_mutex.unlock();
+    return manifold;
+  }
+
+  void releaseManifold(btPersistentManifold *manifold) override
+  {
+    if (!m_batchUpdating) {
+      btCollisionDispatcher::releaseManifold(manifold);
+      return;
+    }
+    m_mutex.lock();
+    m_releasedManifolds.push_back(manifold);
+    m_mutex.unlock();
+  }
+
+  void dispatchAllCollisionPairs(btOverlappingPairCache *pairCache,
+                                 const btDispatcherInfo &info,
+                                 btDispatcher * /*dispatcher*/) override
+  {
+    const int pairs_num = pairCache->getNumOverlappingPairs();
+    if (pairs_num == 0) {
+      return;
+    }
+
+    NearCallbackBody body;
+    body.pairs = pairCache->getOverlappingPairArrayPtr();
+    body.callback = getNearCallback();
+    body.dispatcher = this;
+    body.info = &info;
+
+    const int manifolds_num = m_manifoldsPtr.size();
+    m_batchUpdating = true;
+    btParallelFor(0, pairs_num, 40, body);
+    for (int i = 0; i < pairs_num; i++) {
+      if (pair_uses_gimpact(body.pairs[i])) {
+        body.callback(body.pairs[i], *this, info);
+      }
+    }
+    m_batchUpdating = false;
+
+    /* All manifolds of one pair are created by the same thread, a stable sort keeps them in the
+     * order they were created in. */
+    if (m_manifoldsPtr.size() > manifolds_num) {
+      btPersistentManifold **manifolds = &m_manifoldsPtr[0];
+      std::stable_sort(manifolds + manifolds_num,
+                       manifolds + m_manifoldsPtr.size(),
+                       manifold_bodies_less);
+      for (int i = manifolds_num; i < m_manifoldsPtr.size(); i++) {
+        m_manifoldsPtr[i]->m_index1a = i;
+      }
+    }
+
+    if (m_releasedManifolds.size()) {
+      /* Releasing moves the last manifold into the freed slot, go from the back so the result
+       * only depends on which manifolds were released. */
+      btPersistentManifold **manifolds = &m_releasedManifolds[0];
+      std::sort(manifolds, manifolds + m_releasedManifolds.size(), manifold_index_greater);
+      for (int i = 0; i < m_releasedManifolds.size(); i++) {
+        btCollisionDispatcher::releaseManifold(m_releasedManifolds[i]);
+      }
+      m_releasedManifolds.resizeNoInitialize(0);
+    }
+  }
+
+ private:
+  struct NearCallbackBody : public btIParallelForBody {
+    btBroadphasePair *pairs;
+    btNearCallback callback;
+    btCollisionDispatcher *dispatcher;
+    const btDispatcherInfo *info;
+
+    void forLoop(int iBegin, int iEnd) const override
+    {
+      for (int i = iBegin; i < iEnd; i++) {
+        if (!pair_uses_gimpact(pairs[i])) {
+          callback(pairs[i], *dispatcher, *info);
+        }
+      }
+    }
+  };
+
+  static bool shape_uses_gimpact(const btCollisionShape *shape)
+  {
+    if (shape->getShapeType() == GIMPACT_SHAPE_PROXYTYPE) {
+      return true;
+    }
+    if (shape->isCompound()) {
+      const btCompoundShape *compound = (const btCompoundShape *)shape;
+      for (int i = 0; i < compound->getNumChildShapes(); i++) {
+        if (shape_uses_gimpact(compound->getChildShape(i))) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  static bool pair_uses_gimpact(const btBroadphasePair &pair)
+  {
+    const btCollisionObject *ob0 = (const btCollisionObject *)pair.m_pProxy0->m_clientObject;
+    const btCollisionObject *ob1 = (const btCollisionObject *)pair.m_pProxy1->m_clientObject;
+    return shape_uses_gimpact(ob0->getCollisionShape()) ||
+           shape_uses_gimpact(ob1->getCollisionShape());
+  }
+
+  static bool manifold_bodies_less(const btPersistentManifold *a, const btPersistentManifold *b)
+  {
+    const int a0 = a->getBody0()->getWorldArrayIndex(), b0 = b->getBody0()->getWorldArrayIndex();
+    if (a0 != b0) {
+      return a0 < b0;
+    }
+    return a->getBody1()->getWorldArrayIndex() < b->getBody1()->getWorldArrayIndex();
+  }
+
+  static bool manifold_index_greater(const btPersistentManifold *a,
+                                     const btPersistentManifold *b)
+  {
+    return a->m_index1a > b->m_index1a;
+  }
+
+  bool m_batchUpdating;
+  btSpinMutex m_mutex;
+  btAlignedObjectArray<btPersistentManifold *> m_releasedManifolds;
+};
+
+static void rb_task_scheduler_ensure()
+{
+  /* Bullet requires the scheduler to be set from the first thread that used it, which is the
+   * thread creating the first world. */
+  static rbTaskScheduler *scheduler = []() {
+    rbTaskScheduler *scheduler = new rbTaskScheduler();
+    btSetTaskScheduler(scheduler);
+    return scheduler;
+  }();
+  (void)scheduler;
+}
+#endif
+
 static inline void copy_v3_btvec3(float vec[3], const btVector3 &btvec)
 {
   vec[0] = (float)btvec[0];
@@ -136,14 +403,28 @@ static inline void copy_quat_btquat(float quat[4], const btQuaternion &btquat)
 
 /* Setup ---------------------------- */
 
-rbDynamicsWorld *RB_dworld_new(const float gravity[3])
+rbDynamicsWorld *RB_dworld_new(const float gravity[3], int use_threads)
 {
   rbDynamicsWorld *world = new rbDynamicsWorld;
 
+#if BT_THREADSAFE
+  rb_task_scheduler_ensure();
+#else
+  (void)use_threads;
+#endif
+
   /* collision detection/handling */
   world->collisionConfiguration = new btDefaultCollisionConfiguration();
 
-  world->dispatcher = new btCollisionDispatcher(world->collisionConfiguration);
+#if BT_THREADSAFE
+  if (use_threads) {
+    world->dispatcher = new rbCollisionDispatcherMt(world->collisionConfiguration);
+  }
+  else
+#endif
+  {
+    world->dispatcher = new btCollisionDispatcher(world->collisionConfiguration);
+  }
   btGImpactCollisionAlgorithm::registerAlgorithm((btCollisionDispatcher *)world->dispatcher);
 
   world->pairCache = new btDbvtBroadphase();
@@ -151,12 +432,34 @@ rbDynamicsWorld *RB_dworld_new(const float gravity[3])
   world->filterCallback = new rbFilterCallback();
   world->pairCache->getOverlappingPairCache()->setOverlapFilterCallback(world->filterCallback);
 
-  /* constraint solving */
-  world->constraintSolver = new btSequentialImpulseConstraintSolver();
-
-  /* world */
-  world->dynamicsWorld = new btDiscreteDynamicsWorld(
-      world->dispatcher, world->pairCache, world->constraintSolver, world->collisionConfiguration);
+  world->constraintSolverMt = NULL;
+
+#if BT_THREADSAFE
+  if (use_threads) {
+    /* Islands are solved in parallel by a pool of solvers, large islands are split up by the
+     * multi-threaded solver. */
+    btConstraintSolverPoolMt *solver_pool = new btConstraintSolverPoolMt(rb_threads_num());
+    world->constraintSolver = solver_pool;
+    world->constraintSolverMt = new btSequentialImpulseConstraintSolverMt();
+
+    world->dynamicsWorld = new btDiscreteDynamicsWorldMt(world->dispatcher,
+                                                         world->pairCache,
+                                                         solver_pool,
+                                                         world->constraintSolverMt,
+                                                         world->collisionConfiguration);
+  }
+  else
+#endif
+  {
+    /* constraint solving */
+    world->constraintSolver = new btSequentialImpulseConstraintSolver();
+
+    /* world */
+    world->dynamicsWorld = new btDiscreteDynamicsWorld(world->dispatcher,
+                                                       world->pairCache,
+                                                       world->constraintSolver,
+                                                       world->collisionConfiguration);
+  }
 
   RB_dworld_set_gravity(world, gravity);
 
@@ -168,6 +471,7 @@ void RB_dworld_delete(rbDynamicsWorld *world)
   /* bullet doesn't like if we free these in a different order */
   delete world->dynamicsWorld;
   delete world->constraintSolver;
+  delete world->constraintSolverMt;
   delete world->pairCache;
   delete world->dispatcher;
   delete world->collisionConfiguration;
@@ -132,6 +132,7 @@ const UserDef U_default = {
 
     .prefetchframes = 0,
     .pad_rot_angle = 15,
+    .volume_cache_limit = 1024,
     .rvisize = 25,
     .rvibright = 8,
     .recent_files = 10,
@@ -48,6 +48,7 @@ typedef struct BoidBrainData {
 } BoidBrainData;
 
 void boids_precalc_rules(struct ParticleSettings *part, float cfra);
+bool boids_rules_thread_safe(const BoidSettings *boids);
 void boid_brain(BoidBrainData *bbd, int p, struct ParticleData *pa);
 void boid_body(BoidBrainData *bbd, struct ParticleData *pa);
 void boid_default_settings(BoidSettings *boids);
@@ -88,8 +88,11 @@ typedef struct Cloth {
   short pad3;
   struct BVHTree *bvhtree;     /* collision tree for this cloth object */
   struct BVHTree *bvhselftree; /* collision tree for this cloth object */
+  struct ClothSelfCollisionCache *selfcoll_cache; /* overlaps of bvhselftree between steps */
   struct MVertTri *tri;
   struct Implicit_Data *implicit; /* our implicit solver connects to this pointer */
+  /* Springs grouped in batches without shared vertices, for parallel force evaluation. */
+  struct ClothSpringBatches *spring_batches;
   struct EdgeSet *edgeset;        /* used for selfcollisions */
   int last_frame;
   float initial_mesh_volume;      /* Initial volume of the mesh. Used for pressure */
@@ -271,6 +274,7 @@ int cloth_bvh_collision(struct Depsgraph *depsgraph,
                         struct ClothModifierData *clmd,
                         float step,
                         float dt);
+void cloth_bvh_selfcollision_cache_free(struct Cloth *cloth);
 
 ////////////////////////////////////////////////
 
@@ -291,6 +295,10 @@ void clothModifier_do(struct ClothModifierData *clmd,
 
 int cloth_uses_vgroup(struct ClothModifierData *clmd);
 
+/* The self collision tree is built with a margin this many times the self collision distance,
+ * so that its overlaps can be reused until the vertices move further than the extra margin. */
+#define CLOTH_SELFCOLL_MARGIN_FAC 2.0f
+
 // needed for collision.c
 void bvhtree_update_from_cloth(struct ClothModifierData *clmd, bool moving, bool self);
 
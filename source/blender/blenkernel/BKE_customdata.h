@@ -70,7 +70,11 @@ typedef enum eCDAllocType {
   CD_CALLOC = 1,
   /** Allocate and set to default. */
   CD_DEFAULT = 2,
-  /** Use data pointers, set layer flag NOFREE. */
+  /**
+   * Use data pointers, set layer flag NOFREE. When copying from a layer made shareable with
+   * #CustomData_ensure_shareable_layers() the data stays valid until the last layer using it is
+   * freed, otherwise only for as long as the source lives.
+   */
   CD_REFERENCE = 3,
   /** Do a full copy of all layers, only allowed if source has same number of elements. */
   CD_DUPLICATE = 4,
@@ -137,6 +141,13 @@ void CustomData_copy(const struct CustomData *source,
                      eCDAllocType alloctype,
                      int totelem);
 
+/**
+ * Reference count the data owned by the layers of \a data, so #CD_REFERENCE copies made from it
+ * afterwards keep the data alive when \a data is freed first. This writes run-time sharing info
+ * into the layers, it is thread-safe.
+ */
+void CustomData_ensure_shareable_layers(struct CustomData *data);
+
 /* BMESH_TODO, not really a public function but readfile.c needs it */
 void CustomData_update_typemap(struct CustomData *data);
 
@@ -219,6 +230,7 @@ int CustomData_number_of_layers(const struct CustomData *data, int type);
 int CustomData_number_of_layers_typemask(const struct CustomData *data, CustomDataMask mask);
 
 /* duplicate data of a layer with flag NOFREE, and remove that flag.
+ * When the layer is the last user of shared data, it takes ownership without copying.
  * returns the layer data */
 void *CustomData_duplicate_referenced_layer(struct CustomData *data,
                                             const int type,
@@ -373,7 +385,9 @@ void CustomData_bmesh_set_n(
  */
 void CustomData_bmesh_set_layer_n(struct CustomData *data, void *block, int n, const void *source);
 
-/* set the pointer of to the first layer of type. the old data is not freed.
+/* set the pointer of to the first layer of type. the old data is not freed,
+ * unless it was shared and this layer was its last user. Shared data is owned by its users,
+ * so use #CustomData_duplicate_referenced_layer first when the caller frees the old data.
  * returns the value of ptr if the layer is found, NULL otherwise
  */
 void *CustomData_set_layer(const struct CustomData *data, int type, void *ptr);
@@ -138,6 +138,23 @@ void BKE_defvert_extract_vgroup_to_vertweights(struct MDeformVert *dvert,
                                                const int num_verts,
                                                float *r_weights,
                                                const bool invert_vgroup);
+void BKE_defvert_extract_vgroup_dense(const struct MDeformVert *dvert,
+                                      const int defgroup,
+                                      const int num,
+                                      const int *indices,
+                                      const float default_weight,
+                                      float *r_weights,
+                                      struct MDeformWeight **r_dws);
+void BKE_defvert_apply_vgroup_weights(struct MDeformVert *dvert,
+                                      const int defgroup,
+                                      struct MDeformWeight **dws,
+                                      const int num,
+                                      const int *indices,
+                                      const float *weights,
+                                      const bool do_add,
+                                      const float add_thresh,
+                                      const bool do_rem,
+                                      const float rem_thresh);
 void BKE_defvert_extract_vgroup_to_edgeweights(struct MDeformVert *dvert,
                                                const int defgroup,
                                                const int num_verts,
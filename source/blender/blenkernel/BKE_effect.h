@@ -131,6 +131,15 @@ void BKE_effectors_apply(struct ListBase *effectors,
                          float *force,
                          float *wind_force,
                          float *impulse);
+void BKE_effectors_apply_array(struct ListBase *effectors,
+                               struct ListBase *colliders,
+                               struct EffectorWeights *weights,
+                               struct EffectedPoint *points,
+                               const int points_num,
+                               float (*force)[3],
+                               float (*wind_force)[3],
+                               float (*impulse)[3]);
+bool BKE_effectors_use_noise(const struct ListBase *effectors);
 void BKE_effectors_free(struct ListBase *lb);
 
 void pd_point_from_particle(struct ParticleSimulationData *sim,
@@ -686,9 +686,12 @@ enum {
 };
 void BKE_mesh_batch_cache_dirty_tag(struct Mesh *me, int mode);
 void BKE_mesh_batch_cache_free(struct Mesh *me);
+void *BKE_mesh_batch_cache_detach(struct Mesh *me);
+void BKE_mesh_batch_cache_reuse(struct Mesh *me, void *batch_cache);
 
 extern void (*BKE_mesh_batch_cache_dirty_tag_cb)(struct Mesh *me, int mode);
 extern void (*BKE_mesh_batch_cache_free_cb)(struct Mesh *me);
+extern void (*BKE_mesh_batch_cache_reuse_cb)(struct Mesh *me, void *batch_cache);
 
 /* Inlines */
 
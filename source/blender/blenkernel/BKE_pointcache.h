@@ -109,6 +109,8 @@ typedef struct PTCacheData {
 
 typedef struct PTCacheFile {
   FILE *fp;
+  /* Set when the frame is stored in a single file container. */
+  struct PTCacheContainer *container;
 
   int frame, old_format;
   unsigned int totpoint, type;
@@ -360,6 +362,12 @@ void BKE_ptcache_quick_cache_all(struct Main *bmain,
 /* Bake cache or simulate to current frame with settings defined in the baker. */
 void BKE_ptcache_bake(struct PTCacheBaker *baker);
 
+/* Write disk cache frames on background threads until the writer ends, used while baking.
+ * Returns false when the writer is already running. */
+bool BKE_ptcache_writer_begin(void);
+/* Wait for the queued frames to be written and stop the writer threads. */
+void BKE_ptcache_writer_end(void);
+
 /* Convert disk cache to memory cache. */
 void BKE_ptcache_disk_to_mem(struct PTCacheID *pid);
 
@@ -369,6 +377,9 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Move disk cache frames between separate files and a single file, after changing the flag. */
+void BKE_ptcache_toggle_single_file(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid,
                                    const char *name_src,
@@ -859,6 +859,72 @@ static void mesh_calc_finalize(const Mesh *mesh_input, Mesh *mesh_eval)
   mesh_eval->edit_mesh = mesh_input->edit_mesh;
 }
 
+/* Apply deformed positions to a mesh, unless they are what the mesh already has. Deformers often
+ * leave positions untouched (no influence, rest pose), skipping the write then keeps the vertex
+ * array shared with the input mesh and its normals valid, so they are not recomputed. */
+static void mesh_vert_coords_apply_if_changed(Mesh *mesh, const float (*vert_coords)[3])
+{
+  const MVert *mv = mesh->mvert;
+  for (int i = 0; i < mesh->totvert; i++, mv++) {
+    if (!equals_v3v3(mv->co, vert_coords[i])) {
+      BKE_mesh_vert_coords_apply(mesh, vert_coords);
+      return;
+    }
+  }
+}
+
+/* Triangulation only depends on topology and positions, when the evaluated mesh still shares
+ * both with the input mesh, reuse the looptris the input mesh already computed. */
+static void mesh_looptri_reuse_from_input(const Mesh *mesh_input, Mesh *mesh_final)
+{
+  if (mesh_final->mvert == mesh_input->mvert && mesh_final->mloop == mesh_input->mloop &&
+      mesh_final->mpoly == mesh_input->mpoly) {
+    BKE_mesh_runtime_looptri_copy(mesh_final, mesh_input);
+  }
+}
+
+/* Get the mesh deform-only modifiers in a run of sequential deformers operate on.
+ *
+ * Deform-only modifiers get the float3 position buffer, only the ones depending on normals need
+ * those positions applied to a mesh. A single copy of the input mesh is used for the whole run, it
+ * references the topology and custom data layers of the input mesh, and only its vertex array
+ * gets duplicated (once) on the first write. */
+static Mesh *mesh_deform_run_ensure(Mesh *mesh_input,
+                                    Mesh **r_mesh_final,
+                                    const float (*deformed_verts)[3])
+{
+  if (*r_mesh_final == NULL) {
+    *r_mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
+    ASSERT_IS_VALID_MESH(*r_mesh_final);
+  }
+  mesh_vert_coords_apply_if_changed(*r_mesh_final, deformed_verts);
+  return *r_mesh_final;
+}
+
+/* Initialize original indices the first time we evaluate a constructive modifier. Modifiers
+ * will then do mapping mostly automatic by copying them through CustomData_copy_data along with
+ * other data. */
+static void mesh_origindex_layers_ensure(Mesh *mesh)
+{
+  if (!CustomData_has_layer(&mesh->vdata, CD_ORIGINDEX)) {
+    /* Not worth parallelizing this,
+     * gives less than 0.1% overall speedup in best of best cases... */
+    range_vn_i(CustomData_add_layer(&mesh->vdata, CD_ORIGINDEX, CD_CALLOC, NULL, mesh->totvert),
+               mesh->totvert,
+               0);
+  }
+  if (!CustomData_has_layer(&mesh->edata, CD_ORIGINDEX)) {
+    range_vn_i(CustomData_add_layer(&mesh->edata, CD_ORIGINDEX, CD_CALLOC, NULL, mesh->totedge),
+               mesh->totedge,
+               0);
+  }
+  if (!CustomData_has_layer(&mesh->pdata, CD_ORIGINDEX)) {
+    range_vn_i(CustomData_add_layer(&mesh->pdata, CD_ORIGINDEX, CD_CALLOC, NULL, mesh->totpoly),
+               mesh->totpoly,
+               0);
+  }
+}
+
 void BKE_mesh_wrapper_deferred_finalize(Mesh *me_eval,
                                         const CustomData_MeshMasks *cd_mask_finalize)
 {
@@ -972,11 +1038,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
           deformed_verts = BKE_mesh_vert_coords_alloc(mesh_input, &num_deformed_verts);
         }
         else if (isPrevDeform && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
-          if (mesh_final == NULL) {
-            mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
-            ASSERT_IS_VALID_MESH(mesh_final);
-          }
-          BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
+          mesh_deform_run_ensure(mesh_input, &mesh_final, deformed_verts);
         }
 
         BKE_modifier_deform_verts(md, &mectx, mesh_final, deformed_verts, num_deformed_verts);
@@ -1093,15 +1155,15 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       /* if this is not the last modifier in the stack then recalculate the normals
        * to avoid giving bogus normals to the next modifier see: [#23673] */
       else if (isPrevDeform && mti->dependsOnNormals && mti->dependsOnNormals(md)) {
-        if (mesh_final == NULL) {
-          mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
-          ASSERT_IS_VALID_MESH(mesh_final);
-        }
-        BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
+        mesh_deform_run_ensure(mesh_input, &mesh_final, deformed_verts);
       }
       BKE_modifier_deform_verts(md, &mectx, mesh_final, deformed_verts, num_deformed_verts);
     }
     else {
+      /* The first constructive modifier either gets the mesh of the preceding deform run, or a
+       * copy of the input mesh. In both cases topology and custom data are still shared with the
+       * input mesh. */
+      const bool is_first_constructive = !have_non_onlydeform_modifiers_appled;
       have_non_onlydeform_modifiers_appled = true;
 
       /* determine which data layers are needed by following modifiers */
@@ -1114,45 +1176,20 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
       }
 
       /* apply vertex coordinates or build a Mesh as necessary */
-      if (mesh_final) {
-        if (deformed_verts) {
-          BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
-        }
-      }
-      else {
+      if (mesh_final == NULL) {
         mesh_final = BKE_mesh_copy_for_eval(mesh_input, true);
         ASSERT_IS_VALID_MESH(mesh_final);
+      }
+      if (deformed_verts) {
+        mesh_vert_coords_apply_if_changed(mesh_final, deformed_verts);
+      }
 
-        if (deformed_verts) {
-          BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
-        }
-
-        /* Initialize original indices the first time we evaluate a
-         * constructive modifier. Modifiers will then do mapping mostly
-         * automatic by copying them through CustomData_copy_data along
-         * with other data.
-         *
-         * These are created when either requested by evaluation, or if
-         * following modifiers requested them. */
-        if (need_mapping ||
-            ((nextmask.vmask | nextmask.emask | nextmask.pmask) & CD_MASK_ORIGINDEX)) {
-          /* calc */
-          CustomData_add_layer(
-              &mesh_final->vdata, CD_ORIGINDEX, CD_CALLOC, NULL, mesh_final->totvert);
-          CustomData_add_layer(
-              &mesh_final->edata, CD_ORIGINDEX, CD_CALLOC, NULL, mesh_final->totedge);
-          CustomData_add_layer(
-              &mesh_final->pdata, CD_ORIGINDEX, CD_CALLOC, NULL, mesh_final->totpoly);
-
-          /* Not worth parallelizing this,
-           * gives less than 0.1% overall speedup in best of best cases... */
-          range_vn_i(
-              CustomData_get_layer(&mesh_final->vdata, CD_ORIGINDEX), mesh_final->totvert, 0);
-          range_vn_i(
-              CustomData_get_layer(&mesh_final->edata, CD_ORIGINDEX), mesh_final->totedge, 0);
-          range_vn_i(
-              CustomData_get_layer(&mesh_final->pdata, CD_ORIGINDEX), mesh_final->totpoly, 0);
-        }
+      /* Original indices are created when either requested by evaluation, or if following
+       * modifiers requested them. */
+      if (is_first_constructive &&
+          (need_mapping ||
+           ((nextmask.vmask | nextmask.emask | nextmask.pmask) & CD_MASK_ORIGINDEX))) {
+        mesh_origindex_layers_ensure(mesh_final);
       }
 
       /* set the Mesh to only copy needed data */
@@ -1301,7 +1338,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
     }
   }
   if (deformed_verts) {
-    BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
+    mesh_vert_coords_apply_if_changed(mesh_final, deformed_verts);
     MEM_freeN(deformed_verts);
     deformed_verts = NULL;
   }
@@ -1351,6 +1388,7 @@ static void mesh_calc_modifiers(struct Depsgraph *depsgraph,
   }
 
   if (is_own_mesh) {
+    mesh_looptri_reuse_from_input(mesh_input, mesh_final);
     mesh_calc_finalize(mesh_input, mesh_final);
   }
 
@@ -1766,6 +1804,13 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
    * they aren't cleaned up properly on mode switch, causing crashes, e.g T58150. */
   BLI_assert(ob->id.tag & LIB_TAG_COPIED_ON_WRITE);
 
+  /* Keep GPU buffers which don't depend on vertex positions for deforming meshes. */
+  void *batch_cache = NULL;
+  if (ob->runtime.data_eval && ob->runtime.is_data_eval_owned &&
+      GS(ob->runtime.data_eval->name) == ID_ME) {
+    batch_cache = BKE_mesh_batch_cache_detach((Mesh *)ob->runtime.data_eval);
+  }
+
   BKE_object_free_derived_caches(ob);
   if (DEG_is_active(depsgraph)) {
     BKE_sculpt_update_object_before_eval(ob);
@@ -1802,6 +1847,8 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
   Mesh *mesh = ob->data;
   const bool is_mesh_eval_owned = (mesh_eval != mesh->runtime.mesh_eval);
   BKE_object_eval_assign_data(ob, &mesh_eval->id, is_mesh_eval_owned);
+  /* A mesh which isn't owned can be shared between objects evaluated in parallel. */
+  BKE_mesh_batch_cache_reuse(is_mesh_eval_owned ? mesh_eval : NULL, batch_cache);
 
   ob->runtime.mesh_deform_eval = mesh_deform_eval;
   ob->runtime.last_data_mask = *dataMask;
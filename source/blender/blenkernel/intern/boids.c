@@ -427,7 +427,7 @@ static int rule_separate(BoidRule *UNUSED(rule),
   int ret = 0;
 
   if (neighbors > 1 && ptn[1].dist != 0.0f) {
-    sub_v3_v3v3(vec, pa->prev_state.co, bbd->sim->psys->particles[ptn[1].index].state.co);
+    sub_v3_v3v3(vec, pa->prev_state.co, bbd->sim->psys->particles[ptn[1].index].prev_state.co);
     mul_v3_fl(vec, (2.0f * val->personal_space * pa->size - ptn[1].dist) / ptn[1].dist);
     add_v3_v3(bbd->wanted_co, vec);
     bbd->wanted_speed = val->max_speed;
@@ -995,6 +995,19 @@ void boids_precalc_rules(ParticleSettings *part, float cfra)
     }
   }
 }
+/* Boids only read the previous state of other particles, except for the fight rule which
+ * damages the health of its enemies. Without it the brains can be evaluated in any order. */
+bool boids_rules_thread_safe(const BoidSettings *boids)
+{
+  LISTBASE_FOREACH (const BoidState *, state, &boids->states) {
+    LISTBASE_FOREACH (const BoidRule *, rule, &state->rules) {
+      if (rule->type == eBoidRuleType_Fight) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
 static void boid_climb(BoidSettings *boids,
                        ParticleData *pa,
                        float *surface_co,
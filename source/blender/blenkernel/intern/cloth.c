@@ -576,6 +576,8 @@ void cloth_free_modifier(ClothModifierData *clmd)
       BLI_bvhtree_free(cloth->bvhselftree);
     }
 
+    cloth_bvh_selfcollision_cache_free(cloth);
+
     // we save our faces for collision objects
     if (cloth->tri) {
       MEM_freeN(cloth->tri);
@@ -658,6 +660,8 @@ void cloth_free_modifier_extern(ClothModifierData *clmd)
       BLI_bvhtree_free(cloth->bvhselftree);
     }
 
+    cloth_bvh_selfcollision_cache_free(cloth);
+
     // we save our faces for collision objects
     if (cloth->tri) {
       MEM_freeN(cloth->tri);
@@ -926,7 +930,8 @@ static bool cloth_from_object(
   }
 
   clmd->clothObject->bvhtree = bvhtree_build_from_cloth(clmd, clmd->coll_parms->epsilon);
-  clmd->clothObject->bvhselftree = bvhtree_build_from_cloth(clmd, clmd->coll_parms->selfepsilon);
+  clmd->clothObject->bvhselftree = bvhtree_build_from_cloth(
+      clmd, clmd->coll_parms->selfepsilon * CLOTH_SELFCOLL_MARGIN_FAC);
 
   return true;
 }
@@ -74,6 +74,18 @@ typedef struct SelfColDetectData {
   bool collided;
 } SelfColDetectData;
 
+/* Overlapping triangles of the self collision tree, which is built with a wider margin than the
+ * self collision distance. The overlaps remain a superset of the triangle pairs within collision
+ * distance until a vertex moves further than the extra margin, so the tree only needs to be
+ * updated and queried again after that. */
+typedef struct ClothSelfCollisionCache {
+  BVHTreeOverlap *overlap;
+  uint overlap_num;
+  /* Vertex positions at the time of the overlap query. */
+  float (*co)[3];
+  bool sewing_active;
+} ClothSelfCollisionCache;
+
 /***********************************
  * Collision modifier code start
  ***********************************/
@@ -1061,34 +1073,36 @@ static void cloth_collision(void *__restrict userdata,
   }
 }
 
-static bool cloth_bvh_selfcollision_is_active(const Cloth *cloth,
-                                              const MVertTri *tri_a,
-                                              const MVertTri *tri_b,
-                                              bool sewing_active)
+/* Neighboring triangles and triangles connected by a sewing edge never collide. */
+static bool cloth_bvh_selfcollision_is_connected(const Cloth *cloth,
+                                                 const MVertTri *tri_a,
+                                                 const MVertTri *tri_b,
+                                                 bool sewing_active)
 {
-  const ClothVertex *verts = cloth->verts;
-  /* Ignore overlap of neighboring triangles and triangles connected by a sewing edge. */
   for (uint i = 0; i < 3; i++) {
     for (uint j = 0; j < 3; j++) {
       if (tri_a->tri[i] == tri_b->tri[j]) {
-        return false;
+        return true;
       }
 
       if (sewing_active) {
         if (BLI_edgeset_haskey(cloth->sew_edge_graph, tri_a->tri[i], tri_b->tri[j])) {
-          return false;
+          return true;
         }
       }
     }
   }
+  return false;
+}
 
-  if (((verts[tri_a->tri[0]].flags & verts[tri_a->tri[1]].flags & verts[tri_a->tri[2]].flags) |
-       (verts[tri_b->tri[0]].flags & verts[tri_b->tri[1]].flags & verts[tri_b->tri[2]].flags)) &
-      CLOTH_VERT_FLAG_NOSELFCOLL) {
-    return false;
-  }
-
-  return true;
+/* Vertex group flags, these may change every frame unlike the topology. */
+BLI_INLINE bool cloth_bvh_selfcollision_is_disabled(const ClothVertex *verts,
+                                                    const MVertTri *tri_a,
+                                                    const MVertTri *tri_b)
+{
+  return ((verts[tri_a->tri[0]].flags & verts[tri_a->tri[1]].flags & verts[tri_a->tri[2]].flags) |
+          (verts[tri_b->tri[0]].flags & verts[tri_b->tri[1]].flags & verts[tri_b->tri[2]].flags)) &
+         CLOTH_VERT_FLAG_NOSELFCOLL;
 }
 
 static void cloth_selfcollision(void *__restrict userdata,
@@ -1110,7 +1124,9 @@ static void cloth_selfcollision(void *__restrict userdata,
 
 #ifdef DEBUG
   bool sewing_active = (clmd->sim_parms->flags & CLOTH_SIMSETTINGS_FLAG_SEW);
-  BLI_assert(cloth_bvh_selfcollision_is_active(clmd->clothObject, tri_a, tri_b, sewing_active));
+  BLI_assert(
+      !cloth_bvh_selfcollision_is_connected(clmd->clothObject, tri_a, tri_b, sewing_active));
+  BLI_assert(!cloth_bvh_selfcollision_is_disabled(verts1, tri_a, tri_b));
 #endif
 
   /* Compute distance and normal. */
@@ -1522,13 +1538,148 @@ static bool cloth_bvh_self_overlap_cb(void *userdata, int index_a, int index_b,
 
     bool sewing_active = (clmd->sim_parms->flags & CLOTH_SIMSETTINGS_FLAG_SEW);
 
-    if (cloth_bvh_selfcollision_is_active(clothObject, tri_a, tri_b, sewing_active)) {
+    /* Vertex group flags are tested when the cached overlaps are filtered. */
+    if (!cloth_bvh_selfcollision_is_connected(clothObject, tri_a, tri_b, sewing_active)) {
       return true;
     }
   }
   return false;
 }
 
+void cloth_bvh_selfcollision_cache_free(Cloth *cloth)
+{
+  ClothSelfCollisionCache *cache = cloth->selfcoll_cache;
+
+  if (cache) {
+    MEM_SAFE_FREE(cache->overlap);
+    MEM_SAFE_FREE(cache->co);
+    MEM_freeN(cache);
+    cloth->selfcoll_cache = NULL;
+  }
+}
+
+static bool cloth_bvh_selfcollision_cache_is_valid(const ClothModifierData *clmd,
+                                                   const ClothSelfCollisionCache *cache,
+                                                   bool sewing_active)
+{
+  const Cloth *cloth = clmd->clothObject;
+  const float margin = BLI_bvhtree_get_epsilon(cloth->bvhselftree) -
+                       clmd->coll_parms->selfepsilon;
+
+  if (cache->co == NULL || cache->sewing_active != sewing_active || margin <= 0.0f) {
+    return false;
+  }
+
+  /* Every triangle is still inside its bounds of the query grown by the distance its vertices
+   * moved, so pairs that overlap now with the collision distance overlapped with the margin. */
+  const float margin_sq = square_f(margin);
+  for (uint i = 0; i < cloth->mvert_num; i++) {
+    if (len_squared_v3v3(cloth->verts[i].tx, cache->co[i]) > margin_sq) {
+      return false;
+    }
+  }
+  return true;
+}
+
+typedef struct SelfColBoundsData {
+  const ClothVertex *verts;
+  const MVertTri *tri;
+  float (*bounds)[2][3];
+  float epsilon;
+} SelfColBoundsData;
+
+static void cloth_selfcollision_bounds(void *__restrict userdata,
+                                       const int index,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SelfColBoundsData *data = (SelfColBoundsData *)userdata;
+  const MVertTri *vt = &data->tri[index];
+  float *min = data->bounds[index][0], *max = data->bounds[index][1];
+
+  INIT_MINMAX(min, max);
+  for (int i = 0; i < 3; i++) {
+    minmax_v3v3_v3(min, max, data->verts[vt->tri[i]].tx);
+  }
+  add_v3_fl(min, -data->epsilon);
+  add_v3_fl(max, data->epsilon);
+}
+
+BLI_INLINE bool cloth_selfcollision_bounds_overlap(const float a[2][3], const float b[2][3])
+{
+  return (a[0][0] <= b[1][0]) & (b[0][0] <= a[1][0]) & (a[0][1] <= b[1][1]) &
+         (b[0][1] <= a[1][1]) & (a[0][2] <= b[1][2]) & (b[0][2] <= a[1][2]);
+}
+
+/* Triangle pairs that may be within self collision distance. The overlaps of the self collision
+ * tree are kept between steps, and only the pairs whose bounds still overlap are returned. */
+static BVHTreeOverlap *cloth_bvh_selfcollision_overlap(ClothModifierData *clmd,
+                                                       uint *r_overlap_num)
+{
+  Cloth *cloth = clmd->clothObject;
+  const bool sewing_active = (clmd->sim_parms->flags & CLOTH_SIMSETTINGS_FLAG_SEW);
+
+  if (cloth->selfcoll_cache == NULL) {
+    cloth->selfcoll_cache = MEM_callocN(sizeof(ClothSelfCollisionCache), __func__);
+  }
+  ClothSelfCollisionCache *cache = cloth->selfcoll_cache;
+
+  if (!cloth_bvh_selfcollision_cache_is_valid(clmd, cache, sewing_active)) {
+    MEM_SAFE_FREE(cache->overlap);
+    if (cache->co == NULL) {
+      cache->co = MEM_malloc_arrayN(cloth->mvert_num, sizeof(*cache->co), __func__);
+    }
+
+    bvhtree_update_from_cloth(clmd, false, true);
+    cache->overlap = BLI_bvhtree_overlap(cloth->bvhselftree,
+                                         cloth->bvhselftree,
+                                         &cache->overlap_num,
+                                         cloth_bvh_self_overlap_cb,
+                                         clmd);
+    for (uint i = 0; i < cloth->mvert_num; i++) {
+      copy_v3_v3(cache->co[i], cloth->verts[i].tx);
+    }
+    cache->sewing_active = sewing_active;
+  }
+
+  *r_overlap_num = 0;
+  if (cache->overlap_num == 0) {
+    return NULL;
+  }
+
+  SelfColBoundsData data = {
+      .verts = cloth->verts,
+      .tri = cloth->tri,
+      .bounds = MEM_malloc_arrayN(cloth->primitive_num, sizeof(float[2][3]), __func__),
+      .epsilon = clmd->coll_parms->selfepsilon,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (cloth->primitive_num > 1024);
+  BLI_task_parallel_range(0, cloth->primitive_num, &data, cloth_selfcollision_bounds, &settings);
+
+  BVHTreeOverlap *overlap = MEM_malloc_arrayN(cache->overlap_num, sizeof(*overlap), __func__);
+  uint overlap_num = 0;
+
+  for (uint i = 0; i < cache->overlap_num; i++) {
+    const BVHTreeOverlap *pair = &cache->overlap[i];
+    if (cloth_selfcollision_bounds_overlap(data.bounds[pair->indexA], data.bounds[pair->indexB]) &&
+        !cloth_bvh_selfcollision_is_disabled(
+            cloth->verts, &cloth->tri[pair->indexA], &cloth->tri[pair->indexB])) {
+      overlap[overlap_num++] = *pair;
+    }
+  }
+
+  MEM_freeN(data.bounds);
+
+  if (overlap_num == 0) {
+    MEM_freeN(overlap);
+    return NULL;
+  }
+  *r_overlap_num = overlap_num;
+  return overlap;
+}
+
 int cloth_bvh_collision(
     Depsgraph *depsgraph, Object *ob, ClothModifierData *clmd, float step, float dt)
 {
@@ -1586,11 +1737,8 @@ int cloth_bvh_collision(
     }
   }
 
-  if (clmd->coll_parms->flags & CLOTH_COLLSETTINGS_FLAG_SELF) {
-    bvhtree_update_from_cloth(clmd, false, true);
-
-    overlap_self = BLI_bvhtree_overlap(
-        cloth->bvhselftree, cloth->bvhselftree, &coll_count_self, cloth_bvh_self_overlap_cb, clmd);
+  if ((clmd->coll_parms->flags & CLOTH_COLLSETTINGS_FLAG_SELF) && cloth->bvhselftree) {
+    overlap_self = cloth_bvh_selfcollision_overlap(clmd, &coll_count_self);
   }
 
   do {
@@ -30,6 +30,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_ghash.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -2478,425 +2479,553 @@ void BKE_curve_bevelList_free(ListBase *bev)
   BLI_listbase_clear(bev);
 }
 
-void BKE_curve_bevelList_make(Object *ob, ListBase *nurbs, bool for_render)
+/**
+ * Convert a single spline to a bevel list, with indication of resolution and flags for
+ * double-vertices. Returns NULL for splines that don't make a bevel list (surfaces).
+ */
+static BevList *bevlist_from_nurb(const Curve *cu,
+                                  Nurb *nu,
+                                  const bool for_render,
+                                  const bool need_seglen)
 {
-  /*
-   * - convert all curves to polys, with indication of resol and flags for double-vertices
-   * - possibly; do a smart vertice removal (in case Nurb)
-   * - separate in individual blocks with BoundBox
-   * - AutoHole detection
-   */
-
-  /* this function needs an object, because of tflag and upflag */
-  Curve *cu = ob->data;
-  Nurb *nu;
   BezTriple *bezt, *prevbezt;
   BPoint *bp;
-  BevList *bl, *blnew, *blnext;
-  BevPoint *bevp2, *bevp1 = NULL, *bevp0;
+  BevList *bl = NULL;
+  BevPoint *bevp, *bevp0;
   const float treshold = 0.00001f;
-  float min, inp;
   float *seglen = NULL;
-  struct BevelSort *sortdata, *sd, *sd1;
-  int a, b, nr, poly, resolu = 0, len = 0, segcount;
+  int a, nr, resolu, len, segcount;
   int *segbevcount;
   bool do_tilt, do_radius, do_weight;
-  bool is_editmode = false;
-  ListBase *bev;
 
-  /* segbevcount alsp requires seglen. */
-  const bool need_seglen = ELEM(
-                               cu->bevfac1_mapping, CU_BEVFAC_MAP_SEGMENT, CU_BEVFAC_MAP_SPLINE) ||
-                           ELEM(cu->bevfac2_mapping, CU_BEVFAC_MAP_SEGMENT, CU_BEVFAC_MAP_SPLINE);
+  /* check if we will calculate tilt data */
+  do_tilt = CU_DO_TILT(cu, nu);
 
-  bev = &ob->runtime.curve_cache->bev;
+  /* Normal display uses the radius, better just to calculate them. */
+  do_radius = CU_DO_RADIUS(cu, nu);
 
-#if 0
-  /* do we need to calculate the radius for each point? */
-  do_radius = (cu->bevobj || cu->taperobj || (cu->flag & CU_FRONT) || (cu->flag & CU_BACK)) ? 0 :
-                                                                                              1;
-#endif
+  do_weight = true;
 
-  /* STEP 1: MAKE POLYS  */
+  /* check we are a single point? also check we are not a surface and that the orderu is sane,
+   * enforced in the UI but can go wrong possibly */
+  if (!BKE_nurb_check_valid_u(nu)) {
+    bl = MEM_callocN(sizeof(BevList), "makeBevelList1");
+    bl->bevpoints = MEM_calloc_arrayN(1, sizeof(BevPoint), "makeBevelPoints1");
+    bl->nr = 0;
+    bl->charidx = nu->charidx;
+    return bl;
+  }
 
-  BKE_curve_bevelList_free(&ob->runtime.curve_cache->bev);
-  nu = nurbs->first;
-  if (cu->editnurb && ob->type != OB_FONT) {
-    is_editmode = 1;
+  if (for_render && cu->resolu_ren != 0) {
+    resolu = cu->resolu_ren;
+  }
+  else {
+    resolu = nu->resolu;
   }
 
-  for (; nu; nu = nu->next) {
-    if (nu->hide && is_editmode) {
-      continue;
+  segcount = SEGMENTSU(nu);
+
+  if (nu->type == CU_POLY) {
+    len = nu->pntsu;
+    bl = MEM_callocN(sizeof(BevList), "makeBevelList2");
+    bl->bevpoints = MEM_calloc_arrayN(len, sizeof(BevPoint), "makeBevelPoints2");
+    if (need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0) {
+      bl->seglen = MEM_malloc_arrayN(segcount, sizeof(float), "makeBevelList2_seglen");
+      bl->segbevcount = MEM_malloc_arrayN(segcount, sizeof(int), "makeBevelList2_segbevcount");
+    }
+
+    bl->poly = (nu->flagu & CU_NURB_CYCLIC) ? 0 : -1;
+    bl->nr = len;
+    bl->dupe_nr = 0;
+    bl->charidx = nu->charidx;
+    bevp = bl->bevpoints;
+    bevp->offset = 0;
+    bp = nu->bp;
+    seglen = bl->seglen;
+    segbevcount = bl->segbevcount;
+
+    while (len--) {
+      copy_v3_v3(bevp->vec, bp->vec);
+      bevp->tilt = bp->tilt;
+      bevp->radius = bp->radius;
+      bevp->weight = bp->weight;
+      bevp->split_tag = true;
+      bp++;
+      if (seglen != NULL && len != 0) {
+        *seglen = len_v3v3(bevp->vec, bp->vec);
+        bevp++;
+        bevp->offset = *seglen;
+        if (*seglen > treshold) {
+          *segbevcount = 1;
+        }
+        else {
+          *segbevcount = 0;
+        }
+        seglen++;
+        segbevcount++;
+      }
+      else {
+        bevp++;
+      }
     }
 
-    /* check if we will calculate tilt data */
-    do_tilt = CU_DO_TILT(cu, nu);
+    if ((nu->flagu & CU_NURB_CYCLIC) == 0) {
+      bevlist_firstlast_direction_calc_from_bpoint(nu, bl);
+    }
+  }
+  else if (nu->type == CU_BEZIER) {
+    /* in case last point is not cyclic */
+    len = segcount * resolu + 1;
 
-    /* Normal display uses the radius, better just to calculate them. */
-    do_radius = CU_DO_RADIUS(cu, nu);
+    bl = MEM_callocN(sizeof(BevList), "makeBevelBPoints");
+    bl->bevpoints = MEM_calloc_arrayN(len, sizeof(BevPoint), "makeBevelBPointsPoints");
+    if (need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0) {
+      bl->seglen = MEM_malloc_arrayN(segcount, sizeof(float), "makeBevelBPoints_seglen");
+      bl->segbevcount = MEM_malloc_arrayN(segcount, sizeof(int), "makeBevelBPoints_segbevcount");
+    }
 
-    do_weight = true;
+    bl->poly = (nu->flagu & CU_NURB_CYCLIC) ? 0 : -1;
+    bl->charidx = nu->charidx;
 
-    /* check we are a single point? also check we are not a surface and that the orderu is sane,
-     * enforced in the UI but can go wrong possibly */
-    if (!BKE_nurb_check_valid_u(nu)) {
-      bl = MEM_callocN(sizeof(BevList), "makeBevelList1");
-      bl->bevpoints = MEM_calloc_arrayN(1, sizeof(BevPoint), "makeBevelPoints1");
-      BLI_addtail(bev, bl);
-      bl->nr = 0;
-      bl->charidx = nu->charidx;
+    bevp = bl->bevpoints;
+    seglen = bl->seglen;
+    segbevcount = bl->segbevcount;
+
+    bevp->offset = 0;
+    if (seglen != NULL) {
+      *seglen = 0;
+      *segbevcount = 0;
+    }
+
+    a = nu->pntsu - 1;
+    bezt = nu->bezt;
+    if (nu->flagu & CU_NURB_CYCLIC) {
+      a++;
+      prevbezt = nu->bezt + (nu->pntsu - 1);
     }
     else {
-      BevPoint *bevp;
+      prevbezt = bezt;
+      bezt++;
+    }
 
-      if (for_render && cu->resolu_ren != 0) {
-        resolu = cu->resolu_ren;
-      }
-      else {
-        resolu = nu->resolu;
-      }
+    sub_v3_v3v3(bevp->dir, prevbezt->vec[2], prevbezt->vec[1]);
+    normalize_v3(bevp->dir);
 
-      segcount = SEGMENTSU(nu);
+    BLI_assert(segcount >= a);
 
-      if (nu->type == CU_POLY) {
-        len = nu->pntsu;
-        bl = MEM_callocN(sizeof(BevList), "makeBevelList2");
-        bl->bevpoints = MEM_calloc_arrayN(len, sizeof(BevPoint), "makeBevelPoints2");
-        if (need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0) {
-          bl->seglen = MEM_malloc_arrayN(segcount, sizeof(float), "makeBevelList2_seglen");
-          bl->segbevcount = MEM_malloc_arrayN(segcount, sizeof(int), "makeBevelList2_segbevcount");
-        }
-        BLI_addtail(bev, bl);
+    while (a--) {
+      if (prevbezt->h2 == HD_VECT && bezt->h1 == HD_VECT) {
 
-        bl->poly = (nu->flagu & CU_NURB_CYCLIC) ? 0 : -1;
-        bl->nr = len;
-        bl->dupe_nr = 0;
-        bl->charidx = nu->charidx;
-        bevp = bl->bevpoints;
-        bevp->offset = 0;
-        bp = nu->bp;
-        seglen = bl->seglen;
-        segbevcount = bl->segbevcount;
-
-        while (len--) {
-          copy_v3_v3(bevp->vec, bp->vec);
-          bevp->tilt = bp->tilt;
-          bevp->radius = bp->radius;
-          bevp->weight = bp->weight;
-          bevp->split_tag = true;
-          bp++;
-          if (seglen != NULL && len != 0) {
-            *seglen = len_v3v3(bevp->vec, bp->vec);
-            bevp++;
-            bevp->offset = *seglen;
-            if (*seglen > treshold) {
-              *segbevcount = 1;
-            }
-            else {
-              *segbevcount = 0;
-            }
-            seglen++;
-            segbevcount++;
-          }
-          else {
-            bevp++;
+        copy_v3_v3(bevp->vec, prevbezt->vec[1]);
+        bevp->tilt = prevbezt->tilt;
+        bevp->radius = prevbezt->radius;
+        bevp->weight = prevbezt->weight;
+        bevp->split_tag = true;
+        bevp->dupe_tag = false;
+        bevp++;
+        bl->nr++;
+        bl->dupe_nr = 1;
+        if (seglen != NULL) {
+          *seglen = len_v3v3(prevbezt->vec[1], bezt->vec[1]);
+          bevp->offset = *seglen;
+          seglen++;
+          /* match segbevcount to the cleaned up bevel lists (see STEP 2) */
+          if (bevp->offset > treshold) {
+            *segbevcount = 1;
           }
-        }
-
-        if ((nu->flagu & CU_NURB_CYCLIC) == 0) {
-          bevlist_firstlast_direction_calc_from_bpoint(nu, bl);
+          segbevcount++;
         }
       }
-      else if (nu->type == CU_BEZIER) {
-        /* in case last point is not cyclic */
-        len = segcount * resolu + 1;
+      else {
+        /* always do all three, to prevent data hanging around */
+        int j;
 
-        bl = MEM_callocN(sizeof(BevList), "makeBevelBPoints");
-        bl->bevpoints = MEM_calloc_arrayN(len, sizeof(BevPoint), "makeBevelBPointsPoints");
-        if (need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0) {
-          bl->seglen = MEM_malloc_arrayN(segcount, sizeof(float), "makeBevelBPoints_seglen");
-          bl->segbevcount = MEM_malloc_arrayN(
-              segcount, sizeof(int), "makeBevelBPoints_segbevcount");
+        /* BevPoint must stay aligned to 4 so sizeof(BevPoint)/sizeof(float) works */
+        for (j = 0; j < 3; j++) {
+          BKE_curve_forward_diff_bezier(prevbezt->vec[1][j],
+                                        prevbezt->vec[2][j],
+                                        bezt->vec[0][j],
+                                        bezt->vec[1][j],
+                                        &(bevp->vec[j]),
+                                        resolu,
+                                        sizeof(BevPoint));
         }
-        BLI_addtail(bev, bl);
 
-        bl->poly = (nu->flagu & CU_NURB_CYCLIC) ? 0 : -1;
-        bl->charidx = nu->charidx;
+        /* if both arrays are NULL do nothiong */
+        tilt_bezpart(prevbezt,
+                     bezt,
+                     nu,
+                     do_tilt ? &bevp->tilt : NULL,
+                     do_radius ? &bevp->radius : NULL,
+                     do_weight ? &bevp->weight : NULL,
+                     resolu,
+                     sizeof(BevPoint));
+
+        if (cu->twist_mode == CU_TWIST_TANGENT) {
+          forward_diff_bezier_cotangent(prevbezt->vec[1],
+                                        prevbezt->vec[2],
+                                        bezt->vec[0],
+                                        bezt->vec[1],
+                                        bevp->tan,
+                                        resolu,
+                                        sizeof(BevPoint));
+        }
 
-        bevp = bl->bevpoints;
-        seglen = bl->seglen;
-        segbevcount = bl->segbevcount;
+        /* indicate with handlecodes double points */
+        if (prevbezt->h1 == prevbezt->h2) {
+          if (prevbezt->h1 == 0 || prevbezt->h1 == HD_VECT) {
+            bevp->split_tag = true;
+          }
+        }
+        else {
+          if (prevbezt->h1 == 0 || prevbezt->h1 == HD_VECT) {
+            bevp->split_tag = true;
+          }
+          else if (prevbezt->h2 == 0 || prevbezt->h2 == HD_VECT) {
+            bevp->split_tag = true;
+          }
+        }
 
-        bevp->offset = 0;
+        /* seglen */
         if (seglen != NULL) {
           *seglen = 0;
           *segbevcount = 0;
-        }
-
-        a = nu->pntsu - 1;
-        bezt = nu->bezt;
-        if (nu->flagu & CU_NURB_CYCLIC) {
-          a++;
-          prevbezt = nu->bezt + (nu->pntsu - 1);
+          for (j = 0; j < resolu; j++) {
+            bevp0 = bevp;
+            bevp++;
+            bevp->offset = len_v3v3(bevp0->vec, bevp->vec);
+            /* match seglen and segbevcount to the cleaned up bevel lists (see STEP 2) */
+            if (bevp->offset > treshold) {
+              *seglen += bevp->offset;
+              *segbevcount += 1;
+            }
+          }
+          seglen++;
+          segbevcount++;
         }
         else {
-          prevbezt = bezt;
-          bezt++;
+          bevp += resolu;
         }
+        bl->nr += resolu;
+      }
+      prevbezt = bezt;
+      bezt++;
+    }
 
-        sub_v3_v3v3(bevp->dir, prevbezt->vec[2], prevbezt->vec[1]);
-        normalize_v3(bevp->dir);
+    if ((nu->flagu & CU_NURB_CYCLIC) == 0) { /* not cyclic: endpoint */
+      copy_v3_v3(bevp->vec, prevbezt->vec[1]);
+      bevp->tilt = prevbezt->tilt;
+      bevp->radius = prevbezt->radius;
+      bevp->weight = prevbezt->weight;
 
-        BLI_assert(segcount >= a);
+      sub_v3_v3v3(bevp->dir, prevbezt->vec[1], prevbezt->vec[0]);
+      normalize_v3(bevp->dir);
 
-        while (a--) {
-          if (prevbezt->h2 == HD_VECT && bezt->h1 == HD_VECT) {
+      bl->nr++;
+    }
+  }
+  else if (nu->type == CU_NURBS) {
+    if (nu->pntsv == 1) {
+      len = (resolu * segcount);
 
-            copy_v3_v3(bevp->vec, prevbezt->vec[1]);
-            bevp->tilt = prevbezt->tilt;
-            bevp->radius = prevbezt->radius;
-            bevp->weight = prevbezt->weight;
-            bevp->split_tag = true;
-            bevp->dupe_tag = false;
-            bevp++;
-            bl->nr++;
-            bl->dupe_nr = 1;
-            if (seglen != NULL) {
-              *seglen = len_v3v3(prevbezt->vec[1], bezt->vec[1]);
-              bevp->offset = *seglen;
-              seglen++;
-              /* match segbevcount to the cleaned up bevel lists (see STEP 2) */
-              if (bevp->offset > treshold) {
-                *segbevcount = 1;
-              }
-              segbevcount++;
-            }
-          }
-          else {
-            /* always do all three, to prevent data hanging around */
-            int j;
-
-            /* BevPoint must stay aligned to 4 so sizeof(BevPoint)/sizeof(float) works */
-            for (j = 0; j < 3; j++) {
-              BKE_curve_forward_diff_bezier(prevbezt->vec[1][j],
-                                            prevbezt->vec[2][j],
-                                            bezt->vec[0][j],
-                                            bezt->vec[1][j],
-                                            &(bevp->vec[j]),
-                                            resolu,
-                                            sizeof(BevPoint));
-            }
+      bl = MEM_callocN(sizeof(BevList), "makeBevelList3");
+      bl->bevpoints = MEM_calloc_arrayN(len, sizeof(BevPoint), "makeBevelPoints3");
+      if (need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0) {
+        bl->seglen = MEM_malloc_arrayN(segcount, sizeof(float), "makeBevelList3_seglen");
+        bl->segbevcount = MEM_malloc_arrayN(segcount, sizeof(int), "makeBevelList3_segbevcount");
+      }
+      bl->nr = len;
+      bl->dupe_nr = 0;
+      bl->poly = (nu->flagu & CU_NURB_CYCLIC) ? 0 : -1;
+      bl->charidx = nu->charidx;
+
+      bevp = bl->bevpoints;
+      seglen = bl->seglen;
+      segbevcount = bl->segbevcount;
 
-            /* if both arrays are NULL do nothiong */
-            tilt_bezpart(prevbezt,
-                         bezt,
-                         nu,
+      BKE_nurb_makeCurve(nu,
+                         &bevp->vec[0],
                          do_tilt ? &bevp->tilt : NULL,
                          do_radius ? &bevp->radius : NULL,
                          do_weight ? &bevp->weight : NULL,
                          resolu,
                          sizeof(BevPoint));
 
-            if (cu->twist_mode == CU_TWIST_TANGENT) {
-              forward_diff_bezier_cotangent(prevbezt->vec[1],
-                                            prevbezt->vec[2],
-                                            bezt->vec[0],
-                                            bezt->vec[1],
-                                            bevp->tan,
-                                            resolu,
-                                            sizeof(BevPoint));
-            }
-
-            /* indicate with handlecodes double points */
-            if (prevbezt->h1 == prevbezt->h2) {
-              if (prevbezt->h1 == 0 || prevbezt->h1 == HD_VECT) {
-                bevp->split_tag = true;
-              }
-            }
-            else {
-              if (prevbezt->h1 == 0 || prevbezt->h1 == HD_VECT) {
-                bevp->split_tag = true;
-              }
-              else if (prevbezt->h2 == 0 || prevbezt->h2 == HD_VECT) {
-                bevp->split_tag = true;
-              }
-            }
-
-            /* seglen */
-            if (seglen != NULL) {
-              *seglen = 0;
-              *segbevcount = 0;
-              for (j = 0; j < resolu; j++) {
-                bevp0 = bevp;
-                bevp++;
-                bevp->offset = len_v3v3(bevp0->vec, bevp->vec);
-                /* match seglen and segbevcount to the cleaned up bevel lists (see STEP 2) */
-                if (bevp->offset > treshold) {
-                  *seglen += bevp->offset;
-                  *segbevcount += 1;
-                }
-              }
-              seglen++;
-              segbevcount++;
-            }
-            else {
-              bevp += resolu;
+      /* match seglen and segbevcount to the cleaned up bevel lists (see STEP 2) */
+      if (seglen != NULL) {
+        nr = segcount;
+        bevp0 = bevp;
+        bevp++;
+        while (nr) {
+          int j;
+          *seglen = 0;
+          *segbevcount = 0;
+          /* We keep last bevel segment zero-length. */
+          for (j = 0; j < ((nr == 1) ? (resolu - 1) : resolu); j++) {
+            bevp->offset = len_v3v3(bevp0->vec, bevp->vec);
+            if (bevp->offset > treshold) {
+              *seglen += bevp->offset;
+              *segbevcount += 1;
             }
-            bl->nr += resolu;
-          }
-          prevbezt = bezt;
-          bezt++;
-        }
-
-        if ((nu->flagu & CU_NURB_CYCLIC) == 0) { /* not cyclic: endpoint */
-          copy_v3_v3(bevp->vec, prevbezt->vec[1]);
-          bevp->tilt = prevbezt->tilt;
-          bevp->radius = prevbezt->radius;
-          bevp->weight = prevbezt->weight;
-
-          sub_v3_v3v3(bevp->dir, prevbezt->vec[1], prevbezt->vec[0]);
-          normalize_v3(bevp->dir);
-
-          bl->nr++;
-        }
-      }
-      else if (nu->type == CU_NURBS) {
-        if (nu->pntsv == 1) {
-          len = (resolu * segcount);
-
-          bl = MEM_callocN(sizeof(BevList), "makeBevelList3");
-          bl->bevpoints = MEM_calloc_arrayN(len, sizeof(BevPoint), "makeBevelPoints3");
-          if (need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0) {
-            bl->seglen = MEM_malloc_arrayN(segcount, sizeof(float), "makeBevelList3_seglen");
-            bl->segbevcount = MEM_malloc_arrayN(
-                segcount, sizeof(int), "makeBevelList3_segbevcount");
-          }
-          BLI_addtail(bev, bl);
-          bl->nr = len;
-          bl->dupe_nr = 0;
-          bl->poly = (nu->flagu & CU_NURB_CYCLIC) ? 0 : -1;
-          bl->charidx = nu->charidx;
-
-          bevp = bl->bevpoints;
-          seglen = bl->seglen;
-          segbevcount = bl->segbevcount;
-
-          BKE_nurb_makeCurve(nu,
-                             &bevp->vec[0],
-                             do_tilt ? &bevp->tilt : NULL,
-                             do_radius ? &bevp->radius : NULL,
-                             do_weight ? &bevp->weight : NULL,
-                             resolu,
-                             sizeof(BevPoint));
-
-          /* match seglen and segbevcount to the cleaned up bevel lists (see STEP 2) */
-          if (seglen != NULL) {
-            nr = segcount;
             bevp0 = bevp;
             bevp++;
-            while (nr) {
-              int j;
-              *seglen = 0;
-              *segbevcount = 0;
-              /* We keep last bevel segment zero-length. */
-              for (j = 0; j < ((nr == 1) ? (resolu - 1) : resolu); j++) {
-                bevp->offset = len_v3v3(bevp0->vec, bevp->vec);
-                if (bevp->offset > treshold) {
-                  *seglen += bevp->offset;
-                  *segbevcount += 1;
-                }
-                bevp0 = bevp;
-                bevp++;
-              }
-              seglen++;
-              segbevcount++;
-              nr--;
-            }
-          }
-
-          if ((nu->flagu & CU_NURB_CYCLIC) == 0) {
-            bevlist_firstlast_direction_calc_from_bpoint(nu, bl);
           }
+          seglen++;
+          segbevcount++;
+          nr--;
         }
       }
+
+      if ((nu->flagu & CU_NURB_CYCLIC) == 0) {
+        bevlist_firstlast_direction_calc_from_bpoint(nu, bl);
+      }
     }
   }
 
-  /* STEP 2: DOUBLE POINTS AND AUTOMATIC RESOLUTION, REDUCE DATABLOCKS */
-  bl = bev->first;
-  while (bl) {
-    if (bl->nr) { /* null bevel items come from single points */
-      bool is_cyclic = bl->poly != -1;
-      nr = bl->nr;
-      if (is_cyclic) {
-        bevp1 = bl->bevpoints;
-        bevp0 = bevp1 + (nr - 1);
-      }
-      else {
-        bevp0 = bl->bevpoints;
-        bevp0->offset = 0;
-        bevp1 = bevp0 + 1;
+  return bl;
+}
+
+/**
+ * Tag double points, using the segment lengths when \a use_seglen is set.
+ */
+static void bevlist_tag_doubles(BevList *bl, const bool use_seglen)
+{
+  const float treshold = 0.00001f;
+  BevPoint *bevp0, *bevp1;
+  int nr;
+
+  if (bl->nr == 0) { /* null bevel items come from single points */
+    return;
+  }
+
+  bool is_cyclic = bl->poly != -1;
+  nr = bl->nr;
+  if (is_cyclic) {
+    bevp1 = bl->bevpoints;
+    bevp0 = bevp1 + (nr - 1);
+  }
+  else {
+    bevp0 = bl->bevpoints;
+    bevp0->offset = 0;
+    bevp1 = bevp0 + 1;
+  }
+  nr--;
+  while (nr--) {
+    if (use_seglen) {
+      if (fabsf(bevp1->offset) < treshold) {
+        bevp0->dupe_tag = true;
+        bl->dupe_nr++;
       }
-      nr--;
-      while (nr--) {
-        if (seglen != NULL) {
-          if (fabsf(bevp1->offset) < treshold) {
+    }
+    else {
+      if (fabsf(bevp0->vec[0] - bevp1->vec[0]) < 0.00001f) {
+        if (fabsf(bevp0->vec[1] - bevp1->vec[1]) < 0.00001f) {
+          if (fabsf(bevp0->vec[2] - bevp1->vec[2]) < 0.00001f) {
             bevp0->dupe_tag = true;
             bl->dupe_nr++;
           }
         }
-        else {
-          if (fabsf(bevp0->vec[0] - bevp1->vec[0]) < 0.00001f) {
-            if (fabsf(bevp0->vec[1] - bevp1->vec[1]) < 0.00001f) {
-              if (fabsf(bevp0->vec[2] - bevp1->vec[2]) < 0.00001f) {
-                bevp0->dupe_tag = true;
-                bl->dupe_nr++;
-              }
-            }
-          }
-        }
-        bevp0 = bevp1;
-        bevp1++;
       }
     }
-    bl = bl->next;
+    bevp0 = bevp1;
+    bevp1++;
   }
-  bl = bev->first;
-  while (bl) {
-    blnext = bl->next;
-    if (bl->nr && bl->dupe_nr) {
-      nr = bl->nr - bl->dupe_nr + 1; /* +1 because vectorbezier sets flag too */
-      blnew = MEM_mallocN(sizeof(BevList), "makeBevelList4");
-      memcpy(blnew, bl, sizeof(BevList));
-      blnew->bevpoints = MEM_calloc_arrayN(nr, sizeof(BevPoint), "makeBevelPoints4");
-      if (!blnew->bevpoints) {
-        MEM_freeN(blnew);
-        break;
+}
+
+/**
+ * Return a copy of \a bl without the points tagged as doubles, \a bl is freed.
+ */
+static BevList *bevlist_remove_doubles(BevList *bl)
+{
+  BevList *blnew;
+  BevPoint *bevp0, *bevp1;
+  int nr;
+
+  if (bl->nr == 0 || bl->dupe_nr == 0) {
+    return bl;
+  }
+
+  nr = bl->nr - bl->dupe_nr + 1; /* +1 because vectorbezier sets flag too */
+  blnew = MEM_mallocN(sizeof(BevList), "makeBevelList4");
+  memcpy(blnew, bl, sizeof(BevList));
+  blnew->bevpoints = MEM_calloc_arrayN(nr, sizeof(BevPoint), "makeBevelPoints4");
+  if (!blnew->bevpoints) {
+    MEM_freeN(blnew);
+    return bl;
+  }
+  blnew->segbevcount = bl->segbevcount;
+  blnew->seglen = bl->seglen;
+  blnew->nr = 0;
+  bevp0 = bl->bevpoints;
+  bevp1 = blnew->bevpoints;
+  nr = bl->nr;
+  while (nr--) {
+    if (bevp0->dupe_tag == 0) {
+      memcpy(bevp1, bevp0, sizeof(BevPoint));
+      bevp1++;
+      blnew->nr++;
+    }
+    bevp0++;
+  }
+  if (bl->bevpoints != NULL) {
+    MEM_freeN(bl->bevpoints);
+  }
+  MEM_freeN(bl);
+  blnew->dupe_nr = 0;
+
+  return blnew;
+}
+
+static void bevlist_orientation_calc(const Curve *cu, BevList *bl, const int resolu)
+{
+  if (bl->nr < 2) {
+    BevPoint *bevp = bl->bevpoints;
+    unit_qt(bevp->quat);
+  }
+  else if ((cu->flag & CU_3D) == 0) {
+    /* 2D Curves */
+    if (bl->nr == 2) { /* 2 pnt, treat separate */
+      make_bevel_list_segment_2D(bl);
+    }
+    else {
+      make_bevel_list_2D(bl);
+    }
+  }
+  else {
+    /* 3D Curves */
+    if (bl->nr == 2) { /* 2 pnt, treat separate */
+      make_bevel_list_segment_3D(bl);
+    }
+    else {
+      make_bevel_list_3D(bl, (int)(resolu * cu->twist_smooth), cu->twist_mode);
+    }
+  }
+}
+
+typedef struct BevelListMakeData {
+  const Curve *cu;
+  Nurb **nurbs;
+  /** One item per spline, NULL when the spline doesn't make a bevel list. */
+  BevList **bevlists;
+  bool for_render;
+  bool need_seglen;
+  /** Double points are detected from the segment lengths. */
+  bool use_seglen;
+  /** Resolution used for smoothing the twist of 3D curves. */
+  int resolu;
+} BevelListMakeData;
+
+static void bevlist_make_task_cb(void *__restrict userdata,
+                                 const int i,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BevelListMakeData *data = userdata;
+  BevList *bl = bevlist_from_nurb(data->cu, data->nurbs[i], data->for_render, data->need_seglen);
+
+  if (bl != NULL) {
+    bevlist_tag_doubles(bl, data->use_seglen);
+    bl = bevlist_remove_doubles(bl);
+  }
+  data->bevlists[i] = bl;
+}
+
+static void bevlist_orientation_task_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BevelListMakeData *data = userdata;
+  BevList *bl = data->bevlists[i];
+
+  if (bl != NULL) {
+    bevlist_orientation_calc(data->cu, bl, data->resolu);
+  }
+}
+
+void BKE_curve_bevelList_make(Object *ob, ListBase *nurbs, bool for_render)
+{
+  /*
+   * - convert all curves to polys, with indication of resol and flags for double-vertices
+   * - possibly; do a smart vertice removal (in case Nurb)
+   * - separate in individual blocks with BoundBox
+   * - AutoHole detection
+   *
+   * Splines are independent of each other until the auto-hole detection,
+   * so the polys and the orientation are calculated in parallel.
+   */
+
+  /* this function needs an object, because of tflag and upflag */
+  Curve *cu = ob->data;
+  Nurb *nu;
+  BevList *bl;
+  BevPoint *bevp2, *bevp1 = NULL, *bevp0;
+  float min, inp;
+  struct BevelSort *sortdata, *sd, *sd1;
+  int a, b, nr, poly;
+  bool is_editmode = false;
+  ListBase *bev;
+
+  /* segbevcount alsp requires seglen. */
+  const bool need_seglen = ELEM(
+                               cu->bevfac1_mapping, CU_BEVFAC_MAP_SEGMENT, CU_BEVFAC_MAP_SPLINE) ||
+                           ELEM(cu->bevfac2_mapping, CU_BEVFAC_MAP_SEGMENT, CU_BEVFAC_MAP_SPLINE);
+
+  bev = &ob->runtime.curve_cache->bev;
+
+#if 0
+  /* do we need to calculate the radius for each point? */
+  do_radius = (cu->bevobj || cu->taperobj || (cu->flag & CU_FRONT) || (cu->flag & CU_BACK)) ? 0 :
+                                                                                              1;
+#endif
+
+  /* STEP 1: MAKE POLYS  */
+
+  BKE_curve_bevelList_free(&ob->runtime.curve_cache->bev);
+  if (cu->editnurb && ob->type != OB_FONT) {
+    is_editmode = 1;
+  }
+
+  BevelListMakeData data = {
+      .cu = cu,
+      .for_render = for_render,
+      .need_seglen = need_seglen,
+  };
+  int nurbs_len = 0;
+
+  data.nurbs = MEM_malloc_arrayN(
+      max_ii(BLI_listbase_count(nurbs), 1), sizeof(Nurb *), __func__);
+  for (nu = nurbs->first; nu; nu = nu->next) {
+    if (nu->hide && is_editmode) {
+      continue;
+    }
+    data.nurbs[nurbs_len++] = nu;
+
+    /* The double point test and the twist smoothing follow the last valid spline. */
+    if (BKE_nurb_check_valid_u(nu)) {
+      if (for_render && cu->resolu_ren != 0) {
+        data.resolu = cu->resolu_ren;
       }
-      blnew->segbevcount = bl->segbevcount;
-      blnew->seglen = bl->seglen;
-      blnew->nr = 0;
-      BLI_remlink(bev, bl);
-      BLI_insertlinkbefore(bev, blnext, blnew); /* to make sure bevlijst is tuned with nurblist */
-      bevp0 = bl->bevpoints;
-      bevp1 = blnew->bevpoints;
-      nr = bl->nr;
-      while (nr--) {
-        if (bevp0->dupe_tag == 0) {
-          memcpy(bevp1, bevp0, sizeof(BevPoint));
-          bevp1++;
-          blnew->nr++;
-        }
-        bevp0++;
+      else {
+        data.resolu = nu->resolu;
       }
-      if (bl->bevpoints != NULL) {
-        MEM_freeN(bl->bevpoints);
+      if (ELEM(nu->type, CU_POLY, CU_BEZIER) || (nu->type == CU_NURBS && nu->pntsv == 1)) {
+        data.use_seglen = need_seglen && (nu->flagu & CU_NURB_CYCLIC) == 0;
       }
-      MEM_freeN(bl);
-      blnew->dupe_nr = 0;
     }
-    bl = blnext;
+  }
+  data.bevlists = MEM_malloc_arrayN(max_ii(nurbs_len, 1), sizeof(BevList *), __func__);
+
+  /* STEP 2: DOUBLE POINTS AND AUTOMATIC RESOLUTION, REDUCE DATABLOCKS
+   * (done for each spline right after making its poly). */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (nurbs_len > 1);
+  BLI_task_parallel_range(0, nurbs_len, &data, bevlist_make_task_cb, &settings);
+
+  /* Keep the bevel list tuned with the nurb list. */
+  for (a = 0; a < nurbs_len; a++) {
+    if (data.bevlists[a] != NULL) {
+      BLI_addtail(bev, data.bevlists[a]);
+    }
   }
 
   /* STEP 3: POLYS COUNT AND AUTOHOLE */
@@ -3000,36 +3129,10 @@ void BKE_curve_bevelList_make(Object *ob, ListBase *nurbs, bool for_render)
   }
 
   /* STEP 4: 2D-COSINES or 3D ORIENTATION */
-  if ((cu->flag & CU_3D) == 0) {
-    /* 2D Curves */
-    for (bl = bev->first; bl; bl = bl->next) {
-      if (bl->nr < 2) {
-        BevPoint *bevp = bl->bevpoints;
-        unit_qt(bevp->quat);
-      }
-      else if (bl->nr == 2) { /* 2 pnt, treat separate */
-        make_bevel_list_segment_2D(bl);
-      }
-      else {
-        make_bevel_list_2D(bl);
-      }
-    }
-  }
-  else {
-    /* 3D Curves */
-    for (bl = bev->first; bl; bl = bl->next) {
-      if (bl->nr < 2) {
-        BevPoint *bevp = bl->bevpoints;
-        unit_qt(bevp->quat);
-      }
-      else if (bl->nr == 2) { /* 2 pnt, treat separate */
-        make_bevel_list_segment_3D(bl);
-      }
-      else {
-        make_bevel_list_3D(bl, (int)(resolu * cu->twist_smooth), cu->twist_mode);
-      }
-    }
-  }
+  BLI_task_parallel_range(0, nurbs_len, &data, bevlist_orientation_task_cb, &settings);
+
+  MEM_freeN(data.nurbs);
+  MEM_freeN(data.bevlists);
 }
 
 /* ****************** HANDLES ************** */
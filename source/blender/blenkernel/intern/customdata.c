@@ -62,6 +62,8 @@
 
 #include "CLG_log.h"
 
+#include "atomic_ops.h"
+
 /* only for customdata_data_transfer_interp_normal_normals */
 #include "data_transfer_intern.h"
 
@@ -2168,6 +2170,116 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Layer Data Sharing
+ *
+ * Layers copied with #CD_REFERENCE share the data of the layer they are copied from, when that
+ * layer was made shareable with #CustomData_ensure_shareable_layers(). The data is then reference
+ * counted, so it stays valid for as long as any layer uses it, the last user frees it.
+ * Layers which don't own their data (#CD_FLAG_NOFREE) still have to be duplicated before writing,
+ * which only copies the data when it is still used elsewhere.
+ * \{ */
+
+typedef struct CustomDataSharingInfo {
+  /** Number of layers using the data, accessed atomically. */
+  int32_t users;
+} CustomDataSharingInfo;
+
+static void customData_layer_share(const CustomDataLayer *src_layer, CustomDataLayer *dst_layer)
+{
+  CustomDataSharingInfo *info = src_layer->sharing_info;
+
+  if (info == NULL) {
+    /* The source wasn't made shareable, this is a plain reference which is only valid for as long
+     * as the source data lives. */
+    dst_layer->sharing_info = NULL;
+    return;
+  }
+
+  atomic_add_and_fetch_int32(&info->users, 1);
+  dst_layer->sharing_info = info;
+}
+
+void CustomData_ensure_shareable_layers(CustomData *data)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    CustomDataLayer *layer = &data->layers[i];
+
+    if (layer->data == NULL || layer->sharing_info != NULL || (layer->flag & CD_FLAG_NOFREE)) {
+      /* Nothing to share, already shared, or data which isn't owned by this layer. */
+      continue;
+    }
+
+    /* The same data may be made shareable from multiple threads, e.g. a mesh used by several
+     * objects which are evaluated in parallel. */
+    CustomDataSharingInfo *info = MEM_mallocN(sizeof(*info), __func__);
+    info->users = 1;
+    if (atomic_cas_ptr(&layer->sharing_info, NULL, info) != NULL) {
+      MEM_freeN(info);
+    }
+  }
+}
+
+/**
+ * Stop using the shared data of the layer.
+ * \return true when the layer was the last user, in which case it is responsible for the data.
+ */
+static bool customData_layer_release(CustomDataLayer *layer)
+{
+  CustomDataSharingInfo *info = layer->sharing_info;
+  layer->sharing_info = NULL;
+
+  if (atomic_sub_and_fetch_int32(&info->users, 1) == 0) {
+    MEM_freeN(info);
+    return true;
+  }
+  return false;
+}
+
+static void customData_layer_data_free(const CustomDataLayer *layer, void *data, int totelem)
+{
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+  if (typeInfo->free) {
+    typeInfo->free(data, totelem, typeInfo->size);
+  }
+  MEM_freeN(data);
+}
+
+/**
+ * Make sure the layer is the only user of its data, copying it when it is shared.
+ */
+static void customData_layer_unshare(CustomDataLayer *layer, int totelem)
+{
+  void *data = layer->data;
+
+  if (layer->sharing_info == NULL) {
+    return;
+  }
+  if (atomic_add_and_fetch_int32(&((CustomDataSharingInfo *)layer->sharing_info)->users, 0) > 1) {
+    /* MEM_dupallocN won't work in case of complex layers, like e.g.
+     * CD_MDEFORMVERT, which has pointers to allocated data...
+     * So in case a custom copy function is defined, use it!
+     */
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+
+    if (typeInfo->copy) {
+      layer->data = MEM_malloc_arrayN((size_t)totelem, typeInfo->size, "CD unshare layer");
+      typeInfo->copy(data, layer->data, totelem);
+    }
+    else {
+      layer->data = MEM_dupallocN(data);
+    }
+  }
+
+  if (customData_layer_release(layer) && layer->data != data) {
+    /* Other users were freed in the meantime. */
+    customData_layer_data_free(layer, data, totelem);
+  }
+}
+
+/** \} */
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -2235,6 +2347,14 @@ bool CustomData_merge(const struct CustomData *source,
     }
 
     if (newlayer) {
+      if (alloctype == CD_ASSIGN) {
+        /* Ownership of the data moves to the new layer, including its share. */
+        newlayer->sharing_info = layer->sharing_info;
+      }
+      else if (alloctype == CD_REFERENCE) {
+        customData_layer_share(layer, newlayer);
+      }
+
       newlayer->uid = layer->uid;
 
       newlayer->active = lastactive;
@@ -2261,6 +2381,10 @@ void CustomData_realloc(CustomData *data, int totelem)
       continue;
     }
     typeInfo = layerType_getInfo(layer->type);
+    if (layer->sharing_info) {
+      /* Other layers may still use the data with its current size. */
+      customData_layer_unshare(layer, (int)(MEM_allocN_len(layer->data) / typeInfo->size));
+    }
     layer->data = MEM_reallocN(layer->data, (size_t)totelem * typeInfo->size);
   }
 }
@@ -2282,19 +2406,15 @@ void CustomData_copy(const struct CustomData *source,
 
 static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
 {
-  const LayerTypeInfo *typeInfo;
-
-  if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
-    typeInfo = layerType_getInfo(layer->type);
-
-    if (typeInfo->free) {
-      typeInfo->free(layer->data, totelem, typeInfo->size);
-    }
-
-    if (layer->data) {
-      MEM_freeN(layer->data);
+  if (layer->sharing_info) {
+    /* The last user frees shared data, also when it was referenced. */
+    if (customData_layer_release(layer)) {
+      customData_layer_data_free(layer, layer->data, totelem);
     }
   }
+  else if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+    customData_layer_data_free(layer, layer->data, totelem);
+  }
 }
 
 static void CustomData_external_free(CustomData *data)
@@ -2684,6 +2804,7 @@ static CustomDataLayer *customData_add_layer__internal(CustomData *data,
   data->layers[index].type = type;
   data->layers[index].flag = flag;
   data->layers[index].data = newlayerdata;
+  data->layers[index].sharing_info = NULL;
 
   /* Set default name if none exists. Note we only call DATA_()  once
    * we know there is a default name, to avoid overhead of locale lookups
@@ -2869,7 +2990,13 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
 
   layer = &data->layers[layer_index];
 
-  if (layer->flag & CD_FLAG_NOFREE) {
+  if (layer->sharing_info) {
+    /* Only copies when the data is still used by other layers. This also applies to the layer
+     * the data was shared from, so that it can be modified or freed by the caller. */
+    customData_layer_unshare(layer, totelem);
+    layer->flag &= ~CD_FLAG_NOFREE;
+  }
+  else if (layer->flag & CD_FLAG_NOFREE) {
     /* MEM_dupallocN won't work in case of complex layers, like e.g.
      * CD_MDEFORMVERT, which has pointers to allocated data...
      * So in case a custom copy function is defined, use it!
@@ -3366,6 +3493,22 @@ const char *CustomData_get_layer_name(const CustomData *data, int type, int n)
   return (layer_index == -1) ? NULL : data->layers[layer_index].name;
 }
 
+/**
+ * Release the shared data of a layer whose pointer is about to be replaced. The previous data
+ * belongs to the remaining users, so it is only freed here when the layer was the last one.
+ */
+static void customData_layer_release_replaced(CustomDataLayer *layer)
+{
+  if (layer->sharing_info == NULL) {
+    return;
+  }
+  if (customData_layer_release(layer) && layer->data != NULL) {
+    const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+    customData_layer_data_free(
+        layer, layer->data, (int)(MEM_allocN_len(layer->data) / typeInfo->size));
+  }
+}
+
 void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
 {
   /* get the layer index of the first layer of type */
@@ -3375,6 +3518,7 @@ void *CustomData_set_layer(const CustomData *data, int type, void *ptr)
     return NULL;
   }
 
+  customData_layer_release_replaced(&data->layers[layer_index]);
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -3388,6 +3532,7 @@ void *CustomData_set_layer_n(const struct CustomData *data, int type, int n, voi
     return NULL;
   }
 
+  customData_layer_release_replaced(&data->layers[layer_index]);
   data->layers[layer_index].data = ptr;
 
   return ptr;
@@ -4374,7 +4519,8 @@ void CustomData_file_write_prepare(CustomData *data,
         }
         write_layers_size += chunk_size;
       }
-      write_layers[j++] = *layer;
+      write_layers[j] = *layer;
+      write_layers[j++].sharing_info = NULL;
     }
   }
   BLI_assert(j == data->totlayer);
@@ -5322,6 +5468,7 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing_info = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       BLO_read_data_address(reader, &layer->data);
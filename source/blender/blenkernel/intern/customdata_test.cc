@@ -0,0 +1,190 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "MEM_guardedalloc.h"
+
+#include "BKE_customdata.h"
+
+#include "DNA_customdata_types.h"
+
+#include "testing/testing.h"
+
+namespace blender::bke::tests {
+
+static const int TOTELEM = 8;
+
+static CustomData customdata_with_float_layer()
+{
+  CustomData data;
+  CustomData_reset(&data);
+  float *values = static_cast<float *>(
+      CustomData_add_layer(&data, CD_PROP_FLOAT, CD_CALLOC, nullptr, TOTELEM));
+  for (int i = 0; i < TOTELEM; i++) {
+    values[i] = float(i);
+  }
+  CustomData_ensure_shareable_layers(&data);
+  return data;
+}
+
+TEST(customdata_reference, SharesData)
+{
+  CustomData source = customdata_with_float_layer();
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+
+  EXPECT_EQ(CustomData_get_layer(&source, CD_PROP_FLOAT),
+            CustomData_get_layer(&dest, CD_PROP_FLOAT));
+  EXPECT_FALSE(CustomData_is_referenced_layer(&source, CD_PROP_FLOAT));
+  EXPECT_TRUE(CustomData_is_referenced_layer(&dest, CD_PROP_FLOAT));
+
+  CustomData_free(&dest, TOTELEM);
+  CustomData_free(&source, TOTELEM);
+}
+
+TEST(customdata_reference, OutlivesSource)
+{
+  CustomData source = customdata_with_float_layer();
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+  const void *shared_data = CustomData_get_layer(&dest, CD_PROP_FLOAT);
+
+  CustomData_free(&source, TOTELEM);
+
+  /* The last user of the shared data takes ownership instead of copying it. */
+  const float *values = static_cast<const float *>(
+      CustomData_duplicate_referenced_layer(&dest, CD_PROP_FLOAT, TOTELEM));
+  EXPECT_EQ(values, shared_data);
+  EXPECT_FALSE(CustomData_is_referenced_layer(&dest, CD_PROP_FLOAT));
+  for (int i = 0; i < TOTELEM; i++) {
+    EXPECT_EQ(values[i], float(i));
+  }
+
+  CustomData_free(&dest, TOTELEM);
+}
+
+TEST(customdata_reference, DuplicateWhileShared)
+{
+  CustomData source = customdata_with_float_layer();
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+
+  float *values = static_cast<float *>(
+      CustomData_duplicate_referenced_layer(&dest, CD_PROP_FLOAT, TOTELEM));
+  const float *source_values = static_cast<const float *>(
+      CustomData_get_layer(&source, CD_PROP_FLOAT));
+  EXPECT_NE(values, source_values);
+  values[0] = -1.0f;
+  EXPECT_EQ(source_values[0], 0.0f);
+
+  CustomData_free(&source, TOTELEM);
+  CustomData_free(&dest, TOTELEM);
+}
+
+TEST(customdata_reference, ChainedReferences)
+{
+  CustomData source = customdata_with_float_layer();
+  CustomData first, second;
+  CustomData_copy(&source, &first, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+  CustomData_copy(&first, &second, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+
+  CustomData_free(&source, TOTELEM);
+  CustomData_free(&first, TOTELEM);
+
+  const float *values = static_cast<const float *>(CustomData_get_layer(&second, CD_PROP_FLOAT));
+  for (int i = 0; i < TOTELEM; i++) {
+    EXPECT_EQ(values[i], float(i));
+  }
+
+  CustomData_free(&second, TOTELEM);
+}
+
+TEST(customdata_reference, SetLayerWhileShared)
+{
+  CustomData source = customdata_with_float_layer();
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+  const float *source_values = static_cast<const float *>(
+      CustomData_get_layer(&source, CD_PROP_FLOAT));
+
+  /* The replaced data is still used by the source, so it must stay valid. */
+  float *new_values = static_cast<float *>(MEM_calloc_arrayN(TOTELEM, sizeof(float), __func__));
+  EXPECT_EQ(CustomData_set_layer(&dest, CD_PROP_FLOAT, new_values), new_values);
+  EXPECT_EQ(dest.layers[0].sharing_info, nullptr);
+  for (int i = 0; i < TOTELEM; i++) {
+    EXPECT_EQ(source_values[i], float(i));
+  }
+
+  CustomData_free(&dest, TOTELEM);
+  CustomData_free(&source, TOTELEM);
+}
+
+TEST(customdata_reference, SetLayerLastUser)
+{
+  const uint blocks_num = MEM_get_memory_blocks_in_use();
+  CustomData source = customdata_with_float_layer();
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+  CustomData_free(&source, TOTELEM);
+
+  /* The last user frees the replaced data itself. */
+  CustomData_set_layer(&dest, CD_PROP_FLOAT, nullptr);
+  CustomData_free(&dest, TOTELEM);
+  EXPECT_EQ(MEM_get_memory_blocks_in_use(), blocks_num);
+}
+
+TEST(customdata_reference, DuplicateSourceWhileShared)
+{
+  CustomData source = customdata_with_float_layer();
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+  const float *dest_values = static_cast<const float *>(
+      CustomData_get_layer(&dest, CD_PROP_FLOAT));
+
+  /* Taking over the source data (e.g. to free it) leaves the references intact. */
+  float *values = static_cast<float *>(
+      CustomData_duplicate_referenced_layer(&source, CD_PROP_FLOAT, TOTELEM));
+  EXPECT_NE(values, dest_values);
+  CustomData_set_layer(&source, CD_PROP_FLOAT, nullptr);
+  MEM_freeN(values);
+  for (int i = 0; i < TOTELEM; i++) {
+    EXPECT_EQ(dest_values[i], float(i));
+  }
+
+  CustomData_free(&source, TOTELEM);
+  CustomData_free(&dest, TOTELEM);
+}
+
+TEST(customdata_reference, PlainReferenceLeavesSource)
+{
+  CustomData source;
+  CustomData_reset(&source);
+  CustomData_add_layer(&source, CD_PROP_FLOAT, CD_CALLOC, nullptr, TOTELEM);
+  CustomData dest;
+  CustomData_copy(&source, &dest, CD_MASK_PROP_FLOAT, CD_REFERENCE, TOTELEM);
+
+  /* Sources which weren't made shareable are referenced without being modified. */
+  EXPECT_EQ(dest.layers[0].sharing_info, nullptr);
+  EXPECT_EQ(CustomData_get_layer(&source, CD_PROP_FLOAT),
+            CustomData_get_layer(&dest, CD_PROP_FLOAT));
+
+  CustomData_free(&dest, TOTELEM);
+  CustomData_free(&source, TOTELEM);
+}
+
+}  // namespace blender::bke::tests
@@ -38,6 +38,7 @@
 #include "BLI_math.h"
 #include "BLI_string.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -997,6 +998,61 @@ void BKE_defvert_array_free(MDeformVert *dvert, int totvert)
   MEM_freeN(dvert);
 }
 
+/* Below this amount of vertices, processing a vgroup is not worth threading. */
+#define DEFVERT_PARALLEL_THRESHOLD 10000
+
+typedef struct DefvertExtractData {
+  const MDeformVert *dvert;
+  int defgroup;
+  const int *indices;
+  float default_weight;
+  bool invert_vgroup;
+  float *r_weights;
+  MDeformWeight **r_dws;
+} DefvertExtractData;
+
+static void defvert_extract_vgroup_task_cb(void *__restrict userdata,
+                                           const int i,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const DefvertExtractData *data = userdata;
+  const MDeformVert *dv = &data->dvert[data->indices ? data->indices[i] : i];
+  MDeformWeight *dw = BKE_defvert_find_index(dv, data->defgroup);
+
+  if (data->r_weights) {
+    const float w = dw ? dw->weight : data->default_weight;
+    data->r_weights[i] = data->invert_vgroup ? (1.0f - w) : w;
+  }
+  if (data->r_dws) {
+    data->r_dws[i] = dw;
+  }
+}
+
+static void defvert_extract_vgroup(const MDeformVert *dvert,
+                                   const int defgroup,
+                                   const int num,
+                                   const int *indices,
+                                   const float default_weight,
+                                   const bool invert_vgroup,
+                                   float *r_weights,
+                                   MDeformWeight **r_dws)
+{
+  DefvertExtractData data = {
+      .dvert = dvert,
+      .defgroup = defgroup,
+      .indices = indices,
+      .default_weight = default_weight,
+      .invert_vgroup = invert_vgroup,
+      .r_weights = r_weights,
+      .r_dws = r_dws,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (num > DEFVERT_PARALLEL_THRESHOLD);
+  BLI_task_parallel_range(0, num, &data, defvert_extract_vgroup_task_cb, &settings);
+}
+
 void BKE_defvert_extract_vgroup_to_vertweights(MDeformVert *dvert,
                                                const int defgroup,
                                                const int num_verts,
@@ -1004,18 +1060,114 @@ void BKE_defvert_extract_vgroup_to_vertweights(MDeformVert *dvert,
                                                const bool invert_vgroup)
 {
   if (dvert && defgroup != -1) {
-    int i = num_verts;
-
-    while (i--) {
-      const float w = BKE_defvert_find_weight(&dvert[i], defgroup);
-      r_weights[i] = invert_vgroup ? (1.0f - w) : w;
-    }
+    defvert_extract_vgroup(
+        dvert, defgroup, num_verts, NULL, 0.0f, invert_vgroup, r_weights, NULL);
   }
   else {
     copy_vn_fl(r_weights, num_verts, invert_vgroup ? 1.0f : 0.0f);
   }
 }
 
+/**
+ * Dense extraction of a vgroup, to process its weights as plain arrays.
+ *
+ * For each vertex (or each vertex in \a indices when not NULL), get its weight in \a r_weights
+ * (\a default_weight when the vertex is not in the vgroup), and its #MDeformWeight in \a r_dws
+ * (NULL when the vertex is not in the vgroup). Both outputs are optional.
+ *
+ * The #MDeformWeight pointers remain valid until the weights of their vertex are changed, they can
+ * be given to #BKE_defvert_apply_vgroup_weights to write the weights back without searching again.
+ */
+void BKE_defvert_extract_vgroup_dense(const MDeformVert *dvert,
+                                      const int defgroup,
+                                      const int num,
+                                      const int *indices,
+                                      const float default_weight,
+                                      float *r_weights,
+                                      MDeformWeight **r_dws)
+{
+  BLI_assert(dvert && defgroup >= 0);
+  defvert_extract_vgroup(dvert, defgroup, num, indices, default_weight, false, r_weights, r_dws);
+}
+
+typedef struct DefvertApplyData {
+  MDeformVert *dvert;
+  int defgroup;
+  MDeformWeight **dws;
+  const int *indices;
+  const float *weights;
+  bool do_add;
+  float add_thresh;
+  bool do_rem;
+  float rem_thresh;
+} DefvertApplyData;
+
+static void defvert_apply_vgroup_weights_task_cb(void *__restrict userdata,
+                                                 const int i,
+                                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const DefvertApplyData *data = userdata;
+  MDeformVert *dv = &data->dvert[data->indices ? data->indices[i] : i];
+  MDeformWeight *dw = data->dws ? data->dws[i] : BKE_defvert_find_index(dv, data->defgroup);
+  float w = data->weights[i];
+
+  /* Never allow weights out of [0.0, 1.0] range. */
+  CLAMP(w, 0.0f, 1.0f);
+
+  /* If the vertex is in this vgroup, remove it if needed, or just update it. */
+  if (dw != NULL) {
+    if (data->do_rem && w < data->rem_thresh) {
+      BKE_defvert_remove_group(dv, dw);
+    }
+    else {
+      dw->weight = w;
+    }
+  }
+  /* Else, add it if needed! */
+  else if (data->do_add && w > data->add_thresh) {
+    BKE_defvert_add_index_notest(dv, data->defgroup, w);
+  }
+}
+
+/**
+ * Write back dense weights of a vgroup, clamped to [0.0, 1.0] range, optionally adding vertices
+ * to or removing vertices from the vgroup based on their new weight.
+ *
+ * \param dws: When not NULL, the #MDeformWeight of each element,
+ * as given by #BKE_defvert_extract_vgroup_dense.
+ * \param indices: When not NULL, the vertex index of each element.
+ *
+ * Every element must refer to a different vertex, they are processed in parallel.
+ */
+void BKE_defvert_apply_vgroup_weights(MDeformVert *dvert,
+                                      const int defgroup,
+                                      MDeformWeight **dws,
+                                      const int num,
+                                      const int *indices,
+                                      const float *weights,
+                                      const bool do_add,
+                                      const float add_thresh,
+                                      const bool do_rem,
+                                      const float rem_thresh)
+{
+  DefvertApplyData data = {
+      .dvert = dvert,
+      .defgroup = defgroup,
+      .dws = dws,
+      .indices = indices,
+      .weights = weights,
+      .do_add = do_add,
+      .add_thresh = add_thresh,
+      .do_rem = do_rem,
+      .rem_thresh = rem_thresh,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (num > DEFVERT_PARALLEL_THRESHOLD);
+  BLI_task_parallel_range(0, num, &data, defvert_apply_vgroup_weights_task_cb, &settings);
+}
+
 /**
  * The following three make basic interpolation,
  * using temp vert_weights array to avoid looking up same weight several times.
@@ -45,6 +45,7 @@
 #include "BLI_math.h"
 #include "BLI_noise.h"
 #include "BLI_rand.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "PIL_time.h"
@@ -846,8 +847,11 @@ static void do_texture_effector(EffectorCache *eff,
 
   scene_color_manage = BKE_scene_check_color_management_enabled(eff->scene);
 
+  /* Points may be evaluated in parallel, texture nodes need a stack per thread. */
+  const int thread = BLI_task_parallel_thread_id(NULL);
+
   hasrgb = multitex_ext(
-      eff->pd->tex, tex_co, NULL, NULL, 0, result, 0, NULL, scene_color_manage, false);
+      eff->pd->tex, tex_co, NULL, NULL, 0, result, thread, NULL, scene_color_manage, false);
 
   if (hasrgb && mode == PFIELD_TEX_RGB) {
     force[0] = (0.5f - result->tr) * strength;
@@ -859,17 +863,17 @@ static void do_texture_effector(EffectorCache *eff,
 
     tex_co[0] += nabla;
     multitex_ext(
-        eff->pd->tex, tex_co, NULL, NULL, 0, result + 1, 0, NULL, scene_color_manage, false);
+        eff->pd->tex, tex_co, NULL, NULL, 0, result + 1, thread, NULL, scene_color_manage, false);
 
     tex_co[0] -= nabla;
     tex_co[1] += nabla;
     multitex_ext(
-        eff->pd->tex, tex_co, NULL, NULL, 0, result + 2, 0, NULL, scene_color_manage, false);
+        eff->pd->tex, tex_co, NULL, NULL, 0, result + 2, thread, NULL, scene_color_manage, false);
 
     tex_co[1] -= nabla;
     tex_co[2] += nabla;
     multitex_ext(
-        eff->pd->tex, tex_co, NULL, NULL, 0, result + 3, 0, NULL, scene_color_manage, false);
+        eff->pd->tex, tex_co, NULL, NULL, 0, result + 3, thread, NULL, scene_color_manage, false);
 
     if (mode == PFIELD_TEX_GRAD || !hasrgb) { /* if we don't have rgb fall back to grad */
       /* generate intensity if texture only has rgb value */
@@ -1156,6 +1160,94 @@ void BKE_effectors_apply(ListBase *effectors,
   }
 }
 
+/* Noise of physical effectors is drawn from a random generator shared by all points, so the
+ * result depends on the order in which points are evaluated. */
+bool BKE_effectors_use_noise(const ListBase *effectors)
+{
+  if (effectors) {
+    LISTBASE_FOREACH (const EffectorCache *, eff, effectors) {
+      if (eff->pd->f_noise > 0.0f && eff->pd->forcefield != PFIELD_TEXTURE) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+typedef struct EffectorsApplyData {
+  ListBase *effectors;
+  ListBase *colliders;
+  EffectorWeights *weights;
+  EffectedPoint *points;
+  float (*force)[3];
+  float (*wind_force)[3];
+  float (*impulse)[3];
+} EffectorsApplyData;
+
+static void effectors_apply_task_cb(void *__restrict userdata,
+                                    const int i,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const EffectorsApplyData *data = userdata;
+
+  BKE_effectors_apply(data->effectors,
+                      data->colliders,
+                      data->weights,
+                      &data->points[i],
+                      data->force[i],
+                      data->wind_force ? data->wind_force[i] : NULL,
+                      data->impulse ? data->impulse[i] : NULL);
+}
+
+/* Same as #BKE_effectors_apply for every point of an array, evaluated in parallel.
+ * The `wind_force` and `impulse` arrays are optional. */
+void BKE_effectors_apply_array(ListBase *effectors,
+                               ListBase *colliders,
+                               EffectorWeights *weights,
+                               EffectedPoint *points,
+                               const int points_num,
+                               float (*force)[3],
+                               float (*wind_force)[3],
+                               float (*impulse)[3])
+{
+  if (effectors == NULL || BLI_listbase_is_empty(effectors) || points_num == 0) {
+    return;
+  }
+
+  EffectorsApplyData data = {
+      .effectors = effectors,
+      .colliders = colliders,
+      .weights = weights,
+      .points = points,
+      .force = force,
+      .wind_force = wind_force,
+      .impulse = impulse,
+  };
+
+  /* Without colliders, visibility would build a collider cache for every point. */
+  ListBase *colliders_visibility = NULL;
+  if (colliders == NULL) {
+    LISTBASE_FOREACH (EffectorCache *, eff, effectors) {
+      if (eff->pd->flag & PFIELD_VISIBILITY) {
+        /* The effector object itself is skipped by the visibility test. */
+        colliders_visibility = BKE_collider_cache_create(eff->depsgraph, NULL, NULL);
+        data.colliders = colliders_visibility;
+        break;
+      }
+    }
+  }
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = !BKE_effectors_use_noise(effectors);
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, points_num, &data, effectors_apply_task_cb, &settings);
+
+  if (colliders_visibility) {
+    BKE_collider_cache_free(&colliders_visibility);
+  }
+}
+
 /* ======== Simulation Debugging ======== */
 
 SimDebugData *_sim_debug_data = NULL;
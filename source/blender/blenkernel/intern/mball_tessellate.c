@@ -38,6 +38,7 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_global.h"
@@ -115,21 +116,25 @@ typedef struct process {     /* parameters, storage */
   MetaballBVHNode metaball_bvh; /* The simplest bvh */
   Box allbb;                    /* Bounding box of all metaelems */
 
-  MetaballBVHNode **bvh_queue; /* Queue used during bvh traversal */
-  unsigned int bvh_queue_size;
+  unsigned int bvh_queue_size; /* Size of the queue used during bvh traversal */
 
   CUBES *cubes;         /* stack of cubes waiting for polygonization */
   CENTERLIST **centers; /* cube center hash table */
   CORNER **corners;     /* corner value hash table */
   EDGELIST **edges;     /* edge and vertex id hash table */
 
+  CORNER **pending_corners;    /* corners which value isn't computed yet */
+  unsigned int totpending;     /* size of memory allocated for pending corners */
+  unsigned int curpending;     /* number of currently pending corners */
+
   int (*indices)[4];     /* output indices */
   unsigned int totindex; /* size of memory allocated for indices */
   unsigned int curindex; /* number of currently added indices */
 
   float (*co)[3], (*no)[3]; /* surface vertices - positions and normals */
-  unsigned int totvertex;   /* memory size */
-  unsigned int curvertex;   /* currently added vertices */
+  const CORNER *(*vert_corners)[2]; /* corners of the edge each vertex lies on */
+  unsigned int totvertex;           /* memory size */
+  unsigned int curvertex;           /* currently added vertices */
 
   /* memory allocation from common pool */
   MemArena *pgn_elements;
@@ -139,7 +144,11 @@ typedef struct process {     /* parameters, storage */
 static int vertid(PROCESS *process, const CORNER *c1, const CORNER *c2);
 static void add_cube(PROCESS *process, int i, int j, int k);
 static void make_face(PROCESS *process, int i1, int i2, int i3, int i4);
-static void converge(PROCESS *process, const CORNER *c1, const CORNER *c2, float r_p[3]);
+static void converge(const PROCESS *process,
+                     MetaballBVHNode **bvh_queue,
+                     const CORNER *c1,
+                     const CORNER *c2,
+                     float r_p[3]);
 
 /* ******************* SIMPLE BVH ********************* */
 
@@ -406,25 +415,26 @@ static float densfunc(const MetaElem *ball, float x, float y, float z)
 
 /**
  * Computes density at given position form all meta-balls which contain this point in their box.
- * Traverses BVH using a queue.
+ * Traverses BVH using a queue, \a bvh_queue is owned by the calling thread.
  */
-static float metaball(PROCESS *process, float x, float y, float z)
+static float metaball(
+    const PROCESS *process, MetaballBVHNode **bvh_queue, float x, float y, float z)
 {
   int i;
   float dens = 0.0f;
   unsigned int front = 0, back = 0;
-  MetaballBVHNode *node;
+  const MetaballBVHNode *node;
 
-  process->bvh_queue[front++] = &process->metaball_bvh;
+  bvh_queue[front++] = (MetaballBVHNode *)&process->metaball_bvh;
 
   while (front != back) {
-    node = process->bvh_queue[back++];
+    node = bvh_queue[back++];
 
     for (i = 0; i < 2; i++) {
       if ((node->bb[i].min[0] <= x) && (node->bb[i].max[0] >= x) && (node->bb[i].min[1] <= y) &&
           (node->bb[i].max[1] >= y) && (node->bb[i].min[2] <= z) && (node->bb[i].max[2] >= z)) {
         if (node->child[i]) {
-          process->bvh_queue[front++] = node->child[i];
+          bvh_queue[front++] = node->child[i];
         }
         else {
           dens += densfunc(node->bb[i].ml, x, y, z);
@@ -443,10 +453,6 @@ static void make_face(PROCESS *process, int i1, int i2, int i3, int i4)
 {
   int *cur;
 
-#ifdef USE_ACCUM_NORMAL
-  float n[3];
-#endif
-
   if (UNLIKELY(process->totindex == process->curindex)) {
     process->totindex += 4096;
     process->indices = MEM_reallocN(process->indices, sizeof(int[4]) * process->totindex);
@@ -460,34 +466,47 @@ static void make_face(PROCESS *process, int i1, int i2, int i3, int i4)
   cur[1] = i2;
   cur[2] = i3;
   cur[3] = i4;
+}
 
 #ifdef USE_ACCUM_NORMAL
-  if (i4 == i3) {
-    normal_tri_v3(n, process->co[i1], process->co[i2], process->co[i3]);
-    accumulate_vertex_normals_v3(process->no[i1],
-                                 process->no[i2],
-                                 process->no[i3],
-                                 NULL,
-                                 n,
-                                 process->co[i1],
-                                 process->co[i2],
-                                 process->co[i3],
-                                 NULL);
-  }
-  else {
-    normal_quad_v3(n, process->co[i1], process->co[i2], process->co[i3], process->co[i4]);
-    accumulate_vertex_normals_v3(process->no[i1],
-                                 process->no[i2],
-                                 process->no[i3],
-                                 process->no[i4],
-                                 n,
-                                 process->co[i1],
-                                 process->co[i2],
-                                 process->co[i3],
-                                 process->co[i4]);
+/**
+ * Accumulates face normals into vertex normals, once vertex positions are known.
+ */
+static void accumulate_normals(PROCESS *process)
+{
+  float n[3];
+
+  for (unsigned int a = 0; a < process->curindex; a++) {
+    const int i1 = process->indices[a][0], i2 = process->indices[a][1];
+    const int i3 = process->indices[a][2], i4 = process->indices[a][3];
+
+    if (i4 == i3) {
+      normal_tri_v3(n, process->co[i1], process->co[i2], process->co[i3]);
+      accumulate_vertex_normals_v3(process->no[i1],
+                                   process->no[i2],
+                                   process->no[i3],
+                                   NULL,
+                                   n,
+                                   process->co[i1],
+                                   process->co[i2],
+                                   process->co[i3],
+                                   NULL);
+    }
+    else {
+      normal_quad_v3(n, process->co[i1], process->co[i2], process->co[i3], process->co[i4]);
+      accumulate_vertex_normals_v3(process->no[i1],
+                                   process->no[i2],
+                                   process->no[i3],
+                                   process->no[i4],
+                                   n,
+                                   process->co[i1],
+                                   process->co[i2],
+                                   process->co[i3],
+                                   process->co[i4]);
+    }
   }
-#endif
 }
+#endif
 
 /* Frees allocated memory */
 static void freepolygonize(PROCESS *process)
@@ -504,8 +523,11 @@ static void freepolygonize(PROCESS *process)
   if (process->mainb) {
     MEM_freeN(process->mainb);
   }
-  if (process->bvh_queue) {
-    MEM_freeN(process->bvh_queue);
+  if (process->pending_corners) {
+    MEM_freeN(process->pending_corners);
+  }
+  if (process->vert_corners) {
+    MEM_freeN(process->vert_corners);
   }
   if (process->pgn_elements) {
     BLI_memarena_free(process->pgn_elements);
@@ -670,12 +692,11 @@ static void docube(PROCESS *process, CUBE *cube)
 }
 
 /**
- * return corner with the given lattice location
- * set (and cache) its function value
+ * return corner with the given lattice location,
+ * its function value is computed later for all pending corners at once
  */
 static CORNER *setcorner(PROCESS *process, int i, int j, int k)
 {
-  /* for speed, do corner value caching here */
   CORNER *c;
   int index;
 
@@ -698,7 +719,14 @@ static CORNER *setcorner(PROCESS *process, int i, int j, int k)
   c->k = k;
   c->co[2] = ((float)k - 0.5f) * process->size;
 
-  c->value = metaball(process, c->co[0], c->co[1], c->co[2]);
+  c->value = 0.0f;
+
+  if (UNLIKELY(process->totpending == process->curpending)) {
+    process->totpending += 4096;
+    process->pending_corners = MEM_reallocN(process->pending_corners,
+                                            sizeof(CORNER *) * process->totpending);
+  }
+  process->pending_corners[process->curpending++] = c;
 
   c->next = process->corners[index];
   process->corners[index] = c;
@@ -946,18 +974,21 @@ static int getedge(EDGELIST *table[], int i1, int j1, int k1, int i2, int j2, in
 }
 
 /**
- * Adds a vertex, expands memory if needed.
+ * Adds a vertex lying on the edge between two corners, expands memory if needed.
+ * Its position and normal are computed later for all vertices at once.
  */
-static void addtovertices(PROCESS *process, const float v[3], const float no[3])
+static void addtovertices(PROCESS *process, const CORNER *c1, const CORNER *c2)
 {
   if (process->curvertex == process->totvertex) {
     process->totvertex += 4096;
     process->co = MEM_reallocN(process->co, process->totvertex * sizeof(float[3]));
     process->no = MEM_reallocN(process->no, process->totvertex * sizeof(float[3]));
+    process->vert_corners = MEM_reallocN(process->vert_corners,
+                                         process->totvertex * sizeof(*process->vert_corners));
   }
 
-  copy_v3_v3(process->co[process->curvertex], v);
-  copy_v3_v3(process->no[process->curvertex], no);
+  process->vert_corners[process->curvertex][0] = c1;
+  process->vert_corners[process->curvertex][1] = c2;
 
   process->curvertex++;
 }
@@ -968,40 +999,34 @@ static void addtovertices(PROCESS *process, const float v[3], const float no[3])
  *
  * \note Doesn't do normalization!
  */
-static void vnormal(PROCESS *process, const float point[3], float r_no[3])
+static void vnormal(const PROCESS *process,
+                    MetaballBVHNode **bvh_queue,
+                    const float point[3],
+                    float r_no[3])
 {
   const float delta = process->delta;
-  const float f = metaball(process, point[0], point[1], point[2]);
+  const float f = metaball(process, bvh_queue, point[0], point[1], point[2]);
 
-  r_no[0] = metaball(process, point[0] + delta, point[1], point[2]) - f;
-  r_no[1] = metaball(process, point[0], point[1] + delta, point[2]) - f;
-  r_no[2] = metaball(process, point[0], point[1], point[2] + delta) - f;
+  r_no[0] = metaball(process, bvh_queue, point[0] + delta, point[1], point[2]) - f;
+  r_no[1] = metaball(process, bvh_queue, point[0], point[1] + delta, point[2]) - f;
+  r_no[2] = metaball(process, bvh_queue, point[0], point[1], point[2] + delta) - f;
 }
 #endif /* USE_ACCUM_NORMAL */
 
 /**
  * \return the id of vertex between two corners.
  *
- * If it wasn't previously computed, does #converge() and adds vertex to process.
+ * If it wasn't previously added, adds vertex to process, see #polygonize_vertices().
  */
 static int vertid(PROCESS *process, const CORNER *c1, const CORNER *c2)
 {
-  float v[3], no[3];
   int vid = getedge(process->edges, c1->i, c1->j, c1->k, c2->i, c2->j, c2->k);
 
   if (vid != -1) {
     return vid; /* previously computed */
   }
 
-  converge(process, c1, c2, v); /* position */
-
-#ifdef USE_ACCUM_NORMAL
-  zero_v3(no);
-#else
-  vnormal(process, v, no);
-#endif
-
-  addtovertices(process, v, no); /* save vertex */
+  addtovertices(process, c1, c2); /* save vertex */
   vid = (int)process->curvertex - 1;
   setedge(process, c1->i, c1->j, c1->k, c2->i, c2->j, c2->k, vid);
 
@@ -1012,7 +1037,11 @@ static int vertid(PROCESS *process, const CORNER *c1, const CORNER *c2)
  * Given two corners, computes approximation of surface intersection point between them.
  * In case of small threshold, do bisection.
  */
-static void converge(PROCESS *process, const CORNER *c1, const CORNER *c2, float r_p[3])
+static void converge(const PROCESS *process,
+                     MetaballBVHNode **bvh_queue,
+                     const CORNER *c1,
+                     const CORNER *c2,
+                     float r_p[3])
 {
   float tmp, dens;
   unsigned int i;
@@ -1034,7 +1063,7 @@ static void converge(PROCESS *process, const CORNER *c1, const CORNER *c2, float
 
   for (i = 0; i < process->converge_res; i++) {
     interp_v3_v3v3(r_p, c1_co, c2_co, 0.5f);
-    dens = metaball(process, r_p[0], r_p[1], r_p[2]);
+    dens = metaball(process, bvh_queue, r_p[0], r_p[1], r_p[2]);
 
     if (dens > 0.0f) {
       c1_value = dens;
@@ -1097,14 +1126,31 @@ static void closest_latice(int r[3], const float pos[3], const float size)
   r[2] = (int)floorf(pos[2] / size + 1.0f);
 }
 
+/**
+ * Function value at the given lattice location, the same as #setcorner() computes.
+ */
+static float lattice_value(const PROCESS *process, MetaballBVHNode **bvh_queue, const int it[3])
+{
+  return metaball(process,
+                  bvh_queue,
+                  ((float)it[0] - 0.5f) * process->size,
+                  ((float)it[1] - 0.5f) * process->size,
+                  ((float)it[2] - 0.5f) * process->size);
+}
+
 /**
  * Find at most 26 cubes to start polygonization from.
+ * \return the number of cubes written to \a r_cubes.
  */
-static void find_first_points(PROCESS *process, const unsigned int em)
+static int find_first_points(const PROCESS *process,
+                             MetaballBVHNode **bvh_queue,
+                             const unsigned int em,
+                             int r_cubes[26][3])
 {
   const MetaElem *ml;
   int center[3], lbn[3], rtf[3], it[3], dir[3], add[3];
   float tmp[3], a, b;
+  int cubes_len = 0;
 
   ml = process->mainb[em];
 
@@ -1122,20 +1168,20 @@ static void find_first_points(PROCESS *process, const unsigned int em)
 
         copy_v3_v3_int(it, center);
 
-        b = setcorner(process, it[0], it[1], it[2])->value;
+        b = lattice_value(process, bvh_queue, it);
         do {
           it[0] += dir[0];
           it[1] += dir[1];
           it[2] += dir[2];
           a = b;
-          b = setcorner(process, it[0], it[1], it[2])->value;
+          b = lattice_value(process, bvh_queue, it);
 
           if (a * b < 0.0f) {
             add[0] = it[0] - dir[0];
             add[1] = it[1] - dir[1];
             add[2] = it[2] - dir[2];
             DO_MIN(it, add);
-            add_cube(process, add[0], add[1], add[2]);
+            copy_v3_v3_int(r_cubes[cubes_len++], add);
             break;
           }
         } while ((it[0] > lbn[0]) && (it[1] > lbn[1]) && (it[2] > lbn[2]) && (it[0] < rtf[0]) &&
@@ -1143,6 +1189,136 @@ static void find_first_points(PROCESS *process, const unsigned int em)
       }
     }
   }
+
+  return cubes_len;
+}
+
+/**** Parallel Evaluation ****/
+
+/* The walk over the cubes is done on one thread, evaluating the density function
+ * (the expensive part) is done in parallel: for all corners of every wave of cubes
+ * added by the walk and for all vertices once the walk is done. */
+
+typedef struct PolygonizeTLS {
+  MetaballBVHNode **bvh_queue;
+} PolygonizeTLS;
+
+typedef struct FirstPointsData {
+  const PROCESS *process;
+  int (*cubes)[26][3];
+  int *cubes_len;
+} FirstPointsData;
+
+static MetaballBVHNode **polygonize_tls_bvh_queue(const PROCESS *process,
+                                                  const TaskParallelTLS *__restrict tls)
+{
+  PolygonizeTLS *data = tls->userdata_chunk;
+  if (data->bvh_queue == NULL) {
+    data->bvh_queue = MEM_mallocN(sizeof(MetaballBVHNode *) * process->bvh_queue_size, __func__);
+  }
+  return data->bvh_queue;
+}
+
+static void polygonize_tls_free(const void *__restrict UNUSED(userdata), void *__restrict chunk)
+{
+  PolygonizeTLS *data = chunk;
+  MEM_SAFE_FREE(data->bvh_queue);
+}
+
+static void polygonize_parallel_range(void *userdata, const int len, TaskParallelRangeFunc func)
+{
+  PolygonizeTLS tls = {NULL};
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (len > 256);
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  settings.func_free = polygonize_tls_free;
+  BLI_task_parallel_range(0, len, userdata, func, &settings);
+}
+
+static void first_points_task_cb(void *__restrict userdata,
+                                 const int em,
+                                 const TaskParallelTLS *__restrict tls)
+{
+  FirstPointsData *data = userdata;
+  MetaballBVHNode **bvh_queue = polygonize_tls_bvh_queue(data->process, tls);
+  data->cubes_len[em] = find_first_points(
+      data->process, bvh_queue, (unsigned int)em, data->cubes[em]);
+}
+
+static void corner_value_task_cb(void *__restrict userdata,
+                                 const int i,
+                                 const TaskParallelTLS *__restrict tls)
+{
+  PROCESS *process = userdata;
+  MetaballBVHNode **bvh_queue = polygonize_tls_bvh_queue(process, tls);
+  CORNER *c = process->pending_corners[i];
+
+  c->value = metaball(process, bvh_queue, c->co[0], c->co[1], c->co[2]);
+}
+
+static void vertex_task_cb(void *__restrict userdata,
+                           const int i,
+                           const TaskParallelTLS *__restrict tls)
+{
+  PROCESS *process = userdata;
+  MetaballBVHNode **bvh_queue = polygonize_tls_bvh_queue(process, tls);
+
+  converge(process,
+           bvh_queue,
+           process->vert_corners[i][0],
+           process->vert_corners[i][1],
+           process->co[i]); /* position */
+
+#ifdef USE_ACCUM_NORMAL
+  zero_v3(process->no[i]);
+#else
+  vnormal(process, bvh_queue, process->co[i], process->no[i]);
+#endif
+}
+
+/**
+ * Adds the cubes to start polygonization from for all elements, in element order.
+ */
+static void polygonize_first_points(PROCESS *process)
+{
+  FirstPointsData data = {
+      .process = process,
+      .cubes = MEM_mallocN(sizeof(*data.cubes) * process->totelem, __func__),
+      .cubes_len = MEM_mallocN(sizeof(int) * process->totelem, __func__),
+  };
+  polygonize_parallel_range(&data, (int)process->totelem, first_points_task_cb);
+
+  for (unsigned int em = 0; em < process->totelem; em++) {
+    for (int i = 0; i < data.cubes_len[em]; i++) {
+      add_cube(process, data.cubes[em][i][0], data.cubes[em][i][1], data.cubes[em][i][2]);
+    }
+  }
+
+  MEM_freeN(data.cubes);
+  MEM_freeN(data.cubes_len);
+}
+
+/**
+ * Computes values of all corners created since the last call.
+ */
+static void polygonize_pending_corners(PROCESS *process)
+{
+  polygonize_parallel_range(process, (int)process->curpending, corner_value_task_cb);
+  process->curpending = 0;
+}
+
+/**
+ * Computes positions and normals of all vertices.
+ */
+static void polygonize_vertices(PROCESS *process)
+{
+  polygonize_parallel_range(process, (int)process->curvertex, vertex_task_cb);
+
+#ifdef USE_ACCUM_NORMAL
+  accumulate_normals(process);
+#endif
 }
 
 /**
@@ -1150,30 +1326,35 @@ static void find_first_points(PROCESS *process, const unsigned int em)
  * Allocates memory, makes cubetable,
  * finds starting surface points
  * and processes cubes on the stack until none left.
+ *
+ * Cubes are processed in waves: values of the corners of all cubes added by
+ * the previous wave are computed at once before the cubes are polygonized.
+ * The set of processed cubes, and so the resulting surface, doesn't depend on
+ * the order cubes are processed in. The order of the output vertices and faces
+ * does: it follows the waves rather than a depth first walk of the cubes.
  */
 static void polygonize(PROCESS *process)
 {
-  CUBE c;
-  unsigned int i;
-
   process->centers = MEM_callocN(HASHSIZE * sizeof(CENTERLIST *), "mbproc->centers");
   process->corners = MEM_callocN(HASHSIZE * sizeof(CORNER *), "mbproc->corners");
   process->edges = MEM_callocN(2 * HASHSIZE * sizeof(EDGELIST *), "mbproc->edges");
-  process->bvh_queue = MEM_callocN(sizeof(MetaballBVHNode *) * process->bvh_queue_size,
-                                   "Metaball BVH Queue");
 
   makecubetable();
 
-  for (i = 0; i < process->totelem; i++) {
-    find_first_points(process, i);
-  }
+  polygonize_first_points(process);
 
   while (process->cubes != NULL) {
-    c = process->cubes->cube;
-    process->cubes = process->cubes->next;
+    CUBES *cubes = process->cubes;
+    process->cubes = NULL;
+
+    polygonize_pending_corners(process);
 
-    docube(process, &c);
+    for (; cubes; cubes = cubes->next) {
+      docube(process, &cubes->cube);
+    }
   }
+
+  polygonize_vertices(process);
 }
 
 /**
@@ -125,6 +125,8 @@ static void mesh_copy_data(Main *bmain, ID *id_dst, const ID *id_src, const int
 
   mesh_dst->mat = MEM_dupallocN(mesh_src->mat);
 
+  /* Copy-on-write copies of original meshes still duplicate their layers: code editing original
+   * meshes writes to layers in place, which would show through in copies sharing them. */
   const eCDAllocType alloc_type = (flag & LIB_ID_COPY_CD_REFERENCE) ? CD_REFERENCE : CD_DUPLICATE;
   CustomData_copy(&mesh_src->vdata, &mesh_dst->vdata, mask.vmask, alloc_type, mesh_dst->totvert);
   CustomData_copy(&mesh_src->edata, &mesh_dst->edata, mask.emask, alloc_type, mesh_dst->totedge);
@@ -976,6 +978,12 @@ Mesh *BKE_mesh_copy_for_eval(struct Mesh *source, bool reference)
 
   if (reference) {
     flags |= LIB_ID_COPY_CD_REFERENCE;
+    /* Keep the layers of the copy valid when the source is freed first. */
+    CustomData_ensure_shareable_layers(&source->vdata);
+    CustomData_ensure_shareable_layers(&source->edata);
+    CustomData_ensure_shareable_layers(&source->ldata);
+    CustomData_ensure_shareable_layers(&source->pdata);
+    CustomData_ensure_shareable_layers(&source->fdata);
   }
 
   Mesh *result;
@@ -32,6 +32,7 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_mesh_types.h"
@@ -316,13 +317,125 @@ Mesh *BKE_mesh_remesh_voxel_to_mesh_nomain(Mesh *mesh,
   return new_mesh;
 }
 
+typedef struct RemeshReprojectData {
+  const BVHTreeFromMesh *bvhtree;
+  /** The tree is made of looptris instead of vertices. */
+  bool use_looptri;
+
+  /** Query locations, the face centers when polygons are given, otherwise the vertices. */
+  const MVert *target_verts;
+  const MPoly *target_polys;
+  const MLoop *target_loops;
+
+  int *r_nearest_index;
+} RemeshReprojectData;
+
+typedef struct RemeshReprojectTLS {
+  /** Result of the previous query done by this thread. */
+  int index_hint;
+} RemeshReprojectTLS;
+
+static float remesh_reproject_dist_squared(const RemeshReprojectData *data,
+                                           const int index,
+                                           const float co[3])
+{
+  const BVHTreeFromMesh *bvhtree = data->bvhtree;
+
+  if (data->use_looptri) {
+    const MLoopTri *lt = &bvhtree->looptri[index];
+    float nearest_co[3];
+    closest_on_tri_to_point_v3(nearest_co,
+                               co,
+                               bvhtree->vert[bvhtree->loop[lt->tri[0]].v].co,
+                               bvhtree->vert[bvhtree->loop[lt->tri[1]].v].co,
+                               bvhtree->vert[bvhtree->loop[lt->tri[2]].v].co);
+    return len_squared_v3v3(co, nearest_co);
+  }
+  return len_squared_v3v3(co, bvhtree->vert[index].co);
+}
+
+static void remesh_reproject_nearest_task_cb(void *__restrict userdata,
+                                             const int i,
+                                             const TaskParallelTLS *__restrict tls)
+{
+  RemeshReprojectData *data = userdata;
+  RemeshReprojectTLS *tls_data = tls->userdata_chunk;
+  const BVHTreeFromMesh *bvhtree = data->bvhtree;
+  float from_co[3];
+
+  if (data->target_polys != NULL) {
+    const MPoly *mpoly = &data->target_polys[i];
+    BKE_mesh_calc_poly_center(
+        mpoly, &data->target_loops[mpoly->loopstart], data->target_verts, from_co);
+  }
+  else {
+    copy_v3_v3(from_co, data->target_verts[i].co);
+  }
+
+  BVHTreeNearest nearest;
+  nearest.index = -1;
+  nearest.dist_sq = FLT_MAX;
+
+  /* Consecutive target elements are close to each other, so the distance to the previous result
+   * is a tight bound for the search. Only the distance is used (with a margin for rounding), the
+   * hint itself is not a candidate, so the result is the same as for an unbounded search. */
+  if (tls_data->index_hint != -1) {
+    const float dist_sq = remesh_reproject_dist_squared(data, tls_data->index_hint, from_co);
+    nearest.dist_sq = dist_sq * (1.0f + 1e-5f) + FLT_EPSILON;
+  }
+
+  BLI_bvhtree_find_nearest(
+      bvhtree->tree, from_co, &nearest, bvhtree->nearest_callback, (void *)bvhtree);
+
+  data->r_nearest_index[i] = nearest.index;
+  if (nearest.index != -1) {
+    tls_data->index_hint = nearest.index;
+  }
+}
+
+/**
+ * Find the nearest element of \a bvhtree for each vertex of \a target,
+ * or for each face center when \a use_polys is set.
+ *
+ * \return An array of indices into the tree elements, -1 when nothing was found.
+ */
+static int *remesh_reproject_nearest_indices(const BVHTreeFromMesh *bvhtree,
+                                             const bool use_looptri,
+                                             Mesh *target,
+                                             const bool use_polys)
+{
+  const int totelem = use_polys ? target->totpoly : target->totvert;
+  int *nearest_index = MEM_malloc_arrayN(max_ii(totelem, 1), sizeof(int), __func__);
+
+  RemeshReprojectData data = {
+      .bvhtree = bvhtree,
+      .use_looptri = use_looptri,
+      .target_verts = CustomData_get_layer(&target->vdata, CD_MVERT),
+      .target_polys = use_polys ? CustomData_get_layer(&target->pdata, CD_MPOLY) : NULL,
+      .target_loops = CustomData_get_layer(&target->ldata, CD_MLOOP),
+      .r_nearest_index = nearest_index,
+  };
+  RemeshReprojectTLS tls = {
+      .index_hint = -1,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (totelem > 10000);
+  settings.min_iter_per_thread = 1024;
+  settings.userdata_chunk = &tls;
+  settings.userdata_chunk_size = sizeof(tls);
+  BLI_task_parallel_range(0, totelem, &data, remesh_reproject_nearest_task_cb, &settings);
+
+  return nearest_index;
+}
+
 void BKE_mesh_remesh_reproject_paint_mask(Mesh *target, Mesh *source)
 {
   BVHTreeFromMesh bvhtree = {
       .nearest_callback = NULL,
   };
   BKE_bvhtree_from_mesh_get(&bvhtree, source, BVHTREE_FROM_VERTS, 2);
-  MVert *target_verts = CustomData_get_layer(&target->vdata, CD_MVERT);
 
   float *target_mask;
   if (CustomData_has_layer(&target->vdata, CD_PAINT_MASK)) {
@@ -342,17 +455,13 @@ void BKE_mesh_remesh_reproject_paint_mask(Mesh *target, Mesh *source)
         &source->vdata, CD_PAINT_MASK, CD_CALLOC, NULL, source->totvert);
   }
 
+  int *nearest_index = remesh_reproject_nearest_indices(&bvhtree, false, target, false);
   for (int i = 0; i < target->totvert; i++) {
-    float from_co[3];
-    BVHTreeNearest nearest;
-    nearest.index = -1;
-    nearest.dist_sq = FLT_MAX;
-    copy_v3_v3(from_co, target_verts[i].co);
-    BLI_bvhtree_find_nearest(bvhtree.tree, from_co, &nearest, bvhtree.nearest_callback, &bvhtree);
-    if (nearest.index != -1) {
-      target_mask[i] = source_mask[nearest.index];
+    if (nearest_index[i] != -1) {
+      target_mask[i] = source_mask[nearest_index[i]];
     }
   }
+  MEM_freeN(nearest_index);
   free_bvhtree_from_mesh(&bvhtree);
 }
 
@@ -362,10 +471,6 @@ void BKE_remesh_reproject_sculpt_face_sets(Mesh *target, Mesh *source)
       .nearest_callback = NULL,
   };
 
-  const MPoly *target_polys = CustomData_get_layer(&target->pdata, CD_MPOLY);
-  const MVert *target_verts = CustomData_get_layer(&target->vdata, CD_MVERT);
-  const MLoop *target_loops = CustomData_get_layer(&target->ldata, CD_MLOOP);
-
   int *target_face_sets;
   if (CustomData_has_layer(&target->pdata, CD_SCULPT_FACE_SETS)) {
     target_face_sets = CustomData_get_layer(&target->pdata, CD_SCULPT_FACE_SETS);
@@ -387,21 +492,16 @@ void BKE_remesh_reproject_sculpt_face_sets(Mesh *target, Mesh *source)
   const MLoopTri *looptri = BKE_mesh_runtime_looptri_ensure(source);
   BKE_bvhtree_from_mesh_get(&bvhtree, source, BVHTREE_FROM_LOOPTRI, 2);
 
+  int *nearest_index = remesh_reproject_nearest_indices(&bvhtree, true, target, true);
   for (int i = 0; i < target->totpoly; i++) {
-    float from_co[3];
-    BVHTreeNearest nearest;
-    nearest.index = -1;
-    nearest.dist_sq = FLT_MAX;
-    const MPoly *mpoly = &target_polys[i];
-    BKE_mesh_calc_poly_center(mpoly, &target_loops[mpoly->loopstart], target_verts, from_co);
-    BLI_bvhtree_find_nearest(bvhtree.tree, from_co, &nearest, bvhtree.nearest_callback, &bvhtree);
-    if (nearest.index != -1) {
-      target_face_sets[i] = source_face_sets[looptri[nearest.index].poly];
+    if (nearest_index[i] != -1) {
+      target_face_sets[i] = source_face_sets[looptri[nearest_index[i]].poly];
     }
     else {
       target_face_sets[i] = 1;
     }
   }
+  MEM_freeN(nearest_index);
   free_bvhtree_from_mesh(&bvhtree);
 }
 
@@ -410,9 +510,16 @@ void BKE_remesh_reproject_vertex_paint(Mesh *target, Mesh *source)
   BVHTreeFromMesh bvhtree = {
       .nearest_callback = NULL,
   };
-  BKE_bvhtree_from_mesh_get(&bvhtree, source, BVHTREE_FROM_VERTS, 2);
 
   int tot_color_layer = CustomData_number_of_layers(&source->vdata, CD_PROP_COLOR);
+  if (tot_color_layer == 0) {
+    return;
+  }
+
+  BKE_bvhtree_from_mesh_get(&bvhtree, source, BVHTREE_FROM_VERTS, 2);
+
+  /* The nearest vertices are the same for all layers. */
+  int *nearest_index = remesh_reproject_nearest_indices(&bvhtree, false, target, false);
 
   for (int layer_n = 0; layer_n < tot_color_layer; layer_n++) {
     const char *layer_name = CustomData_get_layer_name(&source->vdata, CD_PROP_COLOR, layer_n);
@@ -420,19 +527,14 @@ void BKE_remesh_reproject_vertex_paint(Mesh *target, Mesh *source)
         &target->vdata, CD_PROP_COLOR, CD_CALLOC, NULL, target->totvert, layer_name);
 
     MPropCol *target_color = CustomData_get_layer_n(&target->vdata, CD_PROP_COLOR, layer_n);
-    MVert *target_verts = CustomData_get_layer(&target->vdata, CD_MVERT);
     MPropCol *source_color = CustomData_get_layer_n(&source->vdata, CD_PROP_COLOR, layer_n);
     for (int i = 0; i < target->totvert; i++) {
-      BVHTreeNearest nearest;
-      nearest.index = -1;
-      nearest.dist_sq = FLT_MAX;
-      BLI_bvhtree_find_nearest(
-          bvhtree.tree, target_verts[i].co, &nearest, bvhtree.nearest_callback, &bvhtree);
-      if (nearest.index != -1) {
-        copy_v4_v4(target_color[i].color, source_color[nearest.index].color);
+      if (nearest_index[i] != -1) {
+        copy_v4_v4(target_color[i].color, source_color[nearest_index[i]].color);
       }
     }
   }
+  MEM_freeN(nearest_index);
   free_bvhtree_from_mesh(&bvhtree);
 }
 
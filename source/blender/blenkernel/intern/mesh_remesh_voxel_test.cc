@@ -0,0 +1,172 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "testing/testing.h"
+
+#include <cfloat>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math.h"
+
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_remesh_voxel.h"
+#include "BKE_mesh_runtime.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+namespace blender::bke::tests {
+
+class mesh_remesh_reproject : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/* A wavy grid of `size * size` quads, spaced by `step` and moved by `offset`. */
+static Mesh *offset_grid_mesh_create(const int size, const float step, const float offset)
+{
+  Mesh *mesh = grid_mesh_create(size, step, 0.1f);
+  const float translation[3] = {offset, offset * 0.5f, offset};
+  BKE_mesh_translate(mesh, translation, false);
+  return mesh;
+}
+
+static float nearest_vert_dist_sq(const Mesh *source, const float co[3])
+{
+  float dist_sq = FLT_MAX;
+  for (int i = 0; i < source->totvert; i++) {
+    dist_sq = min_ff(dist_sq, len_squared_v3v3(co, source->mvert[i].co));
+  }
+  return dist_sq;
+}
+
+static float looptri_dist_sq(const Mesh *source, const MLoopTri *lt, const float co[3])
+{
+  float nearest_co[3];
+  closest_on_tri_to_point_v3(nearest_co,
+                             co,
+                             source->mvert[source->mloop[lt->tri[0]].v].co,
+                             source->mvert[source->mloop[lt->tri[1]].v].co,
+                             source->mvert[source->mloop[lt->tri[2]].v].co);
+  return len_squared_v3v3(co, nearest_co);
+}
+
+TEST_F(mesh_remesh_reproject, PaintMaskAndVertexColors)
+{
+  Mesh *source = offset_grid_mesh_create(24, 0.5f, 0.0f);
+  Mesh *target = offset_grid_mesh_create(37, 0.31f, 0.0137f);
+
+  /* Store the source vertex index, so the chosen vertex can be checked. */
+  float *source_mask = static_cast<float *>(
+      CustomData_add_layer(&source->vdata, CD_PAINT_MASK, CD_CALLOC, nullptr, source->totvert));
+  for (int layer_n = 0; layer_n < 2; layer_n++) {
+    CustomData_add_layer_named(
+        &source->vdata, CD_PROP_COLOR, CD_CALLOC, nullptr, source->totvert, "Color");
+  }
+  for (int i = 0; i < source->totvert; i++) {
+    source_mask[i] = float(i);
+    for (int layer_n = 0; layer_n < 2; layer_n++) {
+      MPropCol *color = static_cast<MPropCol *>(
+          CustomData_get_layer_n(&source->vdata, CD_PROP_COLOR, layer_n));
+      copy_v4_fl4(color[i].color, float(i), float(layer_n), 0.0f, 1.0f);
+    }
+  }
+
+  BKE_mesh_remesh_reproject_paint_mask(target, source);
+  BKE_remesh_reproject_vertex_paint(target, source);
+
+  const float *target_mask = static_cast<const float *>(
+      CustomData_get_layer(&target->vdata, CD_PAINT_MASK));
+  ASSERT_NE(target_mask, nullptr);
+  ASSERT_EQ(CustomData_number_of_layers(&target->vdata, CD_PROP_COLOR), 2);
+
+  for (int i = 0; i < target->totvert; i++) {
+    const float *co = target->mvert[i].co;
+    const int index = int(target_mask[i]);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, source->totvert);
+    EXPECT_FLOAT_EQ(len_squared_v3v3(co, source->mvert[index].co),
+                    nearest_vert_dist_sq(source, co));
+
+    for (int layer_n = 0; layer_n < 2; layer_n++) {
+      const MPropCol *color = static_cast<const MPropCol *>(
+          CustomData_get_layer_n(&target->vdata, CD_PROP_COLOR, layer_n));
+      EXPECT_EQ(color[i].color[0], float(index));
+      EXPECT_EQ(color[i].color[1], float(layer_n));
+    }
+  }
+
+  BKE_id_free(nullptr, source);
+  BKE_id_free(nullptr, target);
+}
+
+TEST_F(mesh_remesh_reproject, FaceSets)
+{
+  Mesh *source = offset_grid_mesh_create(24, 0.5f, 0.0f);
+  Mesh *target = offset_grid_mesh_create(37, 0.31f, 0.0137f);
+
+  int *source_face_sets = static_cast<int *>(CustomData_add_layer(
+      &source->pdata, CD_SCULPT_FACE_SETS, CD_CALLOC, nullptr, source->totpoly));
+  for (int i = 0; i < source->totpoly; i++) {
+    source_face_sets[i] = i + 1;
+  }
+
+  BKE_remesh_reproject_sculpt_face_sets(target, source);
+
+  const int *target_face_sets = static_cast<const int *>(
+      CustomData_get_layer(&target->pdata, CD_SCULPT_FACE_SETS));
+  ASSERT_NE(target_face_sets, nullptr);
+
+  const MLoopTri *looptri = BKE_mesh_runtime_looptri_ensure(source);
+  const int looptri_len = BKE_mesh_runtime_looptri_len(source);
+
+  for (int i = 0; i < target->totpoly; i++) {
+    const MPoly *mpoly = &target->mpoly[i];
+    float co[3];
+    BKE_mesh_calc_poly_center(mpoly, &target->mloop[mpoly->loopstart], target->mvert, co);
+
+    const int poly = target_face_sets[i] - 1;
+    ASSERT_GE(poly, 0);
+    ASSERT_LT(poly, source->totpoly);
+
+    float dist_sq = FLT_MAX, poly_dist_sq = FLT_MAX;
+    for (int j = 0; j < looptri_len; j++) {
+      const float lt_dist_sq = looptri_dist_sq(source, &looptri[j], co);
+      dist_sq = min_ff(dist_sq, lt_dist_sq);
+      if (int(looptri[j].poly) == poly) {
+        poly_dist_sq = min_ff(poly_dist_sq, lt_dist_sq);
+      }
+    }
+    EXPECT_FLOAT_EQ(poly_dist_sq, dist_sq);
+  }
+
+  BKE_id_free(nullptr, source);
+  BKE_id_free(nullptr, target);
+}
+
+}  // namespace blender::bke::tests
@@ -144,6 +144,40 @@ void BKE_mesh_runtime_looptri_recalc(Mesh *mesh)
   mesh->runtime.looptris.array_wip = NULL;
 }
 
+/**
+ * Copy already computed looptris of \a mesh_src to \a mesh_dst instead of recomputing them.
+ * Only valid when both meshes share the same vertex positions and topology.
+ *
+ * \return false when \a mesh_src has no looptris to copy.
+ */
+bool BKE_mesh_runtime_looptri_copy(Mesh *mesh_dst, const Mesh *mesh_src)
+{
+  /* Looptris are published atomically by #BKE_mesh_runtime_looptri_recalc, so a non-NULL array
+   * is always complete. */
+  const MLoopTri *looptri_src = mesh_src->runtime.looptris.array;
+  if (looptri_src == NULL) {
+    return false;
+  }
+  BLI_assert(mesh_dst->totpoly == mesh_src->totpoly && mesh_dst->totloop == mesh_src->totloop);
+
+  ThreadMutex *mesh_eval_mutex = (ThreadMutex *)mesh_dst->runtime.eval_mutex;
+  BLI_mutex_lock(mesh_eval_mutex);
+  if (mesh_dst->runtime.looptris.array == NULL) {
+    mesh_ensure_looptri_data(mesh_dst);
+    if (mesh_dst->runtime.looptris.array_wip != NULL) {
+      memcpy(mesh_dst->runtime.looptris.array_wip,
+             looptri_src,
+             sizeof(*looptri_src) * (size_t)mesh_dst->runtime.looptris.len);
+    }
+    atomic_cas_ptr((void **)&mesh_dst->runtime.looptris.array,
+                   mesh_dst->runtime.looptris.array,
+                   mesh_dst->runtime.looptris.array_wip);
+    mesh_dst->runtime.looptris.array_wip = NULL;
+  }
+  BLI_mutex_unlock(mesh_eval_mutex);
+  return true;
+}
+
 /* This is a ported copy of dm_getNumLoopTri(dm). */
 int BKE_mesh_runtime_looptri_len(const Mesh *mesh)
 {
@@ -251,6 +285,7 @@ void BKE_mesh_runtime_clear_geometry(Mesh *mesh)
 /* Draw Engine */
 void (*BKE_mesh_batch_cache_dirty_tag_cb)(Mesh *me, int mode) = NULL;
 void (*BKE_mesh_batch_cache_free_cb)(Mesh *me) = NULL;
+void (*BKE_mesh_batch_cache_reuse_cb)(Mesh *me, void *batch_cache) = NULL;
 
 void BKE_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
 {
@@ -265,6 +300,29 @@ void BKE_mesh_batch_cache_free(Mesh *me)
   }
 }
 
+/**
+ * Take the batch cache out of \a me before it's freed,
+ * to pass it to the next evaluated mesh of the same object with #BKE_mesh_batch_cache_reuse.
+ */
+void *BKE_mesh_batch_cache_detach(Mesh *me)
+{
+  void *batch_cache = me->runtime.batch_cache;
+  me->runtime.batch_cache = NULL;
+  return batch_cache;
+}
+
+/**
+ * Give a batch cache detached with #BKE_mesh_batch_cache_detach to \a me,
+ * the draw code keeps the buffers which are still valid or frees it.
+ * \param me: Can be NULL to only free the cache.
+ */
+void BKE_mesh_batch_cache_reuse(Mesh *me, void *batch_cache)
+{
+  if (batch_cache) {
+    BKE_mesh_batch_cache_reuse_cb(me, batch_cache);
+  }
+}
+
 /** \} */
 
 /** \name Mesh runtime debug helpers.
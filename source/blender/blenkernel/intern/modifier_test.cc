@@ -0,0 +1,139 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+namespace blender::bke::tests {
+
+class modifier_solidify : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+    BKE_modifier_init();
+  }
+};
+
+static Mesh *solidify_apply(const SolidifyModifierData *smd_template, Mesh *mesh)
+{
+  ModifierData *md = BKE_modifier_new(eModifierType_Solidify);
+  SolidifyModifierData *smd = (SolidifyModifierData *)md;
+  const ModifierData md_header = smd->modifier;
+  *smd = *smd_template;
+  smd->modifier = md_header;
+
+  Object object;
+  memset(&object, 0, sizeof(object));
+  object.type = OB_MESH;
+  object.data = mesh;
+  const ModifierEvalContext ctx = {nullptr, &object, ModifierApplyFlag(0)};
+
+  Mesh *result = BKE_modifier_modify_mesh(md, &ctx, mesh);
+  BKE_modifier_free(md);
+  return result;
+}
+
+/* Run the modifier once with the task scheduler limited to a single thread, once with all
+ * threads, the results have to be identical. */
+static void expect_serial_matches_threaded(const SolidifyModifierData *smd)
+{
+  Mesh *mesh = grid_mesh_create(120, 0.1f, 0.3f);
+
+  BLI_task_scheduler_exit();
+  BLI_system_num_threads_override_set(1);
+  BLI_task_scheduler_init();
+  Mesh *result_serial = solidify_apply(smd, mesh);
+
+  BLI_task_scheduler_exit();
+  BLI_system_num_threads_override_set(0);
+  BLI_task_scheduler_init();
+  Mesh *result_threaded = solidify_apply(smd, mesh);
+
+  ASSERT_NE(result_serial, mesh);
+  ASSERT_EQ(result_serial->totvert, result_threaded->totvert);
+  ASSERT_EQ(result_serial->totedge, result_threaded->totedge);
+  ASSERT_EQ(result_serial->totloop, result_threaded->totloop);
+  ASSERT_EQ(result_serial->totpoly, result_threaded->totpoly);
+  EXPECT_GT(result_serial->totvert, mesh->totvert);
+
+  for (int i = 0; i < result_serial->totvert; i++) {
+    const float *co_serial = result_serial->mvert[i].co;
+    const float *co_threaded = result_threaded->mvert[i].co;
+    EXPECT_EQ(co_serial[0], co_threaded[0]);
+    EXPECT_EQ(co_serial[1], co_threaded[1]);
+    EXPECT_EQ(co_serial[2], co_threaded[2]);
+  }
+  for (int i = 0; i < result_serial->totloop; i++) {
+    EXPECT_EQ(result_serial->mloop[i].v, result_threaded->mloop[i].v);
+  }
+
+  BKE_id_free(nullptr, result_threaded);
+  BKE_id_free(nullptr, result_serial);
+  BKE_id_free(nullptr, mesh);
+}
+
+static SolidifyModifierData solidify_settings(const char mode, const int flag)
+{
+  ModifierData *md = BKE_modifier_new(eModifierType_Solidify);
+  SolidifyModifierData smd = *(SolidifyModifierData *)md;
+  BKE_modifier_free(md);
+  smd.mode = mode;
+  smd.flag |= flag;
+  smd.offset = 0.05f;
+  return smd;
+}
+
+TEST_F(modifier_solidify, SimpleSerialMatchesThreaded)
+{
+  const SolidifyModifierData smd = solidify_settings(MOD_SOLIDIFY_MODE_EXTRUDE, 0);
+  expect_serial_matches_threaded(&smd);
+}
+
+TEST_F(modifier_solidify, SimpleEvenSerialMatchesThreaded)
+{
+  const SolidifyModifierData smd = solidify_settings(
+      MOD_SOLIDIFY_MODE_EXTRUDE, MOD_SOLIDIFY_EVEN | MOD_SOLIDIFY_NORMAL_CALC);
+  expect_serial_matches_threaded(&smd);
+}
+
+TEST_F(modifier_solidify, ComplexSerialMatchesThreaded)
+{
+  SolidifyModifierData smd = solidify_settings(MOD_SOLIDIFY_MODE_NONMANIFOLD, 0);
+  smd.nonmanifold_offset_mode = MOD_SOLIDIFY_NONMANIFOLD_OFFSET_MODE_CONSTRAINTS;
+  expect_serial_matches_threaded(&smd);
+}
+
+}  // namespace blender::bke::tests
@@ -32,7 +32,9 @@
 
 #include "BLI_alloca.h"
 #include "BLI_math.h"
+#include "BLI_memarena.h"
 #include "BLI_rand.h"
+#include "BLI_task.h"
 
 #include "DNA_anim_types.h"
 #include "DNA_collection_types.h"
@@ -68,6 +70,18 @@
 /** \name Internal Duplicate Context
  * \{ */
 
+/**
+ * The result container, callers only see the #ListBase.
+ *
+ * Dupli-objects are allocated from an arena, generators which don't recurse allocate all of
+ * their dupli-objects as a single block and fill it in parallel, see #dupli_block_alloc.
+ */
+typedef struct DupliList {
+  /** Must be first, #object_duplilist returns a pointer to it. */
+  ListBase list;
+  MemArena *arena;
+} DupliList;
+
 typedef struct DupliContext {
   Depsgraph *depsgraph;
   /** XXX child objects are selected from this group if set, could be nicer. */
@@ -85,8 +99,8 @@ typedef struct DupliContext {
 
   const struct DupliGenerator *gen;
 
-  /** Result containers. */
-  ListBase *duplilist; /* Legacy doubly-linked list. */
+  /** Result container. */
+  DupliList *duplilist;
 } DupliContext;
 
 typedef struct DupliGenerator {
@@ -150,27 +164,19 @@ static void copy_dupli_context(
 }
 
 /**
- * Generate a dupli instance.
+ * Initialize a dupli instance allocated by #make_dupli or #dupli_block_alloc,
+ * this is thread-safe as long as each thread initializes its own instances.
  *
  * \param mat: is transform of the object relative to current context (including #Object.obmat).
  */
-static DupliObject *make_dupli(const DupliContext *ctx,
-                               Object *ob,
-                               const float mat[4][4],
-                               int index)
+static void dupli_init(const DupliContext *ctx,
+                       DupliObject *dob,
+                       Object *ob,
+                       const float mat[4][4],
+                       int index)
 {
-  DupliObject *dob;
   int i;
 
-  /* Add a #DupliObject instance to the result container. */
-  if (ctx->duplilist) {
-    dob = MEM_callocN(sizeof(DupliObject), "dupli object");
-    BLI_addtail(ctx->duplilist, dob);
-  }
-  else {
-    return NULL;
-  }
-
   dob->ob = ob;
   mul_m4_m4m4(dob->mat, (float(*)[4])ctx->space_mat, mat);
   dob->type = ctx->gen->type;
@@ -211,10 +217,90 @@ static DupliObject *make_dupli(const DupliContext *ctx,
   if (ctx->object != ob) {
     dob->random_id ^= BLI_hash_int(BLI_hash_string(ctx->object->id.name + 2));
   }
+}
+
+/**
+ * Generate a dupli instance.
+ *
+ * \param mat: is transform of the object relative to current context (including #Object.obmat).
+ */
+static DupliObject *make_dupli(const DupliContext *ctx,
+                               Object *ob,
+                               const float mat[4][4],
+                               int index)
+{
+  DupliObject *dob;
+
+  /* Add a #DupliObject instance to the result container. */
+  if (ctx->duplilist) {
+    dob = BLI_memarena_calloc(ctx->duplilist->arena, sizeof(DupliObject));
+    BLI_addtail(&ctx->duplilist->list, dob);
+  }
+  else {
+    return NULL;
+  }
+
+  dupli_init(ctx, dob, ob, mat, index);
 
   return dob;
 }
 
+/**
+ * Allocate \a len zeroed dupli instances to be initialized with #dupli_init,
+ * once initialized they must be added to the result with #dupli_block_link.
+ *
+ * Only valid for instances of objects which don't generate duplis themselves
+ * (see #dupli_use_block), since recursion adds dupli-objects after each instance.
+ *
+ * \return NULL when there is no result container.
+ */
+static DupliObject *dupli_block_alloc(const DupliContext *ctx, const int len)
+{
+  if (ctx->duplilist == NULL || len == 0) {
+    return NULL;
+  }
+  return BLI_memarena_calloc(ctx->duplilist->arena, sizeof(DupliObject) * (size_t)len);
+}
+
+/**
+ * Add a block of initialized dupli instances to the result, keeping their order.
+ */
+static void dupli_block_link(const DupliContext *ctx, DupliObject *block, const int len)
+{
+  ListBase *lb = &ctx->duplilist->list;
+  DupliObject *prev = lb->last;
+
+  for (int i = 0; i < len; i++) {
+    block[i].prev = prev;
+    block[i].next = (i + 1 < len) ? &block[i + 1] : NULL;
+    prev = &block[i];
+  }
+
+  if (lb->last) {
+    ((DupliObject *)lb->last)->next = block;
+  }
+  else {
+    lb->first = block;
+  }
+  lb->last = &block[len - 1];
+}
+
+/**
+ * Instances of \a ob can be generated as a block when they don't need recursion.
+ */
+static bool dupli_use_block(const DupliContext *ctx, const Object *ob)
+{
+  return (ctx->duplilist != NULL) && ((ob->transflag & OB_DUPLI) == 0);
+}
+
+static void dupli_block_parallel_range(const int len, void *userdata, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (len > 1024);
+  BLI_task_parallel_range(0, len, userdata, func, &settings);
+}
+
 /**
  * Recursive dupli-objects.
  *
@@ -469,28 +555,37 @@ static void get_duplivert_transform(const float co[3],
   loc_quat_size_to_mat4(r_mat, co, quat, size);
 }
 
-static DupliObject *vertex_dupli(const DupliContext *ctx,
-                                 Object *inst_ob,
-                                 const float child_imat[4][4],
-                                 int index,
-                                 const float co[3],
-                                 const float no[3],
-                                 const bool use_rotation)
+static void vertex_dupli_transform(const Object *inst_ob,
+                                   const float child_imat[4][4],
+                                   const float co[3],
+                                   const float no[3],
+                                   const bool use_rotation,
+                                   float r_obmat[4][4],
+                                   float r_space_mat[4][4])
 {
   /* `obmat` is transform to vertex. */
-  float obmat[4][4];
-  get_duplivert_transform(co, no, use_rotation, inst_ob->trackflag, inst_ob->upflag, obmat);
-
-  float space_mat[4][4];
+  get_duplivert_transform(co, no, use_rotation, inst_ob->trackflag, inst_ob->upflag, r_obmat);
 
   /* Make offset relative to inst_ob using relative child transform. */
-  mul_mat3_m4_v3(child_imat, obmat[3]);
+  mul_mat3_m4_v3(child_imat, r_obmat[3]);
   /* Apply `obmat` _after_ the local vertex transform. */
-  mul_m4_m4m4(obmat, inst_ob->obmat, obmat);
+  mul_m4_m4m4(r_obmat, inst_ob->obmat, r_obmat);
 
   /* Space matrix is constructed by removing `obmat` transform,
    * this yields the world-space transform for recursive duplis. */
-  mul_m4_m4m4(space_mat, obmat, inst_ob->imat);
+  mul_m4_m4m4(r_space_mat, r_obmat, inst_ob->imat);
+}
+
+static DupliObject *vertex_dupli(const DupliContext *ctx,
+                                 Object *inst_ob,
+                                 const float child_imat[4][4],
+                                 int index,
+                                 const float co[3],
+                                 const float no[3],
+                                 const bool use_rotation)
+{
+  float obmat[4][4], space_mat[4][4];
+  vertex_dupli_transform(inst_ob, child_imat, co, no, use_rotation, obmat, space_mat);
 
   DupliObject *dob = make_dupli(ctx, inst_ob, obmat, index);
 
@@ -500,6 +595,33 @@ static DupliObject *vertex_dupli(const DupliContext *ctx,
   return dob;
 }
 
+typedef struct VertexDupliBlockData {
+  const VertexDupliData_Mesh *vdd;
+  Object *inst_ob;
+  const float (*child_imat)[4];
+  DupliObject *block;
+} VertexDupliBlockData;
+
+static void vertex_dupli_block_cb(void *__restrict userdata,
+                                  const int i,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const VertexDupliBlockData *data = userdata;
+  const VertexDupliData_Mesh *vdd = data->vdd;
+  const MVert *mv = &vdd->mvert[i];
+  const float no[3] = {UNPACK3(mv->no)};
+
+  float obmat[4][4], space_mat[4][4];
+  vertex_dupli_transform(
+      data->inst_ob, data->child_imat, mv->co, no, vdd->params.use_rotation, obmat, space_mat);
+
+  DupliObject *dob = &data->block[i];
+  dupli_init(vdd->params.ctx, dob, data->inst_ob, obmat, i);
+  if (vdd->orco) {
+    copy_v3_v3(dob->orco, vdd->orco[i]);
+  }
+}
+
 static void make_child_duplis_verts_from_mesh(const DupliContext *ctx,
                                               void *userdata,
                                               Object *inst_ob)
@@ -515,6 +637,20 @@ static void make_child_duplis_verts_from_mesh(const DupliContext *ctx,
   float child_imat[4][4];
   mul_m4_m4m4(child_imat, inst_ob->imat, ctx->object->obmat);
 
+  if (dupli_use_block(vdd->params.ctx, inst_ob)) {
+    VertexDupliBlockData data = {
+        .vdd = vdd,
+        .inst_ob = inst_ob,
+        .child_imat = child_imat,
+        .block = dupli_block_alloc(vdd->params.ctx, totvert),
+    };
+    if (data.block) {
+      dupli_block_parallel_range(totvert, &data, vertex_dupli_block_cb);
+      dupli_block_link(vdd->params.ctx, data.block, totvert);
+    }
+    return;
+  }
+
   const MVert *mv = mvert;
   for (int i = 0; i < totvert; i++, mv++) {
     const float *co = mv->co;
@@ -748,45 +884,97 @@ static const DupliGenerator gen_dupli_verts_font = {
 /** \name Dupli-Vertices Implementation (#OB_DUPLIVERTS for #PointCloud)
  * \{ */
 
+typedef struct PointCloudDupliData {
+  const DupliContext *ctx;
+  Object *child;
+  const float (*child_imat)[4];
+
+  const float (*co)[3];
+  const float *radius;
+  const float (*rotation)[4];
+  const float (*orco)[3];
+
+  DupliObject *block;
+} PointCloudDupliData;
+
+static void pointcloud_dupli_transform(const PointCloudDupliData *pdd,
+                                       const int i,
+                                       float r_obmat[4][4],
+                                       float r_space_mat[4][4])
+{
+  /* Transform matrix from point position, radius and rotation. */
+  float quat[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+  float size[3] = {1.0f, 1.0f, 1.0f};
+  if (pdd->radius) {
+    copy_v3_fl(size, pdd->radius[i]);
+  }
+  if (pdd->rotation) {
+    copy_v4_v4(quat, pdd->rotation[i]);
+  }
+
+  loc_quat_size_to_mat4(r_space_mat, pdd->co[i], quat, size);
+
+  /* Make offset relative to child object using relative child transform,
+   * and apply object matrix after local vertex transform. */
+  mul_mat3_m4_v3(pdd->child_imat, r_space_mat[3]);
+
+  mul_m4_m4m4(r_obmat, pdd->child->obmat, r_space_mat);
+}
+
+static void pointcloud_dupli_block_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const PointCloudDupliData *pdd = userdata;
+
+  float obmat[4][4], space_mat[4][4];
+  pointcloud_dupli_transform(pdd, i, obmat, space_mat);
+
+  DupliObject *dob = &pdd->block[i];
+  dupli_init(pdd->ctx, dob, pdd->child, obmat, i);
+  if (pdd->orco) {
+    copy_v3_v3(dob->orco, pdd->orco[i]);
+  }
+}
+
 static void make_child_duplis_pointcloud(const DupliContext *ctx,
                                          void *UNUSED(userdata),
                                          Object *child)
 {
   const Object *parent = ctx->object;
   const PointCloud *pointcloud = parent->data;
-  const float(*co)[3] = pointcloud->co;
-  const float *radius = pointcloud->radius;
-  const float(*rotation)[4] = NULL; /* TODO: add optional rotation attribute. */
-  const float(*orco)[3] = NULL;     /* TODO: add optional texture coordinate attribute. */
 
   /* Relative transform from parent to child space. */
   float child_imat[4][4];
   mul_m4_m4m4(child_imat, child->imat, parent->obmat);
 
-  for (int i = 0; i < pointcloud->totpoint; i++) {
-    /* Transform matrix from point position, radius and rotation. */
-    float quat[4] = {1.0f, 0.0f, 0.0f, 0.0f};
-    float size[3] = {1.0f, 1.0f, 1.0f};
-    if (radius) {
-      copy_v3_fl(size, radius[i]);
-    }
-    if (rotation) {
-      copy_v4_v4(quat, rotation[i]);
-    }
+  PointCloudDupliData pdd = {
+      .ctx = ctx,
+      .child = child,
+      .child_imat = child_imat,
+      .co = pointcloud->co,
+      .radius = pointcloud->radius,
+      .rotation = NULL, /* TODO: add optional rotation attribute. */
+      .orco = NULL,     /* TODO: add optional texture coordinate attribute. */
+  };
 
-    float space_mat[4][4];
-    loc_quat_size_to_mat4(space_mat, co[i], quat, size);
+  if (dupli_use_block(ctx, child)) {
+    pdd.block = dupli_block_alloc(ctx, pointcloud->totpoint);
+    if (pdd.block) {
+      dupli_block_parallel_range(pointcloud->totpoint, &pdd, pointcloud_dupli_block_cb);
+      dupli_block_link(ctx, pdd.block, pointcloud->totpoint);
+    }
+    return;
+  }
 
-    /* Make offset relative to child object using relative child transform,
-     * and apply object matrix after local vertex transform. */
-    mul_mat3_m4_v3(child_imat, space_mat[3]);
+  for (int i = 0; i < pointcloud->totpoint; i++) {
+    float obmat[4][4], space_mat[4][4];
+    pointcloud_dupli_transform(&pdd, i, obmat, space_mat);
 
     /* Create dupli object. */
-    float obmat[4][4];
-    mul_m4_m4m4(obmat, child->obmat, space_mat);
     DupliObject *dob = make_dupli(ctx, child, obmat, i);
-    if (orco) {
-      copy_v3_v3(dob->orco, orco[i]);
+    if (pdd.orco) {
+      copy_v3_v3(dob->orco, pdd.orco[i]);
     }
 
     /* Recursion. */
@@ -879,38 +1067,51 @@ static void get_dupliface_transform_from_coords(const float coords[][3],
   loc_quat_size_to_mat4(r_mat, loc, quat, size);
 }
 
-static DupliObject *face_dupli(const DupliContext *ctx,
-                               Object *inst_ob,
-                               const float child_imat[4][4],
-                               const int index,
-                               const bool use_scale,
-                               const float scale_fac,
-                               const float (*coords)[3],
-                               const int coords_len)
+static void face_dupli_transform(const Object *inst_ob,
+                                 const float child_imat[4][4],
+                                 const bool use_scale,
+                                 const float scale_fac,
+                                 const float (*coords)[3],
+                                 const int coords_len,
+                                 float r_obmat[4][4],
+                                 float r_space_mat[4][4])
 {
-  float obmat[4][4];
-  float space_mat[4][4];
-
   /* `obmat` is transform to face. */
-  get_dupliface_transform_from_coords(coords, coords_len, use_scale, scale_fac, obmat);
+  get_dupliface_transform_from_coords(coords, coords_len, use_scale, scale_fac, r_obmat);
 
   /* Make offset relative to inst_ob using relative child transform. */
-  mul_mat3_m4_v3(child_imat, obmat[3]);
+  mul_mat3_m4_v3(child_imat, r_obmat[3]);
 
   /* XXX ugly hack to ensure same behavior as in master.
    * This should not be needed, #Object.parentinv is not consistent outside of parenting. */
   {
     float imat[3][3];
     copy_m3_m4(imat, inst_ob->parentinv);
-    mul_m4_m3m4(obmat, imat, obmat);
+    mul_m4_m3m4(r_obmat, imat, r_obmat);
   }
 
   /* Apply `obmat` _after_ the local face transform. */
-  mul_m4_m4m4(obmat, inst_ob->obmat, obmat);
+  mul_m4_m4m4(r_obmat, inst_ob->obmat, r_obmat);
 
   /* Space matrix is constructed by removing `obmat` transform,
    * this yields the world-space transform for recursive duplis. */
-  mul_m4_m4m4(space_mat, obmat, inst_ob->imat);
+  mul_m4_m4m4(r_space_mat, r_obmat, inst_ob->imat);
+}
+
+static DupliObject *face_dupli(const DupliContext *ctx,
+                               Object *inst_ob,
+                               const float child_imat[4][4],
+                               const int index,
+                               const bool use_scale,
+                               const float scale_fac,
+                               const float (*coords)[3],
+                               const int coords_len)
+{
+  float obmat[4][4];
+  float space_mat[4][4];
+
+  face_dupli_transform(
+      inst_ob, child_imat, use_scale, scale_fac, coords, coords_len, obmat, space_mat);
 
   DupliObject *dob = make_dupli(ctx, inst_ob, obmat, index);
 
@@ -976,6 +1177,63 @@ static DupliObject *face_dupli_from_editmesh(const DupliContext *ctx,
   return face_dupli(ctx, inst_ob, child_imat, index, use_scale, scale_fac, coords, coords_len);
 }
 
+/** Set the texture coordinates of a dupli-face from the polygon, \a dob must be zeroed. */
+static void face_dupli_mesh_coords(const FaceDupliData_Mesh *fdd,
+                                   const MPoly *mp,
+                                   DupliObject *dob)
+{
+  const MLoop *loopstart = fdd->mloop + mp->loopstart;
+  const float w = 1.0f / (float)mp->totloop;
+  if (fdd->orco) {
+    for (int j = 0; j < mp->totloop; j++) {
+      madd_v3_v3fl(dob->orco, fdd->orco[loopstart[j].v], w);
+    }
+  }
+  if (fdd->mloopuv) {
+    for (int j = 0; j < mp->totloop; j++) {
+      madd_v2_v2fl(dob->uv, fdd->mloopuv[mp->loopstart + j].uv, w);
+    }
+  }
+}
+
+typedef struct FaceDupliBlockData {
+  const FaceDupliData_Mesh *fdd;
+  Object *inst_ob;
+  const float (*child_imat)[4];
+  float scale_fac;
+  DupliObject *block;
+} FaceDupliBlockData;
+
+static void face_dupli_block_cb(void *__restrict userdata,
+                                const int a,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const FaceDupliBlockData *data = userdata;
+  const FaceDupliData_Mesh *fdd = data->fdd;
+  const MPoly *mp = &fdd->mpoly[a];
+
+  const int coords_len = mp->totloop;
+  float(*coords)[3] = BLI_array_alloca(coords, (size_t)coords_len);
+  const MLoop *ml = fdd->mloop + mp->loopstart;
+  for (int i = 0; i < coords_len; i++, ml++) {
+    copy_v3_v3(coords[i], fdd->mvert[ml->v].co);
+  }
+
+  float obmat[4][4], space_mat[4][4];
+  face_dupli_transform(data->inst_ob,
+                       data->child_imat,
+                       fdd->params.use_scale,
+                       data->scale_fac,
+                       coords,
+                       coords_len,
+                       obmat,
+                       space_mat);
+
+  DupliObject *dob = &data->block[a];
+  dupli_init(fdd->params.ctx, dob, data->inst_ob, obmat, a);
+  face_dupli_mesh_coords(fdd, mp, dob);
+}
+
 static void make_child_duplis_faces_from_mesh(const DupliContext *ctx,
                                               void *userdata,
                                               Object *inst_ob)
@@ -984,8 +1242,6 @@ static void make_child_duplis_faces_from_mesh(const DupliContext *ctx,
   const MPoly *mpoly = fdd->mpoly, *mp;
   const MLoop *mloop = fdd->mloop;
   const MVert *mvert = fdd->mvert;
-  const float(*orco)[3] = fdd->orco;
-  const MLoopUV *mloopuv = fdd->mloopuv;
   const int totface = fdd->totface;
   const bool use_scale = fdd->params.use_scale;
   int a;
@@ -997,22 +1253,26 @@ static void make_child_duplis_faces_from_mesh(const DupliContext *ctx,
   mul_m4_m4m4(child_imat, inst_ob->imat, ctx->object->obmat);
   const float scale_fac = ctx->object->instance_faces_scale;
 
+  if (dupli_use_block(fdd->params.ctx, inst_ob)) {
+    FaceDupliBlockData data = {
+        .fdd = fdd,
+        .inst_ob = inst_ob,
+        .child_imat = child_imat,
+        .scale_fac = scale_fac,
+        .block = dupli_block_alloc(fdd->params.ctx, totface),
+    };
+    if (data.block) {
+      dupli_block_parallel_range(totface, &data, face_dupli_block_cb);
+      dupli_block_link(fdd->params.ctx, data.block, totface);
+    }
+    return;
+  }
+
   for (a = 0, mp = mpoly; a < totface; a++, mp++) {
     const MLoop *loopstart = mloop + mp->loopstart;
     DupliObject *dob = face_dupli_from_mesh(
         fdd->params.ctx, inst_ob, child_imat, a, use_scale, scale_fac, mp, loopstart, mvert);
-
-    const float w = 1.0f / (float)mp->totloop;
-    if (orco) {
-      for (int j = 0; j < mp->totloop; j++) {
-        madd_v3_v3fl(dob->orco, orco[loopstart[j].v], w);
-      }
-    }
-    if (mloopuv) {
-      for (int j = 0; j < mp->totloop; j++) {
-        madd_v2_v2fl(dob->uv, mloopuv[mp->loopstart + j].uv, w);
-      }
-    }
+    face_dupli_mesh_coords(fdd, mp, dob);
   }
 }
 
@@ -1519,21 +1779,25 @@ static const DupliGenerator *get_dupli_generator(const DupliContext *ctx)
  */
 ListBase *object_duplilist(Depsgraph *depsgraph, Scene *sce, Object *ob)
 {
-  ListBase *duplilist = MEM_callocN(sizeof(ListBase), "duplilist");
+  DupliList *duplilist = MEM_callocN(sizeof(DupliList), "duplilist");
   DupliContext ctx;
   init_context(&ctx, depsgraph, sce, ob, NULL);
   if (ctx.gen) {
+    duplilist->arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE * 4, "duplilist arena");
     ctx.duplilist = duplilist;
     ctx.gen->make_duplis(&ctx);
   }
 
-  return duplilist;
+  return &duplilist->list;
 }
 
 void free_object_duplilist(ListBase *lb)
 {
-  BLI_freelistN(lb);
-  MEM_freeN(lb);
+  DupliList *duplilist = (DupliList *)lb;
+  if (duplilist->arena) {
+    BLI_memarena_free(duplilist->arena);
+  }
+  MEM_freeN(duplilist);
 }
 
 /** \} */
@@ -2500,21 +2500,12 @@ static bool psys_thread_context_init_path(ParticleThreadContext *ctx,
   return true;
 }
 
-static void psys_task_init_path(ParticleTask *task, ParticleSimulationData *sim)
-{
-  /* init random number generator */
-  int seed = 31415926 + sim->psys->seed;
-
-  task->rng_path = BLI_rng_new(seed);
-}
-
 /* note: this function must be thread safe, except for branching! */
-static void psys_thread_create_path(ParticleTask *task,
+static void psys_thread_create_path(ParticleThreadContext *ctx,
                                     struct ChildParticle *cpa,
                                     ParticleCacheKey *child_keys,
                                     int i)
 {
-  ParticleThreadContext *ctx = task->ctx;
   Object *ob = ctx->sim.ob;
   ParticleSystem *psys = ctx->sim.psys;
   ParticleSettings *part = psys->part;
@@ -2841,20 +2832,15 @@ static void psys_thread_create_path(ParticleTask *task,
   }
 }
 
-static void exec_child_path_cache(TaskPool *__restrict UNUSED(pool), void *taskdata)
+static void exec_child_path_cache(void *__restrict userdata,
+                                  const int i,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  ParticleTask *task = taskdata;
-  ParticleThreadContext *ctx = task->ctx;
+  ParticleThreadContext *ctx = userdata;
   ParticleSystem *psys = ctx->sim.psys;
-  ParticleCacheKey **cache = psys->childcache;
-  ChildParticle *cpa;
-  int i;
 
-  cpa = psys->child + task->begin;
-  for (i = task->begin; i < task->end; i++, cpa++) {
-    BLI_assert(i < psys->totchildcache);
-    psys_thread_create_path(task, cpa, cache[i], i);
-  }
+  BLI_assert(i < psys->totchildcache);
+  psys_thread_create_path(ctx, &psys->child[i], psys->childcache[i], i);
 }
 
 void psys_cache_child_paths(ParticleSimulationData *sim,
@@ -2862,22 +2848,17 @@ void psys_cache_child_paths(ParticleSimulationData *sim,
                             const bool editupdate,
                             const bool use_render_params)
 {
-  TaskPool *task_pool;
   ParticleThreadContext ctx;
-  ParticleTask *tasks_parent, *tasks_child;
-  int numtasks_parent, numtasks_child;
-  int i, totchild, totparent;
+  int totchild, totparent;
 
   if (sim->psys->flag & PSYS_GLOBAL_HAIR) {
     return;
   }
 
-  /* create a task pool for child path tasks */
   if (!psys_thread_context_init_path(&ctx, sim, sim->scene, cfra, editupdate, use_render_params)) {
     return;
   }
 
-  task_pool = BLI_task_pool_create(&ctx, TASK_PRIORITY_LOW);
   totchild = ctx.totchild;
   totparent = ctx.totparent;
 
@@ -2893,32 +2874,19 @@ void psys_cache_child_paths(ParticleSimulationData *sim,
     sim->psys->totchildcache = totchild;
   }
 
+  /* The cost of a child path varies a lot with its length and the child modifiers, so use
+   * small chunks that the scheduler can balance between threads. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 16;
+
   /* cache parent paths */
   ctx.parent_pass = 1;
-  psys_tasks_create(&ctx, 0, totparent, &tasks_parent, &numtasks_parent);
-  for (i = 0; i < numtasks_parent; i++) {
-    ParticleTask *task = &tasks_parent[i];
-
-    psys_task_init_path(task, sim);
-    BLI_task_pool_push(task_pool, exec_child_path_cache, task, false, NULL);
-  }
-  BLI_task_pool_work_and_wait(task_pool);
+  BLI_task_parallel_range(0, totparent, &ctx, exec_child_path_cache, &settings);
 
   /* cache child paths */
   ctx.parent_pass = 0;
-  psys_tasks_create(&ctx, totparent, totchild, &tasks_child, &numtasks_child);
-  for (i = 0; i < numtasks_child; i++) {
-    ParticleTask *task = &tasks_child[i];
-
-    psys_task_init_path(task, sim);
-    BLI_task_pool_push(task_pool, exec_child_path_cache, task, false, NULL);
-  }
-  BLI_task_pool_work_and_wait(task_pool);
-
-  BLI_task_pool_free(task_pool);
-
-  psys_tasks_free(tasks_parent, numtasks_parent);
-  psys_tasks_free(tasks_child, numtasks_child);
+  BLI_task_parallel_range(totparent, totchild, &ctx, exec_child_path_cache, &settings);
 
   psys_thread_context_free(&ctx);
 }
@@ -4194,7 +4162,9 @@ void psys_get_texture(
           break;
       }
 
-      RE_texture_evaluate(mtex, texvec, 0, NULL, false, false, &value, rgba);
+      /* Particles may be evaluated in parallel, texture nodes need a stack per thread. */
+      RE_texture_evaluate(
+          mtex, texvec, BLI_task_parallel_thread_id(NULL), NULL, false, false, &value, rgba);
 
       if ((event & mtex->mapto) & PAMAP_TIME) {
         /* the first time has to set the base value for time regardless of blend mode */
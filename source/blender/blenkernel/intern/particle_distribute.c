@@ -810,12 +810,10 @@ static void exec_distribute_child(TaskPool *__restrict UNUSED(pool), void *taskd
   int p;
 
   /* RNG skipping at the beginning */
-  cpa = psys->child;
-  for (p = 0; p < task->begin; p++, cpa++) {
-    BLI_rng_skip(task->rng, PSYS_RND_DIST_SKIP);
-  }
+  BLI_rng_skip(task->rng, PSYS_RND_DIST_SKIP * task->begin);
 
-  for (; p < task->end; p++, cpa++) {
+  cpa = psys->child + task->begin;
+  for (p = task->begin; p < task->end; p++, cpa++) {
     distribute_children_exec(task, cpa, p);
   }
 }
@@ -845,6 +843,38 @@ static int distribute_compare_orig_index(const void *p1, const void *p2, void *u
   return 1;
 }
 
+typedef struct DistributeAreaData {
+  const MFace *mface;
+  const MVert *mvert;
+  const float (*orcodata)[3];
+  /* Texture space to transform orcos from normalized 0..1 to object space. */
+  float orco_loc[3], orco_size[3];
+  float *element_weight;
+} DistributeAreaData;
+
+static void distribute_element_area_cb(void *__restrict userdata,
+                                       const int i,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const DistributeAreaData *data = userdata;
+  const MFace *mf = &data->mface[i];
+  const unsigned int verts[4] = {mf->v1, mf->v2, mf->v3, mf->v4};
+  const int verts_num = mf->v4 ? 4 : 3;
+  float co[4][3];
+
+  for (int j = 0; j < verts_num; j++) {
+    if (data->orcodata) {
+      madd_v3_v3v3v3(co[j], data->orco_loc, data->orcodata[verts[j]], data->orco_size);
+    }
+    else {
+      copy_v3_v3(co[j], data->mvert[verts[j]].co);
+    }
+  }
+
+  data->element_weight[i] = mf->v4 ? area_quad_v3(co[0], co[1], co[2], co[3]) :
+                                     area_tri_v3(co[0], co[1], co[2]);
+}
+
 static void distribute_invalid(ParticleSimulationData *sim, int from)
 {
   Scene *scene = sim->scene;
@@ -1051,48 +1081,34 @@ static int psys_thread_context_init_distribute(ParticleThreadContext *ctx,
 
   /* Calculate weights from face areas */
   if ((part->flag & PART_EDISTR || children) && from != PART_FROM_VERT) {
-    MVert *v1, *v2, *v3, *v4;
-    float totarea = 0.f, co1[3], co2[3], co3[3], co4[3];
-    float(*orcodata)[3];
+    Mesh *me_orig = ob->data;
+    float totarea = 0.f;
+    DistributeAreaData area_data = {
+        .mface = mesh->mface,
+        .mvert = mesh->mvert,
+        .orcodata = CustomData_get_layer(&mesh->vdata, CD_ORCO),
+        .element_weight = element_weight,
+    };
+
+    if (area_data.orcodata) {
+      BKE_mesh_texspace_get(me_orig->texcomesh ? me_orig->texcomesh : me_orig,
+                            area_data.orco_loc,
+                            area_data.orco_size);
+    }
 
-    orcodata = CustomData_get_layer(&mesh->vdata, CD_ORCO);
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(0, totelem, &area_data, distribute_element_area_cb, &settings);
 
+    /* Summed in order, so the distribution doesn't depend on the threading. */
     for (i = 0; i < totelem; i++) {
-      MFace *mf = &mesh->mface[i];
-
-      if (orcodata) {
-        /* Transform orcos from normalized 0..1 to object space. */
-        copy_v3_v3(co1, orcodata[mf->v1]);
-        copy_v3_v3(co2, orcodata[mf->v2]);
-        copy_v3_v3(co3, orcodata[mf->v3]);
-        BKE_mesh_orco_verts_transform(ob->data, &co1, 1, 1);
-        BKE_mesh_orco_verts_transform(ob->data, &co2, 1, 1);
-        BKE_mesh_orco_verts_transform(ob->data, &co3, 1, 1);
-        if (mf->v4) {
-          copy_v3_v3(co4, orcodata[mf->v4]);
-          BKE_mesh_orco_verts_transform(ob->data, &co4, 1, 1);
-        }
-      }
-      else {
-        v1 = &mesh->mvert[mf->v1];
-        v2 = &mesh->mvert[mf->v2];
-        v3 = &mesh->mvert[mf->v3];
-        copy_v3_v3(co1, v1->co);
-        copy_v3_v3(co2, v2->co);
-        copy_v3_v3(co3, v3->co);
-        if (mf->v4) {
-          v4 = &mesh->mvert[mf->v4];
-          copy_v3_v3(co4, v4->co);
-        }
-      }
-
-      cur = mf->v4 ? area_quad_v3(co1, co2, co3, co4) : area_tri_v3(co1, co2, co3);
+      cur = element_weight[i];
 
       if (cur > maxweight) {
         maxweight = cur;
       }
 
-      element_weight[i] = cur;
       totarea += cur;
     }
 
@@ -47,6 +47,7 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_edgehash.h"
+#include "BLI_hash.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_kdtree.h"
 #include "BLI_linklist.h"
@@ -328,6 +329,50 @@ int psys_get_tot_child(Scene *scene, ParticleSystem *psys, const bool use_render
 /*          Distribution                        */
 /************************************************/
 
+typedef struct CalcDMCacheData {
+  Mesh *mesh_final, *mesh_original;
+  ParticleSystem *psys;
+  LinkNode **nodearray;
+  int totelem;
+  bool use_modifier_stack;
+} CalcDMCacheData;
+
+static void psys_calc_dmcache_task_cb(void *__restrict userdata,
+                                      const int p,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const CalcDMCacheData *data = userdata;
+  ParticleData *pa = &data->psys->particles[p];
+
+  if (pa->num < 0) {
+    pa->num_dmcache = DMCACHE_NOTFOUND;
+    return;
+  }
+
+  if (data->use_modifier_stack) {
+    if (pa->num < data->totelem) {
+      pa->num_dmcache = DMCACHE_ISCHILD;
+    }
+    else {
+      pa->num_dmcache = DMCACHE_NOTFOUND;
+    }
+  }
+  else {
+    if (data->psys->part->from == PART_FROM_VERT) {
+      if (pa->num < data->totelem && data->nodearray[pa->num]) {
+        pa->num_dmcache = POINTER_AS_INT(data->nodearray[pa->num]->link);
+      }
+      else {
+        pa->num_dmcache = DMCACHE_NOTFOUND;
+      }
+    }
+    else { /* FROM_FACE/FROM_VOLUME */
+      pa->num_dmcache = psys_particle_dm_face_lookup(
+          data->mesh_final, data->mesh_original, pa->num, pa->fuv, data->nodearray);
+    }
+  }
+}
+
 void psys_calc_dmcache(Object *ob, Mesh *mesh_final, Mesh *mesh_original, ParticleSystem *psys)
 {
   /* use for building derived mesh mapping info:
@@ -411,36 +456,19 @@ void psys_calc_dmcache(Object *ob, Mesh *mesh_final, Mesh *mesh_original, Partic
     }
 
     /* cache the verts/faces! */
-    LOOP_PARTICLES
-    {
-      if (pa->num < 0) {
-        pa->num_dmcache = DMCACHE_NOTFOUND;
-        continue;
-      }
-
-      if (use_modifier_stack) {
-        if (pa->num < totelem) {
-          pa->num_dmcache = DMCACHE_ISCHILD;
-        }
-        else {
-          pa->num_dmcache = DMCACHE_NOTFOUND;
-        }
-      }
-      else {
-        if (psys->part->from == PART_FROM_VERT) {
-          if (pa->num < totelem && nodearray[pa->num]) {
-            pa->num_dmcache = POINTER_AS_INT(nodearray[pa->num]->link);
-          }
-          else {
-            pa->num_dmcache = DMCACHE_NOTFOUND;
-          }
-        }
-        else { /* FROM_FACE/FROM_VOLUME */
-          pa->num_dmcache = psys_particle_dm_face_lookup(
-              mesh_final, mesh_original, pa->num, pa->fuv, nodearray);
-        }
-      }
-    }
+    CalcDMCacheData data = {
+        .mesh_final = mesh_final,
+        .mesh_original = mesh_original,
+        .psys = psys,
+        .nodearray = nodearray,
+        .totelem = totelem,
+        .use_modifier_stack = use_modifier_stack,
+    };
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 256;
+    BLI_task_parallel_range(0, psys->totpart, &data, psys_calc_dmcache_task_cb, &settings);
 
     MEM_freeN(nodearray);
     MEM_freeN(nodedmelem);
@@ -500,9 +528,6 @@ void psys_tasks_free(ParticleTask *tasks, int numtasks)
     if (tasks[i].rng) {
       BLI_rng_free(tasks[i].rng);
     }
-    if (tasks[i].rng_path) {
-      BLI_rng_free(tasks[i].rng_path);
-    }
   }
 
   MEM_freeN(tasks);
@@ -3752,6 +3777,27 @@ static void dynamics_step_sph_classical_basic_integrate_task_cb_ex(
   basic_integrate(sim, p, pa->state.time, data->cfra);
 }
 
+static void dynamics_step_newton_task_cb_ex(void *__restrict userdata,
+                                            const int p,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  DynamicStepSolverTaskData *data = userdata;
+  ParticleSimulationData *sim = data->sim;
+  ParticleSystem *psys = sim->psys;
+
+  ParticleData *pa;
+
+  if ((pa = psys->particles + p)->state.time <= 0.0f) {
+    return;
+  }
+
+  /* do global forces & effectors */
+  basic_integrate(sim, p, pa->state.time, data->cfra);
+
+  /* rotations */
+  basic_rotate(psys->part, pa, pa->state.time, data->timestep);
+}
+
 static void dynamics_step_sph_classical_calc_density_task_cb_ex(
     void *__restrict userdata, const int p, const TaskParallelTLS *__restrict tls)
 {
@@ -3803,6 +3849,68 @@ static void dynamics_step_sph_classical_integrate_task_cb_ex(void *__restrict us
   }
 }
 
+typedef struct DynamicStepBoidsTaskData {
+  ParticleSimulationData *sim;
+  float cfra;
+  unsigned int seed;
+} DynamicStepBoidsTaskData;
+
+typedef struct DynamicStepBoidsTLSData {
+  BoidBrainData bbd;
+  /* Copy of the simulation data using the thread's random generator for collisions. */
+  ParticleSimulationData sim;
+} DynamicStepBoidsTLSData;
+
+static void dynamics_step_boids_task_cb_ex(void *__restrict userdata,
+                                           const int p,
+                                           const TaskParallelTLS *__restrict tls)
+{
+  DynamicStepBoidsTaskData *data = userdata;
+  DynamicStepBoidsTLSData *tls_data = tls->userdata_chunk;
+  ParticleSimulationData *sim = &tls_data->sim;
+  BoidBrainData *bbd = &tls_data->bbd;
+
+  ParticleData *pa;
+
+  if ((pa = data->sim->psys->particles + p)->state.time <= 0.0f) {
+    return;
+  }
+
+  if (bbd->rng == NULL) {
+    *sim = *data->sim;
+    sim->rng = BLI_rng_new(0);
+    bbd->sim = sim;
+    bbd->rng = sim->rng;
+  }
+
+  /* Each particle draws from its own sequence, so the result does not depend on the order in
+   * which particles are evaluated. */
+  BLI_rng_seed(bbd->rng, BLI_hash_int_2d(data->seed, (unsigned int)p));
+
+  bbd->goal_ob = NULL;
+
+  boid_brain(bbd, p, pa);
+
+  if (pa->alive != PARS_DYING) {
+    boid_body(bbd, pa);
+
+    /* deflection */
+    if (sim->colliders) {
+      collision_check(sim, p, pa->state.time, data->cfra);
+    }
+  }
+}
+
+static void dynamics_step_boids_free(const void *__restrict UNUSED(userdata),
+                                     void *__restrict chunk_v)
+{
+  DynamicStepBoidsTLSData *tls_data = chunk_v;
+
+  if (tls_data->bbd.rng) {
+    BLI_rng_free(tls_data->bbd.rng);
+  }
+}
+
 /* unbaked particles are calculated dynamically */
 static void dynamics_step(ParticleSimulationData *sim, float cfra)
 {
@@ -3854,7 +3962,8 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
       bbd.cfra = cfra;
       bbd.dfra = dfra;
       bbd.timestep = timestep;
-      bbd.rng = sim->rng;
+      /* Created per thread in #dynamics_step_boids_task_cb_ex. */
+      bbd.rng = NULL;
 
       psys_update_particle_tree(psys, cfra);
 
@@ -3931,6 +4040,26 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
 
   switch (part->phystype) {
     case PART_PHYS_NEWTON: {
+      /* Particles can be integrated in parallel as long as they don't read each other's state
+       * and don't draw from the random generators, which are shared in particle order
+       * (collisions, brownian motion and effector noise). */
+      if (sim->colliders == NULL && part->brownfac == 0.0f &&
+          (part->flag & PART_SELF_EFFECT) == 0 && !BKE_effectors_use_noise(psys->effectors)) {
+        DynamicStepSolverTaskData task_data = {
+            .sim = sim,
+            .cfra = cfra,
+            .timestep = timestep,
+            .dtime = dtime,
+        };
+
+        TaskParallelSettings settings;
+        BLI_parallel_range_settings_defaults(&settings);
+        settings.use_threading = (psys->totpart > 100);
+        BLI_task_parallel_range(
+            0, psys->totpart, &task_data, dynamics_step_newton_task_cb_ex, &settings);
+        break;
+      }
+
       LOOP_DYNAMIC_PARTICLES
       {
         /* do global forces & effectors */
@@ -3947,21 +4076,27 @@ static void dynamics_step(ParticleSimulationData *sim, float cfra)
       break;
     }
     case PART_PHYS_BOIDS: {
-      LOOP_DYNAMIC_PARTICLES
-      {
-        bbd.goal_ob = NULL;
-
-        boid_brain(&bbd, p, pa);
-
-        if (pa->alive != PARS_DYING) {
-          boid_body(&bbd, pa);
-
-          /* deflection */
-          if (sim->colliders) {
-            collision_check(sim, p, pa->state.time, cfra);
-          }
-        }
-      }
+      /* Brains only read the previous state of other particles, so they can be evaluated in
+       * parallel unless a rule changes other boids or an effector draws from its shared random
+       * generator. Texture effectors are safe, they evaluate node trees with a stack per thread.
+       * The same code runs in both cases, so threading doesn't change the result. */
+      DynamicStepBoidsTaskData task_data = {
+          .sim = sim,
+          .cfra = cfra,
+          .seed = 31415926 + (int)cfra + psys->seed,
+      };
+      DynamicStepBoidsTLSData tls_data = {.bbd = bbd};
+
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.use_threading = (psys->totpart > 100) && boids_rules_thread_safe(part->boids) &&
+                               (part->flag & PART_SELF_EFFECT) == 0 &&
+                               !BKE_effectors_use_noise(psys->effectors);
+      settings.userdata_chunk = &tls_data;
+      settings.userdata_chunk_size = sizeof(tls_data);
+      settings.func_free = dynamics_step_boids_free;
+      BLI_task_parallel_range(
+          0, psys->totpart, &task_data, dynamics_step_boids_task_cb_ex, &settings);
       break;
     }
     case PART_PHYS_FLUID: {
@@ -250,43 +250,43 @@ void pbvh_grow_nodes(PBVH *pbvh, int totnode)
   pbvh->totnode = totnode;
 }
 
-/* Add a vertex to the map, with a positive value for unique vertices and
- * a negative value for additional vertices */
-static int map_insert_vert(
-    PBVH *pbvh, GHash *map, unsigned int *face_verts, unsigned int *uniq_verts, int vertex)
+static int vert_index_cmp(const void *a_, const void *b_)
 {
-  void *key, **value_p;
+  const int a = *(const int *)a_;
+  const int b = *(const int *)b_;
+  return (a > b) - (a < b);
+}
 
-  key = POINTER_FROM_INT(vertex);
-  if (!BLI_ghash_ensure_p(map, key, &value_p)) {
-    int value_i;
-    if (BLI_BITMAP_TEST(pbvh->vert_bitmap, vertex) == 0) {
-      BLI_BITMAP_ENABLE(pbvh->vert_bitmap, vertex);
-      value_i = *uniq_verts;
-      (*uniq_verts)++;
+/* Index of \a vertex in the sorted array \a verts, which must contain it. */
+static int vert_index_find(const int *verts, int verts_len, int vertex)
+{
+  int lo = 0, hi = verts_len - 1;
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (verts[mid] < vertex) {
+      lo = mid + 1;
     }
     else {
-      value_i = ~(*face_verts);
-      (*face_verts)++;
+      hi = mid;
     }
-    *value_p = POINTER_FROM_INT(value_i);
-    return value_i;
   }
-
-  return POINTER_AS_INT(*value_p);
+  BLI_assert(verts[lo] == vertex);
+  return lo;
 }
 
-/* Find vertices used by the faces in this node and update the draw buffers */
-static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
+/**
+ * Find vertices used by the faces in this node and update the draw buffers.
+ *
+ * \param vert_leaf: For every vertex, the first leaf (in build order) that uses it.
+ * That leaf stores the vertex as unique, all others as additional face vertex.
+ */
+static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node, int leaf, const int *vert_leaf)
 {
   bool has_visible = false;
 
   node->uniq_verts = node->face_verts = 0;
   const int totface = node->totprim;
 
-  /* reserve size is rough guess */
-  GHash *map = BLI_ghash_int_new_ex("build_mesh_leaf_node gh", 2 * totface);
-
   int(*face_vert_indices)[3] = MEM_mallocN(sizeof(int[3]) * totface, "bvh node face vert indices");
 
   node->face_vert_indices = (const int(*)[3])face_vert_indices;
@@ -295,11 +295,41 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
     has_visible = true;
   }
 
+  /* Sorted array of the vertices used by the node, instead of a hash per node. */
+  int *node_verts = MEM_mallocN(sizeof(int) * totface * 3, __func__);
   for (int i = 0; i < totface; i++) {
     const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
     for (int j = 0; j < 3; j++) {
-      face_vert_indices[i][j] = map_insert_vert(
-          pbvh, map, &node->face_verts, &node->uniq_verts, pbvh->mloop[lt->tri[j]].v);
+      node_verts[i * 3 + j] = pbvh->mloop[lt->tri[j]].v;
+    }
+  }
+  qsort(node_verts, (size_t)totface * 3, sizeof(int), vert_index_cmp);
+  int node_verts_len = 0;
+  for (int i = 0; i < totface * 3; i++) {
+    if (i == 0 || node_verts[i] != node_verts[node_verts_len - 1]) {
+      node_verts[node_verts_len++] = node_verts[i];
+    }
+  }
+
+  /* Index of every vertex in the node, a positive value for unique vertices and
+   * a negative value for additional vertices, in the order they're first used. */
+  int *node_vert_map = MEM_mallocN(sizeof(int) * node_verts_len, __func__);
+  copy_vn_i(node_vert_map, node_verts_len, INT_MAX);
+
+  for (int i = 0; i < totface; i++) {
+    const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
+    for (int j = 0; j < 3; j++) {
+      const int vertex = pbvh->mloop[lt->tri[j]].v;
+      int *value_p = &node_vert_map[vert_index_find(node_verts, node_verts_len, vertex)];
+      if (*value_p == INT_MAX) {
+        if (vert_leaf[vertex] == leaf) {
+          *value_p = node->uniq_verts++;
+        }
+        else {
+          *value_p = ~(node->face_verts++);
+        }
+      }
+      face_vert_indices[i][j] = *value_p;
     }
 
     if (has_visible == false) {
@@ -314,16 +344,14 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
   node->vert_indices = vert_indices;
 
   /* Build the vertex list, unique verts first */
-  GHashIterator gh_iter;
-  GHASH_ITER (gh_iter, map) {
-    void *value = BLI_ghashIterator_getValue(&gh_iter);
-    int ndx = POINTER_AS_INT(value);
+  for (int i = 0; i < node_verts_len; i++) {
+    int ndx = node_vert_map[i];
 
     if (ndx < 0) {
       ndx = -ndx + node->uniq_verts - 1;
     }
 
-    vert_indices[ndx] = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+    vert_indices[ndx] = node_verts[i];
   }
 
   for (int i = 0; i < totface; i++) {
@@ -340,7 +368,8 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
 
   BKE_pbvh_node_fully_hidden_set(node, !has_visible);
 
-  BLI_ghash_free(map, NULL, NULL);
+  MEM_freeN(node_verts);
+  MEM_freeN(node_vert_map);
 }
 
 static void update_vb(PBVH *pbvh, PBVHNode *node, BBC *prim_bbc, int offset, int count)
@@ -413,23 +442,23 @@ static void build_grid_leaf_node(PBVH *pbvh, PBVHNode *node)
   BKE_pbvh_node_mark_rebuild_draw(node);
 }
 
-static void build_leaf(PBVH *pbvh, int node_index, BBC *prim_bbc, int offset, int count)
-{
-  pbvh->nodes[node_index].flag |= PBVH_Leaf;
+/* Tree node while the primitives are partitioned, the final nodes are
+ * created from these once the whole tree is known, see #pbvh_build. */
+typedef struct PBVHBuildNode {
+  /* Array of two children, NULL for leaves. */
+  struct PBVHBuildNode *children;
+  int offset, count;
+} PBVHBuildNode;
 
-  pbvh->nodes[node_index].prim_indices = pbvh->prim_indices + offset;
-  pbvh->nodes[node_index].totprim = count;
+typedef struct PBVHBuildTask {
+  PBVHBuildNode *node;
+  int offset, count;
+} PBVHBuildTask;
 
-  /* Still need vb for searches */
-  update_vb(pbvh, &pbvh->nodes[node_index], prim_bbc, offset, count);
-
-  if (pbvh->looptri) {
-    build_mesh_leaf_node(pbvh, pbvh->nodes + node_index);
-  }
-  else {
-    build_grid_leaf_node(pbvh, pbvh->nodes + node_index);
-  }
-}
+typedef struct PBVHBuildData {
+  PBVH *pbvh;
+  BBC *prim_bbc;
+} PBVHBuildData;
 
 /* Return zero if all primitives in the node can be drawn with the
  * same material (including flat/smooth shading), non-zero otherwise */
@@ -465,38 +494,42 @@ static bool leaf_needs_material_split(PBVH *pbvh, int offset, int count)
   return false;
 }
 
-/* Recursively build a node in the tree
- *
- * vb is the voxel box around all of the primitives contained in
- * this node.
+/* Recursively partition the primitives of a node in the tree
  *
  * cb is the bounding box around all the centroids of the primitives
  * contained in this node
  *
  * offset and start indicate a range in the array of primitive indices
+ *
+ * Subtrees only touch their own range of primitive indices, large ones are
+ * partitioned in parallel as tasks of \a pool.
  */
 
-static void build_sub(PBVH *pbvh, int node_index, BB *cb, BBC *prim_bbc, int offset, int count)
+static void pbvh_build_task_cb(TaskPool *__restrict pool, void *taskdata);
+
+static void build_sub(TaskPool *pool,
+                      PBVH *pbvh,
+                      PBVHBuildNode *node,
+                      BB *cb,
+                      BBC *prim_bbc,
+                      int offset,
+                      int count)
 {
   int end;
   BB cb_backing;
 
+  node->children = NULL;
+  node->offset = offset;
+  node->count = count;
+
   /* Decide whether this is a leaf or not */
   const bool below_leaf_limit = count <= pbvh->leaf_limit;
   if (below_leaf_limit) {
     if (!leaf_needs_material_split(pbvh, offset, count)) {
-      build_leaf(pbvh, node_index, prim_bbc, offset, count);
       return;
     }
   }
 
-  /* Add two child nodes */
-  pbvh->nodes[node_index].children_offset = pbvh->totnode;
-  pbvh_grow_nodes(pbvh, pbvh->totnode + 2);
-
-  /* Update parent node bounding box */
-  update_vb(pbvh, &pbvh->nodes[node_index], prim_bbc, offset, count);
-
   if (!below_leaf_limit) {
     /* Find axis with widest range of primitive centroids */
     if (!cb) {
@@ -521,14 +554,119 @@ static void build_sub(PBVH *pbvh, int node_index, BB *cb, BBC *prim_bbc, int off
     end = partition_indices_material(pbvh, offset, offset + count - 1);
   }
 
+  /* Add two child nodes */
+  node->children = MEM_mallocN(sizeof(*node->children) * 2, __func__);
+
   /* Build children */
-  build_sub(pbvh, pbvh->nodes[node_index].children_offset, NULL, prim_bbc, offset, end - offset);
-  build_sub(pbvh,
-            pbvh->nodes[node_index].children_offset + 1,
-            NULL,
-            prim_bbc,
-            end,
-            offset + count - end);
+  const int child_offset[2] = {offset, end};
+  const int child_count[2] = {end - offset, offset + count - end};
+  for (int i = 0; i < 2; i++) {
+    if (child_count[i] > pbvh->leaf_limit * 4) {
+      PBVHBuildTask *task = MEM_mallocN(sizeof(*task), __func__);
+      task->node = &node->children[i];
+      task->offset = child_offset[i];
+      task->count = child_count[i];
+      BLI_task_pool_push(pool, pbvh_build_task_cb, task, true, NULL);
+    }
+    else {
+      build_sub(pool, pbvh, &node->children[i], NULL, prim_bbc, child_offset[i], child_count[i]);
+    }
+  }
+}
+
+static void pbvh_build_task_cb(TaskPool *__restrict pool, void *taskdata)
+{
+  PBVHBuildData *data = BLI_task_pool_user_data(pool);
+  PBVHBuildTask *task = taskdata;
+  build_sub(pool, data->pbvh, task->node, NULL, data->prim_bbc, task->offset, task->count);
+}
+
+/* Create the tree nodes in depth first order, the same order
+ * nodes were added in when the tree was built recursively. */
+static void build_nodes(PBVH *pbvh, int node_index, PBVHBuildNode *build_node)
+{
+  if (build_node->children == NULL) {
+    PBVHNode *node = &pbvh->nodes[node_index];
+    node->flag |= PBVH_Leaf;
+    node->prim_indices = pbvh->prim_indices + build_node->offset;
+    node->totprim = build_node->count;
+    return;
+  }
+
+  const int children_offset = pbvh->totnode;
+  pbvh->nodes[node_index].children_offset = children_offset;
+  pbvh_grow_nodes(pbvh, pbvh->totnode + 2);
+
+  build_nodes(pbvh, children_offset, &build_node->children[0]);
+  build_nodes(pbvh, children_offset + 1, &build_node->children[1]);
+
+  MEM_freeN(build_node->children);
+}
+
+/* Leaves in the order they're reached depth first, this order decides
+ * which leaf a vertex is unique to. */
+static void build_leaves_gather(PBVH *pbvh, int node_index, int *leaves, int *r_leaves_len)
+{
+  const PBVHNode *node = &pbvh->nodes[node_index];
+  if (node->flag & PBVH_Leaf) {
+    leaves[(*r_leaves_len)++] = node_index;
+    return;
+  }
+  build_leaves_gather(pbvh, node->children_offset, leaves, r_leaves_len);
+  build_leaves_gather(pbvh, node->children_offset + 1, leaves, r_leaves_len);
+}
+
+typedef struct PBVHBuildLeavesData {
+  PBVH *pbvh;
+  BBC *prim_bbc;
+  const int *leaves;
+  /* For every vertex, the first leaf that uses it. */
+  int *vert_leaf;
+} PBVHBuildLeavesData;
+
+static void vert_leaf_claim(int *vert_leaf, int vertex, int leaf)
+{
+  int leaf_old = vert_leaf[vertex];
+  while (leaf < leaf_old) {
+    const int leaf_prev = atomic_cas_int32(&vert_leaf[vertex], leaf_old, leaf);
+    if (leaf_prev == leaf_old) {
+      break;
+    }
+    leaf_old = leaf_prev;
+  }
+}
+
+static void build_leaf_task_cb(void *__restrict userdata,
+                               const int n,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildLeavesData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  PBVHNode *node = &pbvh->nodes[data->leaves[n]];
+
+  /* Still need vb for searches */
+  update_vb(pbvh, node, data->prim_bbc, node->prim_indices - pbvh->prim_indices, node->totprim);
+
+  if (pbvh->looptri) {
+    for (int i = 0; i < node->totprim; i++) {
+      const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
+      for (int j = 0; j < 3; j++) {
+        vert_leaf_claim(data->vert_leaf, pbvh->mloop[lt->tri[j]].v, n);
+      }
+    }
+  }
+  else {
+    build_grid_leaf_node(pbvh, node);
+  }
+}
+
+static void build_mesh_leaf_task_cb(void *__restrict userdata,
+                                    const int n,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildLeavesData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  build_mesh_leaf_node(pbvh, &pbvh->nodes[data->leaves[n]], n, data->vert_leaf);
 }
 
 static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
@@ -552,8 +690,111 @@ static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
     }
   }
 
+  /* Partition the primitives. */
+  PBVHBuildData build_data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+  };
+  PBVHBuildNode build_root;
+  TaskPool *pool = BLI_task_pool_create(&build_data, TASK_PRIORITY_HIGH);
+  build_sub(pool, pbvh, &build_root, cb, prim_bbc, 0, totprim);
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
   pbvh->totnode = 1;
-  build_sub(pbvh, 0, cb, prim_bbc, 0, totprim);
+  build_nodes(pbvh, 0, &build_root);
+
+  /* Build the leaves. */
+  int *leaves = MEM_mallocN(sizeof(int) * ((pbvh->totnode + 1) / 2), __func__);
+  int leaves_len = 0;
+  build_leaves_gather(pbvh, 0, leaves, &leaves_len);
+  BLI_assert(leaves_len == (pbvh->totnode + 1) / 2);
+
+  PBVHBuildLeavesData leaves_data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+      .leaves = leaves,
+      .vert_leaf = NULL,
+  };
+  if (pbvh->looptri) {
+    leaves_data.vert_leaf = MEM_mallocN(sizeof(int) * pbvh->totvert, __func__);
+    copy_vn_i(leaves_data.vert_leaf, pbvh->totvert, INT_MAX);
+  }
+
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, leaves_len);
+  BLI_task_parallel_range(0, leaves_len, &leaves_data, build_leaf_task_cb, &settings);
+  if (pbvh->looptri) {
+    BLI_task_parallel_range(0, leaves_len, &leaves_data, build_mesh_leaf_task_cb, &settings);
+    MEM_freeN(leaves_data.vert_leaf);
+  }
+  MEM_freeN(leaves);
+
+  /* Update parent node bounding boxes, children always come after their parent. */
+  for (int i = pbvh->totnode - 1; i >= 0; i--) {
+    PBVHNode *node = &pbvh->nodes[i];
+    if (!(node->flag & PBVH_Leaf)) {
+      BB_reset(&node->vb);
+      BB_expand_with_bb(&node->vb, &pbvh->nodes[node->children_offset].vb);
+      BB_expand_with_bb(&node->vb, &pbvh->nodes[node->children_offset + 1].vb);
+      node->orig_vb = node->vb;
+    }
+  }
+}
+
+typedef struct PBVHBuildPrimBBData {
+  PBVH *pbvh;
+  BBC *prim_bbc;
+} PBVHBuildPrimBBData;
+
+static void pbvh_build_looptri_bb_task_cb(void *__restrict userdata,
+                                          const int i,
+                                          const TaskParallelTLS *__restrict tls)
+{
+  PBVHBuildPrimBBData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const MLoopTri *lt = &pbvh->looptri[i];
+  const int sides = 3;
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < sides; j++) {
+    BB_expand((BB *)bbc, pbvh->verts[pbvh->mloop[lt->tri[j]].v].co);
+  }
+
+  BBC_update_centroid(bbc);
+
+  BB_expand(tls->userdata_chunk, bbc->bcentroid);
+}
+
+static void pbvh_build_grid_bb_task_cb(void *__restrict userdata,
+                                       const int i,
+                                       const TaskParallelTLS *__restrict tls)
+{
+  PBVHBuildPrimBBData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const CCGKey *key = &pbvh->gridkey;
+  CCGElem *grid = pbvh->grids[i];
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < key->grid_area; j++) {
+    BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
+  }
+
+  BBC_update_centroid(bbc);
+
+  BB_expand(tls->userdata_chunk, bbc->bcentroid);
+}
+
+/* Merge the centroid bounds of the primitives handled by each thread. */
+static void pbvh_build_prim_bb_reduce(const void *__restrict UNUSED(userdata),
+                                      void *__restrict chunk_join,
+                                      void *__restrict chunk)
+{
+  BB_expand_with_bb(chunk_join, chunk);
 }
 
 /**
@@ -583,7 +824,6 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
   pbvh->mloop = mloop;
   pbvh->looptri = looptri;
   pbvh->verts = verts;
-  pbvh->vert_bitmap = BLI_BITMAP_NEW(totvert, "bvh->vert_bitmap");
   pbvh->totvert = totvert;
   pbvh->leaf_limit = LEAF_LIMIT;
   pbvh->vdata = vdata;
@@ -598,28 +838,23 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
   /* For each face, store the AABB and the AABB centroid */
   prim_bbc = MEM_mallocN(sizeof(BBC) * looptri_num, "prim_bbc");
 
-  for (int i = 0; i < looptri_num; i++) {
-    const MLoopTri *lt = &looptri[i];
-    const int sides = 3;
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < sides; j++) {
-      BB_expand((BB *)bbc, verts[pbvh->mloop[lt->tri[j]].v].co);
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  PBVHBuildPrimBBData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (looptri_num > 10000);
+  settings.userdata_chunk = &cb;
+  settings.userdata_chunk_size = sizeof(cb);
+  settings.func_reduce = pbvh_build_prim_bb_reduce;
+  BLI_task_parallel_range(0, looptri_num, &data, pbvh_build_looptri_bb_task_cb, &settings);
 
   if (looptri_num) {
     pbvh_build(pbvh, &cb, prim_bbc, looptri_num);
   }
 
   MEM_freeN(prim_bbc);
-  MEM_freeN(pbvh->vert_bitmap);
 }
 
 /* Do a full rebuild with on Grids data structure */
@@ -648,20 +883,17 @@ void BKE_pbvh_build_grids(PBVH *pbvh,
   /* For each grid, store the AABB and the AABB centroid */
   BBC *prim_bbc = MEM_mallocN(sizeof(BBC) * totgrid, "prim_bbc");
 
-  for (int i = 0; i < totgrid; i++) {
-    CCGElem *grid = grids[i];
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < gridsize * gridsize; j++) {
-      BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  PBVHBuildPrimBBData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (totgrid * gridsize * gridsize > 10000);
+  settings.userdata_chunk = &cb;
+  settings.userdata_chunk_size = sizeof(cb);
+  settings.func_reduce = pbvh_build_prim_bb_reduce;
+  BLI_task_parallel_range(0, totgrid, &data, pbvh_build_grid_bb_task_cb, &settings);
 
   if (totgrid) {
     pbvh_build(pbvh, &cb, prim_bbc, totgrid);
@@ -0,0 +1,235 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "testing/testing.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_bitmap.h"
+#include "BLI_math_geom.h"
+
+#include "BKE_DerivedMesh.h"
+#include "BKE_ccg.h"
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_pbvh.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "pbvh_intern.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+namespace blender::bke::tests {
+
+class pbvh_build : public testing::Test {
+ public:
+  static void SetUpTestSuite()
+  {
+    BKE_idtype_init();
+  }
+};
+
+/* A flat grid of `size * size` quads, with the looptris a sculpt mode PBVH is built on. */
+struct GridMesh {
+  Mesh *mesh;
+  MLoopTri *looptri;
+  int looptri_num;
+
+  GridMesh(const int size)
+  {
+    mesh = grid_mesh_create(size, 1.0f, 0.0f);
+    looptri_num = poly_to_tri_count(mesh->totpoly, mesh->totloop);
+    /* Owned by the PBVH once it is built. */
+    looptri = static_cast<MLoopTri *>(MEM_mallocN(sizeof(MLoopTri) * looptri_num, __func__));
+    BKE_mesh_recalc_looptri(
+        mesh->mloop, mesh->mpoly, mesh->mvert, mesh->totloop, mesh->totpoly, looptri);
+  }
+
+  ~GridMesh()
+  {
+    BKE_id_free(nullptr, mesh);
+  }
+
+  PBVH *build_pbvh()
+  {
+    PBVH *pbvh = BKE_pbvh_new();
+    BKE_pbvh_build_mesh(pbvh,
+                        mesh,
+                        mesh->mpoly,
+                        mesh->mloop,
+                        mesh->mvert,
+                        mesh->totvert,
+                        &mesh->vdata,
+                        &mesh->ldata,
+                        &mesh->pdata,
+                        looptri,
+                        looptri_num);
+    return pbvh;
+  }
+};
+
+/* Multires style grids, with coordinates only. */
+struct GridsData {
+  CCGKey key;
+  CCGElem **grids;
+  void **gridfaces;
+  DMFlagMat *flagmats;
+  BLI_bitmap **grid_hidden;
+  int totgrid;
+
+  GridsData(const int totgrid, const int grid_size) : totgrid(totgrid)
+  {
+    memset(&key, 0, sizeof(key));
+    key.elem_size = sizeof(float[3]);
+    key.grid_size = grid_size;
+    key.grid_area = grid_size * grid_size;
+    key.grid_bytes = key.grid_area * key.elem_size;
+
+    grids = static_cast<CCGElem **>(MEM_mallocN(sizeof(CCGElem *) * totgrid, __func__));
+    gridfaces = static_cast<void **>(MEM_callocN(sizeof(void *) * totgrid, __func__));
+    flagmats = static_cast<DMFlagMat *>(MEM_callocN(sizeof(DMFlagMat) * totgrid, __func__));
+    grid_hidden = static_cast<BLI_bitmap **>(
+        MEM_callocN(sizeof(BLI_bitmap *) * totgrid, __func__));
+
+    const int row = int(ceilf(sqrtf(float(totgrid))));
+    for (int g = 0; g < totgrid; g++) {
+      float *co = static_cast<float *>(MEM_mallocN(key.grid_bytes, __func__));
+      for (int y = 0; y < grid_size; y++) {
+        for (int x = 0; x < grid_size; x++, co += 3) {
+          co[0] = float((g % row) * grid_size + x);
+          co[1] = float((g / row) * grid_size + y);
+          co[2] = 0.0f;
+        }
+      }
+      grids[g] = reinterpret_cast<CCGElem *>(co - key.grid_area * 3);
+    }
+  }
+
+  ~GridsData()
+  {
+    for (int g = 0; g < totgrid; g++) {
+      MEM_freeN(grids[g]);
+    }
+    MEM_freeN(grids);
+    MEM_freeN(gridfaces);
+    MEM_freeN(flagmats);
+    MEM_freeN(grid_hidden);
+  }
+
+  PBVH *build_pbvh()
+  {
+    PBVH *pbvh = BKE_pbvh_new();
+    BKE_pbvh_build_grids(pbvh, grids, totgrid, &key, gridfaces, flagmats, grid_hidden);
+    return pbvh;
+  }
+};
+
+static bool bb_contains(const BB *outer, const BB *inner)
+{
+  for (int i = 0; i < 3; i++) {
+    if (inner->bmin[i] < outer->bmin[i] || inner->bmax[i] > outer->bmax[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void expect_children_bounded(const PBVH *pbvh)
+{
+  for (int i = 0; i < pbvh->totnode; i++) {
+    const PBVHNode *node = &pbvh->nodes[i];
+    if (node->flag & PBVH_Leaf) {
+      continue;
+    }
+    for (int c = 0; c < 2; c++) {
+      const PBVHNode *child = &pbvh->nodes[node->children_offset + c];
+      EXPECT_GT(node->children_offset, i);
+      EXPECT_TRUE(bb_contains(&node->vb, &child->vb));
+    }
+  }
+}
+
+TEST_F(pbvh_build, MeshLeafVerts)
+{
+  GridMesh grid(128);
+  PBVH *pbvh = grid.build_pbvh();
+
+  PBVHNode **nodes;
+  int totnode;
+  BKE_pbvh_search_gather(pbvh, nullptr, nullptr, &nodes, &totnode);
+  EXPECT_GT(totnode, 1);
+
+  int *unique_count = static_cast<int *>(MEM_callocN(sizeof(int) * grid.mesh->totvert, __func__));
+  int totprim = 0;
+  for (int n = 0; n < totnode; n++) {
+    const PBVHNode *node = nodes[n];
+    totprim += node->totprim;
+
+    for (int i = 0; i < node->uniq_verts; i++) {
+      unique_count[node->vert_indices[i]]++;
+    }
+    for (int i = 0; i < node->totprim; i++) {
+      const MLoopTri *lt = &grid.looptri[node->prim_indices[i]];
+      for (int j = 0; j < 3; j++) {
+        const int vert_index = node->vert_indices[node->face_vert_indices[i][j]];
+        EXPECT_EQ(vert_index, grid.mesh->mloop[lt->tri[j]].v);
+      }
+    }
+  }
+  EXPECT_EQ(totprim, grid.looptri_num);
+  for (int v = 0; v < grid.mesh->totvert; v++) {
+    EXPECT_EQ(unique_count[v], 1);
+  }
+  expect_children_bounded(pbvh);
+
+  MEM_freeN(unique_count);
+  MEM_freeN(nodes);
+  BKE_pbvh_free(pbvh);
+}
+
+TEST_F(pbvh_build, GridsLeaves)
+{
+  GridsData grids(256, 9);
+  PBVH *pbvh = grids.build_pbvh();
+
+  PBVHNode **nodes;
+  int totnode;
+  BKE_pbvh_search_gather(pbvh, nullptr, nullptr, &nodes, &totnode);
+  EXPECT_GT(totnode, 1);
+
+  int totprim = 0;
+  for (int n = 0; n < totnode; n++) {
+    totprim += nodes[n]->totprim;
+    EXPECT_FALSE(BKE_pbvh_node_fully_hidden_get(nodes[n]));
+  }
+  EXPECT_EQ(totprim, grids.totgrid);
+  expect_children_bounded(pbvh);
+
+  MEM_freeN(nodes);
+  BKE_pbvh_free(pbvh);
+}
+
+}  // namespace blender::bke::tests
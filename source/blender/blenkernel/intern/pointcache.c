@@ -44,8 +44,11 @@
 #include "DNA_simulation_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 #include "BLI_math.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -2213,28 +2216,447 @@ static int ptcache_filename(PTCacheID *pid, char *filename, int cfra, short do_p
   return len; /* make sure the above string is always 16 chars */
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Background Writer
+ *
+ * While baking, finished frames of disk caches are handed to writer threads
+ * which compress and write them, so the simulation doesn't wait for the disk.
+ * Files that are queued or being written are tracked by their path. Reading
+ * or removing such a file waits for its write to finish first, and checking
+ * for its existence doesn't need to touch the file system.
+ * \{ */
+
+typedef struct PTCacheWriter {
+  ListBase threads;
+  ThreadQueue *queue;
+
+  /* Paths of files that are queued or being written, protected by the mutex. */
+  GSet *pending;
+  /* Simulation waits when this many frames are pending, to bound memory usage. */
+  int pending_max;
+  ThreadMutex mutex;
+  ThreadCondition cond;
+} PTCacheWriter;
+
+/* Only set while baking. */
+static PTCacheWriter *ptcache_writer = NULL;
+
+static bool ptcache_writer_is_pending(const char *filename)
+{
+  PTCacheWriter *writer = ptcache_writer;
+  bool pending;
+
+  if (writer == NULL) {
+    return false;
+  }
+
+  BLI_mutex_lock(&writer->mutex);
+  pending = BLI_gset_haskey(writer->pending, filename);
+  BLI_mutex_unlock(&writer->mutex);
+
+  return pending;
+}
+
+/* Wait until the file is written, or all files when \a filename is NULL. */
+static void ptcache_writer_wait(const char *filename)
+{
+  PTCacheWriter *writer = ptcache_writer;
+
+  if (writer == NULL) {
+    return;
+  }
+
+  BLI_mutex_lock(&writer->mutex);
+  while (filename ? BLI_gset_haskey(writer->pending, filename) :
+                    BLI_gset_len(writer->pending) != 0) {
+    BLI_condition_wait(&writer->cond, &writer->mutex);
+  }
+  BLI_mutex_unlock(&writer->mutex);
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Single File Container
+ *
+ * With #PTCACHE_SINGLE_FILE all frames of a disk cache are stored in one file:
+ * a header, the frames in the same format as separate frame files, and an index
+ * of the frames at the end. A frame is added by appending it after the index and
+ * writing the updated index after it, so finding a frame doesn't need a directory
+ * lookup and a bake doesn't create a file per frame. The header pointing to the
+ * new index is written last, an interrupted write keeps the previous index valid.
+ *
+ * Previous indices and frames that are replaced or cleared leave unused space in
+ * the file until the whole cache is cleared.
+ * \{ */
+
+#define PTCACHE_CONTAINER_EXT ".bpcache"
+#define PTCACHE_CONTAINER_VERSION 1
+
+typedef struct PTCacheContainerHeader {
+  char id[8];
+  unsigned int version;
+  unsigned int frames_num;
+  int64_t index_offset;
+} PTCacheContainerHeader;
+
+typedef struct PTCacheContainerFrame {
+  int frame;
+  char _pad[4];
+  int64_t offset;
+  int64_t size;
+} PTCacheContainerFrame;
+
+typedef struct PTCacheContainer {
+  PTCacheContainerHeader header;
+  PTCacheContainerFrame *frames;
+
+  /* The frame opened for reading or writing. */
+  int frame;
+  bool is_write;
+  int64_t frame_offset;
+  int64_t frame_end;
+  /* Bytes of the frame left to read, only updated by #ptcache_file_read. */
+  int64_t read_left;
+} PTCacheContainer;
+
+/* Protects the index of all container files, held while a frame is written. */
+static ThreadMutex ptcache_container_mutex = BLI_MUTEX_INITIALIZER;
+
+static bool ptcache_use_single_file(const PTCacheID *pid)
+{
+  const PointCache *cache = pid->cache;
+
+  return (cache->flag & PTCACHE_SINGLE_FILE) && (cache->flag & PTCACHE_DISK_CACHE) &&
+         (cache->flag & PTCACHE_EXTERNAL) == 0 && pid->file_type == PTCACHE_FILE_PTCACHE;
+}
+
+/* Get the path of the container file, returns false when the cache has no path yet. */
+static bool ptcache_container_filename(PTCacheID *pid, char *filename)
+{
+  const int len = ptcache_filename(pid, filename, 0, 1, 0);
+
+  if (len == 0) {
+    filename[0] = '\0';
+    return false;
+  }
+
+  BLI_snprintf(filename + len,
+               MAX_PTCACHE_FILE - len,
+               "_%02u" PTCACHE_CONTAINER_EXT,
+               pid->stack_index);
+
+  return true;
+}
+
+static bool ptcache_container_index_read(FILE *fp, PTCacheContainer *container)
+{
+  PTCacheContainerHeader *header = &container->header;
+
+  if (BLI_fseek(fp, 0, SEEK_SET) != 0 || fread(header, sizeof(*header), 1, fp) != 1 ||
+      !STREQLEN(header->id, "BPHYSIDX", 8) || header->version != PTCACHE_CONTAINER_VERSION) {
+    return false;
+  }
+
+  if (header->frames_num == 0) {
+    return true;
+  }
+
+  container->frames = MEM_malloc_arrayN(
+      header->frames_num, sizeof(PTCacheContainerFrame), "PTCacheContainerFrame");
+
+  if (BLI_fseek(fp, header->index_offset, SEEK_SET) != 0 ||
+      fread(container->frames, sizeof(PTCacheContainerFrame), header->frames_num, fp) !=
+          header->frames_num) {
+    MEM_SAFE_FREE(container->frames);
+    return false;
+  }
+
+  return true;
+}
+
+/* Write the index and then the header pointing to it. */
+static bool ptcache_container_index_write(FILE *fp, const PTCacheContainer *container)
+{
+  const PTCacheContainerHeader *header = &container->header;
+
+  if (BLI_fseek(fp, header->index_offset, SEEK_SET) != 0) {
+    return false;
+  }
+
+  if (header->frames_num != 0 &&
+      fwrite(container->frames, sizeof(PTCacheContainerFrame), header->frames_num, fp) !=
+          header->frames_num) {
+    return false;
+  }
+
+  if (fflush(fp) != 0) {
+    return false;
+  }
+
+  return (BLI_fseek(fp, 0, SEEK_SET) == 0 && fwrite(header, sizeof(*header), 1, fp) == 1);
+}
+
+static int ptcache_container_frame_find(const PTCacheContainer *container, int frame)
+{
+  for (unsigned int i = 0; i < container->header.frames_num; i++) {
+    if (container->frames[i].frame == frame) {
+      return (int)i;
+    }
+  }
+
+  return -1;
+}
+
+/* Read only the index of the container, returns false when there is none. */
+static bool ptcache_container_index_load(const char *filename, PTCacheContainer *container)
+{
+  FILE *fp;
+  bool ok = false;
+
+  memset(container, 0, sizeof(*container));
+
+  BLI_mutex_lock(&ptcache_container_mutex);
+  fp = BLI_fopen(filename, "rb");
+  if (fp) {
+    ok = ptcache_container_index_read(fp, container);
+    fclose(fp);
+  }
+  BLI_mutex_unlock(&ptcache_container_mutex);
+
+  return ok;
+}
+
 /**
- * Caller must close after!
+ * Open the container positioned at the start of the frame. Reading fails for
+ * frames that aren't stored, writing appends the frame after the index and keeps
+ * the container locked until #ptcache_container_close.
  */
-static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
+static FILE *ptcache_container_open(const char *filename,
+                                    int mode,
+                                    int cfra,
+                                    PTCacheContainer *container)
 {
-  PTCacheFile *pf;
   FILE *fp = NULL;
-  char filename[FILE_MAX * 2];
 
+  memset(container, 0, sizeof(*container));
+  container->frame = cfra;
+
+  if (mode == PTCACHE_FILE_READ) {
+    int index;
+
+    BLI_mutex_lock(&ptcache_container_mutex);
+    fp = BLI_fopen(filename, "rb");
+    if (fp && !ptcache_container_index_read(fp, container)) {
+      fclose(fp);
+      fp = NULL;
+    }
+    BLI_mutex_unlock(&ptcache_container_mutex);
+
+    if (fp == NULL) {
+      return NULL;
+    }
+
+    index = ptcache_container_frame_find(container, cfra);
+    if (index == -1 || BLI_fseek(fp, container->frames[index].offset, SEEK_SET) != 0) {
+      fclose(fp);
+      MEM_SAFE_FREE(container->frames);
+      return NULL;
+    }
+
+    container->frame_offset = container->frames[index].offset;
+    container->frame_end = container->frame_offset + container->frames[index].size;
+  }
+  else if (mode == PTCACHE_FILE_WRITE) {
+    BLI_mutex_lock(&ptcache_container_mutex);
+
+    fp = BLI_fopen(filename, "rb+");
+    if (fp && !ptcache_container_index_read(fp, container)) {
+      /* Not a valid container, start over. */
+      fclose(fp);
+      fp = NULL;
+    }
+
+    if (fp == NULL) {
+      /* Will create the dir if needs be, same as "//textures" is created. */
+      BLI_make_existing_file(filename);
+      fp = BLI_fopen(filename, "wb+");
+
+      memcpy(container->header.id, "BPHYSIDX", 8);
+      container->header.version = PTCACHE_CONTAINER_VERSION;
+      container->header.frames_num = 0;
+      container->header.index_offset = sizeof(PTCacheContainerHeader);
+    }
+
+    /* Don't overwrite the current index, it stays valid until the header is updated. */
+    const int64_t index_end = container->header.index_offset +
+                              (int64_t)sizeof(PTCacheContainerFrame) *
+                                  container->header.frames_num;
+
+    if (fp == NULL || BLI_fseek(fp, index_end, SEEK_SET) != 0) {
+      if (fp) {
+        fclose(fp);
+      }
+      MEM_SAFE_FREE(container->frames);
+      BLI_mutex_unlock(&ptcache_container_mutex);
+      return NULL;
+    }
+
+    container->is_write = true;
+    container->frame_offset = index_end;
+  }
+
+  return fp;
+}
+
+/* Close the container, adding a written frame to the index when \a write_ok is set. */
+static bool ptcache_container_close(FILE *fp, PTCacheContainer *container, const bool write_ok)
+{
+  bool ok = true;
+
+  if (container->is_write && write_ok) {
+    const int64_t frame_end = BLI_ftell(fp);
+    int index = ptcache_container_frame_find(container, container->frame);
+
+    if (index == -1) {
+      index = (int)container->header.frames_num++;
+      container->frames = MEM_reallocN(
+          container->frames, sizeof(PTCacheContainerFrame) * container->header.frames_num);
+    }
+
+    memset(&container->frames[index], 0, sizeof(PTCacheContainerFrame));
+    container->frames[index].frame = container->frame;
+    container->frames[index].offset = container->frame_offset;
+    container->frames[index].size = frame_end - container->frame_offset;
+    container->header.index_offset = frame_end;
+
+    ok = (frame_end != -1) && ptcache_container_index_write(fp, container);
+  }
+
+  fclose(fp);
+
+  if (container->is_write) {
+    BLI_mutex_unlock(&ptcache_container_mutex);
+  }
+
+  MEM_SAFE_FREE(container->frames);
+
+  return ok;
+}
+
+/* Remove the frames of a clear mode from the index, or the file for #PTCACHE_CLEAR_ALL. */
+static void ptcache_container_clear(const char *filename, int mode, int cfra)
+{
+  BLI_mutex_lock(&ptcache_container_mutex);
+
+  if (mode == PTCACHE_CLEAR_ALL) {
+    if (BLI_exists(filename)) {
+      BLI_delete(filename, false, false);
+    }
+  }
+  else {
+    PTCacheContainer container = {{{0}}};
+    FILE *fp = BLI_fopen(filename, "rb+");
+
+    if (fp && ptcache_container_index_read(fp, &container)) {
+      unsigned int frames_num = 0;
+
+      for (unsigned int i = 0; i < container.header.frames_num; i++) {
+        const int frame = container.frames[i].frame;
+
+        if ((mode == PTCACHE_CLEAR_FRAME && frame == cfra) ||
+            (mode == PTCACHE_CLEAR_BEFORE && frame < cfra) ||
+            (mode == PTCACHE_CLEAR_AFTER && frame > cfra)) {
+          continue;
+        }
+        container.frames[frames_num++] = container.frames[i];
+      }
+
+      if (frames_num != container.header.frames_num) {
+        container.header.frames_num = frames_num;
+        ptcache_container_index_write(fp, &container);
+      }
+    }
+
+    if (fp) {
+      fclose(fp);
+    }
+    MEM_SAFE_FREE(container.frames);
+  }
+
+  BLI_mutex_unlock(&ptcache_container_mutex);
+}
+
+static bool ptcache_container_frame_exists(PTCacheID *pid, int cfra)
+{
+  char filename[MAX_PTCACHE_FILE];
+  PTCacheContainer container;
+  bool exists = false;
+
+  if (ptcache_container_filename(pid, filename) &&
+      ptcache_container_index_load(filename, &container)) {
+    exists = ptcache_container_frame_find(&container, cfra) != -1;
+    MEM_SAFE_FREE(container.frames);
+  }
+
+  return exists;
+}
+
+/** \} */
+
+/**
+ * Get the path of a frame file and of the container it's stored in, or an empty
+ * \a container for separate frame files. Returns false when it can't be opened in this mode.
+ */
+static bool ptcache_file_open_filename(
+    PTCacheID *pid, int mode, int cfra, char *filename, char *container)
+{
 #ifndef DURIAN_POINTCACHE_LIB_OK
   /* don't allow writing for linked objects */
   if (pid->owner_id->lib && mode == PTCACHE_FILE_WRITE) {
-    return NULL;
+    return false;
   }
+#else
+  UNUSED_VARS(mode);
 #endif
   if (!G.relbase_valid && (pid->cache->flag & PTCACHE_EXTERNAL) == 0) {
-    return NULL; /* save blend file before using disk pointcache */
+    return false; /* save blend file before using disk pointcache */
   }
 
   ptcache_filename(pid, filename, cfra, 1, 1);
 
-  if (mode == PTCACHE_FILE_READ) {
+  if (!ptcache_use_single_file(pid) || !ptcache_container_filename(pid, container)) {
+    container[0] = '\0';
+  }
+
+  return true;
+}
+
+/**
+ * Caller must close after!
+ */
+static PTCacheFile *ptcache_file_open_path(const char *filename,
+                                           const char *container_filename,
+                                           int mode,
+                                           int cfra)
+{
+  PTCacheContainer *container = NULL;
+  PTCacheFile *pf;
+  FILE *fp = NULL;
+
+  if (container_filename[0]) {
+    if (mode == PTCACHE_FILE_READ) {
+      ptcache_writer_wait(filename);
+    }
+    container = MEM_mallocN(sizeof(PTCacheContainer), "PTCacheContainer");
+    fp = ptcache_container_open(container_filename, mode, cfra, container);
+    if (fp == NULL) {
+      MEM_freeN(container);
+      return NULL;
+    }
+  }
+  else if (mode == PTCACHE_FILE_READ) {
+    ptcache_writer_wait(filename);
     fp = BLI_fopen(filename, "rb");
   }
   else if (mode == PTCACHE_FILE_WRITE) {
@@ -2244,6 +2666,7 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
     fp = BLI_fopen(filename, "wb");
   }
   else if (mode == PTCACHE_FILE_UPDATE) {
+    ptcache_writer_wait(filename);
     BLI_make_existing_file(filename);
     fp = BLI_fopen(filename, "rb+");
   }
@@ -2254,18 +2677,44 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 
   pf = MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
   pf->fp = fp;
+  pf->container = container;
   pf->old_format = 0;
   pf->frame = cfra;
 
   return pf;
 }
-static void ptcache_file_close(PTCacheFile *pf)
+
+/**
+ * Caller must close after!
+ */
+static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
+{
+  char filename[MAX_PTCACHE_FILE], container[MAX_PTCACHE_FILE];
+
+  if (!ptcache_file_open_filename(pid, mode, cfra, filename, container)) {
+    return NULL;
+  }
+
+  return ptcache_file_open_path(filename, container, mode, cfra);
+}
+/* Close the file, a frame that failed to be written isn't added to a container. */
+static void ptcache_file_close_ex(PTCacheFile *pf, const bool write_ok)
 {
   if (pf) {
-    fclose(pf->fp);
+    if (pf->container) {
+      ptcache_container_close(pf->fp, pf->container, write_ok);
+      MEM_freeN(pf->container);
+    }
+    else {
+      fclose(pf->fp);
+    }
     MEM_freeN(pf);
   }
 }
+static void ptcache_file_close(PTCacheFile *pf)
+{
+  ptcache_file_close_ex(pf, true);
+}
 
 static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result, unsigned int len)
 {
@@ -2316,16 +2765,34 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
 
   return r;
 }
-static int ptcache_file_compressed_write(
-    PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode)
+/* Result of compressing one block of cache data. */
+typedef struct PTCacheCompressed {
+  /* Compression mode that was applied, 0 when the block is stored as is. */
+  unsigned char compressed;
+  size_t out_len;
+  unsigned char props[16];
+  size_t props_len;
+} PTCacheCompressed;
+
+/**
+ * Compress a block of cache data into \a out, which must hold at least
+ * `LZO_OUT_LEN(in_len) * 4` bytes. Touches no shared state, so blocks can be
+ * compressed on any thread.
+ */
+static int ptcache_compress(const unsigned char *in,
+                            unsigned int in_len,
+                            unsigned char *out,
+                            int mode,
+                            PTCacheCompressed *r_result)
 {
   int r = 0;
   unsigned char compressed = 0;
   size_t out_len = 0;
-  unsigned char *props = MEM_callocN(sizeof(char[16]), "tmp");
   size_t sizeOfIt = 5;
 
-  (void)mode; /* unused when building w/o compression */
+  memset(r_result->props, 0, sizeof(r_result->props));
+
+  UNUSED_VARS(in, in_len, out, mode); /* unused when building w/o compression */
 
 #ifdef WITH_LZO
   out_len = LZO_OUT_LEN(in_len);
@@ -2348,7 +2815,7 @@ static int ptcache_file_compressed_write(
                      &out_len,
                      in,
                      in_len,  // assume sizeof(char)==1....
-                     props,
+                     r_result->props,
                      &sizeOfIt,
                      5,
                      1 << 24,
@@ -2367,28 +2834,60 @@ static int ptcache_file_compressed_write(
   }
 #endif
 
-  ptcache_file_write(pf, &compressed, 1, sizeof(unsigned char));
-  if (compressed) {
-    unsigned int size = out_len;
+  r_result->compressed = compressed;
+  r_result->out_len = out_len;
+  r_result->props_len = sizeOfIt;
+
+  return r;
+}
+static void ptcache_file_compressed_data_write(PTCacheFile *pf,
+                                               const unsigned char *in,
+                                               unsigned int in_len,
+                                               const unsigned char *out,
+                                               const PTCacheCompressed *result)
+{
+  ptcache_file_write(pf, &result->compressed, 1, sizeof(unsigned char));
+  if (result->compressed) {
+    unsigned int size = result->out_len;
     ptcache_file_write(pf, &size, 1, sizeof(unsigned int));
-    ptcache_file_write(pf, out, out_len, sizeof(unsigned char));
+    ptcache_file_write(pf, out, result->out_len, sizeof(unsigned char));
   }
   else {
     ptcache_file_write(pf, in, in_len, sizeof(unsigned char));
   }
 
-  if (compressed == 2) {
-    unsigned int size = sizeOfIt;
-    ptcache_file_write(pf, &sizeOfIt, 1, sizeof(unsigned int));
-    ptcache_file_write(pf, props, size, sizeof(unsigned char));
+  if (result->compressed == 2) {
+    unsigned int size = result->props_len;
+    ptcache_file_write(pf, &size, 1, sizeof(unsigned int));
+    ptcache_file_write(pf, result->props, size, sizeof(unsigned char));
   }
+}
+static int ptcache_file_compressed_write(
+    PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode)
+{
+  PTCacheCompressed result;
+  int r = ptcache_compress(in, in_len, out, mode, &result);
 
-  MEM_freeN(props);
+  ptcache_file_compressed_data_write(pf, in, in_len, out, &result);
 
   return r;
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
+  /* Don't read into the next frame of a container. The position is only looked up when
+   * the read may reach the end, since other reads and seeks don't update the count. */
+  if (pf->container && !pf->container->is_write) {
+    PTCacheContainer *container = pf->container;
+    const int64_t len = (int64_t)tot * size;
+
+    if (len > container->read_left) {
+      container->read_left = container->frame_end - BLI_ftell(pf->fp);
+      if (len > container->read_left) {
+        return 0;
+      }
+    }
+    container->read_left -= len;
+  }
   return (fread(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
@@ -2446,7 +2945,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   /* if there was an error set file as it was */
   if (error) {
-    BLI_fseek(pf->fp, 0, SEEK_SET);
+    BLI_fseek(pf->fp, pf->container ? pf->container->frame_offset : 0, SEEK_SET);
   }
 
   return !error;
@@ -2783,64 +3282,141 @@ static PTCacheMem *ptcache_disk_frame_to_mem(PTCacheID *pid, int cfra)
 
   return pm;
 }
-static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
+/* A block of frame data to compress, independent of the others. */
+typedef struct PTCacheCompressBlock {
+  const unsigned char *in;
+  unsigned int in_len;
+  unsigned char *out;
+  PTCacheCompressed result;
+} PTCacheCompressBlock;
+
+/* All compressed blocks of a frame, in the order they're written. */
+typedef struct PTCacheCompressData {
+  PTCacheCompressBlock *blocks;
+  int blocks_num;
+  int mode;
+} PTCacheCompressData;
+
+static void ptcache_compress_block_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  PTCacheFile *pf = NULL;
-  unsigned int i, error = 0;
+  PTCacheCompressData *data = (PTCacheCompressData *)userdata;
+  PTCacheCompressBlock *block = &data->blocks[i];
 
-  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+  block->out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(block->in_len) * 4,
+                                            "pointcache_lzo_buffer");
+  ptcache_compress(block->in, block->in_len, block->out, data->mode, &block->result);
+}
 
-  pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
+static bool ptcache_extra_is_written(const PTCacheExtra *extra)
+{
+  return extra->data != NULL && extra->totdata != 0;
+}
 
-  if (pf == NULL) {
-    if (G.debug & G_DEBUG) {
-      printf("Error opening disk cache file for writing\n");
+/**
+ * Compress all blocks of the frame data in parallel. This is done before opening
+ * the file, so files that are shared between frames are only held while writing.
+ */
+static void ptcache_mem_frame_compress(PTCacheMem *pm, int compression, PTCacheCompressData *data)
+{
+  int block = 0;
+
+  data->blocks = NULL;
+  data->blocks_num = 0;
+  data->mode = compression;
+
+  if (compression == 0) {
+    return;
+  }
+
+  for (int i = 0; i < BPHYS_TOT_DATA; i++) {
+    data->blocks_num += (pm->data[i] != NULL);
+  }
+  LISTBASE_FOREACH (PTCacheExtra *, extra, &pm->extradata) {
+    data->blocks_num += ptcache_extra_is_written(extra);
+  }
+  data->blocks = MEM_callocN(sizeof(*data->blocks) * data->blocks_num, __func__);
+
+  for (int i = 0; i < BPHYS_TOT_DATA; i++) {
+    if (pm->data[i]) {
+      data->blocks[block].in = (unsigned char *)(pm->data[i]);
+      data->blocks[block].in_len = pm->totpoint * ptcache_data_size[i];
+      block++;
+    }
+  }
+  LISTBASE_FOREACH (PTCacheExtra *, extra, &pm->extradata) {
+    if (ptcache_extra_is_written(extra)) {
+      data->blocks[block].in = (unsigned char *)(extra->data);
+      data->blocks[block].in_len = extra->totdata * ptcache_extra_datasize[extra->type];
+      block++;
     }
-    return 0;
   }
 
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, data->blocks_num, data, ptcache_compress_block_cb, &settings);
+}
+
+static void ptcache_mem_frame_compress_free(PTCacheCompressData *data)
+{
+  for (int b = 0; b < data->blocks_num; b++) {
+    MEM_freeN(data->blocks[b].out);
+  }
+  MEM_SAFE_FREE(data->blocks);
+  data->blocks_num = 0;
+}
+
+/* Write the frame data to a file opened for writing, using the blocks compressed before. */
+static int ptcache_mem_frame_write(PTCacheFile *pf,
+                                   PTCacheMem *pm,
+                                   unsigned int type,
+                                   const PTCacheCompressData *compressed,
+                                   int (*write_header)(PTCacheFile *pf))
+{
+  const PTCacheCompressBlock *blocks = compressed->blocks;
+  const int compression = compressed->mode;
+  unsigned int i, error = 0;
+  int block = 0;
+
   pf->data_types = pm->data_types;
   pf->totpoint = pm->totpoint;
-  pf->type = pid->type;
+  pf->type = type;
   pf->flag = 0;
 
   if (pm->extradata.first) {
     pf->flag |= PTCACHE_TYPEFLAG_EXTRADATA;
   }
 
-  if (pid->cache->compression) {
+  if (compression) {
     pf->flag |= PTCACHE_TYPEFLAG_COMPRESS;
   }
 
-  if (!ptcache_file_header_begin_write(pf) || !pid->write_header(pf)) {
-    error = 1;
+  if (!ptcache_file_header_begin_write(pf) || !write_header(pf)) {
+    return 0;
   }
 
-  if (!error) {
-    if (pid->cache->compression) {
-      for (i = 0; i < BPHYS_TOT_DATA; i++) {
-        if (pm->data[i]) {
-          unsigned int in_len = pm->totpoint * ptcache_data_size[i];
-          unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
-                                                            "pointcache_lzo_buffer");
-          ptcache_file_compressed_write(
-              pf, (unsigned char *)(pm->data[i]), in_len, out, pid->cache->compression);
-          MEM_freeN(out);
-        }
+  if (compression) {
+    for (i = 0; i < BPHYS_TOT_DATA; i++) {
+      if (pm->data[i]) {
+        ptcache_file_compressed_data_write(
+            pf, blocks[block].in, blocks[block].in_len, blocks[block].out, &blocks[block].result);
+        block++;
       }
     }
-    else {
-      BKE_ptcache_mem_pointers_init(pm);
-      ptcache_file_pointers_init(pf);
+  }
+  else {
+    BKE_ptcache_mem_pointers_init(pm);
+    ptcache_file_pointers_init(pf);
 
-      for (i = 0; i < pm->totpoint; i++) {
-        ptcache_data_copy(pm->cur, pf->cur);
-        if (!ptcache_file_data_write(pf)) {
-          error = 1;
-          break;
-        }
-        BKE_ptcache_mem_pointers_incr(pm);
+    for (i = 0; i < pm->totpoint; i++) {
+      ptcache_data_copy(pm->cur, pf->cur);
+      if (!ptcache_file_data_write(pf)) {
+        error = 1;
+        break;
       }
+      BKE_ptcache_mem_pointers_incr(pm);
     }
   }
 
@@ -2848,20 +3424,17 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
     PTCacheExtra *extra = pm->extradata.first;
 
     for (; extra; extra = extra->next) {
-      if (extra->data == NULL || extra->totdata == 0) {
+      if (!ptcache_extra_is_written(extra)) {
         continue;
       }
 
       ptcache_file_write(pf, &extra->type, 1, sizeof(unsigned int));
       ptcache_file_write(pf, &extra->totdata, 1, sizeof(unsigned int));
 
-      if (pid->cache->compression) {
-        unsigned int in_len = extra->totdata * ptcache_extra_datasize[extra->type];
-        unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
-                                                          "pointcache_lzo_buffer");
-        ptcache_file_compressed_write(
-            pf, (unsigned char *)(extra->data), in_len, out, pid->cache->compression);
-        MEM_freeN(out);
+      if (compression) {
+        ptcache_file_compressed_data_write(
+            pf, blocks[block].in, blocks[block].in_len, blocks[block].out, &blocks[block].result);
+        block++;
       }
       else {
         ptcache_file_write(pf, extra->data, extra->totdata, ptcache_extra_datasize[extra->type]);
@@ -2869,7 +3442,34 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
     }
   }
 
-  ptcache_file_close(pf);
+  return error == 0;
+}
+static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
+{
+  PTCacheFile *pf = NULL;
+  PTCacheCompressData compressed;
+  unsigned int error = 0;
+
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+
+  ptcache_mem_frame_compress(pm, pid->cache->compression, &compressed);
+
+  pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
+
+  if (pf == NULL) {
+    ptcache_mem_frame_compress_free(&compressed);
+    if (G.debug & G_DEBUG) {
+      printf("Error opening disk cache file for writing\n");
+    }
+    return 0;
+  }
+
+  if (!ptcache_mem_frame_write(pf, pm, pid->type, &compressed, pid->write_header)) {
+    error = 1;
+  }
+
+  ptcache_file_close_ex(pf, error == 0);
+  ptcache_mem_frame_compress_free(&compressed);
 
   if (error && G.debug & G_DEBUG) {
     printf("Error writing to disk cache\n");
@@ -2878,6 +3478,159 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
   return error == 0;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Background Writer Threads
+ * \{ */
+
+typedef struct PTCacheWriteTask {
+  char filename[MAX_PTCACHE_FILE];
+  /* Single file container the frame is written to, empty for separate frame files. */
+  char container[MAX_PTCACHE_FILE];
+  unsigned int type;
+  int compression;
+  int (*write_header)(PTCacheFile *pf);
+  PTCacheMem *pm;
+} PTCacheWriteTask;
+
+static void *ptcache_writer_thread(void *data)
+{
+  PTCacheWriter *writer = (PTCacheWriter *)data;
+  PTCacheWriteTask *task;
+
+  while ((task = BLI_thread_queue_pop(writer->queue))) {
+    PTCacheCompressData compressed;
+    PTCacheFile *pf;
+
+    ptcache_mem_frame_compress(task->pm, task->compression, &compressed);
+
+    pf = ptcache_file_open_path(
+        task->filename, task->container, PTCACHE_FILE_WRITE, task->pm->frame);
+
+    if (pf == NULL) {
+      if (G.debug & G_DEBUG) {
+        printf("Error opening disk cache file for writing\n");
+      }
+    }
+    else {
+      const bool write_ok = ptcache_mem_frame_write(
+          pf, task->pm, task->type, &compressed, task->write_header);
+      if (!write_ok && (G.debug & G_DEBUG)) {
+        printf("Error writing to disk cache\n");
+      }
+      ptcache_file_close_ex(pf, write_ok);
+    }
+    ptcache_mem_frame_compress_free(&compressed);
+
+    ptcache_mem_clear(task->pm);
+    MEM_freeN(task->pm);
+
+    BLI_mutex_lock(&writer->mutex);
+    BLI_gset_remove(writer->pending, task->filename, NULL);
+    BLI_condition_notify_all(&writer->cond);
+    BLI_mutex_unlock(&writer->mutex);
+
+    MEM_freeN(task);
+  }
+
+  return NULL;
+}
+
+/* Start the background writer, returns false when another bake already uses it. */
+bool BKE_ptcache_writer_begin(void)
+{
+  if (ptcache_writer != NULL) {
+    return false;
+  }
+
+  PTCacheWriter *writer = MEM_callocN(sizeof(PTCacheWriter), __func__);
+  const int threads_num = BLI_system_thread_count();
+
+  writer->queue = BLI_thread_queue_init();
+  writer->pending = BLI_gset_str_new(__func__);
+  writer->pending_max = threads_num * 4;
+  BLI_mutex_init(&writer->mutex);
+  BLI_condition_init(&writer->cond);
+
+  BLI_threadpool_init(&writer->threads, ptcache_writer_thread, threads_num);
+  for (int i = 0; i < threads_num; i++) {
+    BLI_threadpool_insert(&writer->threads, writer);
+  }
+
+  ptcache_writer = writer;
+
+  return true;
+}
+
+/* Finish writing all queued frames. */
+void BKE_ptcache_writer_end(void)
+{
+  PTCacheWriter *writer = ptcache_writer;
+
+  BLI_thread_queue_nowait(writer->queue);
+  BLI_threadpool_end(&writer->threads);
+  ptcache_writer = NULL;
+
+  BLI_assert(BLI_gset_len(writer->pending) == 0);
+  BLI_thread_queue_free(writer->queue);
+  BLI_gset_free(writer->pending, NULL);
+  BLI_mutex_end(&writer->mutex);
+  BLI_condition_end(&writer->cond);
+  MEM_freeN(writer);
+}
+
+/**
+ * Write a frame to disk and free it. While baking it's written by the
+ * background writer, which owns the frame from here on.
+ */
+static int ptcache_mem_frame_to_disk_and_free(PTCacheID *pid, PTCacheMem *pm)
+{
+  PTCacheWriter *writer = ptcache_writer;
+  int ok;
+
+  if (writer) {
+    PTCacheWriteTask *task = MEM_callocN(sizeof(PTCacheWriteTask), __func__);
+
+    BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+
+    if (ptcache_file_open_filename(
+            pid, PTCACHE_FILE_WRITE, pm->frame, task->filename, task->container)) {
+      /* Keep a single write per file in flight. */
+      ptcache_writer_wait(task->filename);
+
+      task->type = pid->type;
+      task->compression = pid->cache->compression;
+      task->write_header = pid->write_header;
+      task->pm = pm;
+
+      BLI_mutex_lock(&writer->mutex);
+      while (BLI_gset_len(writer->pending) >= writer->pending_max) {
+        BLI_condition_wait(&writer->cond, &writer->mutex);
+      }
+      BLI_gset_insert(writer->pending, task->filename);
+      BLI_mutex_unlock(&writer->mutex);
+
+      BLI_thread_queue_push(writer->queue, task);
+      return 1;
+    }
+
+    MEM_freeN(task);
+    if (G.debug & G_DEBUG) {
+      printf("Error opening disk cache file for writing\n");
+    }
+    ok = 0;
+  }
+  else {
+    ok = ptcache_mem_frame_to_disk(pid, pm);
+  }
+
+  ptcache_mem_clear(pm);
+  MEM_freeN(pm);
+
+  return ok;
+}
+
+/** \} */
+
 static int ptcache_read_stream(PTCacheID *pid, int cfra)
 {
   PTCacheFile *pf = ptcache_file_open(pid, PTCACHE_FILE_READ, cfra);
@@ -3204,7 +3957,7 @@ static int ptcache_write_stream(PTCacheID *pid, int cfra, int totpoint)
     pid->write_stream(pf, pid->calldata);
   }
 
-  ptcache_file_close(pf);
+  ptcache_file_close_ex(pf, error == 0);
 
   if (error && G.debug & G_DEBUG) {
     printf("Error writing to disk cache\n");
@@ -3285,18 +4038,10 @@ static int ptcache_write(PTCacheID *pid, int cfra, int overwrite)
   pm->frame = cfra;
 
   if (cache->flag & PTCACHE_DISK_CACHE) {
-    error += !ptcache_mem_frame_to_disk(pid, pm);
-
-    // if (pm) /* pm is always set */
-    {
-      ptcache_mem_clear(pm);
-      MEM_freeN(pm);
-    }
+    error += !ptcache_mem_frame_to_disk_and_free(pid, pm);
 
     if (pm2) {
-      error += !ptcache_mem_frame_to_disk(pid, pm2);
-      ptcache_mem_clear(pm2);
-      MEM_freeN(pm2);
+      error += !ptcache_mem_frame_to_disk_and_free(pid, pm2);
     }
   }
   else {
@@ -3395,7 +4140,8 @@ int BKE_ptcache_write(PTCacheID *pid, unsigned int cfra)
   }
 
   /* Update timeline cache display */
-  if (cfra && cache->cached_frames) {
+  if (cfra && cache->cached_frames &&
+      (int)cfra - cache->startframe < (int)cache->cached_frames_len) {
     cache->cached_frames[cfra - cache->startframe] = 1;
   }
 
@@ -3429,8 +4175,9 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
     return;
   }
 
+  /* Bounds of the cached frames, they may be listed for a shorter frame range than the current. */
   sta = pid->cache->startframe;
-  end = pid->cache->endframe;
+  end = sta + pid->cache->cached_frames_len - 1;
 
 #ifndef DURIAN_POINTCACHE_LIB_OK
   /* don't allow clearing for linked objects */
@@ -3449,6 +4196,35 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
     case PTCACHE_CLEAR_BEFORE:
     case PTCACHE_CLEAR_AFTER:
       if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+        /* Don't let queued frames be written after clearing. */
+        ptcache_writer_wait(NULL);
+
+        if (ptcache_use_single_file(pid)) {
+          char container[MAX_PTCACHE_FILE];
+
+          if (ptcache_container_filename(pid, container)) {
+            ptcache_container_clear(container, mode, cfra);
+          }
+
+          if (mode == PTCACHE_CLEAR_ALL) {
+            pid->cache->last_exact = MIN2(pid->cache->startframe, 0);
+          }
+
+          if (pid->cache->cached_frames) {
+            for (int i = 0; i < pid->cache->cached_frames_len; i++) {
+              const int frame = pid->cache->startframe + i;
+
+              if (mode == PTCACHE_CLEAR_ALL ||
+                  (mode == PTCACHE_CLEAR_BEFORE && frame < (int)cfra) ||
+                  (mode == PTCACHE_CLEAR_AFTER && frame > (int)cfra)) {
+                pid->cache->cached_frames[i] = 0;
+              }
+            }
+          }
+        }
+
+        /* Separate frame files are removed in either case, they may be left from before
+         * switching to a single file. */
         ptcache_path(pid, path);
 
         dir = opendir(path);
@@ -3539,7 +4315,18 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
       if (pid->cache->flag & PTCACHE_DISK_CACHE) {
         if (BKE_ptcache_id_exist(pid, cfra)) {
           ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
-          BLI_delete(filename, false, false);
+          ptcache_writer_wait(filename);
+
+          if (ptcache_use_single_file(pid)) {
+            char container[MAX_PTCACHE_FILE];
+
+            if (ptcache_container_filename(pid, container)) {
+              ptcache_container_clear(container, PTCACHE_CLEAR_FRAME, cfra);
+            }
+          }
+          else {
+            BLI_delete(filename, false, false);
+          }
         }
       }
       else {
@@ -3572,7 +4359,12 @@ int BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
     return 0;
   }
 
-  if (pid->cache->cached_frames && pid->cache->cached_frames[cfra - pid->cache->startframe] == 0) {
+  /* The frame range may have grown since the cached frames were listed. */
+  const bool use_cached_frames = pid->cache->cached_frames &&
+                                 cfra - pid->cache->startframe <
+                                     (int)pid->cache->cached_frames_len;
+
+  if (use_cached_frames && pid->cache->cached_frames[cfra - pid->cache->startframe] == 0) {
     return 0;
   }
 
@@ -3581,6 +4373,18 @@ int BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
 
     ptcache_filename(pid, filename, cfra, 1, 1);
 
+    if (ptcache_writer_is_pending(filename)) {
+      return 1;
+    }
+
+    if (ptcache_use_single_file(pid)) {
+      /* The cached frames are read from the container index, no need to open it again. */
+      if (use_cached_frames) {
+        return 1;
+      }
+      return ptcache_container_frame_exists(pid, cfra);
+    }
+
     return BLI_exists(filename);
   }
 
@@ -3644,7 +4448,23 @@ void BKE_ptcache_id_time(
     cache->cached_frames = MEM_callocN(sizeof(char) * cache->cached_frames_len,
                                        "cached frames array");
 
-    if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+    if (ptcache_use_single_file(pid)) {
+      char filename[MAX_PTCACHE_FILE];
+      PTCacheContainer container;
+
+      if (ptcache_container_filename(pid, filename) &&
+          ptcache_container_index_load(filename, &container)) {
+        for (unsigned int i = 0; i < container.header.frames_num; i++) {
+          const int frame = container.frames[i].frame;
+
+          if (frame >= cache->startframe && frame <= cache->endframe) {
+            cache->cached_frames[frame - cache->startframe] = 1;
+          }
+        }
+        MEM_SAFE_FREE(container.frames);
+      }
+    }
+    else if (pid->cache->flag & PTCACHE_DISK_CACHE) {
       /* mode is same as fopen's modes */
       DIR *dir;
       struct dirent *de;
@@ -4154,6 +4974,8 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
 
   stime = ptime = PIL_check_seconds_timer();
 
+  const bool use_writer = BKE_ptcache_writer_begin();
+
   for (int fr = CFRA; fr <= endframe; fr += baker->quick_step, CFRA = fr) {
     BKE_scene_graph_update_for_newframe(depsgraph);
 
@@ -4196,6 +5018,10 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
     CFRA += 1;
   }
 
+  if (use_writer) {
+    BKE_ptcache_writer_end();
+  }
+
   if (use_timer) {
     /* start with newline because of \r above */
     ptcache_dt_to_str(run, PIL_check_seconds_timer() - stime);
@@ -4355,6 +5181,57 @@ void BKE_ptcache_toggle_disk_cache(PTCacheID *pid)
   }
 }
 
+void BKE_ptcache_toggle_single_file(PTCacheID *pid)
+{
+  PointCache *cache = pid->cache;
+  int last_exact = cache->last_exact;
+  int baked = cache->flag & PTCACHE_BAKED;
+  int cfra;
+
+  if ((cache->flag & PTCACHE_DISK_CACHE) == 0 || !G.relbase_valid) {
+    return;
+  }
+
+  if (cache->cached_frames) {
+    MEM_freeN(cache->cached_frames);
+    cache->cached_frames = NULL;
+    cache->cached_frames_len = 0;
+  }
+
+  /* Read the frames in the previous layout and remove them from disk. */
+  cache->flag ^= PTCACHE_SINGLE_FILE;
+
+  for (cfra = cache->startframe; cfra <= cache->endframe; cfra++) {
+    PTCacheMem *pm = ptcache_disk_frame_to_mem(pid, cfra);
+
+    if (pm) {
+      BLI_addtail(&cache->mem_cache, pm);
+    }
+  }
+
+  cache->flag &= ~PTCACHE_BAKED;
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_ALL, 0);
+  cache->flag |= baked;
+
+  cache->flag ^= PTCACHE_SINGLE_FILE;
+
+  BKE_ptcache_mem_to_disk(pid);
+
+  /* On failure the frames are kept as memory cache. */
+  if (cache->flag & PTCACHE_DISK_CACHE) {
+    LISTBASE_FOREACH (PTCacheMem *, pm, &cache->mem_cache) {
+      ptcache_mem_clear(pm);
+    }
+    BLI_freelistN(&cache->mem_cache);
+  }
+
+  cache->last_exact = last_exact;
+
+  BKE_ptcache_id_time(pid, NULL, 0.0f, NULL, NULL, NULL);
+
+  cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
+}
+
 void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
 {
   char old_name[80];
@@ -4367,6 +5244,7 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   char new_path_full[MAX_PTCACHE_FILE];
   char old_path_full[MAX_PTCACHE_FILE];
   char ext[MAX_PTCACHE_PATH];
+  char old_container[MAX_PTCACHE_FILE];
 
   /* save old name */
   BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
@@ -4375,6 +5253,7 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   BLI_strncpy(pid->cache->name, name_src, sizeof(pid->cache->name));
 
   len = ptcache_filename(pid, old_filename, 0, 0, 0); /* no path */
+  ptcache_container_filename(pid, old_container);
 
   ptcache_path(pid, path);
   dir = opendir(path);
@@ -4390,6 +5269,11 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   /* put new name into cache */
   BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
 
+  if (old_container[0] && BLI_exists(old_container) &&
+      ptcache_container_filename(pid, new_path_full)) {
+    BLI_rename(old_container, new_path_full);
+  }
+
   while ((de = readdir(dir)) != NULL) {
     if (strstr(de->d_name, ext)) {                   /* do we have the right extension?*/
       if (STREQLEN(old_filename, de->d_name, len)) { /* do we have the right prefix */
@@ -0,0 +1,322 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation
+ * All rights reserved.
+ */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_math_base.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_pointcache.h"
+#include "BKE_softbody.h"
+
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+
+namespace blender::bke::tests {
+
+static const int TOTPOINT = 64;
+static const int TOTFRAME = 40;
+
+/* A soft body point cache on disk, next to a blend file in the temporary directory. */
+class pointcache_disk : public testing::Test {
+ protected:
+  Object object;
+  PTCacheID pid;
+  char cache_dir[FILE_MAX];
+
+  static void SetUpTestSuite()
+  {
+    BLI_threadapi_init();
+    BKE_tempdir_init(nullptr);
+  }
+
+  static void TearDownTestSuite()
+  {
+    BKE_tempdir_session_purge();
+    BLI_threadapi_exit();
+  }
+
+  void SetUp() override
+  {
+    G.main = BKE_main_new();
+    BLI_join_dirfile(
+        G.main->name, sizeof(G.main->name), BKE_tempdir_session(), "pointcache_test.blend");
+    G.relbase_valid = 1;
+    BLI_join_dirfile(
+        cache_dir, sizeof(cache_dir), BKE_tempdir_session(), "blendcache_pointcache_test");
+
+    memset(&object, 0, sizeof(object));
+    STRNCPY(object.id.name, "OBSoftbody");
+    object.type = OB_MESH;
+
+    SoftBody *sb = sbNew(nullptr);
+    sb->totpoint = TOTPOINT;
+    sb->bpoint = static_cast<BodyPoint *>(
+        MEM_calloc_arrayN(TOTPOINT, sizeof(BodyPoint), __func__));
+    object.soft = sb;
+
+    PointCache *cache = sb->shared->pointcache;
+    cache->flag |= PTCACHE_DISK_CACHE;
+    cache->startframe = 1;
+    cache->endframe = TOTFRAME;
+    BKE_ptcache_id_from_softbody(&pid, &object, sb);
+  }
+
+  void TearDown() override
+  {
+    BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+    sbFree(&object);
+    BKE_main_free(G.main);
+    G.main = nullptr;
+    G.relbase_valid = 0;
+  }
+
+  PointCache *cache()
+  {
+    return object.soft->shared->pointcache;
+  }
+
+  /* Positions and velocities unique to every point and frame. */
+  void write_frame(const int frame)
+  {
+    for (int i = 0; i < TOTPOINT; i++) {
+      BodyPoint *bp = &object.soft->bpoint[i];
+      bp->pos[0] = float(frame * 1000 + i);
+      bp->pos[1] = float(i);
+      bp->pos[2] = float(-frame);
+      bp->vec[0] = float(i);
+      bp->vec[1] = float(frame);
+      bp->vec[2] = 0.5f;
+    }
+    EXPECT_TRUE(BKE_ptcache_write(&pid, frame));
+  }
+
+  void write_frames()
+  {
+    for (int frame = 1; frame <= TOTFRAME; frame++) {
+      write_frame(frame);
+    }
+  }
+
+  void expect_frame(const int frame)
+  {
+    for (int i = 0; i < TOTPOINT; i++) {
+      BodyPoint *bp = &object.soft->bpoint[i];
+      memset(bp->pos, 0, sizeof(bp->pos));
+      memset(bp->vec, 0, sizeof(bp->vec));
+    }
+    ASSERT_EQ(BKE_ptcache_read(&pid, float(frame), true), PTCACHE_READ_EXACT) << frame;
+    for (int i = 0; i < TOTPOINT; i++) {
+      const BodyPoint *bp = &object.soft->bpoint[i];
+      EXPECT_EQ(bp->pos[0], float(frame * 1000 + i));
+      EXPECT_EQ(bp->pos[1], float(i));
+      EXPECT_EQ(bp->pos[2], float(-frame));
+      EXPECT_EQ(bp->vec[0], float(i));
+      EXPECT_EQ(bp->vec[1], float(frame));
+      EXPECT_EQ(bp->vec[2], 0.5f);
+    }
+  }
+
+  /* Number of frames listed for the timeline, from the frame files or the container index. */
+  int cached_frames_count()
+  {
+    MEM_SAFE_FREE(cache()->cached_frames);
+    cache()->cached_frames_len = 0;
+    BKE_ptcache_id_time(&pid, nullptr, 0.0f, nullptr, nullptr, nullptr);
+
+    int count = 0;
+    for (int i = 0; i < int(cache()->cached_frames_len); i++) {
+      count += cache()->cached_frames[i];
+    }
+    return count;
+  }
+
+  /* Hand every frame to the background writer, and read it back while it may still be queued. */
+  void write_frames_pending()
+  {
+    ASSERT_TRUE(BKE_ptcache_writer_begin());
+    EXPECT_FALSE(BKE_ptcache_writer_begin());
+
+    for (int frame = 1; frame <= TOTFRAME; frame++) {
+      write_frame(frame);
+      EXPECT_NE(BKE_ptcache_id_exist(&pid, frame), 0);
+      EXPECT_EQ(BKE_ptcache_id_exist(&pid, frame + 1), 0);
+      expect_frame(frame);
+    }
+
+    BKE_ptcache_writer_end();
+  }
+
+  int cache_files_count()
+  {
+    struct direntry *files;
+    const unsigned int files_num = BLI_filelist_dir_contents(cache_dir, &files);
+    int count = 0;
+    for (unsigned int i = 0; i < files_num; i++) {
+      if (files[i].relname[0] != '.') {
+        count++;
+      }
+    }
+    BLI_filelist_free(files, files_num);
+    return count;
+  }
+};
+
+TEST_F(pointcache_disk, SingleFileWriteRead)
+{
+  cache()->flag |= PTCACHE_SINGLE_FILE;
+  write_frames();
+  EXPECT_EQ(cache_files_count(), 1);
+
+  /* The index is read back from the container. */
+  EXPECT_EQ(cached_frames_count(), TOTFRAME);
+  for (int frame = 1; frame <= TOTFRAME; frame++) {
+    EXPECT_TRUE(BKE_ptcache_id_exist(&pid, frame));
+    expect_frame(frame);
+  }
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, TOTFRAME + 1));
+}
+
+TEST_F(pointcache_disk, SingleFileClearFrame)
+{
+  cache()->flag |= PTCACHE_SINGLE_FILE;
+  write_frames();
+
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_FRAME, 20);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 20));
+  EXPECT_EQ(cached_frames_count(), TOTFRAME - 1);
+  expect_frame(19);
+  expect_frame(21);
+
+  /* Frames written after the clear are appended to the same container, also past the frame range
+   * the cached frames were listed for. */
+  cache()->endframe = TOTFRAME + 1;
+  write_frame(TOTFRAME + 1);
+  EXPECT_EQ(cache_files_count(), 1);
+  EXPECT_EQ(cached_frames_count(), TOTFRAME);
+  expect_frame(TOTFRAME);
+  expect_frame(TOTFRAME + 1);
+}
+
+TEST_F(pointcache_disk, SingleFileClearBeforeAfter)
+{
+  cache()->flag |= PTCACHE_SINGLE_FILE;
+  write_frames();
+
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_BEFORE, 10);
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, 30);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 9));
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 31));
+  EXPECT_EQ(cached_frames_count(), 21);
+  expect_frame(10);
+  expect_frame(30);
+
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+  EXPECT_EQ(cached_frames_count(), 0);
+  EXPECT_EQ(cache_files_count(), 0);
+}
+
+TEST_F(pointcache_disk, ToggleSingleFile)
+{
+  write_frames();
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_FRAME, 20);
+  EXPECT_EQ(cache_files_count(), TOTFRAME - 1);
+
+  cache()->flag |= PTCACHE_SINGLE_FILE;
+  BKE_ptcache_toggle_single_file(&pid);
+  EXPECT_EQ(cache_files_count(), 1);
+  EXPECT_EQ(cached_frames_count(), TOTFRAME - 1);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 20));
+  expect_frame(1);
+  expect_frame(TOTFRAME);
+
+  cache()->flag &= ~PTCACHE_SINGLE_FILE;
+  BKE_ptcache_toggle_single_file(&pid);
+  EXPECT_EQ(cache_files_count(), TOTFRAME - 1);
+  EXPECT_EQ(cached_frames_count(), TOTFRAME - 1);
+  for (int frame = 1; frame <= TOTFRAME; frame++) {
+    EXPECT_EQ(BKE_ptcache_id_exist(&pid, frame) != 0, frame != 20);
+  }
+  expect_frame(19);
+  expect_frame(21);
+}
+
+TEST_F(pointcache_disk, WriterReadPending)
+{
+  write_frames_pending();
+  EXPECT_EQ(cache_files_count(), TOTFRAME);
+  EXPECT_EQ(cached_frames_count(), TOTFRAME);
+  for (int frame = 1; frame <= TOTFRAME; frame++) {
+    expect_frame(frame);
+  }
+}
+
+TEST_F(pointcache_disk, WriterReadPendingSingleFile)
+{
+  cache()->flag |= PTCACHE_SINGLE_FILE;
+  write_frames_pending();
+  EXPECT_EQ(cache_files_count(), 1);
+  EXPECT_EQ(cached_frames_count(), TOTFRAME);
+  for (int frame = 1; frame <= TOTFRAME; frame++) {
+    expect_frame(frame);
+  }
+}
+
+TEST_F(pointcache_disk, WriterPendingMax)
+{
+  /* The writer queues at most four frames per thread, writing waits for the queue otherwise. */
+  const int pending_max = BLI_system_thread_count() * 4;
+  const int frames_num = pending_max * 16;
+  /* A queued frame holds its task, the frame and its data arrays. Frames being written also hold
+   * the opened file. */
+  const int frame_blocks_max = 2 + BPHYS_TOT_DATA;
+  const int thread_blocks_max = 4;
+
+  cache()->endframe = frames_num;
+
+  ASSERT_TRUE(BKE_ptcache_writer_begin());
+  const int blocks_begin = int(MEM_get_memory_blocks_in_use());
+  int pending_blocks_max = 0;
+
+  for (int frame = 1; frame <= frames_num; frame++) {
+    write_frame(frame);
+    pending_blocks_max = max_ii(pending_blocks_max,
+                                int(MEM_get_memory_blocks_in_use()) - blocks_begin);
+  }
+
+  BKE_ptcache_writer_end();
+
+  EXPECT_LE(pending_blocks_max,
+            pending_max * frame_blocks_max + BLI_system_thread_count() * thread_blocks_max);
+  EXPECT_EQ(cache_files_count(), frames_num);
+  expect_frame(frames_num);
+}
+
+}  // namespace blender::bke::tests
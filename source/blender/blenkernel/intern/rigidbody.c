@@ -35,6 +35,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #ifdef WITH_BULLET
 #  include "RBI_api.h"
@@ -1147,7 +1148,8 @@ void BKE_rigidbody_validate_sim_world(Scene *scene, RigidBodyWorld *rbw, bool re
     if (rbw->shared->physics_world) {
       RB_dworld_delete(rbw->shared->physics_world);
     }
-    rbw->shared->physics_world = RB_dworld_new(scene->physics_settings.gravity);
+    rbw->shared->physics_world = RB_dworld_new(scene->physics_settings.gravity,
+                                                rbw->flag & RBW_FLAG_USE_THREADS);
   }
 
   RB_dworld_set_solver_iterations(rbw->shared->physics_world, rbw->num_solver_iterations);
@@ -1657,8 +1659,15 @@ static void rigidbody_update_sim_world(Scene *scene, RigidBodyWorld *rbw)
   rigidbody_update_ob_array(rbw);
 }
 
-static void rigidbody_update_sim_ob(
-    Depsgraph *depsgraph, Scene *scene, RigidBodyWorld *rbw, Object *ob, RigidBodyOb *rbo)
+/**
+ * \param effectors: Effectors shared by all objects, when NULL they're created for this object.
+ */
+static void rigidbody_update_sim_ob(Depsgraph *depsgraph,
+                                    Scene *scene,
+                                    RigidBodyWorld *rbw,
+                                    Object *ob,
+                                    RigidBodyOb *rbo,
+                                    ListBase *effectors_shared)
 {
   /* only update if rigid body exists */
   if (rbo->shared->physics_object == NULL) {
@@ -1718,7 +1727,8 @@ static void rigidbody_update_sim_ob(
     ListBase *effectors;
 
     /* get effectors present in the group specified by effector_weights */
-    effectors = BKE_effectors_create(depsgraph, ob, NULL, effector_weights);
+    effectors = effectors_shared ? effectors_shared :
+                                   BKE_effectors_create(depsgraph, ob, NULL, effector_weights);
     if (effectors) {
       float eff_force[3] = {0.0f, 0.0f, 0.0f};
       float eff_loc[3], eff_vel[3];
@@ -1753,7 +1763,9 @@ static void rigidbody_update_sim_ob(
     }
 
     /* cleanup */
-    BKE_effectors_free(effectors);
+    if (effectors != effectors_shared) {
+      BKE_effectors_free(effectors);
+    }
   }
   /* NOTE: passive objects don't need to be updated since they don't move */
 
@@ -1762,6 +1774,56 @@ static void rigidbody_update_sim_ob(
    */
 }
 
+typedef struct RigidbodyUpdateSimObData {
+  Depsgraph *depsgraph;
+  Scene *scene;
+  RigidBodyWorld *rbw;
+  ListBase *effectors;
+} RigidbodyUpdateSimObData;
+
+static void rigidbody_update_sim_ob_task_cb(void *__restrict userdata,
+                                            const int i,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  RigidbodyUpdateSimObData *data = userdata;
+  Object *ob = data->rbw->objects[i];
+
+  if (ob->type == OB_MESH && ob->rigidbody_object) {
+    rigidbody_update_sim_ob(
+        data->depsgraph, data->scene, data->rbw, ob, ob->rigidbody_object, data->effectors);
+  }
+}
+
+/* Update the simulation objects in parallel, they only touch their own Bullet body and shape. */
+static void rigidbody_update_sim_objects(Depsgraph *depsgraph, Scene *scene, RigidBodyWorld *rbw)
+{
+  /* The effectors don't depend on the object (effector objects aren't affected by effectors),
+   * so they're only created once. Effector noise re-seeds its random generator whenever the
+   * effectors are created though, so every object creates its own then, in order. Texture
+   * effectors are safe to evaluate in parallel, node trees use a stack per thread. */
+  ListBase *effectors = BKE_effectors_create(depsgraph, NULL, NULL, rbw->effector_weights);
+  const bool use_noise = BKE_effectors_use_noise(effectors);
+  if (use_noise) {
+    BKE_effectors_free(effectors);
+    effectors = NULL;
+  }
+
+  RigidbodyUpdateSimObData data = {
+      .depsgraph = depsgraph,
+      .scene = scene,
+      .rbw = rbw,
+      .effectors = effectors,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = !use_noise;
+  settings.min_iter_per_thread = 64;
+  BLI_task_parallel_range(0, rbw->numbodies, &data, rigidbody_update_sim_ob_task_cb, &settings);
+
+  BKE_effectors_free(effectors);
+}
+
 /**
  * Updates and validates world, bodies and shapes.
  *
@@ -1848,13 +1910,13 @@ static void rigidbody_update_simulation(Depsgraph *depsgraph,
         }
       }
       rbo->flag &= ~(RBO_FLAG_NEEDS_VALIDATE | RBO_FLAG_NEEDS_RESHAPE);
-
-      /* update simulation object... */
-      rigidbody_update_sim_ob(depsgraph, scene, rbw, ob, rbo);
     }
   }
   FOREACH_COLLECTION_OBJECT_RECURSIVE_END;
 
+  /* update simulation objects... */
+  rigidbody_update_sim_objects(depsgraph, scene, rbw);
+
   /* update constraints */
   if (rbw->constraints == NULL) { /* no constraints, move on */
     return;
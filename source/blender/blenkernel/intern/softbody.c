@@ -58,7 +58,7 @@
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
-#include "BLI_threads.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_collection.h"
@@ -128,16 +128,29 @@ typedef struct SB_thread_context {
   Object *ob;
   float forcetime;
   float timenow;
-  int ifirst;
-  int ilast;
   ListBase *effectors;
   int do_deflector;
+  int do_selfcollision;
+  int do_springcollision;
+  int do_aero;
   float fieldfactor;
   float windfactor;
-  int nr;
-  int tot;
 } SB_thread_context;
 
+typedef struct SB_apply_forces_context {
+  Object *ob;
+  float forcetime;
+  int mode;
+  int mid_flags;
+} SB_apply_forces_context;
+
+/* Statistics gathered while integrating, per task and then joined. */
+typedef struct SB_apply_forces_chunk {
+  float aabbmin[3], aabbmax[3];
+  float maxerrpos, maxerrvel;
+  bool fuzzy;
+} SB_apply_forces_chunk;
+
 #define MID_PRESERVE 1
 
 #define SOFTGOALSNAP 0.999f
@@ -1441,150 +1454,104 @@ static int sb_detect_edge_collisionCached(const float edge_v1[3],
   return deflected;
 }
 
-static void _scan_for_ext_spring_forces(
-    Scene *scene, Object *ob, float timenow, int ifirst, int ilast, struct ListBase *effectors)
+static void sb_spring_ext_force(
+    Scene *scene, Object *ob, float timenow, BodySpring *bs, struct ListBase *effectors)
 {
   SoftBody *sb = ob->soft;
-  int a;
   float damp;
   float feedback[3];
 
-  if (sb && sb->totspring) {
-    for (a = ifirst; a < ilast; a++) {
-      BodySpring *bs = &sb->bspring[a];
-      bs->ext_force[0] = bs->ext_force[1] = bs->ext_force[2] = 0.0f;
-      feedback[0] = feedback[1] = feedback[2] = 0.0f;
-      bs->flag &= ~BSF_INTERSECT;
+  bs->ext_force[0] = bs->ext_force[1] = bs->ext_force[2] = 0.0f;
+  feedback[0] = feedback[1] = feedback[2] = 0.0f;
+  bs->flag &= ~BSF_INTERSECT;
+
+  if (bs->springtype == SB_EDGE) {
+    /* +++ springs colliding */
+    if (ob->softflag & OB_SB_EDGECOLL) {
+      if (sb_detect_edge_collisionCached(
+              sb->bpoint[bs->v1].pos, sb->bpoint[bs->v2].pos, &damp, feedback, ob, timenow)) {
+        add_v3_v3(bs->ext_force, feedback);
+        bs->flag |= BSF_INTERSECT;
+        // bs->cf=damp;
+        bs->cf = sb->choke * 0.01f;
+      }
+    }
+    /* ---- springs colliding */
 
-      if (bs->springtype == SB_EDGE) {
-        /* +++ springs colliding */
-        if (ob->softflag & OB_SB_EDGECOLL) {
-          if (sb_detect_edge_collisionCached(
-                  sb->bpoint[bs->v1].pos, sb->bpoint[bs->v2].pos, &damp, feedback, ob, timenow)) {
-            add_v3_v3(bs->ext_force, feedback);
-            bs->flag |= BSF_INTERSECT;
-            // bs->cf=damp;
-            bs->cf = sb->choke * 0.01f;
-          }
-        }
-        /* ---- springs colliding */
-
-        /* +++ springs seeing wind ... n stuff depending on their orientation*/
-        /* note we don't use sb->mediafrict but use sb->aeroedge for magnitude of effect*/
-        if (sb->aeroedge) {
-          float vel[3], sp[3], pr[3], force[3];
-          float f, windfactor = 0.25f;
-          /*see if we have wind*/
-          if (effectors) {
-            EffectedPoint epoint;
-            float speed[3] = {0.0f, 0.0f, 0.0f};
-            float pos[3];
-            mid_v3_v3v3(pos, sb->bpoint[bs->v1].pos, sb->bpoint[bs->v2].pos);
-            mid_v3_v3v3(vel, sb->bpoint[bs->v1].vec, sb->bpoint[bs->v2].vec);
-            pd_point_from_soft(scene, pos, vel, -1, &epoint);
-            BKE_effectors_apply(
-                effectors, NULL, sb->effector_weights, &epoint, force, NULL, speed);
-
-            mul_v3_fl(speed, windfactor);
-            add_v3_v3(vel, speed);
-          }
-          /* media in rest */
-          else {
-            add_v3_v3v3(vel, sb->bpoint[bs->v1].vec, sb->bpoint[bs->v2].vec);
-          }
-          f = normalize_v3(vel);
-          f = -0.0001f * f * f * sb->aeroedge;
-          /* (todo) add a nice angle dependent function done for now BUT */
-          /* still there could be some nice drag/lift function, but who needs it */
-
-          sub_v3_v3v3(sp, sb->bpoint[bs->v1].pos, sb->bpoint[bs->v2].pos);
-          project_v3_v3v3(pr, vel, sp);
-          sub_v3_v3(vel, pr);
-          normalize_v3(vel);
-          if (ob->softflag & OB_SB_AERO_ANGLE) {
-            normalize_v3(sp);
-            madd_v3_v3fl(bs->ext_force, vel, f * (1.0f - fabsf(dot_v3v3(vel, sp))));
-          }
-          else {
-            madd_v3_v3fl(bs->ext_force, vel, f);  // to keep compatible with 2.45 release files
-          }
-        }
-        /* --- springs seeing wind */
+    /* +++ springs seeing wind ... n stuff depending on their orientation*/
+    /* note we don't use sb->mediafrict but use sb->aeroedge for magnitude of effect*/
+    if (sb->aeroedge) {
+      float vel[3], sp[3], pr[3], force[3];
+      float f, windfactor = 0.25f;
+      /*see if we have wind*/
+      if (effectors) {
+        EffectedPoint epoint;
+        float speed[3] = {0.0f, 0.0f, 0.0f};
+        float pos[3];
+        mid_v3_v3v3(pos, sb->bpoint[bs->v1].pos, sb->bpoint[bs->v2].pos);
+        mid_v3_v3v3(vel, sb->bpoint[bs->v1].vec, sb->bpoint[bs->v2].vec);
+        pd_point_from_soft(scene, pos, vel, -1, &epoint);
+        BKE_effectors_apply(effectors, NULL, sb->effector_weights, &epoint, force, NULL, speed);
+
+        mul_v3_fl(speed, windfactor);
+        add_v3_v3(vel, speed);
+      }
+      /* media in rest */
+      else {
+        add_v3_v3v3(vel, sb->bpoint[bs->v1].vec, sb->bpoint[bs->v2].vec);
+      }
+      f = normalize_v3(vel);
+      f = -0.0001f * f * f * sb->aeroedge;
+      /* (todo) add a nice angle dependent function done for now BUT */
+      /* still there could be some nice drag/lift function, but who needs it */
+
+      sub_v3_v3v3(sp, sb->bpoint[bs->v1].pos, sb->bpoint[bs->v2].pos);
+      project_v3_v3v3(pr, vel, sp);
+      sub_v3_v3(vel, pr);
+      normalize_v3(vel);
+      if (ob->softflag & OB_SB_AERO_ANGLE) {
+        normalize_v3(sp);
+        madd_v3_v3fl(bs->ext_force, vel, f * (1.0f - fabsf(dot_v3v3(vel, sp))));
+      }
+      else {
+        madd_v3_v3fl(bs->ext_force, vel, f);  // to keep compatible with 2.45 release files
       }
     }
+    /* --- springs seeing wind */
   }
 }
 
-static void *exec_scan_for_ext_spring_forces(void *data)
+static void sb_spring_ext_force_task_cb(void *__restrict userdata,
+                                        const int a,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _scan_for_ext_spring_forces(
-      pctx->scene, pctx->ob, pctx->timenow, pctx->ifirst, pctx->ilast, pctx->effectors);
-  return NULL;
+  const SB_thread_context *pctx = (const SB_thread_context *)userdata;
+  SoftBody *sb = pctx->ob->soft;
+  sb_spring_ext_force(pctx->scene, pctx->ob, pctx->timenow, &sb->bspring[a], pctx->effectors);
 }
 
 static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
                                  Scene *scene,
                                  struct Object *ob,
-                                 float timenow,
-                                 int totsprings,
-                                 int *UNUSED(ptr_to_break_func(void)))
-{
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts */
-  int lowsprings = 100;
-
-  ListBase *effectors = BKE_effectors_create(depsgraph, ob, NULL, ob->soft->effector_weights);
-
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totsprings / totthread < lowsprings) && (totthread > 1)) {
-    totthread--;
-  }
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBSpringsThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totsprings;
-  dec = totsprings / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = 0.0;  // not used here
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = false;  // not used here
-    sb_threads[i].fieldfactor = 0.0f;    // not used here
-    sb_threads[i].windfactor = 0.0f;     // not used here
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_scan_for_ext_spring_forces, totthread);
-
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
+                                 float timenow)
+{
+  SoftBody *sb = ob->soft;
+  ListBase *effectors = BKE_effectors_create(depsgraph, ob, NULL, sb->effector_weights);
 
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_scan_for_ext_spring_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  SB_thread_context ctx = {
+      .scene = scene,
+      .ob = ob,
+      .timenow = timenow,
+      .effectors = effectors,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* Effector noise draws from a generator shared by all springs, keep its order. */
+  settings.use_threading = !BKE_effectors_use_noise(effectors);
+  /* Prevent pretty pointless threading overhead on few springs. */
+  settings.min_iter_per_thread = 100;
+  BLI_task_parallel_range(0, sb->totspring, &ctx, sb_spring_ext_force_task_cb, &settings);
 
   BKE_effectors_free(effectors);
 }
@@ -1958,314 +1925,230 @@ static void sb_spring_force(
 }
 
 /* since this is definitely the most CPU consuming task here .. try to spread it */
-/* core function _softbody_calc_forces_slice_in_a_thread */
-/* result is int to be able to flag user break */
-static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
-                                                   Object *ob,
-                                                   float forcetime,
-                                                   float timenow,
-                                                   int ifirst,
-                                                   int ilast,
-                                                   int *UNUSED(ptr_to_break_func(void)),
-                                                   ListBase *effectors,
-                                                   int do_deflector,
-                                                   float fieldfactor,
-                                                   float windfactor)
-{
-  float iks;
-  int bb, do_selfcollision, do_springcollision, do_aero;
-  int number_of_points_here = ilast - ifirst;
+static void softbody_calc_forces_task_cb(void *__restrict userdata,
+                                         const int a,
+                                         const TaskParallelTLS *__restrict tls)
+{
+  const SB_thread_context *pctx = (const SB_thread_context *)userdata;
+  Scene *scene = pctx->scene;
+  Object *ob = pctx->ob;
+  const float forcetime = pctx->forcetime;
+  const float timenow = pctx->timenow;
+  ListBase *effectors = pctx->effectors;
+  const int do_deflector = pctx->do_deflector;
+  const int do_selfcollision = pctx->do_selfcollision;
+  const int do_springcollision = pctx->do_springcollision;
+  const int do_aero = pctx->do_aero;
+  const float fieldfactor = pctx->fieldfactor;
+  const float windfactor = pctx->windfactor;
+  bool *fuzzy = (bool *)tls->userdata_chunk;
   SoftBody *sb = ob->soft; /* is supposed to be there */
-  BodyPoint *bp;
+  BodyPoint *bp = &sb->bpoint[a];
+  float iks;
 
-  /* initialize */
-  if (sb) {
-    /* check conditions for various options */
-    /* +++ could be done on object level to squeeze out the last bits of it */
-    do_selfcollision = ((ob->softflag & OB_SB_EDGES) && (sb->bspring) &&
-                        (ob->softflag & OB_SB_SELF));
-    do_springcollision = do_deflector && (ob->softflag & OB_SB_EDGES) &&
-                         (ob->softflag & OB_SB_EDGECOLL);
-    do_aero = ((sb->aeroedge) && (ob->softflag & OB_SB_EDGES));
-    /* --- could be done on object level to squeeze out the last bits of it */
-  }
-  else {
-    CLOG_ERROR(&LOG, "expected a SB here");
-    return 999;
-  }
-
-  /* debugerin */
-  if (sb->totpoint < ifirst) {
-    printf("Aye 998");
-    return 998;
-  }
-  /* debugerin */
-
-  bp = &sb->bpoint[ifirst];
-  for (bb = number_of_points_here; bb > 0; bb--, bp++) {
-    /* clear forces  accumulator */
-    bp->force[0] = bp->force[1] = bp->force[2] = 0.0;
-    /* naive ball self collision */
-    /* needs to be done if goal snaps or not */
-    if (do_selfcollision) {
-      int attached;
-      BodyPoint *obp;
-      BodySpring *bs;
-      int c, b;
-      float velcenter[3], dvel[3], def[3];
-      float distance;
-      float compare;
-      float bstune = sb->ballstiff;
-
-      /* Running in a slice we must not assume anything done with obp
-       * neither alter the data of obp. */
-      for (c = sb->totpoint, obp = sb->bpoint; c > 0; c--, obp++) {
-        compare = (obp->colball + bp->colball);
-        sub_v3_v3v3(def, bp->pos, obp->pos);
-        /* rather check the AABBoxes before ever calculating the real distance */
-        /* mathematically it is completely nuts, but performance is pretty much (3) times faster */
-        if ((fabsf(def[0]) > compare) || (fabsf(def[1]) > compare) || (fabsf(def[2]) > compare)) {
-          continue;
-        }
-        distance = normalize_v3(def);
-        if (distance < compare) {
-          /* exclude body points attached with a spring */
-          attached = 0;
-          for (b = obp->nofsprings; b > 0; b--) {
-            bs = sb->bspring + obp->springs[b - 1];
-            if ((ilast - bb == bs->v2) || (ilast - bb == bs->v1)) {
-              attached = 1;
-              continue;
-            }
+  /* clear forces  accumulator */
+  bp->force[0] = bp->force[1] = bp->force[2] = 0.0;
+  /* naive ball self collision */
+  /* needs to be done if goal snaps or not */
+  if (do_selfcollision) {
+    int attached;
+    BodyPoint *obp;
+    BodySpring *bs;
+    int c, b;
+    float velcenter[3], dvel[3], def[3];
+    float distance;
+    float compare;
+    float bstune = sb->ballstiff;
+
+    /* Running in a slice we must not assume anything done with obp
+     * neither alter the data of obp. */
+    for (c = sb->totpoint, obp = sb->bpoint; c > 0; c--, obp++) {
+      compare = (obp->colball + bp->colball);
+      sub_v3_v3v3(def, bp->pos, obp->pos);
+      /* rather check the AABBoxes before ever calculating the real distance */
+      /* mathematically it is completely nuts, but performance is pretty much (3) times faster */
+      if ((fabsf(def[0]) > compare) || (fabsf(def[1]) > compare) || (fabsf(def[2]) > compare)) {
+        continue;
+      }
+      distance = normalize_v3(def);
+      if (distance < compare) {
+        /* exclude body points attached with a spring */
+        attached = 0;
+        for (b = obp->nofsprings; b > 0; b--) {
+          bs = sb->bspring + obp->springs[b - 1];
+          if ((a == bs->v2) || (a == bs->v1)) {
+            attached = 1;
+            continue;
           }
-          if (!attached) {
-            float f = bstune / (distance) + bstune / (compare * compare) * distance -
-                      2.0f * bstune / compare;
+        }
+        if (!attached) {
+          float f = bstune / (distance) + bstune / (compare * compare) * distance -
+                    2.0f * bstune / compare;
 
-            mid_v3_v3v3(velcenter, bp->vec, obp->vec);
-            sub_v3_v3v3(dvel, velcenter, bp->vec);
-            mul_v3_fl(dvel, _final_mass(ob, bp));
+          mid_v3_v3v3(velcenter, bp->vec, obp->vec);
+          sub_v3_v3v3(dvel, velcenter, bp->vec);
+          mul_v3_fl(dvel, _final_mass(ob, bp));
 
-            madd_v3_v3fl(bp->force, def, f * (1.0f - sb->balldamp));
-            madd_v3_v3fl(bp->force, dvel, sb->balldamp);
-          }
+          madd_v3_v3fl(bp->force, def, f * (1.0f - sb->balldamp));
+          madd_v3_v3fl(bp->force, dvel, sb->balldamp);
         }
       }
     }
-    /* naive ball self collision done */
-
-    if (_final_goal(ob, bp) < SOFTGOALSNAP) { /* omit this bp when it snaps */
-      float auxvect[3];
-      float velgoal[3];
-
-      /* do goal stuff */
-      if (ob->softflag & OB_SB_GOAL) {
-        /* true elastic goal */
-        float ks, kd;
-        sub_v3_v3v3(auxvect, bp->pos, bp->origT);
-        ks = 1.0f / (1.0f - _final_goal(ob, bp) * sb->goalspring) - 1.0f;
-        bp->force[0] += -ks * (auxvect[0]);
-        bp->force[1] += -ks * (auxvect[1]);
-        bp->force[2] += -ks * (auxvect[2]);
-
-        /* calculate damping forces generated by goals*/
-        sub_v3_v3v3(velgoal, bp->origS, bp->origE);
-        kd = sb->goalfrict * sb_fric_force_scale(ob);
-        add_v3_v3v3(auxvect, velgoal, bp->vec);
-
-        if (forcetime >
-            0.0f) { /* make sure friction does not become rocket motor on time reversal */
-          bp->force[0] -= kd * (auxvect[0]);
-          bp->force[1] -= kd * (auxvect[1]);
-          bp->force[2] -= kd * (auxvect[2]);
-        }
-        else {
-          bp->force[0] -= kd * (velgoal[0] - bp->vec[0]);
-          bp->force[1] -= kd * (velgoal[1] - bp->vec[1]);
-          bp->force[2] -= kd * (velgoal[2] - bp->vec[2]);
-        }
-      }
-      /* done goal stuff */
-
-      /* gravitation */
-      if (scene->physics_settings.flag & PHYS_GLOBAL_GRAVITY) {
-        float gravity[3];
-        copy_v3_v3(gravity, scene->physics_settings.gravity);
+  }
+  /* naive ball self collision done */
 
-        /* Individual mass of node here. */
-        mul_v3_fl(gravity,
-                  sb_grav_force_scale(ob) * _final_mass(ob, bp) *
-                      sb->effector_weights->global_gravity);
+  if (_final_goal(ob, bp) < SOFTGOALSNAP) { /* omit this bp when it snaps */
+    float auxvect[3];
+    float velgoal[3];
 
-        add_v3_v3(bp->force, gravity);
+    /* do goal stuff */
+    if (ob->softflag & OB_SB_GOAL) {
+      /* true elastic goal */
+      float ks, kd;
+      sub_v3_v3v3(auxvect, bp->pos, bp->origT);
+      ks = 1.0f / (1.0f - _final_goal(ob, bp) * sb->goalspring) - 1.0f;
+      bp->force[0] += -ks * (auxvect[0]);
+      bp->force[1] += -ks * (auxvect[1]);
+      bp->force[2] += -ks * (auxvect[2]);
+
+      /* calculate damping forces generated by goals*/
+      sub_v3_v3v3(velgoal, bp->origS, bp->origE);
+      kd = sb->goalfrict * sb_fric_force_scale(ob);
+      add_v3_v3v3(auxvect, velgoal, bp->vec);
+
+      if (forcetime >
+          0.0f) { /* make sure friction does not become rocket motor on time reversal */
+        bp->force[0] -= kd * (auxvect[0]);
+        bp->force[1] -= kd * (auxvect[1]);
+        bp->force[2] -= kd * (auxvect[2]);
+      }
+      else {
+        bp->force[0] -= kd * (velgoal[0] - bp->vec[0]);
+        bp->force[1] -= kd * (velgoal[1] - bp->vec[1]);
+        bp->force[2] -= kd * (velgoal[2] - bp->vec[2]);
       }
+    }
+    /* done goal stuff */
 
-      /* particle field & vortex */
-      if (effectors) {
-        EffectedPoint epoint;
-        float kd;
-        float force[3] = {0.0f, 0.0f, 0.0f};
-        float speed[3] = {0.0f, 0.0f, 0.0f};
+    /* gravitation */
+    if (scene->physics_settings.flag & PHYS_GLOBAL_GRAVITY) {
+      float gravity[3];
+      copy_v3_v3(gravity, scene->physics_settings.gravity);
 
-        /* just for calling function once */
-        float eval_sb_fric_force_scale = sb_fric_force_scale(ob);
+      /* Individual mass of node here. */
+      mul_v3_fl(gravity,
+                sb_grav_force_scale(ob) * _final_mass(ob, bp) *
+                    sb->effector_weights->global_gravity);
 
-        pd_point_from_soft(scene, bp->pos, bp->vec, sb->bpoint - bp, &epoint);
-        BKE_effectors_apply(effectors, NULL, sb->effector_weights, &epoint, force, NULL, speed);
+      add_v3_v3(bp->force, gravity);
+    }
 
-        /* apply forcefield*/
-        mul_v3_fl(force, fieldfactor * eval_sb_fric_force_scale);
-        add_v3_v3(bp->force, force);
+    /* particle field & vortex */
+    if (effectors) {
+      EffectedPoint epoint;
+      float kd;
+      float force[3] = {0.0f, 0.0f, 0.0f};
+      float speed[3] = {0.0f, 0.0f, 0.0f};
 
-        /* BP friction in moving media */
-        kd = sb->mediafrict * eval_sb_fric_force_scale;
-        bp->force[0] -= kd * (bp->vec[0] + windfactor * speed[0] / eval_sb_fric_force_scale);
-        bp->force[1] -= kd * (bp->vec[1] + windfactor * speed[1] / eval_sb_fric_force_scale);
-        bp->force[2] -= kd * (bp->vec[2] + windfactor * speed[2] / eval_sb_fric_force_scale);
-        /* now we'll have nice centrifugal effect for vortex */
-      }
-      else {
-        /* BP friction in media (not) moving*/
-        float kd = sb->mediafrict * sb_fric_force_scale(ob);
-        /* assume it to be proportional to actual velocity */
-        bp->force[0] -= bp->vec[0] * kd;
-        bp->force[1] -= bp->vec[1] * kd;
-        bp->force[2] -= bp->vec[2] * kd;
-        /* friction in media done */
-      }
-      /* +++cached collision targets */
-      bp->choke = 0.0f;
-      bp->choke2 = 0.0f;
-      bp->loc_flag &= ~SBF_DOFUZZY;
-      if (do_deflector && !(bp->loc_flag & SBF_OUTOFCOLLISION)) {
-        float cfforce[3], defforce[3] = {0.0f, 0.0f, 0.0f}, vel[3] = {0.0f, 0.0f, 0.0f},
-                          facenormal[3], cf = 1.0f, intrusion;
-        float kd = 1.0f;
-
-        if (sb_deflect_face(ob, bp->pos, facenormal, defforce, &cf, timenow, vel, &intrusion)) {
-          if (intrusion < 0.0f) {
-            sb->scratch->flag |= SBF_DOFUZZY;
-            bp->loc_flag |= SBF_DOFUZZY;
-            bp->choke = sb->choke * 0.01f;
-          }
+      /* just for calling function once */
+      float eval_sb_fric_force_scale = sb_fric_force_scale(ob);
 
-          sub_v3_v3v3(cfforce, bp->vec, vel);
-          madd_v3_v3fl(bp->force, cfforce, -cf * 50.0f);
+      pd_point_from_soft(scene, bp->pos, bp->vec, sb->bpoint - bp, &epoint);
+      BKE_effectors_apply(effectors, NULL, sb->effector_weights, &epoint, force, NULL, speed);
 
-          madd_v3_v3fl(bp->force, defforce, kd);
-        }
-      }
-      /* ---cached collision targets */
-
-      /* +++springs */
-      iks = 1.0f / (1.0f - sb->inspring) - 1.0f; /* inner spring constants function */
-      if (ob->softflag & OB_SB_EDGES) {
-        if (sb->bspring) { /* spring list exists at all ? */
-          int b;
-          BodySpring *bs;
-          for (b = bp->nofsprings; b > 0; b--) {
-            bs = sb->bspring + bp->springs[b - 1];
-            if (do_springcollision || do_aero) {
-              add_v3_v3(bp->force, bs->ext_force);
-              if (bs->flag & BSF_INTERSECT) {
-                bp->choke = bs->cf;
-              }
-            }
-            // sb_spring_force(Object *ob, int bpi, BodySpring *bs, float iks, float forcetime)
-            sb_spring_force(ob, ilast - bb, bs, iks, forcetime);
-          } /* loop springs */
-        }   /* existing spring list */
-      }     /*any edges*/
-      /* ---springs */
-    }       /*omit on snap */
-  }         /*loop all bp's*/
-  return 0; /*done fine*/
-}
-
-static void *exec_softbody_calc_forces(void *data)
-{
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _softbody_calc_forces_slice_in_a_thread(pctx->scene,
-                                          pctx->ob,
-                                          pctx->forcetime,
-                                          pctx->timenow,
-                                          pctx->ifirst,
-                                          pctx->ilast,
-                                          NULL,
-                                          pctx->effectors,
-                                          pctx->do_deflector,
-                                          pctx->fieldfactor,
-                                          pctx->windfactor);
-  return NULL;
-}
-
-static void sb_cf_threads_run(Scene *scene,
-                              Object *ob,
-                              float forcetime,
-                              float timenow,
-                              int totpoint,
-                              int *UNUSED(ptr_to_break_func(void)),
-                              struct ListBase *effectors,
-                              int do_deflector,
-                              float fieldfactor,
-                              float windfactor)
-{
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts. */
-  int lowpoints = 100;
-
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totpoint / totthread < lowpoints) && (totthread > 1)) {
-    totthread--;
-  }
-
-  /* printf("sb_cf_threads_run spawning %d threads\n", totthread); */
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totpoint;
-  dec = totpoint / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = forcetime;
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
+      /* apply forcefield*/
+      mul_v3_fl(force, fieldfactor * eval_sb_fric_force_scale);
+      add_v3_v3(bp->force, force);
+
+      /* BP friction in moving media */
+      kd = sb->mediafrict * eval_sb_fric_force_scale;
+      bp->force[0] -= kd * (bp->vec[0] + windfactor * speed[0] / eval_sb_fric_force_scale);
+      bp->force[1] -= kd * (bp->vec[1] + windfactor * speed[1] / eval_sb_fric_force_scale);
+      bp->force[2] -= kd * (bp->vec[2] + windfactor * speed[2] / eval_sb_fric_force_scale);
+      /* now we'll have nice centrifugal effect for vortex */
     }
     else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = do_deflector;
-    sb_threads[i].fieldfactor = fieldfactor;
-    sb_threads[i].windfactor = windfactor;
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
+      /* BP friction in media (not) moving*/
+      float kd = sb->mediafrict * sb_fric_force_scale(ob);
+      /* assume it to be proportional to actual velocity */
+      bp->force[0] -= bp->vec[0] * kd;
+      bp->force[1] -= bp->vec[1] * kd;
+      bp->force[2] -= bp->vec[2] * kd;
+      /* friction in media done */
+    }
+    /* +++cached collision targets */
+    bp->choke = 0.0f;
+    bp->choke2 = 0.0f;
+    bp->loc_flag &= ~SBF_DOFUZZY;
+    if (do_deflector && !(bp->loc_flag & SBF_OUTOFCOLLISION)) {
+      float cfforce[3], defforce[3] = {0.0f, 0.0f, 0.0f}, vel[3] = {0.0f, 0.0f, 0.0f},
+                        facenormal[3], cf = 1.0f, intrusion;
+      float kd = 1.0f;
+
+      if (sb_deflect_face(ob, bp->pos, facenormal, defforce, &cf, timenow, vel, &intrusion)) {
+        if (intrusion < 0.0f) {
+          *fuzzy = true;
+          bp->loc_flag |= SBF_DOFUZZY;
+          bp->choke = sb->choke * 0.01f;
+        }
 
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_softbody_calc_forces, totthread);
+        sub_v3_v3v3(cfforce, bp->vec, vel);
+        madd_v3_v3fl(bp->force, cfforce, -cf * 50.0f);
 
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
+        madd_v3_v3fl(bp->force, defforce, kd);
+      }
     }
+    /* ---cached collision targets */
 
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_softbody_calc_forces(&sb_threads[0]);
+    /* +++springs */
+    iks = 1.0f / (1.0f - sb->inspring) - 1.0f; /* inner spring constants function */
+    if (ob->softflag & OB_SB_EDGES) {
+      if (sb->bspring) { /* spring list exists at all ? */
+        int b;
+        BodySpring *bs;
+        for (b = bp->nofsprings; b > 0; b--) {
+          bs = sb->bspring + bp->springs[b - 1];
+          if (do_springcollision || do_aero) {
+            add_v3_v3(bp->force, bs->ext_force);
+            if (bs->flag & BSF_INTERSECT) {
+              bp->choke = bs->cf;
+            }
+          }
+          // sb_spring_force(Object *ob, int bpi, BodySpring *bs, float iks, float forcetime)
+          sb_spring_force(ob, a, bs, iks, forcetime);
+        } /* loop springs */
+      }   /* existing spring list */
+    }     /*any edges*/
+    /* ---springs */
+  } /*omit on snap */
+}
+
+static void sb_cf_fuzzy_reduce(const void *__restrict UNUSED(userdata),
+                               void *__restrict chunk_join,
+                               void *__restrict chunk)
+{
+  *(bool *)chunk_join |= *(bool *)chunk;
+}
+
+static void sb_cf_threads_run(const SB_thread_context *ctx)
+{
+  SoftBody *sb = ctx->ob->soft;
+  bool fuzzy = false;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* Effector noise draws from a generator shared by all points, keep its order. */
+  settings.use_threading = !BKE_effectors_use_noise(ctx->effectors);
+  /* Prevent pretty pointless threading overhead on few points. */
+  settings.min_iter_per_thread = 100;
+  settings.userdata_chunk = &fuzzy;
+  settings.userdata_chunk_size = sizeof(fuzzy);
+  settings.func_reduce = sb_cf_fuzzy_reduce;
+  BLI_task_parallel_range(0, sb->totpoint, (void *)ctx, softbody_calc_forces_task_cb, &settings);
+
+  if (fuzzy) {
+    sb->scratch->flag |= SBF_DOFUZZY;
   }
-  /* clean up */
-  MEM_freeN(sb_threads);
 }
 
 static void softbody_calc_forces(
@@ -2275,48 +2158,36 @@ static void softbody_calc_forces(
    * this will ruin adaptive stepsize AKA heun! (BM)
    */
   SoftBody *sb = ob->soft; /* is supposed to be there */
-  /*BodyPoint *bproot;*/   /* UNUSED */
-  /* float gravity; */     /* UNUSED */
-  /* float iks; */
-  float fieldfactor = -1.0f, windfactor = 0.25;
-  int do_deflector /*, do_selfcollision*/, do_springcollision, do_aero;
-
-  /* gravity = sb->grav * sb_grav_force_scale(ob); */ /* UNUSED */
+  SB_thread_context ctx = {
+      .scene = scene,
+      .ob = ob,
+      .forcetime = forcetime,
+      .timenow = timenow,
+      .fieldfactor = -1.0f,
+      .windfactor = 0.25f,
+  };
 
   /* check conditions for various options */
-  do_deflector = query_external_colliders(depsgraph, sb->collision_group);
-#if 0
-  do_selfcollision=((ob->softflag & OB_SB_EDGES) && (sb->bspring)&& (ob->softflag & OB_SB_SELF));
-#endif
-  do_springcollision = do_deflector && (ob->softflag & OB_SB_EDGES) &&
-                       (ob->softflag & OB_SB_EDGECOLL);
-  do_aero = ((sb->aeroedge) && (ob->softflag & OB_SB_EDGES));
-
-  /* iks  = 1.0f/(1.0f-sb->inspring)-1.0f; */ /* inner spring constants function */ /* UNUSED */
-  /* bproot= sb->bpoint; */ /* need this for proper spring addressing */            /* UNUSED */
+  ctx.do_deflector = query_external_colliders(depsgraph, sb->collision_group);
+  ctx.do_selfcollision = ((ob->softflag & OB_SB_EDGES) && (sb->bspring) &&
+                          (ob->softflag & OB_SB_SELF));
+  ctx.do_springcollision = ctx.do_deflector && (ob->softflag & OB_SB_EDGES) &&
+                           (ob->softflag & OB_SB_EDGECOLL);
+  ctx.do_aero = ((sb->aeroedge) && (ob->softflag & OB_SB_EDGES));
 
-  if (do_springcollision || do_aero) {
-    sb_sfesf_threads_run(depsgraph, scene, ob, timenow, sb->totspring, NULL);
+  if (ctx.do_springcollision || ctx.do_aero) {
+    sb_sfesf_threads_run(depsgraph, scene, ob, timenow);
   }
 
   /* after spring scan because it uses Effoctors too */
-  ListBase *effectors = BKE_effectors_create(depsgraph, ob, NULL, sb->effector_weights);
+  ctx.effectors = BKE_effectors_create(depsgraph, ob, NULL, sb->effector_weights);
 
-  if (do_deflector) {
+  if (ctx.do_deflector) {
     float defforce[3];
-    do_deflector = sb_detect_aabb_collisionCached(defforce, ob, timenow);
+    ctx.do_deflector = sb_detect_aabb_collisionCached(defforce, ob, timenow);
   }
 
-  sb_cf_threads_run(scene,
-                    ob,
-                    forcetime,
-                    timenow,
-                    sb->totpoint,
-                    NULL,
-                    effectors,
-                    do_deflector,
-                    fieldfactor,
-                    windfactor);
+  sb_cf_threads_run(&ctx);
 
   /* finally add forces caused by face collision */
   if (ob->softflag & OB_SB_FACECOLL) {
@@ -2324,163 +2195,208 @@ static void softbody_calc_forces(
   }
 
   /* finish matrix and solve */
-  BKE_effectors_free(effectors);
+  BKE_effectors_free(ctx.effectors);
 }
 
-static void softbody_apply_forces(Object *ob, float forcetime, int mode, float *err, int mid_flags)
+static void softbody_apply_forces_task_cb(void *__restrict userdata,
+                                          const int a,
+                                          const TaskParallelTLS *__restrict tls)
 {
-  /* time evolution */
-  /* actually does an explicit euler step mode == 0 */
-  /* or heun ~ 2nd order runge-kutta steps, mode 1, 2 */
+  const SB_apply_forces_context *pctx = (const SB_apply_forces_context *)userdata;
+  SB_apply_forces_chunk *chunk = (SB_apply_forces_chunk *)tls->userdata_chunk;
+  Object *ob = pctx->ob;
+  const float forcetime = pctx->forcetime;
+  const int mode = pctx->mode;
+  const int mid_flags = pctx->mid_flags;
   SoftBody *sb = ob->soft; /* is supposed to be there */
-  BodyPoint *bp;
-  float dx[3] = {0}, dv[3], aabbmin[3], aabbmax[3], cm[3] = {0.0f, 0.0f, 0.0f};
+  BodyPoint *bp = &sb->bpoint[a];
+  float dx[3] = {0}, dv[3];
   float timeovermass /*, freezeloc=0.00001f, freezeforce=0.00000000001f*/;
-  float maxerrpos = 0.0f, maxerrvel = 0.0f;
-  int a, fuzzy = 0;
-
-  forcetime *= sb_time_scale(ob);
-
-  aabbmin[0] = aabbmin[1] = aabbmin[2] = 1e20f;
-  aabbmax[0] = aabbmax[1] = aabbmax[2] = -1e20f;
 
-  /* old one with homogeneous masses  */
+  /* Now we have individual masses. */
   /* claim a minimum mass for vertex */
-#if 0
-  if (sb->nodemass > 0.009999f) {
-    timeovermass = forcetime / sb->nodemass;
+  if (_final_mass(ob, bp) > 0.009999f) {
+    timeovermass = forcetime / _final_mass(ob, bp);
   }
   else {
     timeovermass = forcetime / 0.009999f;
   }
-#endif
 
-  for (a = sb->totpoint, bp = sb->bpoint; a > 0; a--, bp++) {
-    /* Now we have individual masses. */
-    /* claim a minimum mass for vertex */
-    if (_final_mass(ob, bp) > 0.009999f) {
-      timeovermass = forcetime / _final_mass(ob, bp);
+  if (_final_goal(ob, bp) < SOFTGOALSNAP) {
+    /* this makes t~ = t */
+    if (mid_flags & MID_PRESERVE) {
+      copy_v3_v3(dx, bp->vec);
+    }
+
+    /**
+     * So here is:
+     * <pre>
+     * (v)' = a(cceleration) =
+     *     sum(F_springs)/m + gravitation + some friction forces + more forces.
+     * </pre>
+     *
+     * The ( ... )' operator denotes derivate respective time.
+     *
+     * The euler step for velocity then becomes:
+     * <pre>
+     * v(t + dt) = v(t) + a(t) * dt
+     * </pre>
+     */
+    mul_v3_fl(bp->force, timeovermass); /* individual mass of node here */
+    /* some nasty if's to have heun in here too */
+    copy_v3_v3(dv, bp->force);
+
+    if (mode == 1) {
+      copy_v3_v3(bp->prevvec, bp->vec);
+      copy_v3_v3(bp->prevdv, dv);
+    }
+
+    if (mode == 2) {
+      /* be optimistic and execute step */
+      bp->vec[0] = bp->prevvec[0] + 0.5f * (dv[0] + bp->prevdv[0]);
+      bp->vec[1] = bp->prevvec[1] + 0.5f * (dv[1] + bp->prevdv[1]);
+      bp->vec[2] = bp->prevvec[2] + 0.5f * (dv[2] + bp->prevdv[2]);
+      /* compare euler to heun to estimate error for step sizing */
+      chunk->maxerrvel = max_ff(chunk->maxerrvel, fabsf(dv[0] - bp->prevdv[0]));
+      chunk->maxerrvel = max_ff(chunk->maxerrvel, fabsf(dv[1] - bp->prevdv[1]));
+      chunk->maxerrvel = max_ff(chunk->maxerrvel, fabsf(dv[2] - bp->prevdv[2]));
     }
     else {
-      timeovermass = forcetime / 0.009999f;
+      add_v3_v3(bp->vec, bp->force);
     }
 
-    if (_final_goal(ob, bp) < SOFTGOALSNAP) {
-      /* this makes t~ = t */
-      if (mid_flags & MID_PRESERVE) {
-        copy_v3_v3(dx, bp->vec);
-      }
+    /* this makes t~ = t+dt */
+    if (!(mid_flags & MID_PRESERVE)) {
+      copy_v3_v3(dx, bp->vec);
+    }
 
-      /**
-       * So here is:
-       * <pre>
-       * (v)' = a(cceleration) =
-       *     sum(F_springs)/m + gravitation + some friction forces + more forces.
-       * </pre>
-       *
-       * The ( ... )' operator denotes derivate respective time.
-       *
-       * The euler step for velocity then becomes:
-       * <pre>
-       * v(t + dt) = v(t) + a(t) * dt
-       * </pre>
-       */
-      mul_v3_fl(bp->force, timeovermass); /* individual mass of node here */
-      /* some nasty if's to have heun in here too */
-      copy_v3_v3(dv, bp->force);
-
-      if (mode == 1) {
-        copy_v3_v3(bp->prevvec, bp->vec);
-        copy_v3_v3(bp->prevdv, dv);
-      }
+    /* so here is (x)'= v(elocity) */
+    /* the euler step for location then becomes */
+    /* x(t + dt) = x(t) + v(t~) * dt */
+    mul_v3_fl(dx, forcetime);
 
-      if (mode == 2) {
-        /* be optimistic and execute step */
-        bp->vec[0] = bp->prevvec[0] + 0.5f * (dv[0] + bp->prevdv[0]);
-        bp->vec[1] = bp->prevvec[1] + 0.5f * (dv[1] + bp->prevdv[1]);
-        bp->vec[2] = bp->prevvec[2] + 0.5f * (dv[2] + bp->prevdv[2]);
-        /* compare euler to heun to estimate error for step sizing */
-        maxerrvel = max_ff(maxerrvel, fabsf(dv[0] - bp->prevdv[0]));
-        maxerrvel = max_ff(maxerrvel, fabsf(dv[1] - bp->prevdv[1]));
-        maxerrvel = max_ff(maxerrvel, fabsf(dv[2] - bp->prevdv[2]));
+    /* the freezer coming sooner or later */
+#if 0
+    if ((dot_v3v3(dx, dx) < freezeloc) && (dot_v3v3(bp->force, bp->force) < freezeforce)) {
+      bp->frozen /= 2;
+    }
+    else {
+      bp->frozen = min_ff(bp->frozen * 1.05f, 1.0f);
+    }
+    mul_v3_fl(dx, bp->frozen);
+#endif
+    /* again some nasty if's to have heun in here too */
+    if (mode == 1) {
+      copy_v3_v3(bp->prevpos, bp->pos);
+      copy_v3_v3(bp->prevdx, dx);
+    }
+
+    if (mode == 2) {
+      bp->pos[0] = bp->prevpos[0] + 0.5f * (dx[0] + bp->prevdx[0]);
+      bp->pos[1] = bp->prevpos[1] + 0.5f * (dx[1] + bp->prevdx[1]);
+      bp->pos[2] = bp->prevpos[2] + 0.5f * (dx[2] + bp->prevdx[2]);
+      chunk->maxerrpos = max_ff(chunk->maxerrpos, fabsf(dx[0] - bp->prevdx[0]));
+      chunk->maxerrpos = max_ff(chunk->maxerrpos, fabsf(dx[1] - bp->prevdx[1]));
+      chunk->maxerrpos = max_ff(chunk->maxerrpos, fabsf(dx[2] - bp->prevdx[2]));
+
+      /* bp->choke is set when we need to pull a vertex or edge out of the collider.
+       * the collider object signals to get out by pushing hard. on the other hand
+       * we don't want to end up in deep space so we add some <viscosity>
+       * to balance that out */
+      if (bp->choke2 > 0.0f) {
+        mul_v3_fl(bp->vec, (1.0f - bp->choke2));
       }
-      else {
-        add_v3_v3(bp->vec, bp->force);
+      if (bp->choke > 0.0f) {
+        mul_v3_fl(bp->vec, (1.0f - bp->choke));
       }
+    }
+    else {
+      add_v3_v3(bp->pos, dx);
+    }
+  } /*snap*/
+  /* so while we are looping BPs anyway do statistics on the fly */
+  minmax_v3v3_v3(chunk->aabbmin, chunk->aabbmax, bp->pos);
+  if (bp->loc_flag & SBF_DOFUZZY) {
+    chunk->fuzzy = true;
+  }
+}
 
-      /* this makes t~ = t+dt */
-      if (!(mid_flags & MID_PRESERVE)) {
-        copy_v3_v3(dx, bp->vec);
-      }
+static void softbody_apply_forces_reduce(const void *__restrict UNUSED(userdata),
+                                         void *__restrict chunk_join,
+                                         void *__restrict chunk)
+{
+  SB_apply_forces_chunk *join = (SB_apply_forces_chunk *)chunk_join;
+  const SB_apply_forces_chunk *other = (const SB_apply_forces_chunk *)chunk;
+
+  for (int i = 0; i < 3; i++) {
+    join->aabbmin[i] = min_ff(join->aabbmin[i], other->aabbmin[i]);
+    join->aabbmax[i] = max_ff(join->aabbmax[i], other->aabbmax[i]);
+  }
+  join->maxerrpos = max_ff(join->maxerrpos, other->maxerrpos);
+  join->maxerrvel = max_ff(join->maxerrvel, other->maxerrvel);
+  join->fuzzy |= other->fuzzy;
+}
+
+static void softbody_apply_forces(Object *ob, float forcetime, int mode, float *err, int mid_flags)
+{
+  /* time evolution */
+  /* actually does an explicit euler step mode == 0 */
+  /* or heun ~ 2nd order runge-kutta steps, mode 1, 2 */
+  SoftBody *sb = ob->soft; /* is supposed to be there */
+  float cm[3] = {0.0f, 0.0f, 0.0f};
 
-      /* so here is (x)'= v(elocity) */
-      /* the euler step for location then becomes */
-      /* x(t + dt) = x(t) + v(t~) * dt */
-      mul_v3_fl(dx, forcetime);
+  forcetime *= sb_time_scale(ob);
 
-      /* the freezer coming sooner or later */
+  /* old one with homogeneous masses  */
+  /* claim a minimum mass for vertex */
 #if 0
-      if ((dot_v3v3(dx, dx) < freezeloc) && (dot_v3v3(bp->force, bp->force) < freezeforce)) {
-        bp->frozen /= 2;
-      }
-      else {
-        bp->frozen = min_ff(bp->frozen * 1.05f, 1.0f);
-      }
-      mul_v3_fl(dx, bp->frozen);
+  if (sb->nodemass > 0.009999f) {
+    timeovermass = forcetime / sb->nodemass;
+  }
+  else {
+    timeovermass = forcetime / 0.009999f;
+  }
 #endif
-      /* again some nasty if's to have heun in here too */
-      if (mode == 1) {
-        copy_v3_v3(bp->prevpos, bp->pos);
-        copy_v3_v3(bp->prevdx, dx);
-      }
 
-      if (mode == 2) {
-        bp->pos[0] = bp->prevpos[0] + 0.5f * (dx[0] + bp->prevdx[0]);
-        bp->pos[1] = bp->prevpos[1] + 0.5f * (dx[1] + bp->prevdx[1]);
-        bp->pos[2] = bp->prevpos[2] + 0.5f * (dx[2] + bp->prevdx[2]);
-        maxerrpos = max_ff(maxerrpos, fabsf(dx[0] - bp->prevdx[0]));
-        maxerrpos = max_ff(maxerrpos, fabsf(dx[1] - bp->prevdx[1]));
-        maxerrpos = max_ff(maxerrpos, fabsf(dx[2] - bp->prevdx[2]));
-
-        /* bp->choke is set when we need to pull a vertex or edge out of the collider.
-         * the collider object signals to get out by pushing hard. on the other hand
-         * we don't want to end up in deep space so we add some <viscosity>
-         * to balance that out */
-        if (bp->choke2 > 0.0f) {
-          mul_v3_fl(bp->vec, (1.0f - bp->choke2));
-        }
-        if (bp->choke > 0.0f) {
-          mul_v3_fl(bp->vec, (1.0f - bp->choke));
-        }
-      }
-      else {
-        add_v3_v3(bp->pos, dx);
-      }
-    } /*snap*/
-    /* so while we are looping BPs anyway do statistics on the fly */
-    minmax_v3v3_v3(aabbmin, aabbmax, bp->pos);
-    if (bp->loc_flag & SBF_DOFUZZY) {
-      fuzzy = 1;
-    }
-  } /*for*/
+  SB_apply_forces_context ctx = {
+      .ob = ob,
+      .forcetime = forcetime,
+      .mode = mode,
+      .mid_flags = mid_flags,
+  };
+  SB_apply_forces_chunk stats = {
+      .aabbmin = {1e20f, 1e20f, 1e20f},
+      .aabbmax = {-1e20f, -1e20f, -1e20f},
+      .maxerrpos = 0.0f,
+      .maxerrvel = 0.0f,
+      .fuzzy = false,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  settings.userdata_chunk = &stats;
+  settings.userdata_chunk_size = sizeof(stats);
+  settings.func_reduce = softbody_apply_forces_reduce;
+  BLI_task_parallel_range(0, sb->totpoint, &ctx, softbody_apply_forces_task_cb, &settings);
 
   if (sb->totpoint) {
     mul_v3_fl(cm, 1.0f / sb->totpoint);
   }
   if (sb->scratch) {
-    copy_v3_v3(sb->scratch->aabbmin, aabbmin);
-    copy_v3_v3(sb->scratch->aabbmax, aabbmax);
+    copy_v3_v3(sb->scratch->aabbmin, stats.aabbmin);
+    copy_v3_v3(sb->scratch->aabbmax, stats.aabbmax);
   }
 
   if (err) { /* so step size will be controlled by biggest difference in slope */
     if (sb->solverflags & SBSO_OLDERR) {
-      *err = max_ff(maxerrpos, maxerrvel);
+      *err = max_ff(stats.maxerrpos, stats.maxerrvel);
     }
     else {
-      *err = maxerrpos;
+      *err = stats.maxerrpos;
     }
     // printf("EP %f EV %f\n", maxerrpos, maxerrvel);
-    if (fuzzy) {
+    if (stats.fuzzy) {
       *err /= sb->fuzzyness;
     }
   }
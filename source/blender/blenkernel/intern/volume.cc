@@ -24,6 +24,7 @@
 #include "DNA_material_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 #include "DNA_volume_types.h"
 
 #include "BLI_compiler_compat.h"
@@ -32,6 +33,7 @@
 #include "BLI_math.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_anim_data.h"
@@ -80,7 +82,14 @@ static CLG_LogRef LOG = {"bke.volume"};
  * rendering for example. So, depending on the users the grid in the cache may
  * have a tree or not.
  *
- * When the number of users drops to zero, the grid data is immediately deleted.
+ * Trees are read with delayed loading, leaf buffers stay in the memory mapped
+ * file until they are accessed. When the last tree user goes away, the tree
+ * stays loaded in a least recently used list so it does not have to be read
+ * again, until the memory of such unused trees exceeds the volume cache limit
+ * from the user preferences. This includes grids without any users left, so
+ * going back to a previous frame of a sequence reuses the grids read before.
+ * Without a loaded tree, the grid data is deleted when the number of users
+ * drops to zero.
  *
  * TODO: also add a cache for OpenVDB files rather than individual grids,
  * so getting the list of grids is also cached.
@@ -92,13 +101,16 @@ static CLG_LogRef LOG = {"bke.volume"};
 static struct VolumeFileCache {
   /* Cache Entry */
   struct Entry {
-    Entry(const std::string &filepath, const openvdb::GridBase::Ptr &grid)
+    Entry(const std::string &filepath, const openvdb::GridBase::Ptr &grid, const int64_t mtime)
         : filepath(filepath),
           grid_name(grid->getName()),
           grid(grid),
+          file_mtime(mtime),
           is_loaded(false),
           num_metadata_users(0),
-          num_tree_users(0)
+          num_tree_users(0),
+          is_unused_tree(false),
+          unused_tree_memory(0)
     {
     }
 
@@ -106,9 +118,12 @@ static struct VolumeFileCache {
         : filepath(other.filepath),
           grid_name(other.grid_name),
           grid(other.grid),
+          file_mtime(other.file_mtime),
           is_loaded(other.is_loaded),
           num_metadata_users(0),
-          num_tree_users(0)
+          num_tree_users(0),
+          is_unused_tree(false),
+          unused_tree_memory(0)
     {
     }
 
@@ -118,6 +133,8 @@ static struct VolumeFileCache {
 
     /* OpenVDB grid. */
     openvdb::GridBase::Ptr grid;
+    /* Modification time of the file, to detect changes while the grid is kept without users. */
+    int64_t file_mtime;
     /* Has the grid tree been loaded? */
     bool is_loaded;
     /* Error message if an error occured during loading. */
@@ -125,6 +142,10 @@ static struct VolumeFileCache {
     /* User counting. */
     int num_metadata_users;
     int num_tree_users;
+    /* Loaded tree without tree users, in the unused trees list. */
+    bool is_unused_tree;
+    size_t unused_tree_memory;
+    std::list<Entry *>::iterator unused_tree_it;
     /* Mutex for on-demand reading of tree. */
     std::mutex mutex;
   };
@@ -152,6 +173,7 @@ static struct VolumeFileCache {
 
   ~VolumeFileCache()
   {
+    free_unused_trees(0);
     assert(cache.empty());
   }
 
@@ -159,6 +181,13 @@ static struct VolumeFileCache {
   {
     std::lock_guard<std::mutex> lock(mutex);
     EntrySet::iterator it = cache.find(template_entry);
+    if (it != cache.end() && it->file_mtime != template_entry.file_mtime &&
+        it->num_metadata_users + it->num_tree_users == 0) {
+      /* File was written again since the grid was kept, don't reuse it. */
+      remove_unused_tree((Entry &)*it);
+      cache.erase(it);
+      it = cache.end();
+    }
     if (it == cache.end()) {
       it = cache.emplace(template_entry).first;
     }
@@ -200,6 +229,8 @@ static struct VolumeFileCache {
     std::lock_guard<std::mutex> lock(mutex);
     entry.num_tree_users++;
     entry.num_metadata_users--;
+    /* Tree is in use again, no need to read it from the file. */
+    remove_unused_tree(entry);
     update_for_remove_user(entry);
   }
 
@@ -211,23 +242,89 @@ static struct VolumeFileCache {
     update_for_remove_user(entry);
   }
 
+  void free_all_unused_trees()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    free_unused_trees(0);
+  }
+
+  /* Memory that unused trees can still take within the volume cache limit. */
+  size_t unused_trees_memory_available()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const size_t memory_limit = size_t(U.volume_cache_limit) * 1024 * 1024;
+    return (unused_trees_memory < memory_limit) ? memory_limit - unused_trees_memory : 0;
+  }
+
  protected:
   void update_for_remove_user(Entry &entry)
   {
-    if (entry.num_metadata_users + entry.num_tree_users == 0) {
+    if (entry.num_tree_users > 0 || entry.is_unused_tree) {
+      return;
+    }
+
+    if (entry.is_loaded) {
+      /* Note this may free the entry right away when it doesn't fit the memory limit. */
+      add_unused_tree(entry);
+      free_unused_trees(size_t(U.volume_cache_limit) * 1024 * 1024);
+    }
+    else if (entry.num_metadata_users == 0) {
       cache.erase(entry);
     }
-    else if (entry.num_tree_users == 0) {
-      /* Note we replace the grid rather than clearing, so that if there is
-       * any other shared pointer to the grid it will keep the tree. */
-      entry.grid = entry.grid->copyGridWithNewTree();
-      entry.is_loaded = false;
+    else {
+      free_tree(entry);
+    }
+  }
+
+  void free_tree(Entry &entry)
+  {
+    /* Note we replace the grid rather than clearing, so that if there is
+     * any other shared pointer to the grid it will keep the tree. */
+    entry.grid = entry.grid->copyGridWithNewTree();
+    entry.is_loaded = false;
+  }
+
+  void add_unused_tree(Entry &entry)
+  {
+    /* Only counts leaf buffers that were actually read from the file. */
+    entry.unused_tree_memory = size_t(entry.grid->memUsage());
+    entry.unused_tree_it = unused_trees.insert(unused_trees.end(), &entry);
+    entry.is_unused_tree = true;
+    unused_trees_memory += entry.unused_tree_memory;
+  }
+
+  void remove_unused_tree(Entry &entry)
+  {
+    if (entry.is_unused_tree) {
+      unused_trees.erase(entry.unused_tree_it);
+      unused_trees_memory -= entry.unused_tree_memory;
+      entry.unused_tree_memory = 0;
+      entry.is_unused_tree = false;
+    }
+  }
+
+  /* Free least recently used trees until the memory limit is respected,
+   * along with the grids that have no users left. */
+  void free_unused_trees(const size_t memory_limit)
+  {
+    while (!unused_trees.empty() && (unused_trees_memory > memory_limit || memory_limit == 0)) {
+      Entry &entry = *unused_trees.front();
+      remove_unused_tree(entry);
+      if (entry.num_metadata_users + entry.num_tree_users == 0) {
+        cache.erase(entry);
+      }
+      else {
+        free_tree(entry);
+      }
     }
   }
 
   /* Cache contents */
   typedef std::unordered_set<Entry, EntryHasher, EntryEqual> EntrySet;
   EntrySet cache;
+  /* Loaded trees without tree users, least recently used first. */
+  std::list<Entry *> unused_trees;
+  size_t unused_trees_memory = 0;
   /* Mutex for multithreaded access. */
   std::mutex mutex;
 } GLOBAL_CACHE;
@@ -290,6 +387,8 @@ struct VolumeGrid {
     openvdb::io::File file(filepath);
 
     try {
+      /* Delayed loading reads the tree topology only, leaf buffers are read
+       * from the memory mapped file when they are accessed. */
       file.setCopyMaxBytes(0);
       file.open();
       openvdb::GridBase::Ptr vdb_grid = file.readGrid(name());
@@ -436,6 +535,10 @@ struct VolumeGridVector : public std::list<VolumeGrid> {
 
 /* Module */
 
+#ifdef WITH_OPENVDB
+static void volume_prefetch_exit();
+#endif
+
 void BKE_volumes_init()
 {
 #ifdef WITH_OPENVDB
@@ -443,6 +546,14 @@ void BKE_volumes_init()
 #endif
 }
 
+void BKE_volumes_exit()
+{
+#ifdef WITH_OPENVDB
+  volume_prefetch_exit();
+  GLOBAL_CACHE.free_all_unused_trees();
+#endif
+}
+
 /* Volume datablock */
 
 static void volume_init_data(ID *id)
@@ -561,7 +672,8 @@ Volume *BKE_volume_copy(Main *bmain, const Volume *volume)
 
 /* Sequence */
 
-static int volume_sequence_frame(const Depsgraph *depsgraph, const Volume *volume)
+/* Map a scene frame to the frame of the volume sequence, depending on the sequence mode. */
+static int volume_sequence_frame_at(const Volume *volume, const int scene_frame)
 {
   if (!volume->is_sequence) {
     return 0;
@@ -574,7 +686,6 @@ static int volume_sequence_frame(const Depsgraph *depsgraph, const Volume *volum
     return 0;
   }
 
-  const int scene_frame = DEG_get_ctime(depsgraph);
   const VolumeSequenceMode mode = (VolumeSequenceMode)volume->sequence_mode;
   const int frame_duration = volume->frame_duration;
   const int frame_start = volume->frame_start;
@@ -629,8 +740,16 @@ static int volume_sequence_frame(const Depsgraph *depsgraph, const Volume *volum
   return frame;
 }
 
+static int volume_sequence_frame(const Depsgraph *depsgraph, const Volume *volume)
+{
+  return volume_sequence_frame_at(volume, DEG_get_ctime(depsgraph));
+}
+
 #ifdef WITH_OPENVDB
-static void volume_filepath_get(const Main *bmain, const Volume *volume, char r_filepath[FILE_MAX])
+static void volume_filepath_get(const Main *bmain,
+                                const Volume *volume,
+                                const int frame,
+                                char r_filepath[FILE_MAX])
 {
   BLI_strncpy(r_filepath, volume->filepath, FILE_MAX);
   BLI_path_abs(r_filepath, ID_BLEND_PATH(bmain, &volume->id));
@@ -639,10 +758,145 @@ static void volume_filepath_get(const Main *bmain, const Volume *volume, char r_
   if (volume->is_sequence && BLI_path_frame_get(r_filepath, &path_frame, &path_digits)) {
     char ext[32];
     BLI_path_frame_strip(r_filepath, ext);
-    BLI_path_frame(r_filepath, volume->runtime.frame, path_digits);
+    BLI_path_frame(r_filepath, frame, path_digits);
     BLI_path_extension_ensure(r_filepath, FILE_MAX, ext);
   }
 }
+
+static int64_t volume_file_mtime(const char *filepath)
+{
+  BLI_stat_t st;
+  if (BLI_stat(filepath, &st) != 0) {
+    return 0;
+  }
+  return int64_t(st.st_mtime);
+}
+
+/* Prefetch
+ *
+ * While a volume sequence plays forward, the grids of the next frames are
+ * loaded into the file cache on a background thread. The grids have no users
+ * once loaded, they are kept within the volume cache limit until the frame is
+ * loaded by the volume datablock. Leaf buffers are only read while they fit in
+ * the limit, otherwise only the tree topology is prefetched. */
+
+#  define VOLUME_PREFETCH_FRAMES 2
+
+static struct VolumePrefetch {
+  TaskPool *pool = NULL;
+  /* File paths queued or being loaded. */
+  std::unordered_set<std::string> filepaths;
+  std::mutex mutex;
+} GLOBAL_PREFETCH;
+
+/* Upper bound of the memory the leaf buffers of a grid take once they are read. */
+static size_t volume_prefetch_grid_buffers_memory(const VolumeGrid &grid)
+{
+  /* Leaf nodes of all supported grid types have 8^3 voxels, with up to three doubles each. */
+  const size_t leaf_memory = 512 * sizeof(double) * size_t(BKE_volume_grid_channels(&grid));
+  return size_t(grid.grid()->baseTree().leafCount()) * leaf_memory;
+}
+
+static void volume_prefetch_file(const std::string &filepath)
+{
+  openvdb::io::File file(filepath);
+  openvdb::GridPtrVec vdb_grids;
+
+  try {
+    file.setCopyMaxBytes(0);
+    file.open();
+    vdb_grids = *(file.readAllGridMetadata());
+  }
+  catch (const openvdb::IoError &e) {
+    CLOG_INFO(&LOG, 1, "Volume prefetch %s: %s", filepath.c_str(), e.what());
+    return;
+  }
+
+  const int64_t mtime = volume_file_mtime(filepath.c_str());
+  for (const openvdb::GridBase::Ptr &vdb_grid : vdb_grids) {
+    if (vdb_grid) {
+      VolumeFileCache::Entry template_entry(filepath, vdb_grid, mtime);
+      VolumeGrid grid(template_entry);
+      grid.load("prefetch", filepath.c_str());
+
+      /* Also read the delay loaded leaf buffers that drawing needs, as long as they fit in the
+       * volume cache limit. Otherwise they would push the trees of other frames out of the
+       * cache, and only the topology is prefetched. */
+      const size_t buffers_memory = volume_prefetch_grid_buffers_memory(grid);
+      if (buffers_memory != 0 && buffers_memory <= GLOBAL_CACHE.unused_trees_memory_available()) {
+        grid.grid()->readNonresidentBuffers();
+      }
+    }
+  }
+}
+
+struct VolumePrefetchTask {
+  VolumePrefetchTask(const char *filepath) : filepath(filepath)
+  {
+  }
+
+  std::string filepath;
+};
+
+static void volume_prefetch_task(TaskPool *__restrict pool, void *taskdata)
+{
+  const std::string &filepath = ((VolumePrefetchTask *)taskdata)->filepath;
+
+  if (!BLI_task_pool_canceled(pool)) {
+    volume_prefetch_file(filepath);
+  }
+
+  std::lock_guard<std::mutex> lock(GLOBAL_PREFETCH.mutex);
+  GLOBAL_PREFETCH.filepaths.erase(filepath);
+}
+
+static void volume_prefetch_task_free(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  VolumePrefetchTask *task = (VolumePrefetchTask *)taskdata;
+  OBJECT_GUARDED_DELETE(task, VolumePrefetchTask);
+}
+
+static void volume_prefetch_exit()
+{
+  if (GLOBAL_PREFETCH.pool) {
+    BLI_task_pool_cancel(GLOBAL_PREFETCH.pool);
+    BLI_task_pool_free(GLOBAL_PREFETCH.pool);
+    GLOBAL_PREFETCH.pool = NULL;
+  }
+}
+
+static void volume_prefetch_frames(const Main *bmain, const Volume *volume, const int scene_frame)
+{
+  if (volume->packedfile != NULL || U.volume_cache_limit == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(GLOBAL_PREFETCH.mutex);
+  if (GLOBAL_PREFETCH.pool == NULL) {
+    GLOBAL_PREFETCH.pool = BLI_task_pool_create_background_serial(NULL, TASK_PRIORITY_LOW);
+  }
+
+  for (int i = 1; i <= VOLUME_PREFETCH_FRAMES; i++) {
+    /* Follow the sequence mode, the next frames may repeat or run backwards. */
+    const int frame = volume_sequence_frame_at(volume, scene_frame + i);
+    if (ELEM(frame, VOLUME_FRAME_NONE, volume->runtime.frame)) {
+      continue;
+    }
+
+    char filepath[FILE_MAX];
+    volume_filepath_get(bmain, volume, frame, filepath);
+    if (!BLI_exists(filepath) || !GLOBAL_PREFETCH.filepaths.insert(filepath).second) {
+      continue;
+    }
+
+    CLOG_INFO(&LOG, 1, "Volume %s: prefetch %s", volume->id.name + 2, filepath);
+    BLI_task_pool_push(GLOBAL_PREFETCH.pool,
+                       volume_prefetch_task,
+                       OBJECT_GUARDED_NEW(VolumePrefetchTask, filepath),
+                       true,
+                       volume_prefetch_task_free);
+  }
+}
 #endif
 
 /* File Load */
@@ -680,7 +934,7 @@ bool BKE_volume_load(Volume *volume, Main *bmain)
 
   /* Get absolute file path at current frame. */
   const char *volume_name = volume->id.name + 2;
-  volume_filepath_get(bmain, volume, grids.filepath);
+  volume_filepath_get(bmain, volume, volume->runtime.frame, grids.filepath);
 
   CLOG_INFO(&LOG, 1, "Volume %s: load %s", volume_name, grids.filepath);
 
@@ -718,9 +972,10 @@ bool BKE_volume_load(Volume *volume, Main *bmain)
   }
 
   /* Add grids read from file to own vector, filtering out any NULL pointers. */
+  const int64_t mtime = volume_file_mtime(grids.filepath);
   for (const openvdb::GridBase::Ptr &vdb_grid : vdb_grids) {
     if (vdb_grid) {
-      VolumeFileCache::Entry template_entry(grids.filepath, vdb_grid);
+      VolumeFileCache::Entry template_entry(grids.filepath, vdb_grid, mtime);
       grids.emplace_back(template_entry);
     }
   }
@@ -893,6 +1148,14 @@ void BKE_volume_eval_geometry(struct Depsgraph *depsgraph, Volume *volume)
   if (DEG_is_active(depsgraph)) {
     Volume *volume_orig = (Volume *)DEG_get_original_id(&volume->id);
     if (volume_orig->runtime.frame != volume->runtime.frame) {
+#ifdef WITH_OPENVDB
+      /* Playing forward, load the next frames ahead of time. */
+      const int scene_frame = DEG_get_ctime(depsgraph);
+      if (volume_orig->runtime.frame != VOLUME_FRAME_NONE &&
+          volume_orig->runtime.frame == volume_sequence_frame_at(volume, scene_frame - 1)) {
+        volume_prefetch_frames(DEG_get_bmain(depsgraph), volume, scene_frame);
+      }
+#endif
       BKE_volume_unload(volume_orig);
       volume_orig->runtime.frame = volume->runtime.frame;
     }
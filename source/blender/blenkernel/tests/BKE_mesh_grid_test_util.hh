@@ -0,0 +1,55 @@
+/* Apache License, Version 2.0 */
+
+#pragma once
+
+/** \file
+ * \ingroup bke
+ *
+ * Procedural grid meshes shared by the blenkernel tests and performance tests.
+ */
+
+#include <cmath>
+
+#include "BKE_mesh.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+namespace blender::bke::tests {
+
+/**
+ * A grid of `size * size` quads spaced by `step` in the XY plane, curved along Z by a wave of
+ * `wave_height` (flat when zero), with edges and vertex normals calculated.
+ */
+inline Mesh *grid_mesh_create(const int size, const float step, const float wave_height)
+{
+  const int totvert = (size + 1) * (size + 1);
+  const int totpoly = size * size;
+  Mesh *mesh = BKE_mesh_new_nomain(totvert, 0, 0, totpoly * 4, totpoly);
+
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      float *co = mesh->mvert[y * (size + 1) + x].co;
+      co[0] = float(x) * step;
+      co[1] = float(y) * step;
+      co[2] = wave_height * sinf(co[0] * 3.0f) * cosf(co[1] * 2.0f);
+    }
+  }
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      const int p = y * size + x;
+      const int v = y * (size + 1) + x;
+      mesh->mpoly[p].loopstart = p * 4;
+      mesh->mpoly[p].totloop = 4;
+      mesh->mloop[p * 4 + 0].v = v;
+      mesh->mloop[p * 4 + 1].v = v + 1;
+      mesh->mloop[p * 4 + 2].v = v + size + 2;
+      mesh->mloop[p * 4 + 3].v = v + size + 1;
+    }
+  }
+  BKE_mesh_calc_edges(mesh, false, false);
+  BKE_mesh_calc_normals(mesh);
+  return mesh;
+}
+
+}  // namespace blender::bke::tests
@@ -0,0 +1,106 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cfloat>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_threads.h"
+
+#include "BKE_bvhutils.h"
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_mesh_remesh_voxel.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+#include "PIL_time_utildefines.h"
+
+using blender::bke::tests::grid_mesh_create;
+
+/* Run the longest tests! */
+//#define REMESH_RUN_BIG
+
+/* The reprojection as it used to be done: unbounded serial queries, one per target vertex. */
+static void reproject_paint_mask_serial(Mesh *target, Mesh *source)
+{
+  const float *source_mask = (const float *)CustomData_get_layer(&source->vdata, CD_PAINT_MASK);
+  float *target_mask = (float *)CustomData_get_layer(&target->vdata, CD_PAINT_MASK);
+
+  BVHTreeFromMesh bvhtree = {nullptr};
+  BKE_bvhtree_from_mesh_get(&bvhtree, source, BVHTREE_FROM_VERTS, 2);
+  for (int i = 0; i < target->totvert; i++) {
+    BVHTreeNearest nearest;
+    nearest.index = -1;
+    nearest.dist_sq = FLT_MAX;
+    BLI_bvhtree_find_nearest(
+        bvhtree.tree, target->mvert[i].co, &nearest, bvhtree.nearest_callback, &bvhtree);
+    if (nearest.index != -1) {
+      target_mask[i] = source_mask[nearest.index];
+    }
+  }
+  free_bvhtree_from_mesh(&bvhtree);
+}
+
+static void remesh_reproject_test(const int source_size, const int target_size)
+{
+  printf("\n========== STARTING %s (%d target vertices) ==========\n",
+         __func__,
+         (target_size + 1) * (target_size + 1));
+
+  BLI_threadapi_init();
+  BKE_idtype_init();
+
+  Mesh *source = grid_mesh_create(source_size, 7.0f / source_size, 0.1f);
+  Mesh *target = grid_mesh_create(target_size, 7.0f / target_size, 0.1f);
+  /* Keep the target vertices off the source ones. */
+  const float target_offset[3] = {0.0013f, 0.00065f, 0.0013f};
+  BKE_mesh_translate(target, target_offset, false);
+  float *source_mask = (float *)CustomData_add_layer(
+      &source->vdata, CD_PAINT_MASK, CD_CALLOC, nullptr, source->totvert);
+  CustomData_add_layer(&target->vdata, CD_PAINT_MASK, CD_CALLOC, nullptr, target->totvert);
+  for (int i = 0; i < source->totvert; i++) {
+    source_mask[i] = float(i % 7) / 7.0f;
+  }
+
+  {
+    TIMEIT_START(reproject_paint_mask_serial);
+    reproject_paint_mask_serial(target, source);
+    TIMEIT_END(reproject_paint_mask_serial);
+  }
+  {
+    TIMEIT_START(reproject_paint_mask);
+    BKE_mesh_remesh_reproject_paint_mask(target, source);
+    TIMEIT_END(reproject_paint_mask);
+  }
+  {
+    TIMEIT_START(reproject_sculpt_face_sets);
+    BKE_remesh_reproject_sculpt_face_sets(target, source);
+    TIMEIT_END(reproject_sculpt_face_sets);
+  }
+
+  BKE_id_free(nullptr, source);
+  BKE_id_free(nullptr, target);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(mesh_remesh_reproject, Grid1000)
+{
+  remesh_reproject_test(700, 1000);
+}
+
+#ifdef REMESH_RUN_BIG
+TEST(mesh_remesh_reproject, Grid2500)
+{
+  remesh_reproject_test(1800, 2500);
+}
+#endif
@@ -0,0 +1,111 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstring>
+
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+#include "PIL_time_utildefines.h"
+
+using blender::bke::tests::grid_mesh_create;
+
+#define NUM_RUN_AVERAGED 10
+
+/* Run the longest tests! */
+//#define SOLIDIFY_RUN_BIG
+
+static void solidify_test_do(Mesh *mesh, const char *id, const char mode, const int flag)
+{
+  ModifierData *md = BKE_modifier_new(eModifierType_Solidify);
+  SolidifyModifierData *smd = (SolidifyModifierData *)md;
+  smd->mode = mode;
+  smd->flag |= flag;
+  smd->offset = 0.05f;
+
+  Object object;
+  memset(&object, 0, sizeof(object));
+  object.type = OB_MESH;
+  object.data = mesh;
+  const ModifierEvalContext ctx = {nullptr, &object, ModifierApplyFlag(0)};
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    const double init_time = PIL_check_seconds_timer();
+    Mesh *result = BKE_modifier_modify_mesh(md, &ctx, mesh);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+    BKE_id_free(nullptr, result);
+  }
+
+  printf("\t%s: done in %fs on average over %d runs\n",
+         id,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BKE_modifier_free(md);
+}
+
+static void solidify_test(const int size, const bool use_threads)
+{
+  printf("\n========== STARTING %s (%d vertices, %s) ==========\n",
+         __func__,
+         (size + 1) * (size + 1),
+         use_threads ? "threaded" : "single thread");
+
+  BLI_threadapi_init();
+  BLI_system_num_threads_override_set(use_threads ? 0 : 1);
+  BLI_task_scheduler_init();
+  BKE_idtype_init();
+  BKE_modifier_init();
+
+  Mesh *mesh = grid_mesh_create(size, 0.1f, 0.3f);
+
+  solidify_test_do(mesh, "Simple", MOD_SOLIDIFY_MODE_EXTRUDE, 0);
+  solidify_test_do(mesh,
+                   "Simple, even thickness",
+                   MOD_SOLIDIFY_MODE_EXTRUDE,
+                   MOD_SOLIDIFY_EVEN | MOD_SOLIDIFY_NORMAL_CALC);
+  solidify_test_do(mesh, "Complex", MOD_SOLIDIFY_MODE_NONMANIFOLD, 0);
+
+  BKE_id_free(nullptr, mesh);
+  BLI_task_scheduler_exit();
+  BLI_system_num_threads_override_set(0);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(solidify, GridNoThread500)
+{
+  solidify_test(500, false);
+}
+
+TEST(solidify, Grid500)
+{
+  solidify_test(500, true);
+}
+
+#ifdef SOLIDIFY_RUN_BIG
+TEST(solidify, GridNoThread2000)
+{
+  solidify_test(2000, false);
+}
+
+TEST(solidify, Grid2000)
+{
+  solidify_test(2000, true);
+}
+#endif
@@ -0,0 +1,144 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_bitmap.h"
+#include "BLI_math_geom.h"
+#include "BLI_threads.h"
+
+#include "BKE_DerivedMesh.h"
+#include "BKE_ccg.h"
+#include "BKE_customdata.h"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_mesh.h"
+#include "BKE_pbvh.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "PIL_time_utildefines.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+using blender::bke::tests::grid_mesh_create;
+
+/* Run the longest tests! */
+//#define PBVH_RUN_BIG
+
+/* A curved grid of `size * size` quads, as the mesh a sculpt mode PBVH is built on. */
+static void pbvh_build_mesh_test(const int size)
+{
+  BLI_threadapi_init();
+  BKE_idtype_init();
+
+  Mesh *mesh = grid_mesh_create(size, 1.0f, 0.1f);
+  const int looptri_num = poly_to_tri_count(mesh->totpoly, mesh->totloop);
+  /* Owned by the PBVH once it is built. */
+  MLoopTri *looptri = (MLoopTri *)MEM_mallocN(sizeof(MLoopTri) * looptri_num, __func__);
+  BKE_mesh_recalc_looptri(
+      mesh->mloop, mesh->mpoly, mesh->mvert, mesh->totloop, mesh->totpoly, looptri);
+
+  printf("\n========== STARTING %s (%d triangles) ==========\n", __func__, looptri_num);
+
+  PBVH *pbvh = BKE_pbvh_new();
+  TIMEIT_START(pbvh_build_mesh);
+  BKE_pbvh_build_mesh(pbvh,
+                      mesh,
+                      mesh->mpoly,
+                      mesh->mloop,
+                      mesh->mvert,
+                      mesh->totvert,
+                      &mesh->vdata,
+                      &mesh->ldata,
+                      &mesh->pdata,
+                      looptri,
+                      looptri_num);
+  TIMEIT_END(pbvh_build_mesh);
+
+  BKE_pbvh_free(pbvh);
+  BKE_id_free(nullptr, mesh);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+/* Multires style grids, with coordinates only. */
+static void pbvh_build_grids_test(const int totgrid, const int grid_size)
+{
+  printf("\n========== STARTING %s (%d grids) ==========\n", __func__, totgrid);
+
+  BLI_threadapi_init();
+
+  CCGKey key;
+  memset(&key, 0, sizeof(key));
+  key.elem_size = sizeof(float[3]);
+  key.grid_size = grid_size;
+  key.grid_area = grid_size * grid_size;
+  key.grid_bytes = key.grid_area * key.elem_size;
+
+  CCGElem **grids = (CCGElem **)MEM_mallocN(sizeof(CCGElem *) * totgrid, __func__);
+  void **gridfaces = (void **)MEM_callocN(sizeof(void *) * totgrid, __func__);
+  DMFlagMat *flagmats = (DMFlagMat *)MEM_callocN(sizeof(DMFlagMat) * totgrid, __func__);
+  BLI_bitmap **grid_hidden = (BLI_bitmap **)MEM_callocN(sizeof(BLI_bitmap *) * totgrid,
+                                                        __func__);
+
+  const int row = int(ceilf(sqrtf(float(totgrid))));
+  for (int g = 0; g < totgrid; g++) {
+    float *co = (float *)MEM_mallocN(key.grid_bytes, __func__);
+    grids[g] = (CCGElem *)co;
+    for (int y = 0; y < grid_size; y++) {
+      for (int x = 0; x < grid_size; x++, co += 3) {
+        co[0] = float((g % row) * grid_size + x);
+        co[1] = float((g / row) * grid_size + y);
+        co[2] = 0.0f;
+      }
+    }
+  }
+
+  PBVH *pbvh = BKE_pbvh_new();
+  TIMEIT_START(pbvh_build_grids);
+  BKE_pbvh_build_grids(pbvh, grids, totgrid, &key, gridfaces, flagmats, grid_hidden);
+  TIMEIT_END(pbvh_build_grids);
+
+  BKE_pbvh_free(pbvh);
+  for (int g = 0; g < totgrid; g++) {
+    MEM_freeN(grids[g]);
+  }
+  MEM_freeN(grids);
+  MEM_freeN(gridfaces);
+  MEM_freeN(flagmats);
+  MEM_freeN(grid_hidden);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(pbvh, BuildMesh512)
+{
+  pbvh_build_mesh_test(512);
+}
+
+#ifdef PBVH_RUN_BIG
+TEST(pbvh, BuildMesh3000)
+{
+  pbvh_build_mesh_test(3000);
+}
+#endif
+
+TEST(pbvh, BuildGrids16384)
+{
+  pbvh_build_grids_test(16384, 17);
+}
+
+#ifdef PBVH_RUN_BIG
+TEST(pbvh, BuildGrids262144)
+{
+  pbvh_build_grids_test(262144, 17);
+}
+#endif
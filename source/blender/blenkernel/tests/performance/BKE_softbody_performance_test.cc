@@ -0,0 +1,157 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_softbody.h"
+
+#include "DEG_depsgraph.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "PIL_time_utildefines.h"
+
+#include "tests/BKE_mesh_grid_test_util.hh"
+
+using blender::bke::tests::grid_mesh_create;
+
+/* Run the longest tests! */
+//#define SOFTBODY_RUN_BIG
+
+#define SOFTBODY_FRAMES 10
+
+/* A wavy grid of `size * size` quads with edge and diagonal springs, held by its goal springs and
+ * sagging under gravity. The frames are simulated the same way the soft body modifier does, from
+ * the rest positions of the mesh. */
+static void softbody_grid_test(const int size, const int softflag, const bool use_threads)
+{
+  printf("\n========== STARTING %s (%d points, %s%s) ==========\n",
+         __func__,
+         (size + 1) * (size + 1),
+         (softflag & OB_SB_SELF) ? "self collision, " : "",
+         use_threads ? "threaded" : "single thread");
+
+  BLI_threadapi_init();
+  BLI_system_num_threads_override_set(use_threads ? 0 : 1);
+  BLI_task_scheduler_init();
+  BKE_idtype_init();
+  DEG_register_node_types();
+
+  Scene scene;
+  memset(&scene, 0, sizeof(scene));
+  scene.r.frs_sec = 25;
+  scene.r.frs_sec_base = 1.0f;
+  scene.r.sfra = 1;
+  scene.r.efra = 250;
+  scene.r.framelen = 1.0f;
+  scene.physics_settings.flag = PHYS_GLOBAL_GRAVITY;
+  copy_v3_fl3(scene.physics_settings.gravity, 0.0f, 0.0f, -9.81f);
+  strcpy(scene.id.name, "SCSoftbody");
+
+  Main *bmain = BKE_main_new();
+  Depsgraph *depsgraph = DEG_graph_new(bmain, &scene, nullptr, DAG_EVAL_VIEWPORT);
+  /* Only an active depsgraph writes the point cache, which the simulation steps rely on. */
+  DEG_make_active(depsgraph);
+
+  Mesh *mesh = grid_mesh_create(size, 2.0f / size, 0.1f);
+  const int verts_num = mesh->totvert;
+  float(*vertex_cos)[3] = (float(*)[3])MEM_malloc_arrayN(
+      verts_num, sizeof(*vertex_cos), __func__);
+
+  Object object;
+  memset(&object, 0, sizeof(object));
+  strcpy(object.id.name, "OBSoftbody");
+  object.type = OB_MESH;
+  object.data = mesh;
+  object.softflag = OB_SB_GOAL | OB_SB_EDGES | OB_SB_QUADS | softflag;
+  unit_m4(object.obmat);
+  object.soft = sbNew(&scene);
+
+  /* The first frame only creates the soft body and sets its positions. */
+  scene.r.cfra = 1;
+  BKE_mesh_vert_coords_get(mesh, vertex_cos);
+  sbObjectStep(depsgraph, &scene, &object, 1.0f, vertex_cos, verts_num);
+
+  TIMEIT_START(softbody_step);
+
+  for (int frame = 2; frame <= SOFTBODY_FRAMES; frame++) {
+    scene.r.cfra = frame;
+    BKE_mesh_vert_coords_get(mesh, vertex_cos);
+    sbObjectStep(depsgraph, &scene, &object, float(frame), vertex_cos, verts_num);
+  }
+
+  TIMEIT_END(softbody_step);
+
+  /* The goal springs hold the grid against gravity, it sags but stays finite. */
+  float min_z = FLT_MAX;
+  for (int i = 0; i < verts_num; i++) {
+    EXPECT_TRUE(std::isfinite(vertex_cos[i][0]) && std::isfinite(vertex_cos[i][1]) &&
+                std::isfinite(vertex_cos[i][2]));
+    min_z = min_ff(min_z, vertex_cos[i][2]);
+  }
+  printf("\t%d frames, lowest point at %f\n", SOFTBODY_FRAMES, min_z);
+  EXPECT_LT(min_z, -0.1f);
+  EXPECT_EQ(object.soft->last_frame, SOFTBODY_FRAMES);
+
+  sbFree(&object);
+  MEM_freeN(vertex_cos);
+  BKE_id_free(nullptr, mesh);
+  DEG_graph_free(depsgraph);
+  BKE_main_free(bmain);
+
+  DEG_free_node_types();
+  BLI_task_scheduler_exit();
+  BLI_system_num_threads_override_set(0);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(softbody, GridNoThread100)
+{
+  softbody_grid_test(100, 0, false);
+}
+
+TEST(softbody, Grid100)
+{
+  softbody_grid_test(100, 0, true);
+}
+
+TEST(softbody, GridSelfCollisionNoThread40)
+{
+  softbody_grid_test(40, OB_SB_SELF, false);
+}
+
+TEST(softbody, GridSelfCollision40)
+{
+  softbody_grid_test(40, OB_SB_SELF, true);
+}
+
+#ifdef SOFTBODY_RUN_BIG
+TEST(softbody, GridNoThread300)
+{
+  softbody_grid_test(300, 0, false);
+}
+
+TEST(softbody, Grid300)
+{
+  softbody_grid_test(300, 0, true);
+}
+#endif
@@ -122,21 +122,35 @@ class RandomNumberGenerator {
 
   /**
    * Simulate getting \a n random values.
+   *
+   * \a n steps of the linear congruential generator combine into a single step with another
+   * multiplier and addend, which are computed by repeated squaring in O(log n). This keeps
+   * skipping cheap for threaded code that skips to the start of its range.
    */
   void skip(int64_t n)
   {
-    while (n--) {
-      this->step();
+    uint64_t step_multiplier = multiplier, step_addend = addend;
+    uint64_t skip_multiplier = 1, skip_addend = 0;
+
+    for (; n > 0; n >>= 1) {
+      if (n & 1) {
+        skip_multiplier = (skip_multiplier * step_multiplier) & mask;
+        skip_addend = (skip_addend * step_multiplier + step_addend) & mask;
+      }
+      step_addend = ((step_multiplier + 1) * step_addend) & mask;
+      step_multiplier = (step_multiplier * step_multiplier) & mask;
     }
+
+    x_ = (skip_multiplier * x_ + skip_addend) & mask;
   }
 
  private:
+  static constexpr uint64_t multiplier = 0x5DEECE66Dll;
+  static constexpr uint64_t addend = 0xB;
+  static constexpr uint64_t mask = 0x0000FFFFFFFFFFFFll;
+
   void step()
   {
-    constexpr uint64_t multiplier = 0x5DEECE66Dll;
-    constexpr uint64_t addend = 0xB;
-    constexpr uint64_t mask = 0x0000FFFFFFFFFFFFll;
-
     x_ = (multiplier * x_ + addend) & mask;
   }
 };
@@ -0,0 +1,57 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "BLI_rand.h"
+#include "BLI_rand.hh"
+
+namespace blender::tests {
+
+TEST(rand, SkipMatchesStepping)
+{
+  for (const int64_t n : {0, 1, 2, 3, 7, 64, 1000, 123457}) {
+    RandomNumberGenerator rng_step(42);
+    RandomNumberGenerator rng_skip(42);
+
+    for (int64_t i = 0; i < n; i++) {
+      rng_step.get_uint32();
+    }
+    rng_skip.skip(n);
+
+    EXPECT_EQ(rng_step.get_uint32(), rng_skip.get_uint32());
+  }
+}
+
+TEST(rand, SkipCombines)
+{
+  RandomNumberGenerator rng_a(123);
+  RandomNumberGenerator rng_b(123);
+
+  rng_a.skip(3 * 100000);
+  for (int i = 0; i < 100000; i++) {
+    rng_b.skip(3);
+  }
+
+  EXPECT_EQ(rng_a.get_uint32(), rng_b.get_uint32());
+}
+
+TEST(rand, SkipCAPI)
+{
+  RNG *rng_step = BLI_rng_new(31415926);
+  RNG *rng_skip = BLI_rng_new(31415926);
+
+  float value = 0.0f;
+  for (int i = 0; i < 5000; i++) {
+    value = BLI_rng_get_float(rng_step);
+  }
+  BLI_rng_skip(rng_skip, 4999);
+
+  EXPECT_EQ(value, BLI_rng_get_float(rng_skip));
+
+  EXPECT_EQ(BLI_rng_get_float(rng_step), BLI_rng_get_float(rng_skip));
+
+  BLI_rng_free(rng_step);
+  BLI_rng_free(rng_skip);
+}
+
+}  // namespace blender::tests
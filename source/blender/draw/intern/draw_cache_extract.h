@@ -236,6 +236,16 @@ typedef struct MeshBatchCache {
   bool is_editmode;
   bool is_uvsyncsel;
 
+  /** Hash of the data buffers depend on other than positions, with the lengths above.
+   * Only computed for evaluated meshes, see #DRW_mesh_batch_cache_reuse. */
+  uint32_t topology_hash;
+  bool has_topology_hash;
+  /** Hash of the triangulation, which depends on positions for quads and n-gons. */
+  uint32_t looptri_hash;
+  /** The cache was reused for a new evaluated mesh with its deformation buffers discarded,
+   * the #BKE_MESH_BATCH_DIRTY_ALL tag following that evaluation is ignored. */
+  bool is_deform_update;
+
   struct DRW_MeshWeightState weight_state;
 
   DRW_MeshCDMask cd_used, cd_needed, cd_used_over_time;
@@ -29,6 +29,7 @@
 #include "BLI_bitmap.h"
 #include "BLI_buffer.h"
 #include "BLI_edgehash.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_listbase.h"
 #include "BLI_math_bits.h"
 #include "BLI_math_vector.h"
@@ -69,7 +70,7 @@
 
 #include "draw_cache_impl.h" /* own include */
 
-static void mesh_batch_cache_clear(Mesh *me);
+static void mesh_batch_cache_clear(MeshBatchCache *cache);
 
 /* Return true is all layers in _b_ are inside _a_. */
 BLI_INLINE bool mesh_cd_layers_type_overlap(DRW_MeshCDMask a, DRW_MeshCDMask b)
@@ -474,6 +475,58 @@ static bool mesh_batch_cache_valid(Mesh *me)
   return true;
 }
 
+static void mesh_batch_cache_topology_hash_layers(BLI_HashMurmur2A *mm2,
+                                                  const CustomData *data,
+                                                  const int type,
+                                                  const int len)
+{
+  const size_t elem_size = (size_t)CustomData_sizeof(type);
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+    if (layer->type == type) {
+      BLI_hash_mm2a_add(mm2, (const uchar *)layer->name, strlen(layer->name));
+      BLI_hash_mm2a_add(mm2, layer->data, elem_size * (size_t)len);
+    }
+  }
+}
+
+/**
+ * Identify the data the cached buffers depend on, except vertex positions and normals,
+ * so buffers can be kept when a deformed mesh is evaluated again,
+ * see #DRW_mesh_batch_cache_reuse.
+ */
+static void mesh_batch_cache_topology_hash(Mesh *me, MeshBatchCache *cache)
+{
+  BLI_HashMurmur2A mm2;
+  BLI_hash_mm2a_init(&mm2, (uint32_t)me->totloop);
+
+  BLI_hash_mm2a_add(&mm2, (const uchar *)me->mloop, sizeof(*me->mloop) * (size_t)me->totloop);
+  BLI_hash_mm2a_add(&mm2, (const uchar *)me->mpoly, sizeof(*me->mpoly) * (size_t)me->totpoly);
+  BLI_hash_mm2a_add(&mm2, (const uchar *)me->medge, sizeof(*me->medge) * (size_t)me->totedge);
+  /* Hidden and selected state. */
+  for (int i = 0; i < me->totvert; i++) {
+    BLI_hash_mm2a_add_int(&mm2, me->mvert[i].flag);
+  }
+
+  mesh_batch_cache_topology_hash_layers(&mm2, &me->ldata, CD_MLOOPUV, me->totloop);
+  mesh_batch_cache_topology_hash_layers(&mm2, &me->ldata, CD_MLOOPCOL, me->totloop);
+  mesh_batch_cache_topology_hash_layers(&mm2, &me->vdata, CD_PROP_COLOR, me->totvert);
+
+  cache->vert_len = me->totvert;
+  cache->edge_len = me->totedge;
+  cache->poly_len = me->totpoly;
+  cache->tri_len = poly_to_tri_count(me->totpoly, me->totloop);
+  cache->topology_hash = BLI_hash_mm2a_end(&mm2);
+  cache->has_topology_hash = true;
+
+  /* Triangles are built from the looptris, quads and n-gons are split depending on positions. */
+  const MLoopTri *mlooptri = BKE_mesh_runtime_looptri_ensure(me);
+  const int looptri_len = BKE_mesh_runtime_looptri_len(me);
+  BLI_hash_mm2a_init(&mm2, (uint32_t)looptri_len);
+  BLI_hash_mm2a_add(&mm2, (const uchar *)mlooptri, sizeof(*mlooptri) * (size_t)looptri_len);
+  cache->looptri_hash = BLI_hash_mm2a_end(&mm2);
+}
+
 static void mesh_batch_cache_init(Mesh *me)
 {
   MeshBatchCache *cache = me->runtime.batch_cache;
@@ -487,11 +540,9 @@ static void mesh_batch_cache_init(Mesh *me)
 
   cache->is_editmode = me->edit_mesh != NULL;
 
-  if (cache->is_editmode == false) {
-    // cache->edge_len = mesh_render_edges_len_get(me);
-    // cache->tri_len = mesh_render_looptri_len_get(me);
-    // cache->poly_len = mesh_render_polys_len_get(me);
-    // cache->vert_len = mesh_render_verts_len_get(me);
+  /* Only evaluated meshes are replaced by a new one on every evaluation. */
+  if ((cache->is_editmode == false) && (me->id.tag & LIB_TAG_COPIED_ON_WRITE_EVAL_RESULT)) {
+    mesh_batch_cache_topology_hash(me, cache);
   }
 
   cache->mat_len = mesh_render_mat_len_get(me);
@@ -506,8 +557,11 @@ static void mesh_batch_cache_init(Mesh *me)
 
 void DRW_mesh_batch_cache_validate(Mesh *me)
 {
+  if (me->runtime.batch_cache) {
+    ((MeshBatchCache *)me->runtime.batch_cache)->is_deform_update = false;
+  }
   if (!mesh_batch_cache_valid(me)) {
-    mesh_batch_cache_clear(me);
+    mesh_batch_cache_clear(me->runtime.batch_cache);
     mesh_batch_cache_init(me);
   }
 }
@@ -669,6 +723,11 @@ void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
       cache->batch_ready &= ~(MBC_SURFACE | MBC_WIRE_EDGES | MBC_WIRE_LOOPS);
       break;
     case BKE_MESH_BATCH_DIRTY_ALL:
+      /* The evaluation reusing the cache already discarded what changed. */
+      if (cache->is_deform_update) {
+        cache->is_deform_update = false;
+        break;
+      }
       cache->is_dirty = true;
       break;
     case BKE_MESH_BATCH_DIRTY_SHADING:
@@ -696,9 +755,8 @@ void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
   }
 }
 
-static void mesh_batch_cache_clear(Mesh *me)
+static void mesh_batch_cache_clear(MeshBatchCache *cache)
 {
-  MeshBatchCache *cache = me->runtime.batch_cache;
   if (!cache) {
     return;
   }
@@ -728,10 +786,76 @@ static void mesh_batch_cache_clear(Mesh *me)
 
 void DRW_mesh_batch_cache_free(Mesh *me)
 {
-  mesh_batch_cache_clear(me);
+  mesh_batch_cache_clear(me->runtime.batch_cache);
   MEM_SAFE_FREE(me->runtime.batch_cache);
 }
 
+/**
+ * Discard everything depending on vertex positions, keeping index buffers
+ * and the UV and color buffers. Index buffers built from the looptris are kept
+ * only when \a looptri_changed is false.
+ */
+static void mesh_batch_cache_discard_deform(MeshBatchCache *cache, const bool looptri_changed)
+{
+  FOREACH_MESH_BUFFER_CACHE (cache, mbufcache) {
+    GPUVertBuf **vbos = (GPUVertBuf **)&mbufcache->vbo;
+    for (int i = 0; i < sizeof(mbufcache->vbo) / sizeof(void *); i++) {
+      if (!ELEM(&vbos[i], &mbufcache->vbo.uv, &mbufcache->vbo.vcol)) {
+        GPU_VERTBUF_DISCARD_SAFE(vbos[i]);
+      }
+    }
+    if (looptri_changed) {
+      GPU_INDEXBUF_DISCARD_SAFE(mbufcache->ibo.tris);
+      GPU_INDEXBUF_DISCARD_SAFE(mbufcache->ibo.lines_adjacency);
+      GPU_INDEXBUF_DISCARD_SAFE(mbufcache->ibo.edituv_tris);
+    }
+  }
+  /* Batches reference the discarded buffers, they are cheap to recreate. */
+  for (int i = 0; i < sizeof(cache->batch) / sizeof(void *); i++) {
+    GPUBatch **batch = (GPUBatch **)&cache->batch;
+    GPU_BATCH_DISCARD_SAFE(batch[i]);
+  }
+  mesh_batch_cache_discard_surface_batches(cache);
+
+  cache->batch_ready = 0;
+  cache->tot_area = 0.0f;
+  cache->tot_uv_area = 0.0f;
+
+  drw_mesh_weight_state_clear(&cache->weight_state);
+}
+
+/**
+ * Transfer \a batch_cache, detached from the previous evaluated mesh of the same object,
+ * to \a me. When the topology and the UV & color layers match, only buffers depending on
+ * vertex positions (and triangle index buffers when the triangulation changed) are extracted
+ * again for deforming meshes. Otherwise the cache is freed.
+ */
+void DRW_mesh_batch_cache_reuse(Mesh *me, void *batch_cache)
+{
+  MeshBatchCache *cache = batch_cache;
+
+  if ((me != NULL) && (me->runtime.batch_cache == NULL) && (me->edit_mesh == NULL) &&
+      !cache->is_editmode && !cache->is_dirty && cache->has_topology_hash &&
+      (cache->mat_len == mesh_render_mat_len_get(me))) {
+    const int vert_len = cache->vert_len, edge_len = cache->edge_len;
+    const int poly_len = cache->poly_len, tri_len = cache->tri_len;
+    const uint32_t topology_hash = cache->topology_hash;
+    const uint32_t looptri_hash = cache->looptri_hash;
+    mesh_batch_cache_topology_hash(me, cache);
+    if ((cache->vert_len == vert_len) && (cache->edge_len == edge_len) &&
+        (cache->poly_len == poly_len) && (cache->tri_len == tri_len) &&
+        (cache->topology_hash == topology_hash)) {
+      mesh_batch_cache_discard_deform(cache, cache->looptri_hash != looptri_hash);
+      cache->is_deform_update = true;
+      me->runtime.batch_cache = cache;
+      return;
+    }
+  }
+
+  mesh_batch_cache_clear(cache);
+  MEM_freeN(cache);
+}
+
 /** \} */
 
 /* ---------------------------------------------------------------------- */
@@ -2652,6 +2652,7 @@ void DRW_engines_register(void)
 
     BKE_mesh_batch_cache_dirty_tag_cb = DRW_mesh_batch_cache_dirty_tag;
     BKE_mesh_batch_cache_free_cb = DRW_mesh_batch_cache_free;
+    BKE_mesh_batch_cache_reuse_cb = DRW_mesh_batch_cache_reuse;
 
     BKE_lattice_batch_cache_dirty_tag_cb = DRW_lattice_batch_cache_dirty_tag;
     BKE_lattice_batch_cache_free_cb = DRW_lattice_batch_cache_free;
@@ -2710,6 +2711,8 @@ void DRW_engines_free(void)
   if (DST.draw_list) {
     GPU_draw_list_discard(DST.draw_list);
   }
+  MEM_SAFE_FREE(DST.draw_group);
+  DST.draw_group_alloc = 0;
 
   DRW_opengl_context_disable();
 }
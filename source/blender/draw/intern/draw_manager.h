@@ -563,6 +563,9 @@ typedef struct DRWManager {
   TicketMutex *gl_context_mutex;
 
   GPUDrawList *draw_list;
+  /** Draw calls of a shading group waiting to be grouped by batch, see #draw_call_group_add. */
+  struct DRWDrawGroupItem *draw_group;
+  uint draw_group_len, draw_group_alloc;
 
   struct {
     /* TODO(fclem) optimize: use chunks. */
@@ -70,6 +70,8 @@ typedef struct DRWCommandsState {
   /* Drawing State */
   DRWState drw_state_enabled;
   DRWState drw_state_disabled;
+  /* Draw calls can be reordered, see #draw_call_group_add. */
+  bool use_grouping;
 } DRWCommandsState;
 
 /* -------------------------------------------------------------------- */
@@ -831,9 +833,106 @@ static void draw_call_batching_do(DRWShadingGroup *shgroup,
   }
 }
 
+/**
+ * Draw calls are merged by #draw_call_batching_do only when they use the same batch as the
+ * previous one. Instances of the same geometry (e.g. dupli-objects sharing a mesh) are often
+ * interleaved with other geometry, so consecutive draw calls are gathered and sorted by
+ * resource chunk and batch first, to be submitted as one multi-draw per batch.
+ *
+ * Only valid when the drawing order doesn't change the result, see #draw_call_group_allowed.
+ */
+typedef struct DRWDrawGroupItem {
+  DRWCommandDraw *call;
+  /** Position of the call in the shading group. */
+  uint order;
+  /** Position of the first call using the same batch, batches are sorted by it. */
+  uint batch_order;
+} DRWDrawGroupItem;
+
+/* With depth writes and a strict depth test, the nearest fragment wins regardless of the drawing
+ * order, except for fragments at the exact same depth (where the first one drawn wins). */
+static bool draw_call_group_allowed(DRWState state)
+{
+  if (state & (DRW_STATE_BLEND_ENABLED | DRW_STATE_WRITE_STENCIL_ENABLED)) {
+    return false;
+  }
+  return (state & DRW_STATE_WRITE_DEPTH) &&
+         ((state & DRW_STATE_DEPTH_TEST_ENABLED) == DRW_STATE_DEPTH_LESS);
+}
+
+static void draw_call_group_add(DRWCommandDraw *call)
+{
+  if (DST.draw_group_len == DST.draw_group_alloc) {
+    DST.draw_group_alloc = max_ii(DRW_DRAWLIST_LEN, (int)DST.draw_group_alloc * 2);
+    DST.draw_group = MEM_reallocN(DST.draw_group,
+                                  sizeof(*DST.draw_group) * DST.draw_group_alloc);
+  }
+  DRWDrawGroupItem *item = &DST.draw_group[DST.draw_group_len];
+  item->call = call;
+  item->order = DST.draw_group_len++;
+}
+
+/* Only used to find calls sharing a batch, the resulting order is never used for drawing. */
+static int draw_call_group_batch_cmp(const void *a_, const void *b_)
+{
+  const DRWDrawGroupItem *a = a_;
+  const DRWDrawGroupItem *b = b_;
+
+  if (a->call->batch != b->call->batch) {
+    return ((uintptr_t)a->call->batch < (uintptr_t)b->call->batch) ? -1 : 1;
+  }
+  return (a->order < b->order) ? -1 : (a->order > b->order);
+}
+
+static int draw_call_group_cmp(const void *a_, const void *b_)
+{
+  const DRWDrawGroupItem *a = a_;
+  const DRWDrawGroupItem *b = b_;
+  const uint32_t chunk_a = DRW_handle_chunk_get(&a->call->handle);
+  const uint32_t chunk_b = DRW_handle_chunk_get(&b->call->handle);
+  const uint32_t neg_a = DRW_handle_negative_scale_get(&a->call->handle);
+  const uint32_t neg_b = DRW_handle_negative_scale_get(&b->call->handle);
+
+  if (chunk_a != chunk_b) {
+    return (chunk_a < chunk_b) ? -1 : 1;
+  }
+  if (neg_a != neg_b) {
+    return (neg_a < neg_b) ? -1 : 1;
+  }
+  if (a->batch_order != b->batch_order) {
+    return (a->batch_order < b->batch_order) ? -1 : 1;
+  }
+  return (a->order < b->order) ? -1 : (a->order > b->order);
+}
+
+static void draw_call_group_flush(DRWShadingGroup *shgroup, DRWCommandsState *state)
+{
+  const uint len = DST.draw_group_len;
+  DRWDrawGroupItem *items = DST.draw_group;
+
+  if (len == 0) {
+    return;
+  }
+  if (len > 1) {
+    /* Key batches on the order they are first used in, so the drawing order only depends on the
+     * order of the calls and not on where batches happen to be allocated. */
+    qsort(items, len, sizeof(*items), draw_call_group_batch_cmp);
+    for (uint i = 0; i < len; i++) {
+      const bool is_first = (i == 0) || (items[i].call->batch != items[i - 1].call->batch);
+      items[i].batch_order = is_first ? items[i].order : items[i - 1].batch_order;
+    }
+    qsort(items, len, sizeof(*items), draw_call_group_cmp);
+  }
+  for (uint i = 0; i < len; i++) {
+    draw_call_batching_do(shgroup, state, items[i].call);
+  }
+  DST.draw_group_len = 0;
+}
+
 /* Flush remaining pending drawcalls. */
 static void draw_call_batching_finish(DRWShadingGroup *shgroup, DRWCommandsState *state)
 {
+  draw_call_group_flush(shgroup, state);
   draw_call_batching_flush(shgroup, state);
 
   /* Reset state */
@@ -896,8 +995,16 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
 
     draw_call_batching_start(&state);
 
+    state.use_grouping = USE_BATCHING && (state.obmats_loc != -1) &&
+                         !(G.f & G_FLAG_PICKSEL) && draw_call_group_allowed(DST.state);
+
     while ((cmd = draw_command_iter_step(&iter, &cmd_type))) {
 
+      /* Commands other than regular draw calls must see the grouped calls as drawn. */
+      if (cmd_type != DRW_CMD_DRAW) {
+        draw_call_group_flush(shgroup, &state);
+      }
+
       switch (cmd_type) {
         case DRW_CMD_DRWSTATE:
         case DRW_CMD_STENCIL:
@@ -929,6 +1036,7 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
           state.drw_state_enabled |= cmd->state.enable;
           state.drw_state_disabled |= cmd->state.disable;
           drw_state_set((pass_state & ~state.drw_state_disabled) | state.drw_state_enabled);
+          state.use_grouping = state.use_grouping && draw_call_group_allowed(DST.state);
           break;
         case DRW_CMD_STENCIL:
           drw_stencil_state_set(cmd->stencil.write_mask, cmd->stencil.ref, cmd->stencil.comp_mask);
@@ -940,9 +1048,13 @@ static void draw_shgroup(DRWShadingGroup *shgroup, DRWState pass_state)
         case DRW_CMD_DRAW:
           if (!USE_BATCHING || state.obmats_loc == -1 || (G.f & G_FLAG_PICKSEL) ||
               cmd->draw.batch->inst[0]) {
+            draw_call_group_flush(shgroup, &state);
             draw_call_single_do(
                 shgroup, &state, cmd->draw.batch, cmd->draw.handle, 0, 0, 0, 0, true);
           }
+          else if (state.use_grouping) {
+            draw_call_group_add(&cmd->draw);
+          }
           else {
             draw_call_batching_do(shgroup, &state, &cmd->draw);
           }
@@ -592,6 +592,12 @@ typedef struct SculptUndoNode {
   /* Sculpt Face Sets */
   int *face_sets;
 
+  /* Vertex arrays compressed once the undo step is finished, NULL otherwise. */
+  void *compressed;
+  size_t compressed_size;
+  /* Flags of the arrays stored in the compressed buffer. */
+  int compressed_arrays;
+
   size_t undo_size;
 } SculptUndoNode;
 
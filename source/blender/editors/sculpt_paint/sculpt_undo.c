@@ -24,6 +24,8 @@
 
 #include <stddef.h>
 
+#include "zlib.h"
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_ghash.h"
@@ -45,6 +47,7 @@
 #include "BKE_customdata.h"
 #include "BKE_global.h"
 #include "BKE_key.h"
+#include "BKE_lib_id.h"
 #include "BKE_main.h"
 #include "BKE_mesh.h"
 #include "BKE_multires.h"
@@ -107,15 +110,25 @@
  * does modifications on it.
  *
  * End of dynamic topology and symmetrize in this mode are handled in a special
- * manner as well. */
+ * manner as well.
+ *
+ * Once a step is finished, COORDS, MASK and COLOR nodes drop the vertices the
+ * operation didn't change and their arrays are compressed in a background task.
+ * They're decompressed again for as long as the step is being undone or redone. */
 
 typedef struct UndoSculpt {
   ListBase nodes;
 
+  /* Compression of the nodes once the step is finished, NULL when done. */
+  struct TaskPool *compress_pool;
+  /* Nodes are no longer used for original data of an operation in progress. */
+  bool is_finished;
+
   size_t undo_size;
 } UndoSculpt;
 
 static UndoSculpt *sculpt_undo_get_nodes(void);
+static UndoSculpt *sculpt_undosys_step_get_nodes(UndoStep *us_p);
 
 static void update_cb(PBVHNode *node, void *rebuild)
 {
@@ -872,6 +885,9 @@ static void sculpt_undo_free_list(ListBase *lb)
     if (unode->face_sets) {
       MEM_freeN(unode->face_sets);
     }
+    if (unode->compressed) {
+      MEM_freeN(unode->compressed);
+    }
 
     MEM_freeN(unode);
 
@@ -902,11 +918,351 @@ static bool sculpt_undo_cleanup(bContext *C, ListBase *lb)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Undo Node Compression
+ *
+ * Finished steps are only read back on undo and redo, so their vertex arrays are stored
+ * compressed. Restoring swaps values between the node and the mesh, which leaves vertices
+ * that hold the same value in both untouched, so those are dropped first.
+ *
+ * Compression is lossless: the values have to be restored exactly. Vertex indices are
+ * stored as differences to the previous index and all arrays are split into byte planes,
+ * which groups the similar high bytes of nearby coordinates for zlib.
+ * \{ */
+
+enum {
+  SCULPT_UNDO_ARRAY_INDEX = 0,
+  SCULPT_UNDO_ARRAY_CO,
+  SCULPT_UNDO_ARRAY_ORIG_CO,
+  SCULPT_UNDO_ARRAY_MASK,
+  SCULPT_UNDO_ARRAY_COL,
+  SCULPT_UNDO_ARRAY_TOT,
+};
+
+static const size_t sculpt_undo_array_elem_size[SCULPT_UNDO_ARRAY_TOT] = {
+    sizeof(int),
+    sizeof(float[3]),
+    sizeof(float[3]),
+    sizeof(float),
+    sizeof(float[4]),
+};
+
+static void **sculpt_undo_node_array_p(SculptUndoNode *unode, const int array)
+{
+  switch (array) {
+    case SCULPT_UNDO_ARRAY_INDEX:
+      return (void **)&unode->index;
+    case SCULPT_UNDO_ARRAY_CO:
+      return (void **)&unode->co;
+    case SCULPT_UNDO_ARRAY_ORIG_CO:
+      return (void **)&unode->orig_co;
+    case SCULPT_UNDO_ARRAY_MASK:
+      return (void **)&unode->mask;
+    case SCULPT_UNDO_ARRAY_COL:
+      return (void **)&unode->col;
+  }
+  BLI_assert(0);
+  return NULL;
+}
+
+static size_t sculpt_undo_node_arrays_size(SculptUndoNode *unode)
+{
+  if (unode->compressed) {
+    return unode->compressed_size;
+  }
+
+  size_t size = 0;
+  for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+    if (*sculpt_undo_node_array_p(unode, array)) {
+      size += sculpt_undo_array_elem_size[array] * (size_t)unode->totvert;
+    }
+  }
+  return size;
+}
+
+static bool sculpt_undo_node_vert_changed(const SculptUndoNode *unode,
+                                          const SculptSession *ss,
+                                          const int i)
+{
+  const int vertex = unode->index[i];
+  switch (unode->type) {
+    case SCULPT_UNDO_COORDS:
+      return memcmp(unode->co[i], ss->mvert[vertex].co, sizeof(float[3])) != 0;
+    case SCULPT_UNDO_MASK:
+      return unode->mask[i] != ss->vmask[vertex];
+    case SCULPT_UNDO_COLOR:
+      return memcmp(unode->col[i], ss->vcol[vertex].color, sizeof(float[4])) != 0;
+    default:
+      return true;
+  }
+}
+
+/* Remove the vertices the finished operation didn't change from a regular mesh node. */
+static void sculpt_undo_node_drop_unchanged(SculptUndoNode *unode, const SculptSession *ss)
+{
+  if (!ELEM(unode->type, SCULPT_UNDO_COORDS, SCULPT_UNDO_MASK, SCULPT_UNDO_COLOR)) {
+    return;
+  }
+  /* Deformed and shape key coordinates aren't restored from the mesh vertices,
+   * keep those nodes as they are. */
+  if (unode->maxvert == 0 || unode->maxvert != ss->totvert || unode->orig_co ||
+      ss->shapekey_active || ss->bm) {
+    return;
+  }
+  if ((unode->type == SCULPT_UNDO_MASK && ss->vmask == NULL) ||
+      (unode->type == SCULPT_UNDO_COLOR && ss->vcol == NULL)) {
+    return;
+  }
+
+  int totvert = 0;
+  for (int i = 0; i < unode->totvert; i++) {
+    if (!sculpt_undo_node_vert_changed(unode, ss, i)) {
+      continue;
+    }
+    unode->index[totvert] = unode->index[i];
+    if (unode->co) {
+      copy_v3_v3(unode->co[totvert], unode->co[i]);
+    }
+    if (unode->mask) {
+      unode->mask[totvert] = unode->mask[i];
+    }
+    if (unode->col) {
+      copy_v4_v4(unode->col[totvert], unode->col[i]);
+    }
+    totvert++;
+  }
+  unode->totvert = totvert;
+
+  if (totvert == 0) {
+    for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+      void **array_p = sculpt_undo_node_array_p(unode, array);
+      MEM_SAFE_FREE(*array_p);
+    }
+  }
+}
+
+static void sculpt_undo_node_compress(SculptUndoNode *unode)
+{
+  BLI_assert(unode->compressed == NULL);
+
+  int arrays = 0;
+  size_t words_len = 0;
+  for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+    if (*sculpt_undo_node_array_p(unode, array)) {
+      arrays |= (1 << array);
+      words_len += sculpt_undo_array_elem_size[array] / sizeof(uint) * (size_t)unode->totvert;
+    }
+  }
+  if (words_len == 0) {
+    return;
+  }
+
+  uint *words = MEM_mallocN(sizeof(uint) * words_len, __func__);
+  uint *word = words;
+  for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+    if ((arrays & (1 << array)) == 0) {
+      continue;
+    }
+    const size_t array_words_len = sculpt_undo_array_elem_size[array] / sizeof(uint) *
+                                   (size_t)unode->totvert;
+    if (array == SCULPT_UNDO_ARRAY_INDEX) {
+      int index_prev = 0;
+      for (int i = 0; i < unode->totvert; i++) {
+        word[i] = (uint)(unode->index[i] - index_prev);
+        index_prev = unode->index[i];
+      }
+    }
+    else {
+      memcpy(word, *sculpt_undo_node_array_p(unode, array), sizeof(uint) * array_words_len);
+    }
+    word += array_words_len;
+  }
+
+  const size_t planes_size = sizeof(uint) * words_len;
+  uchar *planes = MEM_mallocN(planes_size, __func__);
+  for (size_t i = 0; i < words_len; i++) {
+    for (int byte = 0; byte < 4; byte++) {
+      planes[(size_t)byte * words_len + i] = (uchar)(words[i] >> (byte * 8));
+    }
+  }
+  MEM_freeN(words);
+
+  uLongf compressed_size = compressBound(planes_size);
+  void *compressed = MEM_mallocN(compressed_size, __func__);
+  const int error = compress2(compressed, &compressed_size, planes, planes_size, Z_BEST_SPEED);
+  MEM_freeN(planes);
+
+  if (error != Z_OK || compressed_size >= planes_size) {
+    /* Keep the arrays as they are. */
+    MEM_freeN(compressed);
+    return;
+  }
+
+  for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+    void **array_p = sculpt_undo_node_array_p(unode, array);
+    MEM_SAFE_FREE(*array_p);
+  }
+  unode->compressed = MEM_reallocN(compressed, compressed_size);
+  unode->compressed_size = compressed_size;
+  unode->compressed_arrays = arrays;
+}
+
+static void sculpt_undo_node_decompress(SculptUndoNode *unode)
+{
+  if (unode->compressed == NULL) {
+    return;
+  }
+
+  size_t words_len = 0;
+  for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+    if (unode->compressed_arrays & (1 << array)) {
+      words_len += sculpt_undo_array_elem_size[array] / sizeof(uint) * (size_t)unode->totvert;
+    }
+  }
+
+  uLongf planes_size = sizeof(uint) * words_len;
+  uchar *planes = MEM_mallocN(planes_size, __func__);
+  const int error = uncompress(planes, &planes_size, unode->compressed, unode->compressed_size);
+  BLI_assert(error == Z_OK && planes_size == sizeof(uint) * words_len);
+  UNUSED_VARS_NDEBUG(error);
+
+  uint *words = MEM_mallocN(sizeof(uint) * words_len, __func__);
+  for (size_t i = 0; i < words_len; i++) {
+    uint value = 0;
+    for (int byte = 0; byte < 4; byte++) {
+      value |= (uint)planes[(size_t)byte * words_len + i] << (byte * 8);
+    }
+    words[i] = value;
+  }
+  MEM_freeN(planes);
+
+  const uint *word = words;
+  for (int array = 0; array < SCULPT_UNDO_ARRAY_TOT; array++) {
+    if ((unode->compressed_arrays & (1 << array)) == 0) {
+      continue;
+    }
+    const size_t array_words_len = sculpt_undo_array_elem_size[array] / sizeof(uint) *
+                                   (size_t)unode->totvert;
+    void *data = MEM_mallocN(sizeof(uint) * array_words_len, __func__);
+    if (array == SCULPT_UNDO_ARRAY_INDEX) {
+      int *index = data;
+      int index_prev = 0;
+      for (int i = 0; i < unode->totvert; i++) {
+        index[i] = index_prev + (int)word[i];
+        index_prev = index[i];
+      }
+    }
+    else {
+      memcpy(data, word, sizeof(uint) * array_words_len);
+    }
+    *sculpt_undo_node_array_p(unode, array) = data;
+    word += array_words_len;
+  }
+  MEM_freeN(words);
+
+  MEM_freeN(unode->compressed);
+  unode->compressed = NULL;
+  unode->compressed_size = 0;
+  unode->compressed_arrays = 0;
+}
+
+static void sculpt_undo_node_compress_task_cb(TaskPool *__restrict UNUSED(pool), void *taskdata)
+{
+  sculpt_undo_node_compress(taskdata);
+}
+
+/* Start compressing the nodes of a finished step in the background. */
+static void sculpt_undo_compress_begin(UndoSculpt *usculpt)
+{
+  BLI_assert(usculpt->compress_pool == NULL);
+  usculpt->is_finished = true;
+  usculpt->compress_pool = BLI_task_pool_create_background(NULL, TASK_PRIORITY_LOW);
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    if (unode->totvert) {
+      BLI_task_pool_push(
+          usculpt->compress_pool, sculpt_undo_node_compress_task_cb, unode, false, NULL);
+    }
+  }
+}
+
+/* Wait for the compression to finish, the nodes can't be accessed before that. */
+static void sculpt_undo_compress_end(UndoSculpt *usculpt)
+{
+  if (usculpt->compress_pool == NULL) {
+    return;
+  }
+  BLI_task_pool_work_and_wait(usculpt->compress_pool);
+  BLI_task_pool_free(usculpt->compress_pool);
+  usculpt->compress_pool = NULL;
+
+  usculpt->undo_size = 0;
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    usculpt->undo_size += sculpt_undo_node_arrays_size(unode);
+  }
+}
+
+static void sculpt_undo_node_decompress_task_cb(void *__restrict UNUSED(userdata),
+                                                void *item,
+                                                int UNUSED(index),
+                                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  sculpt_undo_node_decompress(item);
+}
+
+static void sculpt_undo_decompress(UndoSculpt *usculpt)
+{
+  sculpt_undo_compress_end(usculpt);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_listbase(
+      &usculpt->nodes, NULL, sculpt_undo_node_decompress_task_cb, &settings);
+}
+
+/* Drop unchanged vertices of a step that was just finished and start compressing it. */
+static void sculpt_undo_finish(UndoSculpt *usculpt)
+{
+  Object *ob = NULL;
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    if (ob == NULL || !STREQ(ob->id.name, unode->idname)) {
+      ob = (Object *)BKE_libblock_find_name(G_MAIN, ID_OB, unode->idname + 2);
+    }
+    if (ob && ob->sculpt) {
+      sculpt_undo_node_drop_unchanged(unode, ob->sculpt);
+    }
+  }
+
+  usculpt->undo_size = 0;
+  LISTBASE_FOREACH (SculptUndoNode *, unode, &usculpt->nodes) {
+    usculpt->undo_size += sculpt_undo_node_arrays_size(unode);
+  }
+
+  sculpt_undo_compress_begin(usculpt);
+}
+
+/* Account for the compressed size of earlier steps before the undo memory limit is applied.
+ * Their compression had a whole operation to finish, so this doesn't wait in practice. */
+static void sculpt_undo_compress_end_all(UndoStack *ustack)
+{
+  LISTBASE_FOREACH (UndoStep *, us, &ustack->steps) {
+    if (us->type != BKE_UNDOSYS_TYPE_SCULPT || us == ustack->step_active) {
+      continue;
+    }
+    UndoSculpt *usculpt = sculpt_undosys_step_get_nodes(us);
+    if (usculpt->compress_pool) {
+      sculpt_undo_compress_end(usculpt);
+      us->data_size = usculpt->undo_size;
+    }
+  }
+}
+
+/** \} */
+
 SculptUndoNode *SCULPT_undo_get_node(PBVHNode *node)
 {
   UndoSculpt *usculpt = sculpt_undo_get_nodes();
 
-  if (usculpt == NULL) {
+  if (usculpt == NULL || usculpt->is_finished) {
     return NULL;
   }
 
@@ -917,7 +1273,7 @@ SculptUndoNode *SCULPT_undo_get_first_node()
 {
   UndoSculpt *usculpt = sculpt_undo_get_nodes();
 
-  if (usculpt == NULL) {
+  if (usculpt == NULL || usculpt->is_finished) {
     return NULL;
   }
 
@@ -1372,8 +1728,10 @@ void SCULPT_undo_push_end_ex(const bool use_nested_undo)
   wmWindowManager *wm = G_MAIN->wm.first;
   if (wm->op_undo_depth == 0 || use_nested_undo) {
     UndoStack *ustack = ED_undo_stack_get();
+    sculpt_undo_finish(usculpt);
     BKE_undosys_step_push(ustack, NULL, NULL);
     if (wm->op_undo_depth == 0) {
+      sculpt_undo_compress_end_all(ustack);
       BKE_undosys_stack_limit_steps_and_memory_defaults(ustack);
     }
     WM_file_tag_modified();
@@ -1424,7 +1782,9 @@ static void sculpt_undosys_step_decode_undo_impl(struct bContext *C,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == true);
+  sculpt_undo_decompress(&us->data);
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
+  sculpt_undo_compress_begin(&us->data);
   us->step.is_applied = false;
 }
 
@@ -1433,7 +1793,9 @@ static void sculpt_undosys_step_decode_redo_impl(struct bContext *C,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == false);
+  sculpt_undo_decompress(&us->data);
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
+  sculpt_undo_compress_begin(&us->data);
   us->step.is_applied = true;
 }
 
@@ -1522,6 +1884,7 @@ static void sculpt_undosys_step_decode(
 static void sculpt_undosys_step_free(UndoStep *us_p)
 {
   SculptUndoStep *us = (SculptUndoStep *)us_p;
+  sculpt_undo_compress_end(&us->data);
   sculpt_undo_free_list(&us->data.nodes);
 }
 
@@ -155,6 +155,8 @@ typedef struct PointCache {
 #define PTCACHE_IGNORE_CLEAR (1 << 13)
 
 #define PTCACHE_FLAG_INFO_DIRTY (1 << 14)
+/* Disk cache frames are stored in one indexed file. */
+#define PTCACHE_SINGLE_FILE (1 << 15)
 
 /* PTCACHE_OUTDATED + PTCACHE_FRAMES_SKIPPED */
 #define PTCACHE_REDO_NEEDED 258
@@ -943,6 +943,16 @@ static void rna_def_rigidbody_world(BlenderRNA *brna)
       "stability a little so use only when necessary)");
   RNA_def_property_update(prop, NC_SCENE, "rna_RigidBodyWorld_reset");
 
+  /* multi-threading */
+  prop = RNA_def_property(srna, "use_threads", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", RBW_FLAG_USE_THREADS);
+  RNA_def_property_ui_text(
+      prop,
+      "Multi-Threaded",
+      "Step the simulation on multiple threads (results are only reproducible with the same "
+      "number of threads, takes effect when the simulation is restarted)");
+  RNA_def_property_update(prop, NC_SCENE, "rna_RigidBodyWorld_reset");
+
   /* cache */
   prop = RNA_def_property(srna, "point_cache", PROP_POINTER, PROP_NONE);
   RNA_def_property_flag(prop, PROP_NEVER_NULL);
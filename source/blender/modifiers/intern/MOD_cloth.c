@@ -101,8 +101,9 @@ static void deformVerts(ModifierData *md,
   }
   else {
     /* Not possible to use get_mesh() in this case as we'll modify its vertices
-     * and get_mesh() would return 'mesh' directly. */
-    BKE_id_copy_ex(NULL, (ID *)mesh, (ID **)&mesh_src, LIB_ID_COPY_LOCALIZE);
+     * and get_mesh() would return 'mesh' directly. Other layers are only read,
+     * so they are shared with 'mesh' instead of copied. */
+    mesh_src = BKE_mesh_copy_for_eval(mesh, true);
   }
 
   /* TODO(sergey): For now it actually duplicates logic from DerivedMesh.c
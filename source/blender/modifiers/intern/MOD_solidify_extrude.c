@@ -22,6 +22,7 @@
 
 #include "BLI_bitmap.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines_stack.h"
 
 #include "DNA_mesh_types.h"
@@ -55,6 +56,122 @@ BLI_INLINE void madd_v3v3short_fl(float r[3], const short a[3], const float f)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Parallel Vertex Loops
+ *
+ * Per vertex passes which only write to their own vertex.
+ * \{ */
+
+typedef struct SolidifyNormalizeData {
+  float (*vert_nors)[3];
+  const MVert *mvert;
+} SolidifyNormalizeData;
+
+static void solidify_normalize_cb(void *__restrict userdata,
+                                  const int i,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyNormalizeData *data = userdata;
+  if (normalize_v3(data->vert_nors[i]) == 0.0f) {
+    normal_short_to_float_v3(data->vert_nors[i], data->mvert[i].no);
+  }
+}
+
+/** Offset along the (short) vertex normals, used when even thickness is disabled. */
+typedef struct SolidifyOffsetData {
+  /** First vertex to offset, either the original or the copied vertices. */
+  MVert *mvert;
+  const uint *new_vert_arr;
+  bool do_shell_align;
+  /** Offset for the original side (uses a different angle clamp). */
+  bool is_orig;
+
+  const MDeformVert *dvert;
+  int defgrp_index;
+  bool defgrp_invert;
+  float offset_fac_vg;
+  float offset_fac_vg_inv;
+
+  float scalar_short;
+  bool do_clamp;
+  bool do_angle_clamp;
+  float offset;
+  float offset_sq;
+  const float *vert_lens;
+  const float *vert_angs;
+} SolidifyOffsetData;
+
+static void solidify_offset_cb(void *__restrict userdata,
+                               const int index,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyOffsetData *data = userdata;
+  const uint i_orig = (uint)index;
+  const uint i = data->do_shell_align ? i_orig : data->new_vert_arr[i_orig];
+  MVert *mv = &data->mvert[i_orig];
+  float scalar_short_vgroup = data->scalar_short;
+
+  if (data->dvert) {
+    const MDeformVert *dv = &data->dvert[i];
+    if (data->defgrp_invert) {
+      scalar_short_vgroup = 1.0f - BKE_defvert_find_weight(dv, data->defgrp_index);
+    }
+    else {
+      scalar_short_vgroup = BKE_defvert_find_weight(dv, data->defgrp_index);
+    }
+    scalar_short_vgroup = (data->offset_fac_vg + (scalar_short_vgroup * data->offset_fac_vg_inv)) *
+                          data->scalar_short;
+  }
+  if (data->do_clamp && data->offset > FLT_EPSILON) {
+    const float offset = data->offset;
+    if (data->do_angle_clamp) {
+      const float cos_ang = data->is_orig ? cosf(data->vert_angs[i_orig] * 0.5f) :
+                                            cosf(((2 * M_PI) - data->vert_angs[i]) * 0.5f);
+      if (cos_ang > 0) {
+        float max_off = sqrtf(data->vert_lens[i]) * 0.5f / cos_ang;
+        if (max_off < offset * 0.5f) {
+          scalar_short_vgroup *= max_off / offset * 2;
+        }
+      }
+    }
+    else {
+      if (data->vert_lens[i] < data->offset_sq) {
+        float scalar = sqrtf(data->vert_lens[i]) / offset;
+        scalar_short_vgroup *= scalar;
+      }
+    }
+  }
+  madd_v3v3short_fl(mv->co, mv->no, scalar_short_vgroup);
+}
+
+/** Offset along the accumulated vertex normals, used for even thickness. */
+typedef struct SolidifyEvenOffsetData {
+  MVert *mvert;
+  const uint *new_vert_arr;
+  bool do_shell_align;
+  float ofs;
+
+  const float (*vert_nors)[3];
+  const float *vert_angles;
+  const float *vert_accum;
+} SolidifyEvenOffsetData;
+
+static void solidify_even_offset_cb(void *__restrict userdata,
+                                    const int index,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const SolidifyEvenOffsetData *data = userdata;
+  const uint i_orig = (uint)index;
+  const uint i_other = data->do_shell_align ? i_orig : data->new_vert_arr[i_orig];
+  if (data->vert_accum[i_other]) { /* zero if unselected */
+    madd_v3_v3fl(data->mvert[i_orig].co,
+                 data->vert_nors[i_other],
+                 data->ofs * (data->vert_angles[i_other] / data->vert_accum[i_other]));
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name High Quality Normal Calculation Function
  * \{ */
@@ -86,7 +203,7 @@ static void mesh_calc_hq_normal(Mesh *mesh, float (*poly_nors)[3], float (*r_ver
   MPoly *mpoly, *mp;
   MLoop *mloop, *ml;
   MEdge *medge, *ed;
-  MVert *mvert, *mv;
+  MVert *mvert;
 
   numVerts = mesh->totvert;
   numEdges = mesh->totedge;
@@ -104,7 +221,6 @@ static void mesh_calc_hq_normal(Mesh *mesh, float (*poly_nors)[3], float (*r_ver
   cddm->mvert = mv;
 #endif
 
-  mv = mvert;
   mp = mpoly;
 
   {
@@ -170,10 +286,15 @@ static void mesh_calc_hq_normal(Mesh *mesh, float (*poly_nors)[3], float (*r_ver
   }
 
   /* normalize vertex normals and assign */
-  for (i = 0; i < numVerts; i++, mv++) {
-    if (normalize_v3(r_vert_nors[i]) == 0.0f) {
-      normal_short_to_float_v3(r_vert_nors[i], mv->no);
-    }
+  {
+    SolidifyNormalizeData data = {
+        .vert_nors = r_vert_nors,
+        .mvert = mvert,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (numVerts > 10000);
+    BLI_task_parallel_range(0, numVerts, &data, solidify_normalize_cb, &settings);
   }
 }
 
@@ -507,9 +628,6 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
   /* note, copied vertex layers don't have flipped normals yet. do this after applying offset */
   if ((smd->flag & MOD_SOLIDIFY_EVEN) == 0) {
     /* no even thickness, very simple */
-    float scalar_short;
-    float scalar_short_vgroup;
-
     /* for clamping */
     float *vert_lens = NULL;
     float *vert_angs = NULL;
@@ -593,96 +711,49 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
       MEM_freeN(edge_user_pairs);
     }
 
-    if (ofs_new != 0.0f) {
-      uint i_orig, i_end;
+    if (ofs_new != 0.0f || ofs_orig != 0.0f) {
+      uint i_end;
       bool do_shell_align;
 
-      scalar_short = scalar_short_vgroup = ofs_new / 32767.0f;
-
-      INIT_VERT_ARRAY_OFFSETS(false);
-
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (dvert) {
-          MDeformVert *dv = &dvert[i];
-          if (defgrp_invert) {
-            scalar_short_vgroup = 1.0f - BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          else {
-            scalar_short_vgroup = BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          scalar_short_vgroup = (offset_fac_vg + (scalar_short_vgroup * offset_fac_vg_inv)) *
-                                scalar_short;
-        }
-        if (do_clamp && offset > FLT_EPSILON) {
-          /* always reset because we may have set before */
-          if (dvert == NULL) {
-            scalar_short_vgroup = scalar_short;
-          }
-          if (do_angle_clamp) {
-            float cos_ang = cosf(((2 * M_PI) - vert_angs[i]) * 0.5f);
-            if (cos_ang > 0) {
-              float max_off = sqrtf(vert_lens[i]) * 0.5f / cos_ang;
-              if (max_off < offset * 0.5f) {
-                scalar_short_vgroup *= max_off / offset * 2;
-              }
-            }
-          }
-          else {
-            if (vert_lens[i] < offset_sq) {
-              float scalar = sqrtf(vert_lens[i]) / offset;
-              scalar_short_vgroup *= scalar;
-            }
-          }
-        }
-        madd_v3v3short_fl(mv->co, mv->no, scalar_short_vgroup);
+      SolidifyOffsetData data = {
+          .dvert = dvert,
+          .defgrp_index = defgrp_index,
+          .defgrp_invert = defgrp_invert,
+          .offset_fac_vg = offset_fac_vg,
+          .offset_fac_vg_inv = offset_fac_vg_inv,
+          .do_clamp = do_clamp,
+          .do_angle_clamp = do_angle_clamp,
+          .offset = offset,
+          .offset_sq = offset_sq,
+          .vert_lens = vert_lens,
+          .vert_angs = vert_angs,
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+
+      if (ofs_new != 0.0f) {
+        INIT_VERT_ARRAY_OFFSETS(false);
+
+        data.mvert = mv;
+        data.new_vert_arr = new_vert_arr;
+        data.do_shell_align = do_shell_align;
+        data.is_orig = false;
+        data.scalar_short = ofs_new / 32767.0f;
+        settings.use_threading = (i_end > 10000);
+        BLI_task_parallel_range(0, (int)i_end, &data, solidify_offset_cb, &settings);
       }
-    }
-
-    if (ofs_orig != 0.0f) {
-      uint i_orig, i_end;
-      bool do_shell_align;
-
-      scalar_short = scalar_short_vgroup = ofs_orig / 32767.0f;
 
-      /* as above but swapped */
-      INIT_VERT_ARRAY_OFFSETS(true);
-
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (dvert) {
-          MDeformVert *dv = &dvert[i];
-          if (defgrp_invert) {
-            scalar_short_vgroup = 1.0f - BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          else {
-            scalar_short_vgroup = BKE_defvert_find_weight(dv, defgrp_index);
-          }
-          scalar_short_vgroup = (offset_fac_vg + (scalar_short_vgroup * offset_fac_vg_inv)) *
-                                scalar_short;
-        }
-        if (do_clamp && offset > FLT_EPSILON) {
-          /* always reset because we may have set before */
-          if (dvert == NULL) {
-            scalar_short_vgroup = scalar_short;
-          }
-          if (do_angle_clamp) {
-            float cos_ang = cosf(vert_angs[i_orig] * 0.5f);
-            if (cos_ang > 0) {
-              float max_off = sqrtf(vert_lens[i]) * 0.5f / cos_ang;
-              if (max_off < offset * 0.5f) {
-                scalar_short_vgroup *= max_off / offset * 2;
-              }
-            }
-          }
-          else {
-            if (vert_lens[i] < offset_sq) {
-              float scalar = sqrtf(vert_lens[i]) / offset;
-              scalar_short_vgroup *= scalar;
-            }
-          }
-        }
-        madd_v3v3short_fl(mv->co, mv->no, scalar_short_vgroup);
+      if (ofs_orig != 0.0f) {
+        /* as above but swapped */
+        INIT_VERT_ARRAY_OFFSETS(true);
+
+        data.mvert = mv;
+        data.new_vert_arr = new_vert_arr;
+        data.do_shell_align = do_shell_align;
+        data.is_orig = true;
+        data.scalar_short = ofs_orig / 32767.0f;
+        settings.use_threading = (i_end > 10000);
+        BLI_task_parallel_range(0, (int)i_end, &data, solidify_offset_cb, &settings);
       }
     }
 
@@ -943,34 +1014,38 @@ Mesh *MOD_solidify_extrude_modifyMesh(ModifierData *md, const ModifierEvalContex
 #undef INVALID_UNUSED
 #undef INVALID_PAIR
 
-    if (ofs_new != 0.0f) {
-      uint i_orig, i_end;
+    if (ofs_new != 0.0f || ofs_orig != 0.0f) {
+      uint i_end;
       bool do_shell_align;
 
-      INIT_VERT_ARRAY_OFFSETS(false);
-
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i_other = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (vert_accum[i_other]) { /* zero if unselected */
-          madd_v3_v3fl(
-              mv->co, vert_nors[i_other], ofs_new * (vert_angles[i_other] / vert_accum[i_other]));
-        }
+      SolidifyEvenOffsetData data = {
+          .new_vert_arr = new_vert_arr,
+          .vert_nors = (const float(*)[3])vert_nors,
+          .vert_angles = vert_angles,
+          .vert_accum = vert_accum,
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+
+      if (ofs_new != 0.0f) {
+        INIT_VERT_ARRAY_OFFSETS(false);
+
+        data.mvert = mv;
+        data.do_shell_align = do_shell_align;
+        data.ofs = ofs_new;
+        settings.use_threading = (i_end > 10000);
+        BLI_task_parallel_range(0, (int)i_end, &data, solidify_even_offset_cb, &settings);
       }
-    }
-
-    if (ofs_orig != 0.0f) {
-      uint i_orig, i_end;
-      bool do_shell_align;
 
-      /* same as above but swapped, intentional use of 'ofs_new' */
-      INIT_VERT_ARRAY_OFFSETS(true);
+      if (ofs_orig != 0.0f) {
+        /* same as above but swapped, intentional use of 'ofs_new' */
+        INIT_VERT_ARRAY_OFFSETS(true);
 
-      for (i_orig = 0; i_orig < i_end; i_orig++, mv++) {
-        const uint i_other = do_shell_align ? i_orig : new_vert_arr[i_orig];
-        if (vert_accum[i_other]) { /* zero if unselected */
-          madd_v3_v3fl(
-              mv->co, vert_nors[i_other], ofs_orig * (vert_angles[i_other] / vert_accum[i_other]));
-        }
+        data.mvert = mv;
+        data.do_shell_align = do_shell_align;
+        data.ofs = ofs_orig;
+        settings.use_threading = (i_end > 10000);
+        BLI_task_parallel_range(0, (int)i_end, &data, solidify_even_offset_cb, &settings);
       }
     }
 
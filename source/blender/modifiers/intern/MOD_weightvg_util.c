@@ -26,6 +26,7 @@
 #include "BLI_math.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -57,6 +58,61 @@
 #include "MOD_weightvg_util.h"
 #include "RE_shader_ext.h" /* Texture masking. */
 
+/* Below this amount of weights, processing them is not worth threading. */
+#define WEIGHTVG_PARALLEL_THRESHOLD 10000
+
+/* Random mapping is not handled here, its values have to be drawn in order, see
+ * #weightvg_do_map. */
+static float weightvg_map_weight(
+    float fac, const short falloff_type, const bool do_invert, CurveMapping *cmap)
+{
+  /* Code borrowed from the warp modifier. */
+  /* Closely matches PROP_SMOOTH and similar. */
+  switch (falloff_type) {
+    case MOD_WVG_MAPPING_CURVE:
+      fac = BKE_curvemapping_evaluateF(cmap, 0, fac);
+      break;
+    case MOD_WVG_MAPPING_SHARP:
+      fac = fac * fac;
+      break;
+    case MOD_WVG_MAPPING_SMOOTH:
+      fac = 3.0f * fac * fac - 2.0f * fac * fac * fac;
+      break;
+    case MOD_WVG_MAPPING_ROOT:
+      fac = sqrtf(fac);
+      break;
+    case MOD_WVG_MAPPING_SPHERE:
+      fac = sqrtf(2 * fac - fac * fac);
+      break;
+    case MOD_WVG_MAPPING_STEP:
+      fac = (fac >= 0.5f) ? 1.0f : 0.0f;
+      break;
+    case MOD_WVG_MAPPING_NONE:
+      BLI_assert(do_invert);
+      break;
+    default:
+      BLI_assert(0);
+  }
+
+  return do_invert ? 1.0f - fac : fac;
+}
+
+typedef struct WeightVGMapData {
+  float *new_w;
+  short falloff_type;
+  bool do_invert;
+  CurveMapping *cmap;
+} WeightVGMapData;
+
+static void weightvg_do_map_task_cb(void *__restrict userdata,
+                                    const int i,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const WeightVGMapData *data = userdata;
+  data->new_w[i] = weightvg_map_weight(
+      data->new_w[i], data->falloff_type, data->do_invert, data->cmap);
+}
+
 /* Maps new_w weights in place, using either one of the predefined functions, or a custom curve.
  * Return values are in new_w.
  * If indices is not NULL, it must be a table of same length as org_w and new_w,
@@ -86,43 +142,26 @@ void weightvg_do_map(
     BKE_curvemapping_init(cmap);
   }
 
-  /* Map each weight (vertex) to its new value, accordingly to the chosen mode. */
-  for (i = 0; i < num; i++) {
-    float fac = new_w[i];
-
-    /* Code borrowed from the warp modifier. */
-    /* Closely matches PROP_SMOOTH and similar. */
-    switch (falloff_type) {
-      case MOD_WVG_MAPPING_CURVE:
-        fac = BKE_curvemapping_evaluateF(cmap, 0, fac);
-        break;
-      case MOD_WVG_MAPPING_SHARP:
-        fac = fac * fac;
-        break;
-      case MOD_WVG_MAPPING_SMOOTH:
-        fac = 3.0f * fac * fac - 2.0f * fac * fac * fac;
-        break;
-      case MOD_WVG_MAPPING_ROOT:
-        fac = sqrtf(fac);
-        break;
-      case MOD_WVG_MAPPING_SPHERE:
-        fac = sqrtf(2 * fac - fac * fac);
-        break;
-      case MOD_WVG_MAPPING_RANDOM:
-        fac = BLI_rng_get_float(rng) * fac;
-        break;
-      case MOD_WVG_MAPPING_STEP:
-        fac = (fac >= 0.5f) ? 1.0f : 0.0f;
-        break;
-      case MOD_WVG_MAPPING_NONE:
-        BLI_assert(do_invert);
-        break;
-      default:
-        BLI_assert(0);
+  /* Random values have to be drawn in order, to remain stable. */
+  if (falloff_type == MOD_WVG_MAPPING_RANDOM) {
+    for (i = 0; i < num; i++) {
+      const float fac = BLI_rng_get_float(rng) * new_w[i];
+      new_w[i] = do_invert ? 1.0f - fac : fac;
     }
-
-    new_w[i] = do_invert ? 1.0f - fac : fac;
+    return;
   }
+
+  /* Map each weight (vertex) to its new value, accordingly to the chosen mode. */
+  WeightVGMapData data = {
+      .new_w = new_w,
+      .falloff_type = falloff_type,
+      .do_invert = do_invert,
+      .cmap = cmap,
+  };
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (num > WEIGHTVG_PARALLEL_THRESHOLD);
+  BLI_task_parallel_range(0, num, &data, weightvg_do_map_task_cb, &settings);
 }
 
 /* Applies new_w weights to org_w ones, using either a texture, vgroup or constant value as factor.
@@ -246,15 +285,17 @@ void weightvg_do_mask(const ModifierEvalContext *ctx,
       return;
     }
 
+    /* Get the mask weights densely, vertices not in ref vgroup get a null factor. */
+    float *mask_w = MEM_malloc_arrayN(num, sizeof(*mask_w), "WeightVG Modifier, mask_w");
+    BKE_defvert_extract_vgroup_dense(dvert, ref_didx, num, indices, 0.0f, mask_w, NULL);
+
     /* For each weight (vertex), make the mix between org and new weights. */
     for (i = 0; i < num; i++) {
-      int idx = indices ? indices[i] : i;
-      const float f = invert_vgroup_mask ?
-                          1.0f - BKE_defvert_find_weight(&dvert[idx], ref_didx) * fact :
-                          BKE_defvert_find_weight(&dvert[idx], ref_didx) * fact;
+      const float f = invert_vgroup_mask ? 1.0f - mask_w[i] * fact : mask_w[i] * fact;
       org_w[i] = (new_w[i] * f) + (org_w[i] * (1.0f - f));
-      /* If that vertex is not in ref vgroup, assume null factor, and hence do nothing! */
     }
+
+    MEM_freeN(mask_w);
   }
   else {
     /* Default "influence" behavior. */
@@ -311,31 +352,28 @@ void weightvg_update_vg(MDeformVert *dvert,
     }
   }
 
-  for (i = 0; i < num; i++) {
-    float w = weights[i];
-    MDeformVert *dv = &dvert[indices ? indices[i] : i];
-    MDeformWeight *dw = dws ? dws[i] :
-                              ((defgrp_idx >= 0) ? BKE_defvert_find_index(dv, defgrp_idx) : NULL);
-
-    if (do_normalize) {
-      w = (w - min_w) * norm_fac;
-    }
-    /* Never allow weights out of [0.0, 1.0] range. */
-    CLAMP(w, 0.0f, 1.0f);
-
-    /* If the vertex is in this vgroup, remove it if needed, or just update it. */
-    if (dw != NULL) {
-      if (do_rem && w < rem_thresh) {
-        BKE_defvert_remove_group(dv, dw);
-      }
-      else {
-        dw->weight = w;
-      }
-    }
-    /* Else, add it if needed! */
-    else if (do_add && w > add_thresh) {
-      BKE_defvert_add_index_notest(dv, defgrp_idx, w);
+  if (do_normalize) {
+    /* Given weights are left untouched, normalize a copy of them. */
+    float *weights_normalized = MEM_malloc_arrayN(
+        num, sizeof(*weights_normalized), "WeightVG Modifier, weights_normalized");
+    for (i = 0; i < num; i++) {
+      weights_normalized[i] = (weights[i] - min_w) * norm_fac;
     }
+    BKE_defvert_apply_vgroup_weights(dvert,
+                                     defgrp_idx,
+                                     dws,
+                                     num,
+                                     indices,
+                                     weights_normalized,
+                                     do_add,
+                                     add_thresh,
+                                     do_rem,
+                                     rem_thresh);
+    MEM_freeN(weights_normalized);
+  }
+  else {
+    BKE_defvert_apply_vgroup_weights(
+        dvert, defgrp_idx, dws, num, indices, weights, do_add, add_thresh, do_rem, rem_thresh);
   }
 }
 
@@ -21,6 +21,8 @@
  * \ingroup modifiers
  */
 
+#include <string.h>
+
 #include "BLI_utildefines.h"
 
 #include "BLI_ghash.h"
@@ -187,7 +189,6 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   MDeformWeight **dw = NULL;
   float *org_w; /* Array original weights. */
   float *new_w; /* Array new weights. */
-  int i;
   const bool invert_vgroup_mask = (wmd->edit_flags & MOD_WVG_EDIT_INVERT_VGROUP_MASK) != 0;
 
   /* Flags. */
@@ -240,15 +241,9 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   org_w = MEM_malloc_arrayN(numVerts, sizeof(float), "WeightVGEdit Modifier, org_w");
   new_w = MEM_malloc_arrayN(numVerts, sizeof(float), "WeightVGEdit Modifier, new_w");
   dw = MEM_malloc_arrayN(numVerts, sizeof(MDeformWeight *), "WeightVGEdit Modifier, dw");
-  for (i = 0; i < numVerts; i++) {
-    dw[i] = BKE_defvert_find_index(&dvert[i], defgrp_index);
-    if (dw[i]) {
-      org_w[i] = new_w[i] = dw[i]->weight;
-    }
-    else {
-      org_w[i] = new_w[i] = wmd->default_weight;
-    }
-  }
+  BKE_defvert_extract_vgroup_dense(
+      dvert, defgrp_index, numVerts, NULL, wmd->default_weight, org_w, dw);
+  memcpy(new_w, org_w, sizeof(*new_w) * numVerts);
 
   /* Do mapping. */
   const bool do_invert_mapping = (wmd->edit_flags & MOD_WVG_INVERT_FALLOFF) != 0;
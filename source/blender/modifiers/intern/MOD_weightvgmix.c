@@ -300,16 +300,22 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   tidx = MEM_malloc_arrayN(numVerts, sizeof(int), "WeightVGMix Modifier, tidx");
   tdw1 = MEM_malloc_arrayN(numVerts, sizeof(MDeformWeight *), "WeightVGMix Modifier, tdw1");
   tdw2 = MEM_malloc_arrayN(numVerts, sizeof(MDeformWeight *), "WeightVGMix Modifier, tdw2");
+  BKE_defvert_extract_vgroup_dense(dvert, defgrp_index, numVerts, NULL, 0.0f, NULL, tdw1);
+  if (defgrp_index_other >= 0) {
+    BKE_defvert_extract_vgroup_dense(
+        dvert, defgrp_index_other, numVerts, NULL, 0.0f, NULL, tdw2);
+  }
+  else {
+    memset(tdw2, 0, sizeof(*tdw2) * numVerts);
+  }
+  /* Compact in place, numIdx never gets past i. */
   switch (wmd->mix_set) {
     case MOD_WVG_SET_A:
       /* All vertices in first vgroup. */
       for (i = 0; i < numVerts; i++) {
-        MDeformWeight *dw = BKE_defvert_find_index(&dvert[i], defgrp_index);
-        if (dw) {
-          tdw1[numIdx] = dw;
-          tdw2[numIdx] = (defgrp_index_other >= 0) ?
-                             BKE_defvert_find_index(&dvert[i], defgrp_index_other) :
-                             NULL;
+        if (tdw1[i]) {
+          tdw1[numIdx] = tdw1[i];
+          tdw2[numIdx] = tdw2[i];
           tidx[numIdx++] = i;
         }
       }
@@ -317,12 +323,9 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
     case MOD_WVG_SET_B:
       /* All vertices in second vgroup. */
       for (i = 0; i < numVerts; i++) {
-        MDeformWeight *dw = (defgrp_index_other >= 0) ?
-                                BKE_defvert_find_index(&dvert[i], defgrp_index_other) :
-                                NULL;
-        if (dw) {
-          tdw1[numIdx] = BKE_defvert_find_index(&dvert[i], defgrp_index);
-          tdw2[numIdx] = dw;
+        if (tdw2[i]) {
+          tdw1[numIdx] = tdw1[i];
+          tdw2[numIdx] = tdw2[i];
           tidx[numIdx++] = i;
         }
       }
@@ -330,13 +333,9 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
     case MOD_WVG_SET_OR:
       /* All vertices in one vgroup or the other. */
       for (i = 0; i < numVerts; i++) {
-        MDeformWeight *adw = BKE_defvert_find_index(&dvert[i], defgrp_index);
-        MDeformWeight *bdw = (defgrp_index_other >= 0) ?
-                                 BKE_defvert_find_index(&dvert[i], defgrp_index_other) :
-                                 NULL;
-        if (adw || bdw) {
-          tdw1[numIdx] = adw;
-          tdw2[numIdx] = bdw;
+        if (tdw1[i] || tdw2[i]) {
+          tdw1[numIdx] = tdw1[i];
+          tdw2[numIdx] = tdw2[i];
           tidx[numIdx++] = i;
         }
       }
@@ -344,13 +343,9 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
     case MOD_WVG_SET_AND:
       /* All vertices in both vgroups. */
       for (i = 0; i < numVerts; i++) {
-        MDeformWeight *adw = BKE_defvert_find_index(&dvert[i], defgrp_index);
-        MDeformWeight *bdw = (defgrp_index_other >= 0) ?
-                                 BKE_defvert_find_index(&dvert[i], defgrp_index_other) :
-                                 NULL;
-        if (adw && bdw) {
-          tdw1[numIdx] = adw;
-          tdw2[numIdx] = bdw;
+        if (tdw1[i] && tdw2[i]) {
+          tdw1[numIdx] = tdw1[i];
+          tdw2[numIdx] = tdw2[i];
           tidx[numIdx++] = i;
         }
       }
@@ -358,12 +353,6 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
     case MOD_WVG_SET_ALL:
     default:
       /* Use all vertices. */
-      for (i = 0; i < numVerts; i++) {
-        tdw1[i] = BKE_defvert_find_index(&dvert[i], defgrp_index);
-        tdw2[i] = (defgrp_index_other >= 0) ?
-                      BKE_defvert_find_index(&dvert[i], defgrp_index_other) :
-                      NULL;
-      }
       numIdx = -1;
       break;
   }
@@ -490,8 +490,10 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   tidx = MEM_malloc_arrayN(numVerts, sizeof(int), "WeightVGProximity Modifier, tidx");
   tw = MEM_malloc_arrayN(numVerts, sizeof(float), "WeightVGProximity Modifier, tw");
   tdw = MEM_malloc_arrayN(numVerts, sizeof(MDeformWeight *), "WeightVGProximity Modifier, tdw");
+  BKE_defvert_extract_vgroup_dense(dvert, defgrp_index, numVerts, NULL, 0.0f, NULL, tdw);
+  /* Compact in place, numIdx never gets past i. */
   for (i = 0; i < numVerts; i++) {
-    MDeformWeight *_dw = BKE_defvert_find_index(&dvert[i], defgrp_index);
+    MDeformWeight *_dw = tdw[i];
     if (_dw) {
       tidx[numIdx] = i;
       tw[numIdx] = _dw->weight;
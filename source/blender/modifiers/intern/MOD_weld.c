@@ -32,8 +32,11 @@
 #include "BLI_utildefines.h"
 
 #include "BLI_alloca.h"
+#include "BLI_bitmap.h"
 #include "BLI_kdopbvh.h"
+#include "BLI_kdtree.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "BLT_translation.h"
 
@@ -43,7 +46,6 @@
 #include "DNA_object_types.h"
 #include "DNA_screen_types.h"
 
-#include "BKE_bvhutils.h"
 #include "BKE_context.h"
 #include "BKE_deform.h"
 #include "BKE_mesh.h"
@@ -382,6 +384,42 @@ static void weld_assert_poly_len(const WeldPoly *wp, const WeldLoop *wloop)
 /** \name Weld Vert API
  * \{ */
 
+/**
+ * Find the root of the cluster of \a v, halving the path on the way.
+ */
+static uint weld_vert_root_find(uint *vert_parent, uint v)
+{
+  while (vert_parent[v] != v) {
+    vert_parent[v] = vert_parent[vert_parent[v]];
+    v = vert_parent[v];
+  }
+  return v;
+}
+
+typedef struct WeldVertDestResolveData {
+  const uint *vert_parent;
+  uint *vert_dest_map;
+} WeldVertDestResolveData;
+
+static void weld_vert_dest_resolve_cb(void *__restrict userdata,
+                                      const int index,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  WeldVertDestResolveData *data = userdata;
+  const uint v = (uint)index;
+  if (data->vert_dest_map[v] == OUT_OF_CONTEXT) {
+    return;
+  }
+  /* Read only, roots are never written here. */
+  uint root = v;
+  while (data->vert_parent[root] != root) {
+    root = data->vert_parent[root];
+  }
+  if (root != v) {
+    data->vert_dest_map[v] = data->vert_dest_map[root];
+  }
+}
+
 static void weld_vert_ctx_alloc_and_setup(const uint mvert_len,
                                           const BVHTreeOverlap *overlap,
                                           const uint overlap_len,
@@ -395,6 +433,13 @@ static void weld_vert_ctx_alloc_and_setup(const uint mvert_len,
     *v_dest_iter = OUT_OF_CONTEXT;
   }
 
+  /* Join the overlapping vertices with a union-find, the root of every cluster stores the
+   * destination vertex of the cluster in `r_vert_dest_map`. A new cluster uses its lowest vertex
+   * and when two clusters are joined the lowest destination is kept.
+   * For vertices that are not a root, `r_vert_dest_map` only tags them as being in context
+   * until the destinations are resolved below. */
+  uint *vert_parent = MEM_mallocN(sizeof(*vert_parent) * mvert_len, __func__);
+
   uint vert_kill_len = 0;
   const BVHTreeOverlap *overlap_iter = &overlap[0];
   for (uint i = 0; i < overlap_len; i++, overlap_iter++) {
@@ -403,49 +448,51 @@ static void weld_vert_ctx_alloc_and_setup(const uint mvert_len,
 
     BLI_assert(indexA < indexB);
 
-    uint va_dst = r_vert_dest_map[indexA];
-    uint vb_dst = r_vert_dest_map[indexB];
-    if (va_dst == OUT_OF_CONTEXT) {
-      if (vb_dst == OUT_OF_CONTEXT) {
-        vb_dst = indexA;
-        r_vert_dest_map[indexB] = vb_dst;
-      }
-      r_vert_dest_map[indexA] = vb_dst;
+    const bool va_in_ctx = r_vert_dest_map[indexA] != OUT_OF_CONTEXT;
+    const bool vb_in_ctx = r_vert_dest_map[indexB] != OUT_OF_CONTEXT;
+    if (!va_in_ctx && !vb_in_ctx) {
+      vert_parent[indexA] = indexA;
+      vert_parent[indexB] = indexA;
+      r_vert_dest_map[indexA] = indexA;
+      r_vert_dest_map[indexB] = indexA;
       vert_kill_len++;
     }
-    else if (vb_dst == OUT_OF_CONTEXT) {
-      r_vert_dest_map[indexB] = va_dst;
+    else if (!va_in_ctx) {
+      vert_parent[indexA] = weld_vert_root_find(vert_parent, indexB);
+      r_vert_dest_map[indexA] = r_vert_dest_map[vert_parent[indexA]];
       vert_kill_len++;
     }
-    else if (va_dst != vb_dst) {
-      uint v_new, v_old;
-      if (va_dst < vb_dst) {
-        v_new = va_dst;
-        v_old = vb_dst;
-      }
-      else {
-        v_new = vb_dst;
-        v_old = va_dst;
-      }
-      BLI_assert(r_vert_dest_map[v_old] == v_old);
-      BLI_assert(r_vert_dest_map[v_new] == v_new);
+    else if (!vb_in_ctx) {
+      vert_parent[indexB] = weld_vert_root_find(vert_parent, indexA);
+      r_vert_dest_map[indexB] = r_vert_dest_map[vert_parent[indexB]];
       vert_kill_len++;
-
-      const BVHTreeOverlap *overlap_iter_b = &overlap[0];
-      for (uint j = i + 1; j--; overlap_iter_b++) {
-        indexA = overlap_iter_b->indexA;
-        indexB = overlap_iter_b->indexB;
-        va_dst = r_vert_dest_map[indexA];
-        vb_dst = r_vert_dest_map[indexB];
-        if (ELEM(v_old, vb_dst, va_dst)) {
-          r_vert_dest_map[indexA] = v_new;
-          r_vert_dest_map[indexB] = v_new;
-        }
+    }
+    else {
+      const uint root_a = weld_vert_root_find(vert_parent, indexA);
+      const uint root_b = weld_vert_root_find(vert_parent, indexB);
+      if (root_a != root_b) {
+        const uint va_dst = r_vert_dest_map[root_a];
+        const uint vb_dst = r_vert_dest_map[root_b];
+        vert_parent[root_b] = root_a;
+        r_vert_dest_map[root_a] = MIN2(va_dst, vb_dst);
+        vert_kill_len++;
       }
-      BLI_assert(r_vert_dest_map[v_old] == v_new);
     }
   }
 
+  {
+    WeldVertDestResolveData data = {
+        .vert_parent = vert_parent,
+        .vert_dest_map = r_vert_dest_map,
+    };
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (mvert_len > 10000);
+    BLI_task_parallel_range(0, (int)mvert_len, &data, weld_vert_dest_resolve_cb, &settings);
+  }
+
+  MEM_freeN(vert_parent);
+
   /* Vert Context. */
   uint wvert_len = 0;
 
@@ -1633,20 +1680,126 @@ static void customdata_weld(
 /** \name Weld Modifier Main
  * \{ */
 
-struct WeldOverlapData {
+/** Neighbors of a single vertex found by #weld_candidates_search_cb. */
+struct WeldCandidatesSearch {
+  uint index;
+  uint len;
+  uint max_len;
+  /* NULL when only counting. */
+  BVHTreeOverlap *r_overlap;
+};
+
+static bool weld_candidates_search_cb(void *user_data,
+                                      int index,
+                                      const float UNUSED(co[3]),
+                                      float UNUSED(dist_sq))
+{
+  struct WeldCandidatesSearch *search = user_data;
+  /* Each pair is only stored by its lowest index. */
+  if ((uint)index > search->index) {
+    if (search->r_overlap) {
+      search->r_overlap[search->len].indexA = (int)search->index;
+      search->r_overlap[search->len].indexB = index;
+    }
+    search->len++;
+    return search->len != search->max_len;
+  }
+  return true;
+}
+
+struct WeldCandidatesData {
   const MVert *mvert;
-  float merge_dist_sq;
+  const BLI_bitmap *v_mask;
+  const KDTree_3d *tree;
+  float merge_dist;
+  uint max_interactions;
+  /* The number of pairs of each vertex on the first pass,
+   * their offset in `overlap` on the second. */
+  uint *overlap_ofs;
+  BVHTreeOverlap *overlap;
 };
-static bool bvhtree_weld_overlap_cb(void *userdata, int index_a, int index_b, int UNUSED(thread))
+
+static void weld_candidates_search_task_cb(void *__restrict userdata,
+                                           const int index,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  if (index_a < index_b) {
-    struct WeldOverlapData *data = userdata;
-    const MVert *mvert = data->mvert;
-    const float dist_sq = len_squared_v3v3(mvert[index_a].co, mvert[index_b].co);
-    BLI_assert(dist_sq <= ((data->merge_dist_sq + FLT_EPSILON) * 3));
-    return dist_sq <= data->merge_dist_sq;
+  struct WeldCandidatesData *data = userdata;
+  const uint i = (uint)index;
+  if (data->v_mask && !BLI_BITMAP_TEST(data->v_mask, i)) {
+    data->overlap_ofs[i] = 0;
+    return;
+  }
+
+  struct WeldCandidatesSearch search = {
+      .index = i,
+      .len = 0,
+      .max_len = data->max_interactions,
+      .r_overlap = data->overlap ? &data->overlap[data->overlap_ofs[i]] : NULL,
+  };
+  /* The tree is traversed in the same order on both passes,
+   * so the same pairs are found when `max_interactions` cuts the search short. */
+  BLI_kdtree_3d_range_search_cb(
+      data->tree, data->mvert[i].co, data->merge_dist, weld_candidates_search_cb, &search);
+
+  if (data->overlap == NULL) {
+    data->overlap_ofs[i] = search.len;
   }
-  return false;
+}
+
+/**
+ * Find all pairs of vertices closer than \a merge_dist.
+ *
+ * The pairs are counted and then written in two parallel passes over a KD-tree,
+ * the result is ordered by the lowest index of each pair and doesn't depend on threading.
+ */
+static BVHTreeOverlap *weld_candidates_find(const MVert *mvert,
+                                            const uint mvert_len,
+                                            const BLI_bitmap *v_mask,
+                                            const uint v_mask_act,
+                                            const float merge_dist,
+                                            const uint max_interactions,
+                                            uint *r_overlap_len)
+{
+  KDTree_3d *tree = BLI_kdtree_3d_new(v_mask ? v_mask_act : mvert_len);
+  for (uint i = 0; i < mvert_len; i++) {
+    if (v_mask == NULL || BLI_BITMAP_TEST(v_mask, i)) {
+      BLI_kdtree_3d_insert(tree, (int)i, mvert[i].co);
+    }
+  }
+  BLI_kdtree_3d_balance(tree);
+
+  struct WeldCandidatesData data = {
+      .mvert = mvert,
+      .v_mask = v_mask,
+      .tree = tree,
+      .merge_dist = merge_dist,
+      .max_interactions = max_interactions,
+      .overlap_ofs = MEM_mallocN(sizeof(uint) * mvert_len, __func__),
+      .overlap = NULL,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (mvert_len > 1000);
+  BLI_task_parallel_range(0, (int)mvert_len, &data, weld_candidates_search_task_cb, &settings);
+
+  uint overlap_len = 0;
+  for (uint i = 0; i < mvert_len; i++) {
+    const uint len = data.overlap_ofs[i];
+    data.overlap_ofs[i] = overlap_len;
+    overlap_len += len;
+  }
+
+  if (overlap_len) {
+    data.overlap = MEM_mallocN(sizeof(*data.overlap) * overlap_len, __func__);
+    BLI_task_parallel_range(0, (int)mvert_len, &data, weld_candidates_search_task_cb, &settings);
+  }
+
+  MEM_freeN(data.overlap_ofs);
+  BLI_kdtree_3d_free(tree);
+
+  *r_overlap_len = overlap_len;
+  return data.overlap;
 }
 
 static Mesh *weldModifier_doWeld(WeldModifierData *wmd, const ModifierEvalContext *ctx, Mesh *mesh)
@@ -1686,44 +1839,19 @@ static Mesh *weldModifier_doWeld(WeldModifierData *wmd, const ModifierEvalContex
   }
 
   /* Get overlap map. */
-  /* TODO: For a better performanse use KD-Tree. */
-  struct BVHTreeFromMesh treedata;
-  BVHTree *bvhtree = bvhtree_from_mesh_verts_ex(&treedata,
-                                                mvert,
-                                                totvert,
-                                                false,
-                                                v_mask,
-                                                v_mask_act,
-                                                wmd->merge_dist / 2,
-                                                2,
-                                                6,
-                                                0,
-                                                NULL,
-                                                NULL);
+  uint overlap_len;
+  BVHTreeOverlap *overlap = weld_candidates_find(mvert,
+                                                 totvert,
+                                                 v_mask,
+                                                 (uint)v_mask_act,
+                                                 wmd->merge_dist,
+                                                 wmd->max_interactions,
+                                                 &overlap_len);
 
   if (v_mask) {
     MEM_freeN(v_mask);
   }
 
-  if (bvhtree == NULL) {
-    return result;
-  }
-
-  struct WeldOverlapData data;
-  data.mvert = mvert;
-  data.merge_dist_sq = square_f(wmd->merge_dist);
-
-  uint overlap_len;
-  BVHTreeOverlap *overlap = BLI_bvhtree_overlap_ex(bvhtree,
-                                                   bvhtree,
-                                                   &overlap_len,
-                                                   bvhtree_weld_overlap_cb,
-                                                   &data,
-                                                   wmd->max_interactions,
-                                                   BVH_OVERLAP_RETURN_PAIRS);
-
-  free_bvhtree_from_mesh(&treedata);
-
   if (overlap_len) {
     WeldMesh weld_mesh;
     weld_mesh_context_create(mesh, overlap, overlap_len, &weld_mesh);
@@ -1916,9 +2044,10 @@ static Mesh *weldModifier_doWeld(WeldModifierData *wmd, const ModifierEvalContex
     result->runtime.cd_dirty_vert |= CD_MASK_NORMAL;
 
     weld_mesh_context_free(&weld_mesh);
+
+    MEM_freeN(overlap);
   }
 
-  MEM_freeN(overlap);
   return result;
 }
 
@@ -32,6 +32,7 @@
 
 #include "BLI_linklist.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_cloth.h"
@@ -72,6 +73,131 @@ static int cloth_count_nondiag_blocks(Cloth *cloth)
   return nondiag;
 }
 
+/* Springs are evaluated in batches of springs that don't share any vertices, so the springs of a
+ * batch can run in parallel without writing to the forces of the same vertex. The batches are
+ * always processed in the same order, so results don't depend on the number of threads. */
+typedef struct ClothSpringBatches {
+  /* Springs of batch `i` are `springs[offsets[i]]` to `springs[offsets[i + 1] - 1]`. */
+  ClothSpring **springs;
+  int *offsets;
+  int batches_num;
+  /* First off-diagonal matrix block of every spring, added at every step. */
+  int *blocks;
+} ClothSpringBatches;
+
+/* Number of off-diagonal blocks used by the force of a spring,
+ * matching the force types of #cloth_calc_spring_force. */
+static int cloth_spring_blocks_num(const ClothSimSettings *parms, const ClothSpring *spring)
+{
+  /* Angular bending forces only act on the diagonal blocks. */
+  if ((spring->type & CLOTH_SPRING_TYPE_BENDING) &&
+      (parms->bending_model == CLOTH_BENDING_ANGULAR)) {
+    return 0;
+  }
+  if (spring->type & (CLOTH_SPRING_TYPE_STRUCTURAL | CLOTH_SPRING_TYPE_SEWING |
+                      CLOTH_SPRING_TYPE_INTERNAL | CLOTH_SPRING_TYPE_SHEAR |
+                      CLOTH_SPRING_TYPE_BENDING)) {
+    return 1;
+  }
+  if (spring->type & CLOTH_SPRING_TYPE_BENDING_HAIR) {
+    return 3;
+  }
+  return 0;
+}
+
+/* Test if none of the vertices a spring writes to are used in the batch yet,
+ * or mark them as used when `mark` is set. */
+static bool cloth_spring_batch_verts(const ClothSpring *spring,
+                                     int *vert_batch,
+                                     const int batch,
+                                     const bool mark)
+{
+  int verts[3] = {spring->ij, spring->kl, -1};
+  if (spring->type & CLOTH_SPRING_TYPE_BENDING_HAIR) {
+    verts[2] = spring->mn;
+  }
+
+  for (int i = 0; i < 3 + spring->la + spring->lb; i++) {
+    int v;
+    if (i < 3) {
+      v = verts[i];
+    }
+    else if (i < 3 + spring->la) {
+      v = spring->pa[i - 3];
+    }
+    else {
+      v = spring->pb[i - 3 - spring->la];
+    }
+
+    if (v == -1) {
+      continue;
+    }
+    if (mark) {
+      vert_batch[v] = batch;
+    }
+    else if (vert_batch[v] == batch) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static ClothSpringBatches *cloth_spring_batches_create(Cloth *cloth)
+{
+  const int springs_num = BLI_linklist_count(cloth->springs);
+  ClothSpringBatches *batches = (ClothSpringBatches *)MEM_callocN(sizeof(ClothSpringBatches),
+                                                                  __func__);
+  batches->springs = (ClothSpring **)MEM_malloc_arrayN(
+      springs_num, sizeof(ClothSpring *), __func__);
+  batches->offsets = (int *)MEM_malloc_arrayN(springs_num + 1, sizeof(int), __func__);
+  batches->blocks = (int *)MEM_malloc_arrayN(springs_num, sizeof(int), __func__);
+
+  ClothSpring **pending = (ClothSpring **)MEM_malloc_arrayN(
+      springs_num, sizeof(ClothSpring *), __func__);
+  int *vert_batch = (int *)MEM_malloc_arrayN(cloth->mvert_num, sizeof(int), __func__);
+  int pending_num = 0;
+
+  for (LinkNode *link = cloth->springs; link; link = link->next) {
+    pending[pending_num++] = (ClothSpring *)link->link;
+  }
+  copy_vn_i(vert_batch, cloth->mvert_num, -1);
+
+  /* Greedily fill every batch with the pending springs in list order,
+   * the springs that share a vertex with the batch are left for the next one. */
+  int springs_done = 0;
+  while (pending_num > 0) {
+    const int batch = batches->batches_num++;
+    int deferred_num = 0;
+
+    batches->offsets[batch] = springs_done;
+    for (int i = 0; i < pending_num; i++) {
+      ClothSpring *spring = pending[i];
+      if (cloth_spring_batch_verts(spring, vert_batch, batch, false)) {
+        cloth_spring_batch_verts(spring, vert_batch, batch, true);
+        batches->springs[springs_done++] = spring;
+      }
+      else {
+        pending[deferred_num++] = spring;
+      }
+    }
+    pending_num = deferred_num;
+  }
+  batches->offsets[batches->batches_num] = springs_done;
+
+  MEM_freeN(pending);
+  MEM_freeN(vert_batch);
+
+  return batches;
+}
+
+static void cloth_spring_batches_free(ClothSpringBatches *batches)
+{
+  MEM_freeN(batches->springs);
+  MEM_freeN(batches->offsets);
+  MEM_freeN(batches->blocks);
+  MEM_freeN(batches);
+}
+
 static bool cloth_get_pressure_weights(ClothModifierData *clmd,
                                        const MVertTri *vt,
                                        float *r_weights)
@@ -210,6 +336,8 @@ int SIM_cloth_solver_init(Object *UNUSED(ob), ClothModifierData *clmd)
     SIM_mass_spring_set_motion_state(id, i, verts[i].x, ZERO);
   }
 
+  cloth->spring_batches = cloth_spring_batches_create(cloth);
+
   return 1;
 }
 
@@ -221,6 +349,10 @@ void SIM_cloth_solver_free(ClothModifierData *clmd)
     SIM_mass_spring_solver_free(cloth->implicit);
     cloth->implicit = NULL;
   }
+  if (cloth->spring_batches) {
+    cloth_spring_batches_free(cloth->spring_batches);
+    cloth->spring_batches = NULL;
+  }
 }
 
 void SIM_cloth_solver_set_positions(ClothModifierData *clmd)
@@ -366,7 +498,7 @@ static int UNUSED_FUNCTION(cloth_calc_helper_forces)(Object *UNUSED(ob),
   return 1;
 }
 
-BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
+BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s, int block)
 {
   Cloth *cloth = clmd->clothObject;
   ClothSimSettings *parms = clmd->sim_parms;
@@ -412,6 +544,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
       SIM_mass_spring_force_spring_linear(data,
                                           s->ij,
                                           s->kl,
+                                          block,
                                           s->restlen,
                                           k_tension,
                                           parms->tension_damp,
@@ -430,6 +563,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
       SIM_mass_spring_force_spring_linear(data,
                                           s->ij,
                                           s->kl,
+                                          block,
                                           s->restlen,
                                           k_tension,
                                           parms->tension_damp,
@@ -468,6 +602,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
       SIM_mass_spring_force_spring_linear(data,
                                           s->ij,
                                           s->kl,
+                                          block,
                                           s->restlen,
                                           k_tension,
                                           k_tension_damp,
@@ -491,6 +626,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
     SIM_mass_spring_force_spring_linear(data,
                                         s->ij,
                                         s->kl,
+                                        block,
                                         s->restlen,
                                         k,
                                         parms->shear_damp,
@@ -513,7 +649,7 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
     // Fix for [#45084] for cloth stiffness must have cb proportional to kb
     cb = kb * parms->bending_damping;
 
-    SIM_mass_spring_force_spring_bending(data, s->ij, s->kl, s->restlen, kb, cb);
+    SIM_mass_spring_force_spring_bending(data, s->ij, s->kl, block, s->restlen, kb, cb);
 #endif
   }
   else if (s->type & CLOTH_SPRING_TYPE_BENDING_HAIR) {
@@ -534,7 +670,8 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
 
     /* XXX assuming same restlen for ij and jk segments here,
      * this can be done correctly for hair later. */
-    SIM_mass_spring_force_spring_bending_hair(data, s->ij, s->kl, s->mn, s->target, kb, cb);
+    SIM_mass_spring_force_spring_bending_hair(
+        data, s->ij, s->kl, s->mn, block, s->target, kb, cb);
 
 #  if 0
     {
@@ -559,6 +696,63 @@ BLI_INLINE void cloth_calc_spring_force(ClothModifierData *clmd, ClothSpring *s)
   }
 }
 
+typedef struct ClothSpringForceData {
+  ClothModifierData *clmd;
+  const ClothSpringBatches *batches;
+} ClothSpringForceData;
+
+static void cloth_calc_spring_force_task_cb(void *__restrict userdata,
+                                            const int i,
+                                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ClothSpringForceData *data = (const ClothSpringForceData *)userdata;
+  ClothSpring *spring = data->batches->springs[i];
+
+  // only handle active springs
+  if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE)) {
+    cloth_calc_spring_force(data->clmd, spring, data->batches->blocks[i]);
+  }
+}
+
+static void cloth_calc_spring_forces(ClothModifierData *clmd)
+{
+  Cloth *cloth = clmd->clothObject;
+  Implicit_Data *data = cloth->implicit;
+  ClothSpringBatches *batches = cloth->spring_batches;
+  const int springs_num = batches->offsets[batches->batches_num];
+
+  /* Add the matrix blocks of all springs up front, in batch order. */
+  for (int i = 0; i < springs_num; i++) {
+    const ClothSpring *spring = batches->springs[i];
+    const int blocks_num = (spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE) ?
+                               0 :
+                               cloth_spring_blocks_num(clmd->sim_parms, spring);
+
+    batches->blocks[i] = -1;
+    if (blocks_num == 1) {
+      batches->blocks[i] = SIM_mass_spring_add_block(data, spring->ij, spring->kl);
+    }
+    else if (blocks_num == 3) {
+      batches->blocks[i] = SIM_mass_spring_add_block(data, spring->ij, spring->kl);
+      SIM_mass_spring_add_block(data, spring->kl, spring->mn);
+      SIM_mass_spring_add_block(data, spring->ij, spring->mn);
+    }
+  }
+
+  ClothSpringForceData force_data = {clmd, batches};
+
+  for (int batch = 0; batch < batches->batches_num; batch++) {
+    const int start = batches->offsets[batch];
+    const int end = batches->offsets[batch + 1];
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.use_threading = (end - start > 256);
+    settings.min_iter_per_thread = 64;
+    BLI_task_parallel_range(start, end, &force_data, cloth_calc_spring_force_task_cb, &settings);
+  }
+}
+
 static void hair_get_boundbox(ClothModifierData *clmd, float gmin[3], float gmax[3])
 {
   Cloth *cloth = clmd->clothObject;
@@ -720,20 +914,30 @@ static void cloth_calc_force(
                                                  "effector forces");
     float(*forcevec)[3] = is_not_hair ? winvec + mvert_num : winvec;
 
-    for (i = 0; i < cloth->mvert_num; i++) {
-      float x[3], v[3];
-      EffectedPoint epoint;
+    float(*motion)[3] = (float(*)[3])MEM_malloc_arrayN(
+        mvert_num * 2, sizeof(float[3]), "effector motion state");
+    EffectedPoint *epoints = (EffectedPoint *)MEM_malloc_arrayN(
+        mvert_num, sizeof(EffectedPoint), "effector points");
 
+    for (i = 0; i < cloth->mvert_num; i++) {
+      float *x = motion[i * 2], *v = motion[i * 2 + 1];
       SIM_mass_spring_get_motion_state(data, i, x, v);
-      pd_point_from_loc(scene, x, v, i, &epoint);
-      BKE_effectors_apply(effectors,
-                          NULL,
-                          clmd->sim_parms->effector_weights,
-                          &epoint,
-                          forcevec[i],
-                          winvec[i],
-                          NULL);
+      pd_point_from_loc(scene, x, v, i, &epoints[i]);
+    }
+
+    BKE_effectors_apply_array(effectors,
+                              NULL,
+                              clmd->sim_parms->effector_weights,
+                              epoints,
+                              mvert_num,
+                              forcevec,
+                              winvec,
+                              NULL);
 
+    MEM_freeN(motion);
+    MEM_freeN(epoints);
+
+    for (i = 0; i < cloth->mvert_num; i++) {
       has_wind = has_wind || !is_zero_v3(winvec[i]);
       has_force = has_force || !is_zero_v3(forcevec[i]);
     }
@@ -789,13 +993,7 @@ static void cloth_calc_force(
   }
 
   // calculate spring forces
-  for (LinkNode *link = cloth->springs; link; link = link->next) {
-    ClothSpring *spring = (ClothSpring *)link->link;
-    // only handle active springs
-    if (!(spring->flags & CLOTH_SPRING_FLAG_DEACTIVATE)) {
-      cloth_calc_spring_force(clmd, spring);
-    }
-  }
+  cloth_calc_spring_forces(clmd);
 }
 
 /* returns vertexes' motion state */
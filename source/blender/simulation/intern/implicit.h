@@ -143,10 +143,15 @@ void SIM_mass_spring_force_vertex_wind(struct Implicit_Data *data,
                                        int v,
                                        float radius,
                                        const float (*winvec)[3]);
+/* Add the off-diagonal matrix block of the interaction between two vertices, returns its index.
+ * Spring forces write to blocks added beforehand, so that springs which don't share vertices
+ * can be evaluated in parallel while the blocks keep the same order. */
+int SIM_mass_spring_add_block(struct Implicit_Data *data, int v1, int v2);
 /* Linear spring force between two points */
 bool SIM_mass_spring_force_spring_linear(struct Implicit_Data *data,
                                          int i,
                                          int j,
+                                         int block_ij,
                                          float restlen,
                                          float stiffness_tension,
                                          float damping_tension,
@@ -168,12 +173,14 @@ bool SIM_mass_spring_force_spring_angular(struct Implicit_Data *data,
                                           float damping);
 /* Bending force, forming a triangle at the base of two structural springs */
 bool SIM_mass_spring_force_spring_bending(
-    struct Implicit_Data *data, int i, int j, float restlen, float kb, float cb);
-/* Angular bending force based on local target vectors */
+    struct Implicit_Data *data, int i, int j, int block_ij, float restlen, float kb, float cb);
+/* Angular bending force based on local target vectors,
+ * uses the three consecutive blocks for (i, j), (j, k) and (i, k) starting at `block_ij`. */
 bool SIM_mass_spring_force_spring_bending_hair(struct Implicit_Data *data,
                                                int i,
                                                int j,
                                                int k,
+                                               int block_ij,
                                                const float target[3],
                                                float stiffness,
                                                float damping);
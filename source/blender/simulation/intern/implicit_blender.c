@@ -34,6 +34,7 @@
 #  include "DNA_texture_types.h"
 
 #  include "BLI_math.h"
+#  include "BLI_task.h"
 #  include "BLI_utildefines.h"
 
 #  include "BKE_cloth.h"
@@ -168,6 +169,123 @@ DO_INLINE void zero_lfvector(float (*to)[3], unsigned int verts)
 {
   memset(to, 0.0f, verts * sizeof(lfVector));
 }
+/* Long vector operations are split in chunks that run in parallel. The chunk boundaries only
+ * depend on the vector length, not on the number of threads, so sums are always accumulated in
+ * the same order and the simulation gives the same result on every run. The loops inside a chunk
+ * work on the flat float arrays, so the compiler can vectorize them.
+ *
+ * Chunks grow for big meshes so there are never more than #LFVECTOR_CHUNKS_MAX of them,
+ * which lets the partial sums of dot products stay on the stack. */
+#  define LFVECTOR_CHUNK_SIZE 1024
+#  define LFVECTOR_CHUNKS_MAX 256
+#  define LFVECTOR_THREADING_LIMIT 4096
+
+typedef struct LongVectorTaskData {
+  float *to;
+  const float *a;
+  const float *b;
+  float bS;
+  /* Number of floats (three per vertex). */
+  unsigned int len;
+  /* Number of vertices in a chunk. */
+  unsigned int chunk_size;
+  /* Partial sum of every chunk, for dot products. */
+  float *r_sums;
+} LongVectorTaskData;
+
+BLI_INLINE unsigned int lfvector_chunk_size(unsigned int verts)
+{
+  return MAX2(LFVECTOR_CHUNK_SIZE, divide_ceil_u(verts, LFVECTOR_CHUNKS_MAX));
+}
+
+BLI_INLINE unsigned int lfvector_chunks_len(unsigned int verts)
+{
+  return divide_ceil_u(verts, lfvector_chunk_size(verts));
+}
+
+BLI_INLINE void lfvector_chunk_range(const LongVectorTaskData *data,
+                                     const int chunk,
+                                     unsigned int *r_start,
+                                     unsigned int *r_end)
+{
+  *r_start = (unsigned int)chunk * data->chunk_size * 3;
+  *r_end = MIN2(*r_start + data->chunk_size * 3, data->len);
+}
+
+static void lfvector_parallel_chunks(LongVectorTaskData *data,
+                                     unsigned int verts,
+                                     TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (verts > LFVECTOR_THREADING_LIMIT);
+  data->len = verts * 3;
+  data->chunk_size = lfvector_chunk_size(verts);
+  BLI_task_parallel_range(0, (int)lfvector_chunks_len(verts), data, func, &settings);
+}
+
+static void lfvector_dot_task_cb(void *__restrict userdata,
+                                 const int chunk,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LongVectorTaskData *data = userdata;
+  const float *a = data->a, *b = data->b;
+  unsigned int start, end;
+  float sum = 0.0f;
+
+  lfvector_chunk_range(data, chunk, &start, &end);
+  for (unsigned int i = start; i < end; i++) {
+    sum += a[i] * b[i];
+  }
+  data->r_sums[chunk] = sum;
+}
+
+static void lfvector_add_task_cb(void *__restrict userdata,
+                                 const int chunk,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LongVectorTaskData *data = userdata;
+  float *to = data->to;
+  const float *a = data->a, *b = data->b;
+  unsigned int start, end;
+
+  lfvector_chunk_range(data, chunk, &start, &end);
+  for (unsigned int i = start; i < end; i++) {
+    to[i] = a[i] + b[i];
+  }
+}
+
+static void lfvector_addS_task_cb(void *__restrict userdata,
+                                  const int chunk,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LongVectorTaskData *data = userdata;
+  float *to = data->to;
+  const float *a = data->a, *b = data->b;
+  const float bS = data->bS;
+  unsigned int start, end;
+
+  lfvector_chunk_range(data, chunk, &start, &end);
+  for (unsigned int i = start; i < end; i++) {
+    to[i] = a[i] + b[i] * bS;
+  }
+}
+
+static void lfvector_sub_task_cb(void *__restrict userdata,
+                                 const int chunk,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LongVectorTaskData *data = userdata;
+  float *to = data->to;
+  const float *a = data->a, *b = data->b;
+  unsigned int start, end;
+
+  lfvector_chunk_range(data, chunk, &start, &end);
+  for (unsigned int i = start; i < end; i++) {
+    to[i] = a[i] - b[i];
+  }
+}
+
 /* multiply long vector with scalar*/
 DO_INLINE void mul_lfvectorS(float (*to)[3],
                              float (*fLongVector)[3],
@@ -197,15 +315,20 @@ DO_INLINE float dot_lfvector(float (*fLongVectorA)[3],
                              float (*fLongVectorB)[3],
                              unsigned int verts)
 {
-  long i = 0;
-  float temp = 0.0;
-  // XXX brecht, disabled this for now (first schedule line was already disabled),
-  // due to non-commutative nature of floating point ops this makes the sim give
-  // different results each time you run it!
-  // schedule(guided, 2)
-  //#pragma omp parallel for reduction(+: temp) if (verts > CLOTH_OPENMP_LIMIT)
-  for (i = 0; i < (long)verts; i++) {
-    temp += dot_v3v3(fLongVectorA[i], fLongVectorB[i]);
+  /* Unlike a parallel reduction, adding the chunk sums in order keeps the result the same on
+   * every run, floating point addition not being associative. */
+  const unsigned int chunks_len = lfvector_chunks_len(verts);
+  float sums[LFVECTOR_CHUNKS_MAX];
+  LongVectorTaskData data = {
+      .a = (const float *)fLongVectorA,
+      .b = (const float *)fLongVectorB,
+      .r_sums = sums,
+  };
+  float temp = 0.0f;
+
+  lfvector_parallel_chunks(&data, verts, lfvector_dot_task_cb);
+  for (unsigned int i = 0; i < chunks_len; i++) {
+    temp += sums[i];
   }
   return temp;
 }
@@ -215,11 +338,12 @@ DO_INLINE void add_lfvector_lfvector(float (*to)[3],
                                      float (*fLongVectorB)[3],
                                      unsigned int verts)
 {
-  unsigned int i = 0;
-
-  for (i = 0; i < verts; i++) {
-    add_v3_v3v3(to[i], fLongVectorA[i], fLongVectorB[i]);
-  }
+  LongVectorTaskData data = {
+      .to = (float *)to,
+      .a = (const float *)fLongVectorA,
+      .b = (const float *)fLongVectorB,
+  };
+  lfvector_parallel_chunks(&data, verts, lfvector_add_task_cb);
 }
 /* A = B + C * float --> for big vector */
 DO_INLINE void add_lfvector_lfvectorS(float (*to)[3],
@@ -228,11 +352,13 @@ DO_INLINE void add_lfvector_lfvectorS(float (*to)[3],
                                       float bS,
                                       unsigned int verts)
 {
-  unsigned int i = 0;
-
-  for (i = 0; i < verts; i++) {
-    VECADDS(to[i], fLongVectorA[i], fLongVectorB[i], bS);
-  }
+  LongVectorTaskData data = {
+      .to = (float *)to,
+      .a = (const float *)fLongVectorA,
+      .b = (const float *)fLongVectorB,
+      .bS = bS,
+  };
+  lfvector_parallel_chunks(&data, verts, lfvector_addS_task_cb);
 }
 /* A = B * float + C * float --> for big vector */
 DO_INLINE void add_lfvectorS_lfvectorS(float (*to)[3],
@@ -266,11 +392,12 @@ DO_INLINE void sub_lfvector_lfvector(float (*to)[3],
                                      float (*fLongVectorB)[3],
                                      unsigned int verts)
 {
-  unsigned int i = 0;
-
-  for (i = 0; i < verts; i++) {
-    sub_v3_v3v3(to[i], fLongVectorA[i], fLongVectorB[i]);
-  }
+  LongVectorTaskData data = {
+      .to = (float *)to,
+      .a = (const float *)fLongVectorA,
+      .b = (const float *)fLongVectorB,
+  };
+  lfvector_parallel_chunks(&data, verts, lfvector_sub_task_cb);
 }
 ///////////////////////////
 // 3x3 matrix
@@ -642,18 +769,152 @@ DO_INLINE void mul_bfmatrix_lfvector(float (*to)[3], fmatrix3x3 *from, lfVector
   del_lfvector(temp);
 }
 
+/* Blocks of every row of a big matrix, so that the rows of a product can be computed in
+ * parallel without two threads writing to the same vertex. Off-diagonal blocks are listed in
+ * the rows of both their vertices, the `transposed` bit marks the lower triangle entry. */
+typedef struct BigMatrixRows {
+  /* Entries of row `i` are `blocks[offsets[i]]` to `blocks[offsets[i + 1] - 1]`. */
+  unsigned int *offsets;
+  /* Block index shifted left by one, or'ed with the transposed bit. */
+  unsigned int *blocks;
+} BigMatrixRows;
+
+/* The rows only depend on the row and column numbers of the blocks, which are the same for all
+ * matrices of the solver. Only the first `num_blocks` off-diagonal blocks are in use. */
+static void bfmatrix_rows_build(BigMatrixRows *rows,
+                                const fmatrix3x3 *matrix,
+                                unsigned int num_blocks)
+{
+  const unsigned int vcount = matrix[0].vcount;
+  const unsigned int blocks_len = vcount + num_blocks;
+  unsigned int *offsets = MEM_calloc_arrayN(vcount + 1, sizeof(*offsets), "bfmatrix rows");
+  unsigned int *blocks = MEM_malloc_arrayN(
+      vcount + 2 * num_blocks, sizeof(*blocks), "bfmatrix row blocks");
+
+  /* Count the entries of every row, shifted by one for the prefix sum below. */
+  for (unsigned int i = 0; i < blocks_len; i++) {
+    offsets[matrix[i].r + 1]++;
+    if (i >= vcount) {
+      offsets[matrix[i].c + 1]++;
+    }
+  }
+  for (unsigned int i = 0; i < vcount; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  /* Fill in block order, so every row is accumulated in the same order as the serial product.
+   * The offsets end up shifted back by one row, the first one is restored afterwards. */
+  for (unsigned int i = 0; i < blocks_len; i++) {
+    blocks[offsets[matrix[i].r]++] = i << 1;
+    if (i >= vcount) {
+      blocks[offsets[matrix[i].c]++] = (i << 1) | 1;
+    }
+  }
+  memmove(offsets + 1, offsets, sizeof(*offsets) * vcount);
+  offsets[0] = 0;
+
+  rows->offsets = offsets;
+  rows->blocks = blocks;
+}
+
+static void bfmatrix_rows_free(BigMatrixRows *rows)
+{
+  MEM_SAFE_FREE(rows->offsets);
+  MEM_SAFE_FREE(rows->blocks);
+}
+
+typedef struct BigMatrixMulData {
+  float (*to)[3];
+  const fmatrix3x3 *matrix;
+  const BigMatrixRows *rows;
+  const lfVector *fLongVector;
+} BigMatrixMulData;
+
+static void mul_bfmatrix_rows_task_cb(void *__restrict userdata,
+                                      const int i,
+                                      const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BigMatrixMulData *data = userdata;
+  const fmatrix3x3 *matrix = data->matrix;
+  const unsigned int *blocks = data->rows->blocks;
+  const unsigned int end = data->rows->offsets[i + 1];
+  /* Same sums as the serial product: `lower` for the transposed blocks, `upper` for the diagonal
+   * block (first in the row) and the upper blocks, added as `lower + upper` at the end. */
+  float upper[3] = {0.0f, 0.0f, 0.0f};
+  float lower[3] = {0.0f, 0.0f, 0.0f};
+
+  for (unsigned int j = data->rows->offsets[i]; j < end; j++) {
+    const fmatrix3x3 *block = &matrix[blocks[j] >> 1];
+    if (blocks[j] & 1) {
+      /* This is the lower triangle of the sparse matrix,
+       * therefore multiplication occurs with transposed submatrices. */
+      muladd_fmatrixT_fvector(lower, block->m, data->fLongVector[block->r]);
+    }
+    else {
+      muladd_fmatrix_fvector(upper, block->m, data->fLongVector[block->c]);
+    }
+  }
+  add_v3_v3v3(data->to[i], lower, upper);
+}
+
+/* SPARSE SYMMETRIC multiply big matrix with long vector, one row per task */
+static void mul_bfmatrix_rows_lfvector(float (*to)[3],
+                                       const fmatrix3x3 *from,
+                                       const BigMatrixRows *rows,
+                                       const lfVector *fLongVector)
+{
+  const unsigned int vcount = from[0].vcount;
+  BigMatrixMulData data = {
+      .to = to,
+      .matrix = from,
+      .rows = rows,
+      .fLongVector = fLongVector,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (vcount > LFVECTOR_THREADING_LIMIT);
+  settings.min_iter_per_thread = LFVECTOR_CHUNK_SIZE;
+  BLI_task_parallel_range(0, (int)vcount, &data, mul_bfmatrix_rows_task_cb, &settings);
+}
+
+typedef struct BigMatrixSubAddData {
+  fmatrix3x3 *to;
+  const fmatrix3x3 *from;
+  const fmatrix3x3 *matrix;
+  float aS, bS;
+} BigMatrixSubAddData;
+
+static void subadd_bfmatrixS_task_cb(void *__restrict userdata,
+                                     const int i,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BigMatrixSubAddData *data = userdata;
+  subadd_fmatrixS_fmatrixS(
+      data->to[i].m, data->from[i].m, data->aS, data->matrix[i].m, data->bS);
+}
+
 /* SPARSE SYMMETRIC sub big matrix with big matrix*/
 /* A -= B * float + C * float --> for big matrix */
 /* VERIFIED */
 DO_INLINE void subadd_bfmatrixS_bfmatrixS(
     fmatrix3x3 *to, fmatrix3x3 *from, float aS, fmatrix3x3 *matrix, float bS)
 {
-  unsigned int i = 0;
+  const unsigned int blocks_len = matrix[0].vcount + matrix[0].scount;
+  BigMatrixSubAddData data = {
+      .to = to,
+      .from = from,
+      .matrix = matrix,
+      .aS = aS,
+      .bS = bS,
+  };
 
   /* process diagonal elements */
-  for (i = 0; i < matrix[0].vcount + matrix[0].scount; i++) {
-    subadd_fmatrixS_fmatrixS(to[i].m, from[i].m, aS, matrix[i].m, bS);
-  }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (blocks_len > LFVECTOR_THREADING_LIMIT);
+  settings.min_iter_per_thread = LFVECTOR_CHUNK_SIZE;
+  BLI_task_parallel_range(0, (int)blocks_len, &data, subadd_bfmatrixS_task_cb, &settings);
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -769,13 +1030,29 @@ BLI_INLINE void root_to_world_m3(Implicit_Data *data,
 
 /* ================================ */
 
+typedef struct FilterTaskData {
+  lfVector *V;
+  fmatrix3x3 *S;
+} FilterTaskData;
+
+static void filter_task_cb(void *__restrict userdata,
+                           const int i,
+                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  FilterTaskData *data = userdata;
+  /* S is block diagonal, every task writes a different vertex. */
+  mul_m3_v3(data->S[i].m, data->V[data->S[i].r]);
+}
+
 DO_INLINE void filter(lfVector *V, fmatrix3x3 *S)
 {
-  unsigned int i = 0;
+  FilterTaskData data = {.V = V, .S = S};
 
-  for (i = 0; i < S[0].vcount; i++) {
-    mul_m3_v3(S[i].m, V[S[i].r]);
-  }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (S[0].vcount > LFVECTOR_THREADING_LIMIT);
+  settings.min_iter_per_thread = LFVECTOR_CHUNK_SIZE;
+  BLI_task_parallel_range(0, (int)S[0].vcount, &data, filter_task_cb, &settings);
 }
 
 /* this version of the CG algorithm does not work very well with partial constraints
@@ -850,6 +1127,7 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 
 static int cg_filtered(lfVector *ldV,
                        fmatrix3x3 *lA,
+                       const BigMatrixRows *lA_rows,
                        lfVector *lB,
                        lfVector *z,
                        fmatrix3x3 *S,
@@ -877,7 +1155,7 @@ static int cg_filtered(lfVector *ldV,
   delta_target = conjgrad_epsilon * conjgrad_epsilon * bnorm2;
 
   /* r = filter(B - A * dV) */
-  mul_bfmatrix_lfvector(AdV, lA, ldV);
+  mul_bfmatrix_rows_lfvector(AdV, lA, lA_rows, ldV);
   sub_lfvector_lfvector(r, lB, AdV, numverts);
   filter(r, S);
 
@@ -900,7 +1178,7 @@ static int cg_filtered(lfVector *ldV,
 #  endif
 
   while (delta_new > delta_target && conjgrad_loopcount < conjgrad_looplimit) {
-    mul_bfmatrix_lfvector(q, lA, c);
+    mul_bfmatrix_rows_lfvector(q, lA, lA_rows, c);
     filter(q, S);
 
     alpha = delta_new / dot_lfvector(c, q, numverts);
@@ -1152,6 +1430,7 @@ static int cg_filtered_pre(lfVector *dv,
 bool SIM_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSolverResult *result)
 {
   unsigned int numverts = data->dFdV[0].vcount;
+  BigMatrixRows rows;
 
   lfVector *dFdXmV = create_lfvector(numverts);
   zero_lfvector(data->dV, numverts);
@@ -1160,7 +1439,10 @@ bool SIM_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 
   subadd_bfmatrixS_bfmatrixS(data->A, data->dFdV, dt, data->dFdX, (dt * dt));
 
-  mul_bfmatrix_lfvector(dFdXmV, data->dFdX, data->V);
+  /* All matrices share the block layout, the rows are used by every product of this step. */
+  bfmatrix_rows_build(&rows, data->A, (unsigned int)data->num_blocks);
+
+  mul_bfmatrix_rows_lfvector(dFdXmV, data->dFdX, &rows, data->V);
 
   add_lfvectorS_lfvectorS(data->B, data->F, dt, dFdXmV, (dt * dt), numverts);
 
@@ -1169,7 +1451,7 @@ bool SIM_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 #  endif
 
   /* Conjugate gradient algorithm to solve Ax=b. */
-  cg_filtered(data->dV, data->A, data->B, data->z, data->S, result);
+  cg_filtered(data->dV, data->A, &rows, data->B, data->z, data->S, result);
 
   // cg_filtered_pre(id->dV, id->A, id->B, id->z, id->S, id->P, id->Pinv, id->bigI);
 
@@ -1182,6 +1464,7 @@ bool SIM_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
   add_lfvector_lfvector(data->Vnew, data->V, data->dV, numverts);
 
   del_lfvector(dFdXmV);
+  bfmatrix_rows_free(&rows);
 
   return result->status == SIM_SOLVER_SUCCESS;
 }
@@ -1283,7 +1566,7 @@ void SIM_mass_spring_set_new_velocity(struct Implicit_Data *data, int index, con
 
 /* -------------------------------- */
 
-static int SIM_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
+int SIM_mass_spring_add_block(Implicit_Data *data, int v1, int v2)
 {
   int s = data->M[0].vcount + data->num_blocks; /* index from array start */
   BLI_assert(s < data->M[0].vcount + data->M[0].scount);
@@ -1774,12 +2057,11 @@ BLI_INLINE bool spring_length(Implicit_Data *data,
 BLI_INLINE void apply_spring(Implicit_Data *data,
                              int i,
                              int j,
+                             int block_ij,
                              const float f[3],
                              const float dfdx[3][3],
                              const float dfdv[3][3])
 {
-  int block_ij = SIM_mass_spring_add_block(data, i, j);
-
   add_v3_v3(data->F[i], f);
   sub_v3_v3(data->F[j], f);
 
@@ -1795,6 +2077,7 @@ BLI_INLINE void apply_spring(Implicit_Data *data,
 bool SIM_mass_spring_force_spring_linear(Implicit_Data *data,
                                          int i,
                                          int j,
+                                         int block_ij,
                                          float restlen,
                                          float stiffness_tension,
                                          float damping_tension,
@@ -1847,14 +2130,14 @@ bool SIM_mass_spring_force_spring_linear(Implicit_Data *data,
   madd_v3_v3fl(f, dir, damping * dot_v3v3(vel, dir));
   dfdv_damp(dfdv, dir, damping);
 
-  apply_spring(data, i, j, f, dfdx, dfdv);
+  apply_spring(data, i, j, block_ij, f, dfdx, dfdv);
 
   return true;
 }
 
 /* See "Stable but Responsive Cloth" (Choi, Ko 2005) */
 bool SIM_mass_spring_force_spring_bending(
-    Implicit_Data *data, int i, int j, float restlen, float kb, float cb)
+    Implicit_Data *data, int i, int j, int block_ij, float restlen, float kb, float cb)
 {
   float extent[3], length, dir[3], vel[3];
 
@@ -1872,7 +2155,7 @@ bool SIM_mass_spring_force_spring_bending(
     /* XXX damping not supported */
     zero_m3(dfdv);
 
-    apply_spring(data, i, j, f, dfdx, dfdv);
+    apply_spring(data, i, j, block_ij, f, dfdx, dfdv);
 
     return true;
   }
@@ -2184,6 +2467,7 @@ bool SIM_mass_spring_force_spring_bending_hair(Implicit_Data *data,
                                                int i,
                                                int j,
                                                int k,
+                                               int block_ij,
                                                const float target[3],
                                                float stiffness,
                                                float damping)
@@ -2195,9 +2479,8 @@ bool SIM_mass_spring_force_spring_bending_hair(Implicit_Data *data,
 
   const float vecnull[3] = {0.0f, 0.0f, 0.0f};
 
-  int block_ij = SIM_mass_spring_add_block(data, i, j);
-  int block_jk = SIM_mass_spring_add_block(data, j, k);
-  int block_ik = SIM_mass_spring_add_block(data, i, k);
+  const int block_jk = block_ij + 1;
+  const int block_ik = block_ij + 2;
 
   world_to_root_v3(data, j, goal, target);
 
@@ -0,0 +1,158 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cmath>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_math.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "SIM_mass_spring.h"
+#include "implicit.h"
+
+#include "PIL_time_utildefines.h"
+
+/* Run the longest tests! */
+//#define MASS_SPRING_RUN_BIG
+
+#define MASS_SPRING_STEPS 10
+
+/* A square cloth of `size * size` quads with structural and shear springs, pinned at one edge and
+ * falling under gravity. */
+static void mass_spring_cloth_grid_test(const int size, const bool use_threads)
+{
+  printf("\n========== STARTING %s (%d vertices, %s) ==========\n",
+         __func__,
+         (size + 1) * (size + 1),
+         use_threads ? "threaded" : "single thread");
+
+  BLI_threadapi_init();
+  BLI_system_num_threads_override_set(use_threads ? 0 : 1);
+  BLI_task_scheduler_init();
+
+  const int verts_num = (size + 1) * (size + 1);
+  const int springs_num = 2 * size * (size + 1) + 2 * size * size;
+  const float spacing = 0.02f;
+  const float mass = 0.3f;
+  const float gravity[3] = {0.0f, 0.0f, -9.81f};
+  const float zero[3] = {0.0f, 0.0f, 0.0f};
+  const float dt = 1.0f / 25.0f / 5.0f;
+
+  int(*springs)[2] = (int(*)[2])MEM_malloc_arrayN(springs_num, sizeof(*springs), __func__);
+  float *springs_restlen = (float *)MEM_malloc_arrayN(springs_num, sizeof(float), __func__);
+  int spring = 0;
+  for (int y = 0; y <= size; y++) {
+    for (int x = 0; x <= size; x++) {
+      const int v = y * (size + 1) + x;
+      if (x < size) {
+        springs[spring][0] = v;
+        springs[spring][1] = v + 1;
+        springs_restlen[spring++] = spacing;
+      }
+      if (y < size) {
+        springs[spring][0] = v;
+        springs[spring][1] = v + size + 1;
+        springs_restlen[spring++] = spacing;
+      }
+      if (x < size && y < size) {
+        springs[spring][0] = v;
+        springs[spring][1] = v + size + 2;
+        springs_restlen[spring++] = spacing * (float)M_SQRT2;
+        springs[spring][0] = v + 1;
+        springs[spring][1] = v + size + 1;
+        springs_restlen[spring++] = spacing * (float)M_SQRT2;
+      }
+    }
+  }
+  EXPECT_EQ(spring, springs_num);
+
+  Implicit_Data *id = SIM_mass_spring_solver_create(verts_num, springs_num);
+  float rest_rot[3][3];
+  unit_m3(rest_rot);
+  for (int i = 0; i < verts_num; i++) {
+    const float co[3] = {(i % (size + 1)) * spacing, (i / (size + 1)) * spacing, 0.0f};
+    SIM_mass_spring_set_vertex_mass(id, i, mass);
+    SIM_mass_spring_set_rest_transform(id, i, rest_rot);
+    SIM_mass_spring_set_motion_state(id, i, co, zero);
+  }
+
+  int iterations = 0;
+  bool success = true;
+
+  TIMEIT_START(mass_spring_step);
+
+  for (int step = 0; step < MASS_SPRING_STEPS; step++) {
+    ImplicitSolverResult result;
+
+    SIM_mass_spring_clear_constraints(id);
+    for (int x = 0; x <= size; x++) {
+      SIM_mass_spring_add_constraint_ndof0(id, x, zero);
+    }
+
+    SIM_mass_spring_clear_forces(id);
+    for (int i = 0; i < verts_num; i++) {
+      SIM_mass_spring_force_gravity(id, i, mass, gravity);
+    }
+    for (int i = 0; i < springs_num; i++) {
+      const int block = SIM_mass_spring_add_block(id, springs[i][0], springs[i][1]);
+      SIM_mass_spring_force_spring_linear(id,
+                                          springs[i][0],
+                                          springs[i][1],
+                                          block,
+                                          springs_restlen[i],
+                                          15.0f / spacing,
+                                          5.0f,
+                                          15.0f / spacing,
+                                          5.0f,
+                                          true,
+                                          false,
+                                          0.0f);
+    }
+
+    success &= SIM_mass_spring_solve_velocities(id, dt, &result);
+    iterations += result.iterations;
+
+    SIM_mass_spring_solve_positions(id, dt);
+    SIM_mass_spring_apply_result(id);
+  }
+
+  TIMEIT_END(mass_spring_step);
+
+  printf("\t%d steps, %d solver iterations\n", MASS_SPRING_STEPS, iterations);
+  EXPECT_TRUE(success);
+
+  SIM_mass_spring_solver_free(id);
+  MEM_freeN(springs);
+  MEM_freeN(springs_restlen);
+
+  BLI_task_scheduler_exit();
+  BLI_system_num_threads_override_set(0);
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(mass_spring, ClothGridNoThread150)
+{
+  mass_spring_cloth_grid_test(150, false);
+}
+
+TEST(mass_spring, ClothGrid150)
+{
+  mass_spring_cloth_grid_test(150, true);
+}
+
+#ifdef MASS_SPRING_RUN_BIG
+TEST(mass_spring, ClothGridNoThread500)
+{
+  mass_spring_cloth_grid_test(500, false);
+}
+
+TEST(mass_spring, ClothGrid500)
+{
+  mass_spring_cloth_grid_test(500, true);
+}
+#endif
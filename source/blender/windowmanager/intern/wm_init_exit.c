@@ -128,6 +128,7 @@
 
 #include "BKE_sound.h"
 #include "BKE_subdiv.h"
+#include "BKE_volume.h"
 
 #include "COM_compositor.h"
 
@@ -573,6 +574,7 @@ void WM_exit_ex(bContext *C, const bool do_python)
 #endif
 
   BKE_subdiv_exit();
+  BKE_volumes_exit();
 
   if (opengl_is_init) {
     BKE_image_free_unused_gpu_textures();